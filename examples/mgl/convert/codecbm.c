@@ -0,0 +1,224 @@
+/****************************************************************************
+*
+*                   SciTech Multi-platform Graphics Library
+*
+*  ========================================================================
+*
+*   Copyright (C) 1991-2004 SciTech Software, Inc. All rights reserved.
+*
+*   This file may be distributed and/or modified under the terms of the
+*   GNU General Public License version 2.0 as published by the Free
+*   Software Foundation and appearing in the file LICENSE.GPL included
+*   in the packaging of this file.
+*
+*   Licensees holding a valid Commercial License for this product from
+*   SciTech Software, Inc. may use this file in accordance with the
+*   Commercial License Agreement provided with the Software.
+*
+*   This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING
+*   THE WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+*   PURPOSE.
+*
+*   See http://www.scitechsoft.com/license/ for information about
+*   the licensing options available and how to purchase a Commercial
+*   License Agreement.
+*
+*   Contact license@scitechsoft.com if any conditions of this licensing
+*   are not clear to you, or you have questions about licensing options.
+*
+*  ========================================================================
+*
+*
+* Language:     ANSI C
+* Environment:  Any
+*
+* Description:  Simple benchmark program to measure the performance of the
+*               MGL image codecs. The input image is loaded repeatedly
+*               with the loader for its format, and 8 bit images are also
+*               saved repeatedly as PCX files, so that changes to the
+*               decoders and encoders can be tracked over time.
+*
+****************************************************************************/
+
+#include "mgraph.h"
+#include "ztimer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef  ISV_LICENSE
+#include "snap/graphics.h"
+#include "isv.c"
+#endif
+
+/*----------------------------- Global Variables --------------------------*/
+
+#define DEF_ITERATIONS  100
+#define TMP_PCX_NAME    "codecbm.pcx"
+
+typedef bitmap_t * (MGLAPIP loader_t)(const char *name,ibool loadPalette);
+
+/*------------------------------ Implementation ---------------------------*/
+
+/****************************************************************************
+REMARKS:
+Display the command line usage information.
+****************************************************************************/
+static void help(void)
+{
+    printf("Usage: codecbm [infile] <iterations>\n");
+    printf("\n");
+    printf("Loads the BMP, PCX, JPEG or PNG file [infile] <iterations> times\n");
+    printf("(default %d) and reports the average decode time. 8 bit images are\n", DEF_ITERATIONS);
+    printf("also encoded as PCX files to measure the PCX encoder.\n");
+    exit(1);
+}
+
+/****************************************************************************
+REMARKS:
+Determine the length of the input file
+****************************************************************************/
+static long fileSize(
+    FILE *f)
+{
+    long    size,oldpos = ftell(f);
+    fseek(f,0,SEEK_END);
+    size = ftell(f);
+    fseek(f,oldpos,SEEK_SET);
+    return size;
+}
+
+/****************************************************************************
+REMARKS:
+Wrapper to load JPEG files with the same interface as the other loaders.
+****************************************************************************/
+static bitmap_t * MGLAPI loadJPEG(
+    const char *name,
+    ibool loadPalette)
+{
+    (void)loadPalette;
+    return MGL_loadJPEG(name,0);
+}
+
+/****************************************************************************
+REMARKS:
+Print the timing results for a benchmark pass.
+****************************************************************************/
+static void report(
+    const char *name,
+    ulong ticks,
+    int iterations,
+    int width,
+    int height)
+{
+    double  ms,mpix;
+
+    if (ticks == 0)
+        ticks = 1;
+    ms = (ticks / 1000.0) / iterations;
+    mpix = ((double)width * height * iterations) / ticks;
+
+    printf("%-8s %8.3f ms/image  %8.2f Mpixels/s\n", name, ms, mpix);
+}
+
+/****************************************************************************
+REMARKS:
+Main program entry point
+****************************************************************************/
+int main(int argc,char *argv[])
+{
+    FILE        *in;
+    ulong       dwSize;
+    int         i,width,height,bits,iterations = DEF_ITERATIONS;
+    pixel_format_t pf;
+    const char  *format;
+    loader_t    loader;
+    bitmap_t    *bitmap;
+    MGLDC       *memDC;
+
+    /* Parse the command line */
+    if (argc < 2 || argc > 3)
+        help();
+    if (argc == 3 && (iterations = atoi(argv[2])) <= 0)
+        help();
+
+    /* Register the ISV license file if desired */
+#ifdef  ISV_LICENSE
+    GA_registerLicense(OemLicense,false);
+#endif
+
+    /* Initialise the MGL */
+    if (MGL_init("..\\..\\..\\",NULL) == 0)
+        MGL_fatalError(MGL_errorMsg(MGL_result()));
+    ZTimerInit();
+
+    /* Determine the format and dimensions of the input file */
+    if ((in = fopen(argv[1],"rb")) == NULL) {
+        printf("Unable to open input file '%s'\n", argv[1]);
+        return -1;
+        }
+    dwSize = fileSize(in);
+    if (MGL_getBitmapSizeExt(in,0,dwSize,&width,&height,&bits,&pf)) {
+        format = "BMP";
+        loader = MGL_loadBitmap;
+        }
+    else if (MGL_getPCXSizeExt(in,0,dwSize,&width,&height,&bits)) {
+        format = "PCX";
+        loader = MGL_loadPCX;
+        }
+    else if (MGL_getJPEGSizeExt(in,0,dwSize,&width,&height,&bits,&pf)) {
+        format = "JPEG";
+        loader = loadJPEG;
+        }
+    else if (MGL_getPNGSizeExt(in,0,dwSize,&width,&height,&bits,&pf)) {
+        format = "PNG";
+        loader = MGL_loadPNG;
+        }
+    else {
+        printf("Unknown input bitmap format!\n");
+        return -1;
+        }
+    fclose(in);
+    printf("%s: %d x %d x %d %s image, %lu bytes\n\n", argv[1], width, height, bits, format, dwSize);
+
+    /* Time the decoder for the image format */
+    LZTimerOn();
+    for (i = 0; i < iterations; i++) {
+        if ((bitmap = loader(argv[1],true)) == NULL)
+            MGL_fatalError(MGL_errorMsg(MGL_result()));
+        MGL_unloadBitmap(bitmap);
+        }
+    LZTimerOff();
+    report(format,LZTimerCount(),iterations,width,height);
+
+    /* Time the PCX encoder for 8 bit images */
+    if (bits == 8) {
+        if ((memDC = MGL_createMemoryDC(width,height,8,NULL)) == NULL)
+            MGL_fatalError(MGL_errorMsg(MGL_result()));
+        if ((bitmap = loader(argv[1],true)) == NULL)
+            MGL_fatalError(MGL_errorMsg(MGL_result()));
+        MGL_putBitmap(memDC,0,0,bitmap,MGL_REPLACE_MODE);
+        MGL_unloadBitmap(bitmap);
+        LZTimerOn();
+        for (i = 0; i < iterations; i++) {
+            if (!MGL_savePCXFromDC(memDC,TMP_PCX_NAME,0,0,width,height))
+                MGL_fatalError(MGL_errorMsg(MGL_result()));
+            }
+        LZTimerOff();
+        report("PCX save",LZTimerCount(),iterations,width,height);
+
+        /* Time decoding of the PCX file we just wrote */
+        LZTimerOn();
+        for (i = 0; i < iterations; i++) {
+            if ((bitmap = MGL_loadPCX(TMP_PCX_NAME,true)) == NULL)
+                MGL_fatalError(MGL_errorMsg(MGL_result()));
+            MGL_unloadBitmap(bitmap);
+            }
+        LZTimerOff();
+        report("PCX load",LZTimerCount(),iterations,width,height);
+        MGL_destroyDC(memDC);
+        remove(TMP_PCX_NAME);
+        }
+
+    MGL_exit();
+    return 0;
+}
@@ -426,6 +426,14 @@ typedef struct {
     rVecs   colorPatt;      /* Color pattern filled vectors (all ROP's) */
     } vecs;
 
+/* Software buffer heap manager for DC's without a hardware buffer manager */
+
+typedef struct _MGL_bufHeap MGL_bufHeap;
+
+/* Inverse color map for mapping RGB colors to a color index palette */
+
+typedef struct _MGL_invCMap MGL_invCMap;
+
 /* Device Context structure */
 
 struct internalDevCtx_t {
@@ -465,6 +473,8 @@ struct internalDevCtx_t {
     GA_HGLRC        rc;                 /* SNAP OpenGL rendering context            */
     MGLVisual       cntVis;             /* Current MGL OpenGL Visual                */
     MGLBUF          *offBuf;            /* Offscreen device context buffer          */
+    MGL_bufHeap     *bufHeap;           /* Software buffer heap (NULL if none)      */
+    MGL_invCMap     *invCMap;           /* Cached inverse color map for palette     */
 
     /* User supplied viewport, viewport origin, clip rectangle and clip regions */
     rect_t          viewPort;           /* Current user supplied viewport rectangle */
@@ -484,6 +494,10 @@ struct internalDevCtx_t {
     rectFX          clipRectScreenFX;   /* Fixed point final clipping rectangle     */
     region_t        *clipRegionScreen;  /* Final screen space clip region           */
 
+    /* Damage tracking for presenting only the modified parts of the DC */
+    region_t        *dirtyRegion;       /* Screen space dirty region (NULL if off)  */
+    rect_t          dirtyRect;          /* Pending dirty rectangle being coalesced  */
+
     /* Internal device driver variables */
     GA_trap         tr;                 /* Current trapezoid parameters             */
     arc_coords_t    ac;                 /* Coordinates of last arc operation        */
@@ -181,7 +181,10 @@ Defines the MGL dithering modes, used when blitting RGB images to 8, 15
 and 16 bits per pixel device context. If dithering is enabled, the blit
 operation will dither the resulting image to produce the best quality. When
 dithering is disabled, the blit operation uses the closest color which
-has less quality but is faster.
+has less quality but is faster. Error diffusion dithering uses a
+Floyd-Steinberg filter, which is slower than the ordered halftone dither
+but gives better results for photographic images on low color depth
+displays.
 
 Note:   The closest color method is fastest when the destination device
         context is a 15 or 16 bits per pixel bitmap. However when the
@@ -192,10 +195,16 @@ Note:   Dithering is /on/ by default in the MGL.
 
 HEADER:
 mgraph.h
+
+MEMBERS:
+MGL_DITHER_OFF      - Use the closest color
+MGL_DITHER_ON       - Use an ordered halftone dither
+MGL_DITHER_DIFFUSE  - Use Floyd-Steinberg error diffusion
 ****************************************************************************/
 typedef enum {
     MGL_DITHER_OFF,
-    MGL_DITHER_ON
+    MGL_DITHER_ON,
+    MGL_DITHER_DIFFUSE
     } MGL_ditherModes;
 
 /****************************************************************************
@@ -1011,11 +1020,15 @@ Currently only two types, which are blended and non Blended. Used by
 the MGL_setFontBlendMode function, and only affects TrueType or Adobe
 Type 1 fonts loaded with anti-aliasing enabled.
 
+Anti-aliased glyphs are drawn with 17 levels of coverage on RGB surfaces
+that can be linearly accessed, and with four levels of coverage using the
+anti-aliasing palette otherwise.
+
 HEADER:
 mgraph.h
 
 MEMBERS:
-MGL_AA_NORMAL     - Four level antialiasing, between foreground and background.
+MGL_AA_NORMAL     - Antialiasing blended between foreground and background.
 MGL_AA_RGBBLEND   - Blends antialiasing with contents of screen. RGB only.
 ****************************************************************************/
 typedef enum {
@@ -1259,6 +1272,165 @@ typedef enum {
     MGL_BLT_ANY_COLOR_KEY               = MGL_BLT_ANY_SINGLE_COLOR_KEY | MGL_BLT_ANY_RANGE_COLOR_KEY
     } MGL_bitBltFxFlagsType;
 
+/****************************************************************************
+REMARKS:
+Defines the filters available for the MGL_resampleBlt family of functions.
+These functions stretch images with proper filtering, and produce much
+higher quality results than the stretching done by the MGL_stretchBlt
+family of functions, especially when reducing images by large factors.
+
+The MGL_RESAMPLE_NEAREST filter picks the nearest source pixel, and is
+equivalent to a regular stretch blit.
+
+The MGL_RESAMPLE_BILINEAR filter linearly interpolates between the four
+nearest source pixels. This is the fastest filter and is a good choice for
+enlarging images, but will alias when reducing images by more than a
+factor of two.
+
+The MGL_RESAMPLE_BOX filter averages all the source pixels that are
+covered by each destination pixel. This is the fastest filter for
+reducing images by large factors (ie: generating thumbnails) and never
+aliases, but produces blocky results when enlarging images.
+
+The MGL_RESAMPLE_BICUBIC filter uses a Catmull-Rom cubic spline, which
+produces sharper results than the bilinear or box filters at some extra
+cost.
+
+The MGL_RESAMPLE_LANCZOS3 filter uses a three lobed Lanczos windowed sinc
+filter. This produces the highest quality results, but is also the
+slowest filter and is intended for offline processing.
+
+The MGL_RESAMPLE_FAST filter selects the box filter when reducing and the
+bilinear filter when enlarging, independently for each axis.
+
+HEADER:
+mgraph.h
+
+MEMBERS:
+MGL_RESAMPLE_NEAREST    - Nearest pixel, no filtering
+MGL_RESAMPLE_BILINEAR   - Bilinear interpolation
+MGL_RESAMPLE_BOX        - Box filter (area average)
+MGL_RESAMPLE_BICUBIC    - Catmull-Rom bicubic filter
+MGL_RESAMPLE_LANCZOS3   - Lanczos three lobed windowed sinc filter
+MGL_RESAMPLE_FAST       - Box when reducing, bilinear when enlarging
+****************************************************************************/
+typedef enum {
+    MGL_RESAMPLE_NEAREST,
+    MGL_RESAMPLE_BILINEAR,
+    MGL_RESAMPLE_BOX,
+    MGL_RESAMPLE_BICUBIC,
+    MGL_RESAMPLE_LANCZOS3,
+    MGL_RESAMPLE_FAST
+    } MGL_resampleFilterType;
+
+/****************************************************************************
+REMARKS:
+Defines the types of resources that can be loaded in the background with
+the MGL_loadAsync family of functions. The type selects which MGL resource
+loader is used, and the type of the resource handed back in the
+async_load_t structure.
+
+HEADER:
+mgraph.h
+
+MEMBERS:
+MGL_ASYNC_BITMAP    - Windows BMP file loaded with MGL_loadBitmap (bitmap_t)
+MGL_ASYNC_PCX       - PCX file loaded with MGL_loadPCX (bitmap_t)
+MGL_ASYNC_JPEG      - JPEG file loaded with MGL_loadJPEG (bitmap_t)
+MGL_ASYNC_PNG       - PNG file loaded with MGL_loadPNG (bitmap_t)
+MGL_ASYNC_ICON      - Icon file loaded with MGL_loadIcon (icon_t)
+MGL_ASYNC_CURSOR    - Cursor file loaded with MGL_loadCursor (cursor_t)
+MGL_ASYNC_FONT      - Font file loaded with MGL_loadFont (font_t)
+MGL_ASYNC_SURFACE   - Surface file loaded with MGL_loadSurface (bitmap_t)
+****************************************************************************/
+typedef enum {
+    MGL_ASYNC_BITMAP,
+    MGL_ASYNC_PCX,
+    MGL_ASYNC_JPEG,
+    MGL_ASYNC_PNG,
+    MGL_ASYNC_ICON,
+    MGL_ASYNC_CURSOR,
+    MGL_ASYNC_FONT,
+    MGL_ASYNC_SURFACE
+    } MGL_asyncLoadType;
+
+/****************************************************************************
+REMARKS:
+Structure describing a completed asynchronous resource load, handed back
+to the application by MGL_pollAsyncLoads and MGL_getAsyncLoad.
+
+HEADER:
+mgraph.h
+
+MEMBERS:
+id          - Identifier returned when the load was queued
+type        - Type of resource loaded (MGL_asyncLoadType)
+resource    - Pointer to the loaded resource, or NULL if the load failed
+result      - Result code for the load (grOK on success)
+cookie      - Cookie passed when the load was queued
+****************************************************************************/
+typedef struct {
+    ulong           id;
+    int             type;
+    void            *resource;
+    int             result;
+    void            *cookie;
+    } async_load_t;
+
+/****************************************************************************
+REMARKS:
+Structure returned by MGL_getImageCacheStats describing the usage of the
+decoded image cache.
+
+HEADER:
+mgraph.h
+
+MEMBERS:
+hits        - Number of loads that were satisfied from the cache
+misses      - Number of loads that had to decode the image from disk
+evictions   - Number of unused images freed to stay within the budget
+bytesUsed   - Number of bytes of memory used by all cached images
+maxBytes    - Memory budget set with MGL_setImageCacheSize
+numImages   - Number of images in the cache
+numUnused   - Number of cached images that are not currently in use
+****************************************************************************/
+typedef struct {
+    ulong           hits;
+    ulong           misses;
+    ulong           evictions;
+    ulong           bytesUsed;
+    ulong           maxBytes;
+    int             numImages;
+    int             numUnused;
+    } imagecache_stats_t;
+
+/****************************************************************************
+REMARKS:
+Structure returned by MGL_getGlyphCacheStats describing the usage of the
+TrueType glyph cache.
+
+HEADER:
+mgraph.h
+
+MEMBERS:
+hits        - Number of glyphs that were found in the cache
+misses      - Number of glyphs that had to be rasterised
+evictions   - Number of glyphs freed to stay within the budget
+bytesUsed   - Number of bytes of memory used by the cache
+maxBytes    - Memory budget set with MGL_setGlyphCacheSize
+numGlyphs   - Number of glyphs in the cache
+numPages    - Number of atlas pages allocated for the glyphs
+****************************************************************************/
+typedef struct {
+    ulong           hits;
+    ulong           misses;
+    ulong           evictions;
+    ulong           bytesUsed;
+    ulong           maxBytes;
+    int             numGlyphs;
+    int             numPages;
+    } glyphcache_stats_t;
+
 /****************************************************************************
 REMARKS:
 Defines the flags for the types of direct surface access provided.
@@ -1604,6 +1776,67 @@ typedef enum {
     MGL_BUF_NOSYSMEM                = 0x00000020
     } MGL_bufferFlagsType;
 
+/****************************************************************************
+REMARKS:
+Defines the scanline filters that MGL_savePNGFromDCOpt is allowed to use
+when saving a PNG file. The values can be combined, in which case the
+filter that works best for each scanline is chosen from the allowed set.
+MGL_PNG_FILTER_DEFAULT lets the PNG library choose, which uses no filtering
+for palette based images and all filters for everything else.
+
+Palette based and grayscale images with less than 8 bits per pixel rarely
+compress better with filtering, while filtering usually helps a great deal
+for RGB images.
+
+HEADER:
+mgraph.h
+
+MEMBERS:
+MGL_PNG_FILTER_DEFAULT  - Use the default filters for the image type
+MGL_PNG_FILTER_NONE     - Store scanlines without filtering
+MGL_PNG_FILTER_SUB      - Difference against the pixel to the left
+MGL_PNG_FILTER_UP       - Difference against the pixel above
+MGL_PNG_FILTER_AVG      - Difference against the average of left and above
+MGL_PNG_FILTER_PAETH    - Difference against the Paeth predictor
+MGL_PNG_FILTER_ALL      - Allow all the filters
+****************************************************************************/
+typedef enum {
+    MGL_PNG_FILTER_DEFAULT          = 0x00,
+    MGL_PNG_FILTER_NONE             = 0x08,
+    MGL_PNG_FILTER_SUB              = 0x10,
+    MGL_PNG_FILTER_UP               = 0x20,
+    MGL_PNG_FILTER_AVG              = 0x40,
+    MGL_PNG_FILTER_PAETH            = 0x80,
+    MGL_PNG_FILTER_ALL              = 0xF8
+    } MGL_pngFilterType;
+
+/****************************************************************************
+REMARKS:
+Defines the speed presets for MGL_savePNGFromDCOpt. A preset selects both
+the compression level and the filters, overriding the values in the
+pngsaveopts_t structure. Use MGL_PNG_SPEED_CUSTOM to use the compression
+level and filters from the structure instead. When a preset is used,
+palette based images and images with less than 8 bits per pixel are always
+saved without filtering.
+
+HEADER:
+mgraph.h
+
+MEMBERS:
+MGL_PNG_SPEED_CUSTOM    - Use the compression level and filters given
+MGL_PNG_SPEED_FASTEST   - Compression level 1 with the sub filter
+MGL_PNG_SPEED_FAST      - Compression level 3 with the sub and up filters
+MGL_PNG_SPEED_NORMAL    - Compression level 6 with all filters
+MGL_PNG_SPEED_SMALLEST  - Compression level 9 with all filters
+****************************************************************************/
+typedef enum {
+    MGL_PNG_SPEED_CUSTOM,
+    MGL_PNG_SPEED_FASTEST,
+    MGL_PNG_SPEED_FAST,
+    MGL_PNG_SPEED_NORMAL,
+    MGL_PNG_SPEED_SMALLEST
+    } MGL_pngSpeedType;
+
 /****************************************************************************
 REMARKS:
 Type definition for 8-bit signed values used in MGL.
@@ -2807,6 +3040,7 @@ dstBlendFunc    - Current dest alpha blend function. Will be a value from
 alphaValue      - Current constant alpha value between 0 and 255.
 planeMask       - Current plane mask to determine which bits get updated.
 ditherMode      - Current dither mode for blitting RGB bitmaps
+linearLight     - True if blending and resampling is done in linear light
 ts              - Current text drawing attributes
 ****************************************************************************/
 typedef struct {
@@ -2836,6 +3070,7 @@ typedef struct {
     uchar           alphaValue;
     ulong           planeMask;
     int             ditherMode;
+    ibool           linearLight;
     text_settings_t ts;
     } attributes_t;
 
@@ -3070,6 +3305,75 @@ typedef struct {
     } MGLBUF;
 #pragma pack(4)
 
+/****************************************************************************
+REMARKS:
+Structure returned by MGL_getBufferHeapInfo, which describes the current
+state of the software buffer heap for a device context. The free block
+information can be used to determine how fragmented the heap is, and the
+hit, miss and eviction counts show how well the heap is performing.
+
+HEADER:
+mgraph.h
+
+MEMBERS:
+heapSize        - Total size of the buffer heap in bytes
+bytesFree       - Total number of free bytes in the heap
+largestFree     - Size of the largest free block in the heap in bytes
+freeBlocks      - Number of separate free blocks in the heap
+numBuffers      - Number of buffers allocated for the device context
+numResident     - Number of buffers currently resident in the heap
+hits            - Number of uses of buffers that were resident in the heap
+misses          - Number of uses of buffers that were paged out
+evictions       - Number of buffers paged out to make room in the heap
+compactions     - Number of times the heap has been compacted
+bytesMoved      - Total number of bytes moved compacting the heap
+****************************************************************************/
+typedef struct {
+    long        heapSize;
+    long        bytesFree;
+    long        largestFree;
+    int         freeBlocks;
+    int         numBuffers;
+    int         numResident;
+    ulong       hits;
+    ulong       misses;
+    ulong       evictions;
+    ulong       compactions;
+    ulong       bytesMoved;
+    } bufheapinfo_t;
+
+/****************************************************************************
+REMARKS:
+Structure passed to MGL_savePNGFromDCOpt to control how the PNG file is
+compressed. The compression level ranges from 0 (no compression) to 9
+(best compression), and a value of -1 selects the default level of 6.
+
+If the parallel flag is set and multi-threaded blitting has been enabled
+with MGL_setBltThreads, large images are split into groups of scanlines
+that are filtered and compressed on all the worker threads at the same
+time. The compressed groups are stitched back together into a single
+standard PNG data stream, so the resulting file can be read by any PNG
+decoder. The file will be very slightly larger than one compressed on a
+single thread.
+
+HEADER:
+mgraph.h
+
+MEMBERS:
+speed               - Speed preset to use (MGL_pngSpeedType)
+compressionLevel    - Compression level (-1 for default, 0 to 9)
+filters             - Allowed scanline filters (MGL_pngFilterType)
+savePalette         - True to save the palette for color index images
+parallel            - True to compress on multiple threads if enabled
+****************************************************************************/
+typedef struct {
+    int         speed;
+    int         compressionLevel;
+    int         filters;
+    ibool       savePalette;
+    ibool       parallel;
+    } pngsaveopts_t;
+
 /****************************************************************************
 REMARKS:
 Structure representing the set of file I/O functions that can be overridden
@@ -3103,6 +3407,16 @@ typedef struct {
     size_t  (*fwrite)(const void *ptr,size_t size,size_t n,FILE *f);
     } fileio_t;
 
+/****************************************************************************
+REMARKS:
+Opaque structure representing a pack file archive opened with
+MGL_openPackFile.
+
+HEADER:
+mgraph.h
+****************************************************************************/
+typedef struct packfile_t packfile_t;
+
 struct window_t;
 
 /* {partOf:MGL_wmPushWindowEventHandler} */
@@ -3327,6 +3641,7 @@ int     MGLAPI MGL_findMode(int xRes,int yRes,int bitsPerPixel);
 ibool   MGLAPI MGL_addCustomMode(int xRes,int yRes,int bitsPerPixel);
 void    MGLAPI MGL_exit(void);
 void    MGLAPI MGL_setBufSize(unsigned size);
+void    MGLAPI MGL_setBltThreads(int numThreads,long minPixels);
 void    MGLAPI MGL_fatalError(const char *msg, ...);
 int     MGLAPI MGL_result(void);
 void    MGLAPI MGL_setResult(int result);
@@ -3419,6 +3734,8 @@ color_t MGLAPI MGL_getBackColor(void);
 color_t MGLAPI MGL_defaultColor(void);
 void    MGLAPI MGL_setDitherMode(int mode);
 int     MGLAPI MGL_getDitherMode(void);
+void    MGLAPI MGL_setLinearLightMode(ibool enable);
+ibool   MGLAPI MGL_getLinearLightMode(void);
 color_t MGLAPI MGL_packColor(pixel_format_t *pf,uchar R,uchar G,uchar B);
 color_t MGLAPI MGL_packColorExt(pixel_format_t *pf,uchar A,uchar R,uchar G,uchar B);
 void    MGLAPI MGL_unpackColor(pixel_format_t *pf,color_t color,uchar *R,uchar *G,uchar *B);
@@ -3439,6 +3756,10 @@ void    MGLAPI MGL_setPaletteSnowLevel(MGLDC *dc,int level);
 int     MGLAPI MGL_getPaletteSnowLevel(MGLDC *dc);
 ibool   MGLAPI MGL_checkIdentityPalette(ibool enable);
 void    MGLAPI MGL_mapToPalette(MGLDC *dc,palette_t *pal);
+bitmap_t * MGLAPI MGL_mapBitmapToPalette(MGLDC *dc,const bitmap_t *bitmap);
+int     MGLAPI MGL_quantizePalette(bitmap_t **bitmaps,int numBitmaps,palette_t *pal,int numColors);
+bitmap_t * MGLAPI MGL_quantizeBitmap(const bitmap_t *bitmap,const palette_t *pal,int numColors);
+int     MGLAPI MGL_quantizeDC(MGLDC *dc,palette_t *pal,int numColors);
 ibool   MGLAPI MGL_setGammaRamp(MGLDC *dc,palette_ext_t *gamma,int num,int index,ibool waitVRT);
 ibool   MGLAPI MGL_getGammaRamp(MGLDC *dc,palette_ext_t *gamma,int num,int index);
 void    MGLAPI MGL_setFontAntiAliasPalette(color_t colorfg, color_t color75, color_t color50, color_t color25, color_t colorbg);
@@ -3673,12 +3994,30 @@ ibool   MGLAPI MGL_bitBltFxTestBuf(MGLDC *dst,MGLBUF *src,bltfx_t *fx);
 void    MGLAPI MGL_bitBltFxCoord(MGLDC *dst,MGLDC *src,int left,int top,int right,int bottom,int dstLeft,int dstTop,bltfx_t *fx);
 void    MGLAPI MGL_stretchBltCoord(MGLDC *dst,MGLDC *src,int left,int top,int right,int bottom,int dstLeft,int dstTop,int dstRight,int dstBottom,int op);
 void    MGLAPI MGL_stretchBltFxCoord(MGLDC *dst,MGLDC *src,int left,int top,int right,int bottom,int dstLeft,int dstTop,int dstRight,int dstBottom,bltfx_t *fx);
+void    MGLAPI MGL_resampleBltCoord(MGLDC *dst,MGLDC *src,int left,int top,int right,int bottom,int dstLeft,int dstTop,int dstRight,int dstBottom,int filter,int op);
 void    MGLAPI MGL_copyPageCoord(MGLDC *dc,int srcPage,int left,int top,int right,int bottom,int dstLeft,int dstTop,int op);
 void    MGLAPI MGL_getDivotCoord(MGLDC *dc,int left,int top,int right,int bottom,void *divot);
 void    MGLAPI MGL_putDivot(MGLDC *dc,void *divot);
 long    MGLAPI MGL_divotSizeCoord(MGLDC *dc,int left,int top,int right,int bottom);
 void    MGLAPI MGL_putMonoImage(MGLDC *dc,int x,int y,int width,int byteWidth,int height,void *image);
 
+/* Damage tracking and dirty rectangle presentation */
+
+ibool   MGLAPI MGL_setDirtyTracking(MGLDC *dc,ibool enable);
+void    MGLAPI MGL_markDirtyCoord(MGLDC *dc,int left,int top,int right,int bottom);
+void    MGLAPI MGL_getDirtyRegion(MGLDC *dc,region_t *region);
+void    MGLAPI MGL_clearDirty(MGLDC *dc);
+void    MGLAPI MGL_bitBltDirty(MGLDC *dst,MGLDC *src,int dstLeft,int dstTop,int op);
+
+/* Blit and fill command batching */
+
+ibool   MGLAPI MGL_beginBatch(MGLDC *dc);
+void    MGLAPI MGL_endBatch(void);
+void    MGLAPI MGL_batchFillRectCoord(MGLDC *dc,int left,int top,int right,int bottom,color_t color,int op);
+void    MGLAPI MGL_batchPutBitmap(MGLDC *dc,int x,int y,const bitmap_t *bitmap,int op);
+void    MGLAPI MGL_batchPutBitmapSection(MGLDC *dc,int left,int top,int right,int bottom,int dstLeft,int dstTop,const bitmap_t *bitmap,int op);
+void    MGLAPI MGL_batchBitBltCoord(MGLDC *dst,MGLDC *src,int left,int top,int right,int bottom,int dstLeft,int dstTop,int op);
+
 /* Bitmap drawing support */
 
 void    MGLAPI MGL_putBitmap(MGLDC *dc,int x,int y,const bitmap_t *bitmap,int op);
@@ -3696,6 +4035,8 @@ void    MGLAPI MGL_stretchBitmap(MGLDC *dc,int left,int top,int right,int bottom
 void    MGLAPI MGL_stretchBitmapSection(MGLDC *dc,int left,int top,int right,int bottom,int dstLeft,int dstTop,int dstRight,int dstBottom,const bitmap_t *bitmap,int op);
 void    MGLAPI MGL_stretchBitmapFx(MGLDC *dc,int dstLeft,int dstTop,int dstRight,int dstBottom,const bitmap_t *bitmap,bltfx_t *fx);
 void    MGLAPI MGL_stretchBitmapFxSection(MGLDC *dc,int left,int top,int right,int bottom,int dstLeft,int dstTop,int dstRight,int dstBottom,const bitmap_t *bitmap,bltfx_t *fx);
+void    MGLAPI MGL_resampleBitmap(MGLDC *dc,int dstLeft,int dstTop,int dstRight,int dstBottom,const bitmap_t *bitmap,int filter,int op);
+void    MGLAPI MGL_resampleBitmapSection(MGLDC *dc,int left,int top,int right,int bottom,int dstLeft,int dstTop,int dstRight,int dstBottom,const bitmap_t *bitmap,int filter,int op);
 void    MGLAPI MGL_putIcon(MGLDC *dc,int x,int y,const icon_t *icon);
 
 /* Lightweight offscreen buffer support */
@@ -3708,6 +4049,9 @@ void    MGLAPI MGL_copyToBuffer(MGLDC *dc,int left,int top,int right,int bottom,
 void    MGLAPI MGL_copyBitmapToBuffer(bitmap_t *bitmap,int left,int top,int right,int bottom,int dstLeft,int dstTop,MGLBUF *buf);
 void    MGLAPI MGL_updateBufferCache(MGLBUF *buf);
 void    MGLAPI MGL_updateFromBufferCache(MGLBUF *buf);
+ibool   MGLAPI MGL_createBufferHeap(MGLDC *dc,long heapSize);
+long    MGLAPI MGL_compactBufferHeap(MGLDC *dc);
+ibool   MGLAPI MGL_getBufferHeapInfo(MGLDC *dc,bufheapinfo_t *info);
 void    MGLAPI MGL_putBuffer(MGLDC *dc,int x,int y,MGLBUF *buf,int op);
 void    MGLAPI MGL_putBufferSection(MGLDC *dc,int left,int top,int right,int bottom,int dstLeft,int dstTop,MGLBUF *buf,int op);
 void    MGLAPI MGL_putBufferSrcTrans(MGLDC *dc,int x,int y,MGLBUF *buf,color_t transparent,int op);
@@ -3776,6 +4120,9 @@ void    MGLAPI MGL_getHalfTonePalette(palette_t *pal);
 uchar   MGLAPI MGL_halfTonePixel(int x,int y,uchar R,uchar G,uchar B);
 ushort  MGLAPI MGL_halfTonePixel555(int x,int y,uchar R,uchar G,uchar B);
 ushort  MGLAPI MGL_halfTonePixel565(int x,int y,uchar R,uchar G,uchar B);
+void    MGLAPI MGL_halfToneSpan(uchar *dst,const M_uint32 *src,int x,int y,int count);
+void    MGLAPI MGL_halfToneSpan555(ushort *dst,const M_uint32 *src,int x,int y,int count);
+void    MGLAPI MGL_halfToneSpan565(ushort *dst,const M_uint32 *src,int x,int y,int count);
 
 /* Font loading and unloading functions */
 
@@ -3790,6 +4137,17 @@ void    MGLAPI MGL_closeFontLib(font_lib_t *lib);
 typedef ibool (MGLAPIP enumfntcallback_t)(const font_info_t *info, void *cookie);
 void    MGLAPI MGL_enumerateFonts(enumfntcallback_t callback, void *cookie);
 
+/* TrueType glyph cache */
+
+void    MGLAPI MGL_setGlyphCacheSize(ulong maxBytes);
+void    MGLAPI MGL_flushGlyphCache(void);
+void    MGLAPI MGL_getGlyphCacheStats(glyphcache_stats_t *stats,ibool reset);
+
+/* Text run cache */
+
+void    MGLAPI MGL_setTextRunCacheSize(ulong maxBytes);
+void    MGLAPI MGL_flushTextRunCache(void);
+
 /* Obsolete compatibility bitmap font loading functions */
 
 font_t * MGLAPI MGL_loadFont(const char *fontname);
@@ -3824,6 +4182,8 @@ ibool   MGLAPI MGL_loadBitmapIntoDCExt(MGLDC *dc,FILE *f,ulong dwOffset,ulong dw
 ibool   MGLAPI MGL_saveBitmapFromDC(MGLDC *dc,const char *bitmapName,int left,int top,int right,int bottom);
 bitmap_t * MGLAPI MGL_getBitmapFromDC(MGLDC *dc,int left,int top,int right,int bottom,ibool savePalette);
 bitmap_t * MGLAPI MGL_buildMonoMask(bitmap_t *bitmap,color_t transparent);
+bitmap_t * MGLAPI MGL_mapBitmap(const char *bitmapName,ibool loadPalette);
+void    MGLAPI MGL_unmapBitmap(bitmap_t *bitmap);
 
 /* PCX bitmap loading, unloading and saving */
 
@@ -3846,6 +4206,14 @@ ibool MGLAPI MGL_getJPEGSizeExt(FILE *f,ulong dwOffset,ulong dwSize,int *width,i
 ibool MGLAPI MGL_loadJPEGIntoDC(MGLDC *dc,const char *JPEGName,int dstLeft,int dstTop,int num8BitColors);
 ibool MGLAPI MGL_loadJPEGIntoDCExt(MGLDC *dc,FILE *f,ulong dwOffset,ulong dwSize,int dstLeft,int dstTop,int num8BitColors);
 ibool MGLAPI MGL_saveJPEGFromDC(MGLDC *dc,const char *JPEGName,int left,int top,int right,int bottom,int quality);
+bitmap_t * MGLAPI MGL_loadJPEGScaled(const char *JPEGName,int width,int height);
+bitmap_t * MGLAPI MGL_loadJPEGScaledExt(FILE *f,ulong dwOffset,ulong dwSize,int width,int height);
+ibool MGLAPI MGL_loadJPEGIntoDCScaled(MGLDC *dc,const char *JPEGName,int dstLeft,int dstTop,int dstRight,int dstBottom);
+ibool MGLAPI MGL_loadJPEGIntoDCScaledExt(MGLDC *dc,FILE *f,ulong dwOffset,ulong dwSize,int dstLeft,int dstTop,int dstRight,int dstBottom);
+/* {partOf:MGL_streamJPEG} */
+typedef ibool (MGLAPIP bandcallback_t)(const bitmap_t *band,int top,void *cookie);
+ibool MGLAPI MGL_streamJPEG(const char *JPEGName,int bandHeight,bandcallback_t callback,void *cookie);
+ibool MGLAPI MGL_streamJPEGExt(FILE *f,ulong dwOffset,ulong dwSize,int bandHeight,bandcallback_t callback,void *cookie);
 
 /* PNG bitmap loading, unloading and saving */
 
@@ -3858,6 +4226,47 @@ ibool MGLAPI MGL_loadPNGIntoDC(MGLDC *dc,const char *PNGName,int dstLeft,int dst
 ibool MGLAPI MGL_loadPNGIntoDCExt(MGLDC *dc,FILE *f,ulong dwOffset,ulong dwSize,int dstLeft,int dstTop,ibool loadPalette);
 ibool MGLAPI MGL_savePNGFromDC(MGLDC *dc,const char *PNGName,int left,int top,int right,int bottom);
 ibool MGLAPI MGL_savePNGFromDCExt(MGLDC *dc,const char *PNGName,int left,int top,int right,int bottom,ibool savePalette);
+ibool MGLAPI MGL_savePNGFromDCOpt(MGLDC *dc,const char *PNGName,int left,int top,int right,int bottom,const pngsaveopts_t *opts);
+ibool MGLAPI MGL_streamPNG(const char *PNGName,int bandHeight,bandcallback_t callback,void *cookie);
+ibool MGLAPI MGL_streamPNGExt(FILE *f,ulong dwOffset,ulong dwSize,int bandHeight,bandcallback_t callback,void *cookie);
+
+/* TIFF bitmap loading, unloading and saving */
+
+bitmap_t * MGLAPI MGL_loadTIFF(const char *TIFFName);
+ibool MGLAPI MGL_getTIFFSize(const char *TIFFName,int *width,int *height,int *bitsPerPixel,pixel_format_t *pf);
+ibool MGLAPI MGL_loadTIFFIntoDC(MGLDC *dc,const char *TIFFName,int dstLeft,int dstTop);
+ibool MGLAPI MGL_saveTIFFFromDC(MGLDC *dc,const char *TIFFName,int left,int top,int right,int bottom);
+
+/* Native surface file loading, unloading and saving */
+
+bitmap_t * MGLAPI MGL_loadSurface(const char *surfaceName,ibool loadPalette);
+bitmap_t * MGLAPI MGL_loadSurfaceExt(FILE *f,ulong dwOffset,ulong dwSize,ibool loadPalette);
+bitmap_t * MGLAPI MGL_mapSurface(const char *surfaceName,ibool loadPalette);
+ibool   MGLAPI MGL_getSurfaceSize(const char *surfaceName,int *width,int *height,int *bitsPerPixel,pixel_format_t *pf);
+ibool   MGLAPI MGL_getSurfaceSizeExt(FILE *f,ulong dwOffset,ulong dwSize,int *width,int *height,int *bitsPerPixel,pixel_format_t *pf);
+ibool   MGLAPI MGL_loadSurfaceIntoDC(MGLDC *dc,const char *surfaceName,int dstLeft,int dstTop,ibool loadPalette);
+ibool   MGLAPI MGL_loadSurfaceIntoDCExt(MGLDC *dc,FILE *f,ulong dwOffset,ulong dwSize,int dstLeft,int dstTop,ibool loadPalette);
+ibool   MGLAPI MGL_saveSurface(const char *surfaceName,const bitmap_t *bitmap,ibool compress);
+
+/* Asynchronous resource loading */
+
+void    MGLAPI MGL_setLoaderThreads(int numThreads);
+/* {partOf:MGL_loadAsync} */
+typedef void (MGLAPIP asynccallback_t)(const async_load_t *load);
+ulong   MGLAPI MGL_loadAsync(int type,const char *name,int param,asynccallback_t callback,void *cookie);
+ulong   MGLAPI MGL_loadAsyncExt(int type,FILE *f,ulong dwOffset,ulong dwSize,int param,asynccallback_t callback,void *cookie);
+int     MGLAPI MGL_pollAsyncLoads(void);
+ibool   MGLAPI MGL_getAsyncLoad(async_load_t *load);
+int     MGLAPI MGL_pendingAsyncLoads(void);
+
+/* Decoded image cache */
+
+bitmap_t * MGLAPI MGL_loadCachedImage(int type,const char *name,int param);
+bitmap_t * MGLAPI MGL_loadCachedImageExt(int type,const char *name,ulong dwOffset,ulong dwSize,int param);
+void    MGLAPI MGL_unloadCachedImage(bitmap_t *bitmap);
+void    MGLAPI MGL_setImageCacheSize(ulong maxBytes);
+void    MGLAPI MGL_flushImageCache(void);
+void    MGLAPI MGL_getImageCacheStats(imagecache_stats_t *stats,ibool reset);
 
 /* Random number generation routines */
 
@@ -4036,6 +4445,11 @@ long    MGLAPI MGL_ftell(FILE *f);
 size_t  MGLAPI MGL_fread(void *ptr,size_t size,size_t n,FILE *f);
 size_t  MGLAPI MGL_fwrite(const void *ptr,size_t size,size_t n,FILE *f);
 
+/* Pack file archive support */
+
+packfile_t * MGLAPI MGL_openPackFile(const char *filename);
+ibool   MGLAPI MGL_closePackFile(packfile_t *pack);
+
 /*---------------------------------------------------------------------------
  * Memory clearing utility functions
  *-------------------------------------------------------------------------*/
@@ -4169,6 +4583,16 @@ void    MGLAPI MGL_useLinearBlit(ibool enable);
 #define MGL_stretchBlt(d,s,sr,dr,op)    MGL_stretchBltCoord((d),(s),(sr).left,          \
                                         (sr).top,(sr).right,(sr).bottom,                \
                                         (dr).left,(dr).top,(dr).right,(dr).bottom,op)
+#define MGL_resampleBlt(d,s,sr,dr,f,op) MGL_resampleBltCoord((d),(s),(sr).left,         \
+                                        (sr).top,(sr).right,(sr).bottom,                \
+                                        (dr).left,(dr).top,(dr).right,(dr).bottom,f,op)
+#define MGL_markDirty(dc,r)             MGL_markDirtyCoord((dc),(r).left,(r).top,       \
+                                        (r).right,(r).bottom)
+#define MGL_presentDirty(d,s)           MGL_bitBltDirty((d),(s),0,0,MGL_REPLACE_MODE)
+#define MGL_batchFillRect(dc,r,c,op)    MGL_batchFillRectCoord((dc),(r).left,(r).top,   \
+                                    (r).right,(r).bottom,c,op)
+#define MGL_batchBitBlt(d,s,r,dl,dt,op) MGL_batchBitBltCoord((d),(s),(r).left,          \
+                                    (r).top,(r).right,(r).bottom,dl,dt,op)
 #define MGL_copyPage(d,s,r,dl,dt,op) MGL_copyPageCoord((d),(s),(r).left,        \
                                     (r).top,(r).right,(r).bottom,dl,dt,op)
 #define MGL_getDivot(dc,r,divot) MGL_getDivotCoord(dc,(r).left,(r).top, \
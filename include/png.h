@@ -2362,6 +2362,14 @@ typedef struct {
     void        (PNGAPIP png_set_tIME)(png_structp png_ptr,png_infop info_ptr,png_timep mod_time);
     png_uint_32 (PNGAPIP png_get_tRNS)(png_structp png_ptr,png_infop info_ptr,png_bytep *trans,int *num_trans,png_color_16p *trans_values);
     void        (PNGAPIP png_set_tRNS)(png_structp png_ptr,png_infop info_ptr,png_bytep trans,int num_trans,png_color_16p trans_values);
+    int         (PNGAPIP deflateInit2_)(z_streamp strm,int level,int method,int windowBits,int memLevel,int strategy,const char *version,int stream_size);
+    int         (PNGAPIP deflateSetDictionary)(z_streamp strm,const Bytef *dictionary,uInt dictLength);
+    int         (PNGAPIP deflate)(z_streamp strm,int flush);
+    int         (PNGAPIP deflateEnd)(z_streamp strm);
+    uLong       (PNGAPIP adler32)(uLong adler,const Bytef *buf,uInt len);
+    int         (PNGAPIP inflateInit2_)(z_streamp strm,int windowBits,const char *version,int stream_size);
+    int         (PNGAPIP inflate)(z_streamp strm,int flush);
+    int         (PNGAPIP inflateEnd)(z_streamp strm);
     } PNG_exports;
 
 /* Imports into the SciTech MGL Binary Portable DLL */
@@ -134,6 +134,14 @@ DECLARE_IMP png_get_tIME,0
 DECLARE_IMP png_set_tIME,0
 DECLARE_IMP png_get_tRNS,0
 DECLARE_IMP png_set_tRNS,0
+DECLARE_IMP deflateInit2_,0
+DECLARE_IMP deflateSetDictionary,0
+DECLARE_IMP deflate,0
+DECLARE_IMP deflateEnd,0
+DECLARE_IMP adler32,0
+DECLARE_IMP __inflateInit2_,0             ; Handled in C code!
+DECLARE_IMP __inflate,0                   ; Handled in C code!
+DECLARE_IMP __inflateEnd,0                ; Handled in C code!
 END_IMPORTS_DEF
 
         END
@@ -185,6 +185,14 @@ PNG_exports * _CEXPORT PNG_initLibrary(
         png_set_tIME,
         png_get_tRNS,
         png_set_tRNS,
+        deflateInit2_,
+        deflateSetDictionary,
+        deflate,
+        deflateEnd,
+        adler32,
+        inflateInit2_,
+        inflate,
+        inflateEnd,
         };
     int     i,max;
     ulong   *p;
@@ -124,3 +124,34 @@ png_structp PNGAPI png_create_write_struct(
     return _PNG_exports.png_create_write_struct(user_png_ver,error_ptr,error_fn,warn_fn);
 }
 
+// The MGL pack file code uses the zlib inflate functions directly, without
+// going through any of the above entry points first.
+
+int ZEXPORT inflateInit2_(
+    z_streamp strm,
+    int windowBits,
+    const char *version,
+    int stream_size)
+{
+    if (!LoadDriver())
+        return Z_STREAM_ERROR;
+    return _PNG_exports.inflateInit2_(strm,windowBits,version,stream_size);
+}
+
+int ZEXPORT inflate(
+    z_streamp strm,
+    int flush)
+{
+    if (!LoadDriver())
+        return Z_STREAM_ERROR;
+    return _PNG_exports.inflate(strm,flush);
+}
+
+int ZEXPORT inflateEnd(
+    z_streamp strm)
+{
+    if (!LoadDriver())
+        return Z_STREAM_ERROR;
+    return _PNG_exports.inflateEnd(strm);
+}
+
@@ -0,0 +1,489 @@
+/****************************************************************************
+*
+*                   SciTech Multi-platform Graphics Library
+*
+*  ========================================================================
+*
+*   Copyright (C) 1991-2004 SciTech Software, Inc. All rights reserved.
+*
+*   This file may be distributed and/or modified under the terms of the
+*   GNU General Public License version 2.0 as published by the Free
+*   Software Foundation and appearing in the file LICENSE.GPL included
+*   in the packaging of this file.
+*
+*   Licensees holding a valid Commercial License for this product from
+*   SciTech Software, Inc. may use this file in accordance with the
+*   Commercial License Agreement provided with the Software.
+*
+*   This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING
+*   THE WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+*   PURPOSE.
+*
+*   See http://www.scitechsoft.com/license/ for information about
+*   the licensing options available and how to purchase a Commercial
+*   License Agreement.
+*
+*   Contact license@scitechsoft.com if any conditions of this licensing
+*   are not clear to you, or you have questions about licensing options.
+*
+*  ========================================================================
+*
+* Language:     ANSI C
+* Environment:  Any
+*
+* Description:  Single pass blending of 8-bit coverage glyphs for
+*               anti-aliased text. Glyphs are composited in the current
+*               color directly onto 15, 16, 24 and 32 bits per pixel
+*               surfaces that can be linearly accessed. Blending against
+*               a fixed background color goes through a 256 entry table
+*               of pre-blended colors, while blending against the
+*               destination has SSE2 versions for 16 and 32 bits per
+*               pixel that produce identical results to the C code.
+*
+****************************************************************************/
+
+#include "mgl.h"
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BLEND_SSE2
+#include <emmintrin.h>
+#endif
+
+/*--------------------------- Global Variables ----------------------------*/
+
+/* Blending state for the glyphs in the string being drawn. The table of
+ * pre-blended colors is kept between strings and only rebuilt when the
+ * colors or the pixel format change.
+ */
+
+static struct {
+    ibool           active;         /* True while blending is enabled   */
+    uchar           *surface;       /* Destination surface              */
+    int             bytesPerLine;   /* Destination scanline width       */
+    int             bytesPerPixel;  /* Destination pixel size           */
+    ibool           blendDst;       /* Blend with destination pixels    */
+    ibool           opaque;         /* Fill zero coverage pixels        */
+    M_uint32        color;          /* Foreground color                 */
+    M_uint32        keepMask;       /* 16 bpp bits outside RGB fields   */
+    pixel_format_t  pf;             /* Destination pixel format         */
+    ibool           lutValid;       /* True if lookup table is valid    */
+    M_uint32        lutColor;       /* Foreground color for the table   */
+    M_uint32        lutBack;        /* Background color for the table   */
+    int             lutBytes;       /* Pixel size for the table         */
+    pixel_format_t  lutPF;          /* Pixel format for the table       */
+    M_uint32        lut[256];       /* Color for each coverage value    */
+    } blend;
+
+/* Divide a blended value (at most 255*255) by 255 with rounding */
+
+#define DIV255(x)   ((((x) + 128) + (((x) + 128) >> 8)) >> 8)
+
+/*------------------------- Implementation --------------------------------*/
+
+/****************************************************************************
+REMARKS:
+Blends a foreground pixel onto a destination pixel with 8 bits per
+component, two components at a time. Each 16 bit lane holds at most
+255*255+128, so the lanes never carry into each other. This is used for 24
+and 32 bits per pixel, and the alpha or reserved byte is blended along with
+the color components.
+****************************************************************************/
+static M_uint32 blend32(
+    M_uint32 d,
+    M_uint32 s,
+    uint a)
+{
+    uint        ia = 255 - a;
+    M_uint32    rb,ag;
+
+    rb = (s & 0xFF00FF) * a + (d & 0xFF00FF) * ia + 0x800080;
+    ag = ((s >> 8) & 0xFF00FF) * a + ((d >> 8) & 0xFF00FF) * ia + 0x800080;
+    rb = ((rb + ((rb >> 8) & 0xFF00FF)) >> 8) & 0xFF00FF;
+    ag = (ag + ((ag >> 8) & 0xFF00FF)) & 0xFF00FF00;
+    return rb | ag;
+}
+
+/****************************************************************************
+REMARKS:
+Blends a foreground pixel onto a 15 or 16 bits per pixel destination pixel.
+Each color field is blended at its native precision, and any bits outside
+the color fields are taken from the foreground color as they are for fully
+covered pixels.
+****************************************************************************/
+static M_uint32 blend16(
+    M_uint32 d,
+    M_uint32 s,
+    uint a)
+{
+    uint        ia = 255 - a;
+    M_uint32    c,f,r = s & blend.keepMask;
+
+    c = (d >> blend.pf.redPos) & blend.pf.redMask;
+    f = (s >> blend.pf.redPos) & blend.pf.redMask;
+    r |= DIV255(f * a + c * ia) << blend.pf.redPos;
+    c = (d >> blend.pf.greenPos) & blend.pf.greenMask;
+    f = (s >> blend.pf.greenPos) & blend.pf.greenMask;
+    r |= DIV255(f * a + c * ia) << blend.pf.greenPos;
+    c = (d >> blend.pf.bluePos) & blend.pf.blueMask;
+    f = (s >> blend.pf.bluePos) & blend.pf.blueMask;
+    r |= DIV255(f * a + c * ia) << blend.pf.bluePos;
+    return r;
+}
+
+/****************************************************************************
+REMARKS:
+Builds the table of colors blended between the background and foreground
+colors for every coverage value, unless the table is already up to date.
+****************************************************************************/
+static void buildBlendTable(
+    M_uint32 back)
+{
+    uint    a;
+
+    if (blend.lutValid && blend.lutColor == blend.color && blend.lutBack == back
+            && blend.lutBytes == blend.bytesPerPixel
+            && memcmp(&blend.lutPF,&blend.pf,sizeof(blend.pf)) == 0)
+        return;
+    for (a = 0; a < 256; a++) {
+        if (blend.bytesPerPixel == 2)
+            blend.lut[a] = blend16(back,blend.color,a);
+        else
+            blend.lut[a] = blend32(back,blend.color,a);
+        }
+    blend.lutColor = blend.color;
+    blend.lutBack = back;
+    blend.lutBytes = blend.bytesPerPixel;
+    blend.lutPF = blend.pf;
+    blend.lutValid = true;
+}
+
+/****************************************************************************
+REMARKS:
+Blends a span of coverage values in the foreground color onto a 32 bits
+per pixel destination. The SSE2 version blends four pixels at a time, and
+skips or fills runs of four pixels with zero or full coverage.
+****************************************************************************/
+static void blendSpan32(
+    M_uint32 *d,
+    const uchar *cov,
+    int count)
+{
+    M_uint32    s = blend.color;
+    uint        a;
+#ifdef BLEND_SSE2
+    M_uint32    c4;
+
+    if (count >= 4) {
+        __m128i zero = _mm_setzero_si128();
+        __m128i c128 = _mm_set1_epi16(128);
+        __m128i c255 = _mm_set1_epi16(255);
+        __m128i fg = _mm_set1_epi32((int)s);
+        __m128i src = _mm_unpacklo_epi8(fg,zero);
+        __m128i p,va,alo,ahi,lo,hi;
+
+        for (; count >= 4; count -= 4, d += 4, cov += 4) {
+            c4 = cov[0] | ((M_uint32)cov[1] << 8) | ((M_uint32)cov[2] << 16) | ((M_uint32)cov[3] << 24);
+            if (c4 == 0)
+                continue;
+            if (c4 == 0xFFFFFFFFUL) {
+                _mm_storeu_si128((__m128i*)d,fg);
+                continue;
+                }
+            va = _mm_cvtsi32_si128((int)c4);
+            va = _mm_unpacklo_epi8(va,va);
+            va = _mm_unpacklo_epi16(va,va);
+            alo = _mm_unpacklo_epi8(va,zero);
+            ahi = _mm_unpackhi_epi8(va,zero);
+            p = _mm_loadu_si128((__m128i*)d);
+            lo = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(src,alo),
+                _mm_mullo_epi16(_mm_unpacklo_epi8(p,zero),_mm_sub_epi16(c255,alo))),c128);
+            hi = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(src,ahi),
+                _mm_mullo_epi16(_mm_unpackhi_epi8(p,zero),_mm_sub_epi16(c255,ahi))),c128);
+            lo = _mm_srli_epi16(_mm_add_epi16(lo,_mm_srli_epi16(lo,8)),8);
+            hi = _mm_srli_epi16(_mm_add_epi16(hi,_mm_srli_epi16(hi,8)),8);
+            _mm_storeu_si128((__m128i*)d,_mm_packus_epi16(lo,hi));
+            }
+        }
+#endif
+    for (; count > 0; count--, d++) {
+        if ((a = *cov++) == 0)
+            continue;
+        *d = (a == 255) ? s : blend32(*d,s,a);
+        }
+}
+
+/****************************************************************************
+REMARKS:
+Blends a span of coverage values in the foreground color onto a 15 or 16
+bits per pixel destination. The SSE2 version blends eight pixels at a time,
+extracting each color field with the shift and mask from the pixel format.
+****************************************************************************/
+static void blendSpan16(
+    ushort *d,
+    const uchar *cov,
+    int count)
+{
+    M_uint32    s = blend.color;
+    uint        a;
+#ifdef BLEND_SSE2
+    int         i;
+
+    if (count >= 8) {
+        __m128i zero = _mm_setzero_si128();
+        __m128i c128 = _mm_set1_epi16(128);
+        __m128i c255 = _mm_set1_epi16(255);
+        __m128i fg = _mm_set1_epi16((short)s);
+        __m128i keep = _mm_set1_epi16((short)blend.keepMask);
+        __m128i pos[3],mask[3],src[3];
+        __m128i p,r,c,va,ia;
+        uchar   fpos[3],fmask[3];
+
+        fpos[0] = blend.pf.redPos;      fmask[0] = blend.pf.redMask;
+        fpos[1] = blend.pf.greenPos;    fmask[1] = blend.pf.greenMask;
+        fpos[2] = blend.pf.bluePos;     fmask[2] = blend.pf.blueMask;
+        for (i = 0; i < 3; i++) {
+            pos[i] = _mm_cvtsi32_si128(fpos[i]);
+            mask[i] = _mm_set1_epi16(fmask[i]);
+            src[i] = _mm_set1_epi16((short)((s >> fpos[i]) & fmask[i]));
+            }
+        for (; count >= 8; count -= 8, d += 8, cov += 8) {
+            va = _mm_loadl_epi64((__m128i*)cov);
+            if (_mm_movemask_epi8(_mm_cmpeq_epi8(va,zero)) == 0xFFFF)
+                continue;
+            if ((_mm_movemask_epi8(_mm_cmpeq_epi8(va,_mm_cmpeq_epi8(zero,zero))) & 0xFF) == 0xFF) {
+                _mm_storeu_si128((__m128i*)d,fg);
+                continue;
+                }
+            va = _mm_unpacklo_epi8(va,zero);
+            ia = _mm_sub_epi16(c255,va);
+            p = _mm_loadu_si128((__m128i*)d);
+            r = _mm_and_si128(fg,keep);
+            for (i = 0; i < 3; i++) {
+                c = _mm_and_si128(_mm_srl_epi16(p,pos[i]),mask[i]);
+                c = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(src[i],va),_mm_mullo_epi16(c,ia)),c128);
+                c = _mm_srli_epi16(_mm_add_epi16(c,_mm_srli_epi16(c,8)),8);
+                r = _mm_or_si128(r,_mm_sll_epi16(c,pos[i]));
+                }
+
+            /* Leave pixels with no coverage untouched */
+            c = _mm_cmpeq_epi16(va,zero);
+            r = _mm_or_si128(_mm_and_si128(c,p),_mm_andnot_si128(c,r));
+            _mm_storeu_si128((__m128i*)d,r);
+            }
+        }
+#endif
+    for (; count > 0; count--, d++) {
+        if ((a = *cov++) == 0)
+            continue;
+        *d = (ushort)((a == 255) ? s : blend16(*d,s,a));
+        }
+}
+
+/****************************************************************************
+REMARKS:
+Blends a span of coverage values in the foreground color onto a 24 bits
+per pixel destination.
+****************************************************************************/
+static void blendSpan24(
+    uchar *d,
+    const uchar *cov,
+    int count)
+{
+    M_uint32    p,s = blend.color;
+    uint        a;
+
+    for (; count > 0; count--, d += 3) {
+        if ((a = *cov++) == 0)
+            continue;
+        if (a == 255)
+            p = s;
+        else
+            p = blend32(d[0] | ((M_uint32)d[1] << 8) | ((M_uint32)d[2] << 16),s,a);
+        d[0] = (uchar)p;
+        d[1] = (uchar)(p >> 8);
+        d[2] = (uchar)(p >> 16);
+        }
+}
+
+/****************************************************************************
+REMARKS:
+Draws a span of coverage values using the table of pre-blended colors. In
+transparent mode pixels with no coverage are left alone, while in opaque
+mode they are filled with the background color.
+****************************************************************************/
+static void lookupSpan(
+    uchar *d,
+    const uchar *cov,
+    int count)
+{
+    M_uint32    p;
+    uint        a;
+    ibool       opaque = blend.opaque;
+
+    switch (blend.bytesPerPixel) {
+        case 2:
+            for (; count > 0; count--, d += 2) {
+                if ((a = *cov++) != 0 || opaque)
+                    *((ushort*)d) = (ushort)blend.lut[a];
+                }
+            break;
+        case 3:
+            for (; count > 0; count--, d += 3) {
+                if ((a = *cov++) != 0 || opaque) {
+                    p = blend.lut[a];
+                    d[0] = (uchar)p;
+                    d[1] = (uchar)(p >> 8);
+                    d[2] = (uchar)(p >> 16);
+                    }
+                }
+            break;
+        default:
+            for (; count > 0; count--, d += 4) {
+                if ((a = *cov++) != 0 || opaque)
+                    *((M_uint32*)d) = blend.lut[a];
+                }
+            break;
+        }
+}
+
+/****************************************************************************
+PARAMETERS:
+x           - Screen x coordinate of the glyph
+y           - Screen y coordinate of the glyph
+coverage    - Glyph coverage values
+stride      - Width of a row of coverage values
+r           - Clipped rectangle to draw (screen coordinates)
+
+REMARKS:
+Blends the part of the glyph inside the clipped rectangle onto the
+destination surface.
+****************************************************************************/
+static void blendRect(
+    int x,
+    int y,
+    const uchar *coverage,
+    int stride,
+    rect_t *r)
+{
+    int         j,count = r->right - r->left;
+    uchar       *d;
+    const uchar *cov;
+
+    d = blend.surface + (long)r->top * blend.bytesPerLine + r->left * blend.bytesPerPixel;
+    cov = coverage + (long)(r->top - y) * stride + (r->left - x);
+    for (j = r->top; j < r->bottom; j++, d += blend.bytesPerLine, cov += stride) {
+        if (!blend.blendDst)
+            lookupSpan(d,cov,count);
+        else if (blend.bytesPerPixel == 4)
+            blendSpan32((M_uint32*)d,cov,count);
+        else if (blend.bytesPerPixel == 2)
+            blendSpan16((ushort*)d,cov,count);
+        else
+            blendSpan24(d,cov,count);
+        }
+}
+
+/****************************************************************************
+RETURNS:
+True if glyphs can be blended directly, false if not.
+
+REMARKS:
+Prepares to blend anti-aliased glyphs directly onto the current device
+context, and enables direct access to the surface. Blending is only done
+for RGB surfaces with 15 bits per pixel or more that can be linearly
+accessed, and in the replace write mode. In the MGL_AA_RGBBLEND mode with
+a transparent background the glyph is blended with the destination pixels,
+and otherwise it is blended with the background color through a lookup
+table as with the anti-aliasing palette. Every call that returns true must
+be matched with a call to _MGL_endGlyphBlend.
+{secret}
+****************************************************************************/
+ibool _MGL_beginGlyphBlend(void)
+{
+    int bits = DC.mi.bitsPerPixel;
+
+    if ((DC.mi.modeFlags & MGL_IS_COLOR_INDEX) || (bits != 15 && bits != 16 && bits != 24 && bits != 32)
+            || (DC.flags & MGL_SURFACE_FLAGS) != MGL_LINEAR_ACCESS
+            || DC.a.writeMode != MGL_REPLACE_MODE)
+        return false;
+    MGL_beginDirectAccess();
+    if (!DC.surface) {
+        MGL_endDirectAccess();
+        return false;
+        }
+    blend.surface = DC.surface;
+    blend.bytesPerLine = DC.mi.bytesPerLine;
+    blend.bytesPerPixel = (bits + 7) / 8;
+    blend.pf = DC.pf;
+    blend.color = (M_uint32)DC.a.color;
+    blend.opaque = (DC.a.backMode == MGL_OPAQUE_BACKGROUND);
+    blend.blendDst = (DC.a.fontBlendMode == MGL_AA_RGBBLEND && !blend.opaque);
+    if (blend.bytesPerPixel == 2) {
+        blend.color &= 0xFFFF;
+        blend.keepMask = ~(((M_uint32)blend.pf.redMask << blend.pf.redPos)
+            | ((M_uint32)blend.pf.greenMask << blend.pf.greenPos)
+            | ((M_uint32)blend.pf.blueMask << blend.pf.bluePos)) & 0xFFFF;
+        }
+    else if (blend.bytesPerPixel == 3)
+        blend.color &= 0xFFFFFF;
+    if (!blend.blendDst)
+        buildBlendTable((M_uint32)DC.a.backColor);
+    blend.active = true;
+    return true;
+}
+
+/****************************************************************************
+PARAMETERS:
+x           - Screen x coordinate to draw the glyph at
+y           - Screen y coordinate to draw the glyph at
+width       - Width of the glyph in pixels
+height      - Height of the glyph in pixels
+coverage    - Glyph coverage values, one byte per pixel
+stride      - Width of a row of coverage values
+
+RETURNS:
+True if the glyph was drawn, false if the caller needs to draw it.
+
+REMARKS:
+Composites an 8-bit coverage glyph in a single pass, clipped to the clip
+rectangle and the complex clip region for the device context.
+{secret}
+****************************************************************************/
+ibool _MGL_blendGlyph(
+    int x,
+    int y,
+    int width,
+    int height,
+    const uchar *coverage,
+    int stride)
+{
+    rect_t  d,r,c,clip;
+
+    if (!blend.active)
+        return false;
+    d.left = x;             d.top = y;
+    d.right = x + width;    d.bottom = y + height;
+    if (!MGL_sectRect(DC.clipRectScreen,d,&r))
+        return true;
+    if (DC.clipRegionScreen) {
+        BEGIN_CLIP_REGION(clip,DC.clipRegionScreen);
+            if (MGL_sectRect(clip,r,&c))
+                blendRect(x,y,coverage,stride,&c);
+        END_CLIP_REGION();
+        }
+    else
+        blendRect(x,y,coverage,stride,&r);
+    return true;
+}
+
+/****************************************************************************
+REMARKS:
+Ends blending glyphs directly onto the current device context.
+{secret}
+****************************************************************************/
+void _MGL_endGlyphBlend(void)
+{
+    if (blend.active) {
+        blend.active = false;
+        MGL_endDirectAccess();
+        }
+}
@@ -0,0 +1,712 @@
+/****************************************************************************
+*
+*                   SciTech Multi-platform Graphics Library
+*
+*  ========================================================================
+*
+*   Copyright (C) 1991-2004 SciTech Software, Inc. All rights reserved.
+*
+*   This file may be distributed and/or modified under the terms of the
+*   GNU General Public License version 2.0 as published by the Free
+*   Software Foundation and appearing in the file LICENSE.GPL included
+*   in the packaging of this file.
+*
+*   Licensees holding a valid Commercial License for this product from
+*   SciTech Software, Inc. may use this file in accordance with the
+*   Commercial License Agreement provided with the Software.
+*
+*   This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING
+*   THE WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+*   PURPOSE.
+*
+*   See http://www.scitechsoft.com/license/ for information about
+*   the licensing options available and how to purchase a Commercial
+*   License Agreement.
+*
+*   Contact license@scitechsoft.com if any conditions of this licensing
+*   are not clear to you, or you have questions about licensing options.
+*
+*  ========================================================================
+*
+* Language:     ANSI C
+* Environment:  Any
+*
+* Description:  Asynchronous resource loader. Bitmaps, icons, cursors and
+*               fonts are read from disk and decoded by a pool of worker
+*               threads, and the completed resources are handed back to
+*               the application on the thread that polls for them. The
+*               result code and scratch buffer used by the resource
+*               loaders are private to each thread, so the workers never
+*               disturb the state of the thread calling the MGL. On systems
+*               without threads the requests are simply loaded on the
+*               calling thread when it polls for them.
+*
+****************************************************************************/
+
+#include "mgl.h"
+
+/*--------------------------- Global Variables ----------------------------*/
+
+#define MAX_LOADER_THREADS  16
+
+/* Flags to select which requests are removed from a queue */
+
+#define DQ_ANY              0
+#define DQ_CALLBACK         1
+#define DQ_NOCALLBACK       2
+
+typedef struct asyncRequest {
+    struct asyncRequest *next;          /* Next request in the queue        */
+    async_load_t        load;           /* Information passed back to app   */
+    asynccallback_t     callback;       /* Completion callback (or NULL)    */
+    FILE                *f;             /* Open file (NULL to load by name) */
+    ulong               dwOffset;       /* Offset of resource within file   */
+    ulong               dwSize;         /* Size of resource in bytes        */
+    int                 param;          /* Loader parameter for resource    */
+    char                name[PM_MAX_PATH];  /* Name of resource to load     */
+    } asyncRequest;
+
+typedef struct {
+    asyncRequest    *head;              /* First request in the queue       */
+    asyncRequest    *tail;              /* Last request in the queue        */
+    } asyncQueue;
+
+typedef struct {
+    void        *done;                  /* Event signalled on thread exit   */
+    void        *buf;                   /* Private scratch buffer           */
+    } loaderWorker;
+
+static int          numLoaders = 0;
+static loaderWorker loaders[MAX_LOADER_THREADS];
+static void         *workEvent = NULL;
+static void         *queueLock = NULL;
+static asyncQueue   pending;
+static asyncQueue   completed;
+static int          outstanding = 0;
+static ulong        nextID = 1;
+static ibool        exiting = false;
+
+/*------------------------- Implementation --------------------------------*/
+
+/****************************************************************************
+REMARKS:
+Takes ownership of the request queues. The lock is an event that is left
+signalled while the queues are free, so it is only needed once the worker
+threads have been created.
+****************************************************************************/
+static void lockQueues(void)
+{
+    if (queueLock)
+        _MGL_waitEvent(queueLock);
+}
+
+/****************************************************************************
+REMARKS:
+Releases ownership of the request queues.
+****************************************************************************/
+static void unlockQueues(void)
+{
+    if (queueLock)
+        _MGL_signalEvent(queueLock);
+}
+
+/****************************************************************************
+PARAMETERS:
+q   - Queue to add the request to
+r   - Request to add
+
+REMARKS:
+Adds a request to the end of a queue. The queues must be locked.
+****************************************************************************/
+static void enqueue(
+    asyncQueue *q,
+    asyncRequest *r)
+{
+    r->next = NULL;
+    if (q->tail)
+        q->tail->next = r;
+    else
+        q->head = r;
+    q->tail = r;
+}
+
+/****************************************************************************
+PARAMETERS:
+q       - Queue to remove the request from
+match   - Which requests to remove (DQ_ANY, DQ_CALLBACK or DQ_NOCALLBACK)
+
+RETURNS:
+First matching request in the queue, or NULL if there are none.
+
+REMARKS:
+Removes the first matching request from a queue. The queues must be locked.
+****************************************************************************/
+static asyncRequest *dequeue(
+    asyncQueue *q,
+    int match)
+{
+    asyncRequest    *r,*prev = NULL;
+
+    for (r = q->head; r; prev = r, r = r->next) {
+        if (match == DQ_ANY)
+            break;
+        if ((match == DQ_CALLBACK) == (r->callback != NULL))
+            break;
+        }
+    if (r) {
+        if (prev)
+            prev->next = r->next;
+        else
+            q->head = r->next;
+        if (q->tail == r)
+            q->tail = prev;
+        }
+    return r;
+}
+
+/****************************************************************************
+PARAMETERS:
+r   - Request to load
+
+REMARKS:
+Loads the resource for a request, and records the result code for the
+load. This runs on the worker threads, and only calls the resource loaders
+which do not touch any device contexts or other shared MGL state.
+****************************************************************************/
+static void loadResource(
+    asyncRequest *r)
+{
+    void    *res = NULL;
+    FILE    *f = r->f;
+
+    __MGL_result = grOK;
+    switch (r->load.type) {
+        case MGL_ASYNC_BITMAP:
+            res = f ? MGL_loadBitmapExt(f,r->dwOffset,r->dwSize,r->param)
+                    : MGL_loadBitmap(r->name,r->param);
+            break;
+        case MGL_ASYNC_PCX:
+            res = f ? MGL_loadPCXExt(f,r->dwOffset,r->dwSize,r->param)
+                    : MGL_loadPCX(r->name,r->param);
+            break;
+        case MGL_ASYNC_JPEG:
+            res = f ? MGL_loadJPEGExt(f,r->dwOffset,r->dwSize,r->param)
+                    : MGL_loadJPEG(r->name,r->param);
+            break;
+        case MGL_ASYNC_PNG:
+            res = f ? MGL_loadPNGExt(f,r->dwOffset,r->dwSize,r->param)
+                    : MGL_loadPNG(r->name,r->param);
+            break;
+        case MGL_ASYNC_ICON:
+            res = f ? MGL_loadIconExt(f,r->dwOffset,r->dwSize,r->param)
+                    : MGL_loadIcon(r->name,r->param);
+            break;
+        case MGL_ASYNC_CURSOR:
+            res = f ? MGL_loadCursorExt(f,r->dwOffset,r->dwSize)
+                    : MGL_loadCursor(r->name);
+            break;
+        case MGL_ASYNC_FONT:
+            res = f ? MGL_loadFontExt(f,r->dwOffset,r->dwSize)
+                    : MGL_loadFont(r->name);
+            break;
+        case MGL_ASYNC_SURFACE:
+            res = f ? MGL_loadSurfaceExt(f,r->dwOffset,r->dwSize,r->param)
+                    : MGL_loadSurface(r->name,r->param);
+            break;
+        }
+    r->load.resource = res;
+    r->load.result = (res == NULL && __MGL_result == grOK) ? grError : __MGL_result;
+    __MGL_result = grOK;
+}
+
+/****************************************************************************
+PARAMETERS:
+load    - Completed load to free the resource for
+
+REMARKS:
+Frees a loaded resource that was never handed back to the application.
+****************************************************************************/
+static void unloadResource(
+    async_load_t *load)
+{
+    if (!load->resource)
+        return;
+    switch (load->type) {
+        case MGL_ASYNC_BITMAP:
+        case MGL_ASYNC_PCX:
+        case MGL_ASYNC_JPEG:
+        case MGL_ASYNC_PNG:
+        case MGL_ASYNC_SURFACE:
+            MGL_unloadBitmap((bitmap_t*)load->resource);
+            break;
+        case MGL_ASYNC_ICON:
+            MGL_unloadIcon((icon_t*)load->resource);
+            break;
+        case MGL_ASYNC_CURSOR:
+            MGL_unloadCursor((cursor_t*)load->resource);
+            break;
+        case MGL_ASYNC_FONT:
+            MGL_unloadFont((font_t*)load->resource);
+            break;
+        }
+}
+
+/****************************************************************************
+PARAMETERS:
+arg - Pointer to the worker structure for this thread
+
+REMARKS:
+Main loop for each loader thread. The thread sleeps until requests are
+queued, and loads them one at a time until the pool is destroyed. The
+work event may only wake a single thread for several requests, so each
+thread wakes up the next one if there is still work left in the queue.
+****************************************************************************/
+static void loaderThread(
+    void *arg)
+{
+    loaderWorker    *w = (loaderWorker*)arg;
+    asyncRequest    *r;
+    ibool           more;
+
+    _MGL_buf = w->buf;
+    for (;;) {
+        _MGL_waitEvent(workEvent);
+        if (exiting)
+            break;
+        lockQueues();
+        r = dequeue(&pending,DQ_ANY);
+        more = (pending.head != NULL);
+        unlockQueues();
+        if (more)
+            _MGL_signalEvent(workEvent);
+        if (r) {
+            loadResource(r);
+            lockQueues();
+            enqueue(&completed,r);
+            unlockQueues();
+            }
+        }
+    _MGL_buf = NULL;
+    _MGL_signalEvent(workEvent);
+    _MGL_signalEvent(w->done);
+}
+
+/****************************************************************************
+REMARKS:
+Stops all the loader threads, waiting for any loads in progress to finish.
+Requests that have not been started are left in the pending queue.
+****************************************************************************/
+static void stopLoaderThreads(void)
+{
+    int i;
+
+    if (numLoaders == 0)
+        return;
+    exiting = true;
+    _MGL_signalEvent(workEvent);
+    for (i = 0; i < numLoaders; i++) {
+        _MGL_waitEvent(loaders[i].done);
+        _MGL_destroyEvent(loaders[i].done);
+        PM_free(loaders[i].buf);
+        }
+    numLoaders = 0;
+    exiting = false;
+}
+
+/****************************************************************************
+REMARKS:
+Shuts down the loader threads and frees all outstanding requests, along with
+any resources that were loaded but never handed back to the application.
+****************************************************************************/
+void _MGL_destroyLoaderThreads(void)
+{
+    asyncRequest    *r;
+
+    stopLoaderThreads();
+    while ((r = dequeue(&pending,DQ_ANY)) != NULL)
+        PM_free(r);
+    while ((r = dequeue(&completed,DQ_ANY)) != NULL) {
+        unloadResource(&r->load);
+        PM_free(r);
+        }
+    if (workEvent) {
+        _MGL_destroyEvent(workEvent);
+        workEvent = NULL;
+        }
+    if (queueLock) {
+        _MGL_destroyEvent(queueLock);
+        queueLock = NULL;
+        }
+    outstanding = 0;
+}
+
+/****************************************************************************
+REMARKS:
+Loads the next pending request on the calling thread. This is used when
+there are no loader threads, so that asynchronous loads still complete on
+systems without threads.
+****************************************************************************/
+static void loadOnCaller(void)
+{
+    asyncRequest    *r;
+    int             oldResult;
+
+    if (numLoaders > 0 || (r = dequeue(&pending,DQ_ANY)) == NULL)
+        return;
+    oldResult = __MGL_result;
+    loadResource(r);
+    __MGL_result = oldResult;
+    enqueue(&completed,r);
+}
+
+/****************************************************************************
+PARAMETERS:
+type        - Type of resource to load (MGL_asyncLoadType)
+name        - Name of the resource file to load (NULL if loading from f)
+f           - Open file to load from (NULL if loading by name)
+dwOffset    - Offset of the resource within the open file
+dwSize      - Size of the resource in bytes
+param       - Parameter for the resource loader
+callback    - Completion callback (NULL to retrieve with MGL_getAsyncLoad)
+cookie      - Cookie passed back with the completed load
+
+RETURNS:
+Identifier for the request, or 0 on failure.
+
+REMARKS:
+Common code to queue up a new load request for the loader threads.
+****************************************************************************/
+static ulong queueLoad(
+    int type,
+    const char *name,
+    FILE *f,
+    ulong dwOffset,
+    ulong dwSize,
+    int param,
+    asynccallback_t callback,
+    void *cookie)
+{
+    asyncRequest    *r;
+
+    if (type < MGL_ASYNC_BITMAP || type > MGL_ASYNC_SURFACE) {
+        SETERROR(grError);
+        return 0;
+        }
+    if (name && strlen(name) >= PM_MAX_PATH) {
+        SETERROR(grInvalidName);
+        return 0;
+        }
+    if ((r = PM_calloc(1,sizeof(asyncRequest))) == NULL) {
+        FATALERROR(grNoMem);
+        return 0;
+        }
+    r->load.id = nextID++;
+    if (nextID == 0)
+        nextID = 1;
+    r->load.type = type;
+    r->load.cookie = cookie;
+    r->callback = callback;
+    r->f = f;
+    r->dwOffset = dwOffset;
+    r->dwSize = dwSize;
+    r->param = param;
+    if (name)
+        strcpy(r->name,name);
+    lockQueues();
+    enqueue(&pending,r);
+    unlockQueues();
+    outstanding++;
+    if (numLoaders > 0)
+        _MGL_signalEvent(workEvent);
+    return r->load.id;
+}
+
+/****************************************************************************
+DESCRIPTION:
+Sets the number of threads used to load resources asynchronously.
+
+HEADER:
+mgraph.h
+
+PARAMETERS:
+numThreads  - Number of loader threads to create (0 for one per processor)
+
+REMARKS:
+This function creates a pool of worker threads used to load the resources
+requested with MGL_loadAsync and MGL_loadAsyncExt in the background. Each
+thread loads one resource at a time, so the number of threads sets the
+number of resources that can be loaded and decoded in parallel. Calling
+this function again resizes the pool, and any requests that have not yet
+been started are picked up by the new threads. The threads are destroyed
+when MGL_exit is called.
+
+If this function is never called, or the threads could not be created,
+asynchronous loads are still supported but each request is loaded on the
+calling thread during MGL_pollAsyncLoads or MGL_getAsyncLoad.
+
+Note:   This function is not supported on DOS, where threads are not
+        available, or when the MGL is compiled without support for thread
+        local storage.
+
+SEE ALSO:
+MGL_loadAsync, MGL_pollAsyncLoads, MGL_setBltThreads
+****************************************************************************/
+void MGLAPI MGL_setLoaderThreads(
+    int numThreads)
+{
+#ifndef MGL_NO_THREAD_LOCAL
+    loaderWorker    *w;
+    ibool           more;
+
+    stopLoaderThreads();
+    if (!workEvent && (workEvent = _MGL_createEvent()) == NULL)
+        return;
+    if (!queueLock) {
+        if ((queueLock = _MGL_createEvent()) == NULL)
+            return;
+        _MGL_signalEvent(queueLock);
+        }
+    if (numThreads <= 0)
+        numThreads = _MGL_numProcessors();
+    numThreads = MIN(numThreads,MAX_LOADER_THREADS);
+
+    /* Load the image libraries before any thread can be the first to use them */
+    _MGL_loadPNGLibrary();
+    _MGL_loadJPEGLibrary();
+    while (numLoaders < numThreads) {
+        w = &loaders[numLoaders];
+        if ((w->buf = PM_malloc(_MGL_bufSize)) == NULL)
+            break;
+        if ((w->done = _MGL_createEvent()) == NULL) {
+            PM_free(w->buf);
+            break;
+            }
+        if (!_MGL_createThread(loaderThread,w)) {
+            _MGL_destroyEvent(w->done);
+            PM_free(w->buf);
+            break;
+            }
+        numLoaders++;
+        }
+
+    /* Hand any requests queued while there were no threads to the pool */
+    lockQueues();
+    more = (pending.head != NULL);
+    unlockQueues();
+    if (more && numLoaders > 0)
+        _MGL_signalEvent(workEvent);
+#else
+    (void)numThreads;
+#endif
+}
+
+/****************************************************************************
+DESCRIPTION:
+Queues up a resource file to be loaded asynchronously.
+
+HEADER:
+mgraph.h
+
+PARAMETERS:
+type        - Type of resource to load (MGL_asyncLoadType)
+name        - Name of the resource file to load
+param       - Parameter for the resource loader
+callback    - Function to call when the load completes (NULL for none)
+cookie      - Cookie passed back with the completed load
+
+RETURNS:
+Identifier for the load request, or 0 on failure.
+
+REMARKS:
+This function queues up a resource file to be loaded and decoded in the
+background by the threads created with MGL_setLoaderThreads, and returns
+immediately. The type of resource is one of the values in the
+MGL_asyncLoadType enumeration, and selects which MGL resource loader is
+used, and what type of resource is returned. The param value is passed on
+to the resource loader as the loadPalette parameter for bitmaps and icons,
+and as the num8BitColors parameter for JPEG files. It is ignored for
+cursors and fonts. The file is located using the same search rules as the
+regular resource loading functions such as MGL_loadBitmap.
+
+When the load completes the results are placed in a completion queue. If
+you passed a callback function, the callback is called with the results of
+the load from the next call to MGL_pollAsyncLoads. Otherwise you retrieve
+the results yourself with MGL_getAsyncLoad. Either way, the callbacks and
+completed loads are only ever handed back on the thread that polls for
+them, so they can safely use the MGL. The async_load_t structure passed to
+the callback is only valid for the duration of the callback. The loaded
+resource belongs to the application once it has been handed back, and must
+be freed with the regular unload function for the type of resource. If the
+load failed the resource will be NULL, and the result member contains the
+error code.
+
+SEE ALSO:
+MGL_loadAsyncExt, MGL_pollAsyncLoads, MGL_getAsyncLoad,
+MGL_setLoaderThreads
+****************************************************************************/
+ulong MGLAPI MGL_loadAsync(
+    int type,
+    const char *name,
+    int param,
+    asynccallback_t callback,
+    void *cookie)
+{
+    return queueLoad(type,name,NULL,0,0,param,callback,cookie);
+}
+
+/****************************************************************************
+DESCRIPTION:
+Queues up a resource to be loaded asynchronously from an open file.
+
+HEADER:
+mgraph.h
+
+PARAMETERS:
+type        - Type of resource to load (MGL_asyncLoadType)
+f           - Open binary file to load the resource from
+dwOffset    - Offset to start of the resource within the open file
+dwSize      - Size of the resource in bytes
+param       - Parameter for the resource loader
+callback    - Function to call when the load completes (NULL for none)
+cookie      - Cookie passed back with the completed load
+
+RETURNS:
+Identifier for the load request, or 0 on failure.
+
+REMARKS:
+This function is the same as MGL_loadAsync, however it loads the resource
+from a previously open file. This allows you to create your own large files
+with multiple resources embedded in them.
+
+Note:   The loader threads read from the file using the file position, so
+        you must not touch the file, or queue up another load from the same
+        file, until the load has completed. To load several resources in
+        parallel from one large file, open the file once for each request.
+
+SEE ALSO:
+MGL_loadAsync, MGL_pollAsyncLoads, MGL_getAsyncLoad
+****************************************************************************/
+ulong MGLAPI MGL_loadAsyncExt(
+    int type,
+    FILE *f,
+    ulong dwOffset,
+    ulong dwSize,
+    int param,
+    asynccallback_t callback,
+    void *cookie)
+{
+    return queueLoad(type,NULL,f,dwOffset,dwSize,param,callback,cookie);
+}
+
+/****************************************************************************
+DESCRIPTION:
+Calls the completion callbacks for all completed asynchronous loads.
+
+HEADER:
+mgraph.h
+
+RETURNS:
+Number of completion callbacks that were called.
+
+REMARKS:
+This function calls the completion callback for every asynchronous load
+that has completed since the last call, on the calling thread. You would
+normally call this once per frame from your main loop. Completed loads that
+were queued without a callback are left in the completion queue, to be
+retrieved with MGL_getAsyncLoad.
+
+If there are no loader threads, this function first loads the next pending
+request on the calling thread, so that loads still complete one at a time
+on systems without threads.
+
+SEE ALSO:
+MGL_loadAsync, MGL_getAsyncLoad, MGL_pendingAsyncLoads
+****************************************************************************/
+int MGLAPI MGL_pollAsyncLoads(void)
+{
+    asyncRequest    *r;
+    int             count = 0;
+
+    loadOnCaller();
+    for (;;) {
+        lockQueues();
+        r = dequeue(&completed,DQ_CALLBACK);
+        unlockQueues();
+        if (!r)
+            break;
+        outstanding--;
+        r->callback(&r->load);
+        PM_free(r);
+        count++;
+        }
+    return count;
+}
+
+/****************************************************************************
+DESCRIPTION:
+Retrieves the next completed asynchronous load.
+
+HEADER:
+mgraph.h
+
+PARAMETERS:
+load    - Place to store the results of the completed load
+
+RETURNS:
+True if a completed load was returned, false if none are ready.
+
+REMARKS:
+This function removes the next completed asynchronous load that was queued
+without a completion callback from the completion queue, and copies the
+results into the load parameter. Loads are returned in the order that they
+complete, which is not necessarily the order that they were queued in, so
+use the id or cookie members to match them to your requests.
+
+If there are no loader threads, this function first loads the next pending
+request on the calling thread.
+
+SEE ALSO:
+MGL_loadAsync, MGL_pollAsyncLoads, MGL_pendingAsyncLoads
+****************************************************************************/
+ibool MGLAPI MGL_getAsyncLoad(
+    async_load_t *load)
+{
+    asyncRequest    *r;
+
+    loadOnCaller();
+    lockQueues();
+    r = dequeue(&completed,DQ_NOCALLBACK);
+    unlockQueues();
+    if (!r)
+        return false;
+    outstanding--;
+    *load = r->load;
+    PM_free(r);
+    return true;
+}
+
+/****************************************************************************
+DESCRIPTION:
+Returns the number of asynchronous loads that have not been handed back.
+
+HEADER:
+mgraph.h
+
+RETURNS:
+Number of queued loads not yet returned to the application.
+
+REMARKS:
+This function returns the number of asynchronous loads that have been
+queued, but have not yet been handed back to the application through a
+completion callback or MGL_getAsyncLoad. This includes loads that are
+still waiting to be started, loads in progress and loads that have
+completed but have not yet been polled for, so it is useful for driving
+a progress bar while loading a level.
+
+SEE ALSO:
+MGL_loadAsync, MGL_pollAsyncLoads, MGL_getAsyncLoad
+****************************************************************************/
+int MGLAPI MGL_pendingAsyncLoads(void)
+{
+    return outstanding;
+}
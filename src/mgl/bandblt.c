@@ -0,0 +1,721 @@
+/****************************************************************************
+*
+*                   SciTech Multi-platform Graphics Library
+*
+*  ========================================================================
+*
+*   Copyright (C) 1991-2004 SciTech Software, Inc. All rights reserved.
+*
+*   This file may be distributed and/or modified under the terms of the
+*   GNU General Public License version 2.0 as published by the Free
+*   Software Foundation and appearing in the file LICENSE.GPL included
+*   in the packaging of this file.
+*
+*   Licensees holding a valid Commercial License for this product from
+*   SciTech Software, Inc. may use this file in accordance with the
+*   Commercial License Agreement provided with the Software.
+*
+*   This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING
+*   THE WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+*   PURPOSE.
+*
+*   See http://www.scitechsoft.com/license/ for information about
+*   the licensing options available and how to purchase a Commercial
+*   License Agreement.
+*
+*   Contact license@scitechsoft.com if any conditions of this licensing
+*   are not clear to you, or you have questions about licensing options.
+*
+*  ========================================================================
+*
+* Language:     ANSI C
+* Environment:  Any
+*
+* Description:  Multi-threaded band split blitting for large blits
+*               between system memory surfaces. These routines are used
+*               by the regular blit functions once clipping to the source
+*               has been done, and handle the destination clipping and
+*               pixel format conversion themselves so that each band can
+*               be processed independently on a different thread without
+*               touching the (non re-entrant) rendering vectors. If a blit
+*               cannot be handled here, false is returned and the caller
+*               falls back on the regular single threaded code.
+*
+*               Blits from RGB sources that need dithering to 8, 15 or
+*               16 bits per pixel are always handled here (even if they
+*               are too small to split into bands), so that they can use
+*               the span dithering kernels. Alpha blended blits are also
+*               handled here when linear light mode is enabled, so that
+*               they can be blended in linear light.
+*
+****************************************************************************/
+
+#include "mgl.h"
+
+/*--------------------------- Global Variables ----------------------------*/
+
+#define BAND_CHUNK      256         /* Pixels converted per inner loop      */
+
+#define BAND_COPY       0           /* Straight copy, no translation        */
+#define BAND_LUT        1           /* 8bpp source translated via table     */
+#define BAND_CONVERT    2           /* RGB to RGB pixel format conversion   */
+#define BAND_DITHER     3           /* RGB dithered to 8/15/16bpp           */
+#define BAND_BLEND      4           /* RGB blended in linear light          */
+
+typedef struct {
+    uchar           *src;           /* Source surface                       */
+    int             srcPitch;       /* Source bytes per line                */
+    int             srcBytes;       /* Source bytes per pixel               */
+    pixel_format_t  srcPF;          /* Source pixel format                  */
+    ibool           srcAlpha;       /* True if source alpha is used         */
+    ibool           srcRGB;         /* True if source is 0x00RRGGBB         */
+    uchar           *dst;           /* Destination surface                  */
+    int             dstPitch;       /* Destination bytes per line           */
+    int             dstBytes;       /* Destination bytes per pixel          */
+    pixel_format_t  dstPF;          /* Destination pixel format             */
+    int             mode;           /* Translation mode (BAND_*)            */
+    M_uint32        lut[256];       /* Translation table for BAND_LUT       */
+    rect_t          d;              /* Full destination rectangle (screen)  */
+    rect_t          clip;           /* Clipped destination rectangle        */
+    region_t        *region;        /* Complex clip region or NULL          */
+    int             srcLeft;        /* Source pixel for d.left              */
+    int             srcTop;         /* Source scanline for d.top            */
+    int             srcWidth;       /* Source width (for stretching)        */
+    int             srcHeight;      /* Source height (for stretching)       */
+    int             *xmap;          /* Source x for each clipped dst x      */
+    ibool           useThreads;     /* True to split into bands             */
+    MGL_dither      dither;         /* Dither information for BAND_DITHER   */
+    int             constAlpha;     /* Constant alpha or -1 for BAND_BLEND  */
+    ibool           blendAlpha;     /* True to blend destination alpha      */
+    } bandBlt;
+
+/*------------------------- Implementation --------------------------------*/
+
+/****************************************************************************
+REMARKS:
+Reads a run of pixels into a buffer of 32-bit values. If xmap is not NULL
+it contains the source pixel to read for every destination pixel,
+otherwise the pixels are read sequentially.
+****************************************************************************/
+static void readPixels(
+    int bytes,
+    uchar *s,
+    int *xmap,
+    int count,
+    M_uint32 *p)
+{
+    int i;
+
+    switch (bytes) {
+        case 1:
+            if (xmap) { for (i = 0; i < count; i++) p[i] = s[xmap[i]]; }
+            else      { for (i = 0; i < count; i++) p[i] = s[i]; }
+            break;
+        case 2:
+            if (xmap) { for (i = 0; i < count; i++) p[i] = ((ushort*)s)[xmap[i]]; }
+            else      { for (i = 0; i < count; i++) p[i] = ((ushort*)s)[i]; }
+            break;
+        case 3:
+            for (i = 0; i < count; i++) {
+                uchar *q = s + (xmap ? xmap[i] : i) * 3;
+                p[i] = q[0] | ((M_uint32)q[1] << 8) | ((M_uint32)q[2] << 16);
+                }
+            break;
+        case 4:
+            if (xmap) { for (i = 0; i < count; i++) p[i] = ((M_uint32*)s)[xmap[i]]; }
+            else      { for (i = 0; i < count; i++) p[i] = ((M_uint32*)s)[i]; }
+            break;
+        }
+}
+
+/****************************************************************************
+REMARKS:
+Translates a buffer of source pixels into destination pixels in place.
+****************************************************************************/
+static void translatePixels(
+    bandBlt *b,
+    int count,
+    M_uint32 *p)
+{
+    uchar   A,R,G,B;
+    int     i;
+
+    if (b->mode == BAND_LUT) {
+        for (i = 0; i < count; i++)
+            p[i] = b->lut[p[i] & 0xFF];
+        }
+    else if (b->mode == BAND_CONVERT) {
+        for (i = 0; i < count; i++) {
+            MGL_unpackColorFastExt(&b->srcPF,p[i],A,R,G,B);
+            if (!b->srcAlpha)
+                A = 0xFF;
+            p[i] = MGL_packColorFastExt(&b->dstPF,A,R,G,B);
+            }
+        }
+    else if (b->mode == BAND_DITHER && !b->srcRGB) {
+        for (i = 0; i < count; i++) {
+            MGL_unpackColorFastExt(&b->srcPF,p[i],A,R,G,B);
+            p[i] = ((M_uint32)R << 16) | ((M_uint32)G << 8) | B;
+            }
+        }
+    else if (b->mode == BAND_BLEND) {
+        for (i = 0; i < count; i++) {
+            MGL_unpackColorFastExt(&b->srcPF,p[i],A,R,G,B);
+            if (!b->srcAlpha)
+                A = 0xFF;
+            p[i] = ((M_uint32)A << 24) | ((M_uint32)R << 16) | ((M_uint32)G << 8) | B;
+            }
+        }
+}
+
+/****************************************************************************
+REMARKS:
+Writes a buffer of 32-bit destination pixel values to the destination.
+****************************************************************************/
+static void writePixels(
+    bandBlt *b,
+    uchar *d,
+    int count,
+    M_uint32 *p)
+{
+    int i;
+
+    switch (b->dstBytes) {
+        case 1:
+            for (i = 0; i < count; i++)
+                d[i] = (uchar)p[i];
+            break;
+        case 2:
+            for (i = 0; i < count; i++)
+                ((ushort*)d)[i] = (ushort)p[i];
+            break;
+        case 3:
+            for (i = 0; i < count; i++, d += 3) {
+                d[0] = (uchar)p[i];
+                d[1] = (uchar)(p[i] >> 8);
+                d[2] = (uchar)(p[i] >> 16);
+                }
+            break;
+        case 4:
+            memcpy(d,p,count * 4);
+            break;
+        }
+}
+
+/****************************************************************************
+REMARKS:
+Blends a buffer of ARGB source pixels with the destination pixels in
+linear light and writes the results back to the destination.
+****************************************************************************/
+static void blendPixels(
+    bandBlt *b,
+    uchar *d,
+    int count,
+    M_uint32 *p)
+{
+    M_uint32    buf[BAND_CHUNK];
+    uchar       A,R,G,B;
+    int         i;
+
+    readPixels(b->dstBytes,d,NULL,count,buf);
+    for (i = 0; i < count; i++) {
+        MGL_unpackColorFastExt(&b->dstPF,buf[i],A,R,G,B);
+        buf[i] = ((M_uint32)A << 24) | ((M_uint32)R << 16) | ((M_uint32)G << 8) | B;
+        }
+    _MGL_blendLinearSpan(buf,p,count,b->constAlpha,b->blendAlpha);
+    for (i = 0; i < count; i++) {
+        A = (uchar)(buf[i] >> 24);
+        R = (uchar)(buf[i] >> 16);
+        G = (uchar)(buf[i] >> 8);
+        B = (uchar)buf[i];
+        buf[i] = MGL_packColorFastExt(&b->dstPF,A,R,G,B);
+        }
+    writePixels(b,d,count,buf);
+}
+
+/****************************************************************************
+REMARKS:
+Blits a single destination rectangle (in screen coordinates), which has
+already been clipped, mapping back to the source as necessary.
+****************************************************************************/
+static void blitRect(
+    bandBlt *b,
+    rect_t *r)
+{
+    M_uint32    buf[BAND_CHUNK];
+    uchar       *s,*d;
+    int         *xmap = NULL;
+    int         x,y,sy,count,width = r->right - r->left;
+    int         dstHeight = b->d.bottom - b->d.top;
+
+    for (y = r->top; y < r->bottom; y++) {
+        d = PIXEL_ADDR(r->left,y,b->dst,b->dstPitch,b->dstBytes*8);
+        if (b->xmap) {
+            sy = b->srcTop + (int)(((2L * (y - b->d.top) + 1) * b->srcHeight) / (2L * dstHeight));
+            s = Y_ADDR(sy,b->src,b->srcPitch);
+            xmap = b->xmap + (r->left - b->clip.left);
+            }
+        else {
+            sy = b->srcTop + (y - b->d.top);
+            s = PIXEL_ADDR(b->srcLeft + (r->left - b->d.left),sy,b->src,b->srcPitch,b->srcBytes*8);
+            if (b->mode == BAND_COPY) {
+                memcpy(d,s,width * b->dstBytes);
+                continue;
+                }
+            }
+        for (x = 0; x < width; x += count) {
+            count = MIN(width - x,BAND_CHUNK);
+            readPixels(b->srcBytes,xmap ? s : s + x * b->srcBytes,xmap ? xmap + x : NULL,count,buf);
+            translatePixels(b,count,buf);
+            if (b->mode == BAND_DITHER)
+                _MGL_ditherSpan(&b->dither,d + x * b->dstBytes,buf,r->left + x,y,count);
+            else if (b->mode == BAND_BLEND)
+                blendPixels(b,d + x * b->dstBytes,count,buf);
+            else
+                writePixels(b,d + x * b->dstBytes,count,buf);
+            }
+        }
+}
+
+/****************************************************************************
+REMARKS:
+Band function called on each thread to blit the scanlines from top to
+bottom, clipped to the destination clip rectangle or clip region.
+****************************************************************************/
+static void blitBand(
+    void *ctx,
+    int top,
+    int bottom)
+{
+    bandBlt *b = (bandBlt*)ctx;
+    rect_t  band,clip,r;
+
+    band.left = b->clip.left;
+    band.right = b->clip.right;
+    band.top = top;
+    band.bottom = bottom;
+    if (b->region) {
+        BEGIN_CLIP_REGION(clip,b->region);
+            if (MGL_sectRect(clip,band,&r))
+                blitRect(b,&r);
+        END_CLIP_REGION();
+        }
+    else
+        blitRect(b,&band);
+}
+
+/****************************************************************************
+REMARKS:
+Sets up the source and destination surface information for a blit.
+****************************************************************************/
+static void setupSurfaces(
+    bandBlt *b,
+    MGLDC *dst,
+    void *surface,
+    int bytesPerLine,
+    int bitsPerPixel,
+    long pixels)
+{
+    b->src = surface;
+    b->srcPitch = bytesPerLine;
+    b->srcBytes = (bitsPerPixel + 7) / 8;
+    b->dst = dst->surface;
+    b->dstPitch = dst->mi.bytesPerLine;
+    b->dstBytes = (dst->mi.bitsPerPixel + 7) / 8;
+    b->dstPF = dst->pf;
+    b->region = dst->clipRegionScreen;
+    b->xmap = NULL;
+    b->useThreads = _MGL_useBandThreads(pixels);
+}
+
+/****************************************************************************
+RETURNS:
+True if the blit can be handled by the band blitter, false if not.
+
+REMARKS:
+Sets up the source and destination information and works out how pixels
+need to be translated from the source to the destination. The translation
+rules follow the regular blit code. Blits that need dithering use the span
+dithering kernels if the destination format is supported, and any other
+blit that would need dithering or closest color matching to a color index
+destination is rejected. If the blit is too small to split into bands,
+only dithered blits are accepted.
+****************************************************************************/
+static ibool setupBandBlt(
+    bandBlt *b,
+    MGLDC *dst,
+    void *surface,
+    int bytesPerLine,
+    int bitsPerPixel,
+    pixel_format_t *pf,
+    palette_t *pal,
+    ibool translate,
+    int op,
+    long pixels)
+{
+    int i;
+
+    if (op != MGL_REPLACE_MODE || dst->deviceType != MGL_MEMORY_DEVICE
+            || bitsPerPixel < 8 || dst->mi.bitsPerPixel < 8)
+        return false;
+    setupSurfaces(b,dst,surface,bytesPerLine,bitsPerPixel,pixels);
+    if (!translate) {
+        b->mode = BAND_COPY;
+        return b->useThreads;
+        }
+    if (bitsPerPixel == 8) {
+        if (!b->useThreads || (dst->mi.modeFlags & MGL_IS_COLOR_INDEX))
+            return false;
+        b->mode = BAND_LUT;
+        for (i = 0; i < 256; i++) {
+            if (!_MGL_checkIdentityPal || !pal)
+                b->lut[i] = dst->colorTab[i];
+            else
+                b->lut[i] = MGL_packColorFastExt(&b->dstPF,0xFF,pal[i].red,pal[i].green,pal[i].blue);
+            }
+        return true;
+        }
+    if (bitsPerPixel == 16 && pf->alphaPos == 8)
+        return false;
+    if (_MGL_setupDither(dst,&b->dither,bitsPerPixel)) {
+        b->mode = BAND_DITHER;
+        b->srcPF = *pf;
+        b->srcRGB = (bitsPerPixel >= 24 && pf->redPos == 16 && pf->greenPos == 8
+            && pf->bluePos == 0 && pf->redMask == 0xFF && pf->greenMask == 0xFF
+            && pf->blueMask == 0xFF);
+        return true;
+        }
+    if (!b->useThreads || (dst->mi.modeFlags & MGL_IS_COLOR_INDEX))
+        return false;
+    if (dst->a.ditherMode && dst->mi.bitsPerPixel <= 16 && bitsPerPixel >= 24)
+        return false;
+    b->mode = BAND_CONVERT;
+    b->srcPF = *pf;
+    b->srcAlpha = (b->srcBytes == 4 && pf->alphaMask != 0);
+    return true;
+}
+
+/****************************************************************************
+RETURNS:
+True if the blend can be handled by the band blitter, false if not.
+
+REMARKS:
+Sets up the source and destination information for a linear light alpha
+blended blit. Only source alpha and constant alpha blending from an RGB
+source to an RGB memory device context with no other effects is handled
+here, and everything else is left for the regular effects blit code.
+****************************************************************************/
+static ibool setupBandBlend(
+    bandBlt *b,
+    MGLDC *dst,
+    void *surface,
+    int bytesPerLine,
+    int bitsPerPixel,
+    pixel_format_t *pf,
+    bltfx_t *fx,
+    long pixels)
+{
+    int srcFunc = fx->srcBlendFunc,dstFunc = fx->dstBlendFunc;
+
+    if (!dst->a.linearLight || (fx->flags & ~MGL_BLT_WRITE_MODE_ENABLE) != MGL_BLT_BLEND
+            || ((fx->flags & MGL_BLT_WRITE_MODE_ENABLE) && fx->writeMode != MGL_REPLACE_MODE)
+            || dst->deviceType != MGL_MEMORY_DEVICE || bitsPerPixel < 15
+            || dst->mi.bitsPerPixel < 15 || (dst->mi.modeFlags & MGL_IS_COLOR_INDEX)
+            || (bitsPerPixel == 16 && pf->alphaPos == 8))
+        return false;
+    if ((srcFunc == MGL_BLEND_SRCALPHA && dstFunc == MGL_BLEND_ONEMINUSSRCALPHA)
+            || (srcFunc == MGL_BLEND_SRCALPHAFAST && dstFunc == MGL_BLEND_SRCALPHAFAST))
+        b->constAlpha = -1;
+    else if ((srcFunc == MGL_BLEND_CONSTANTALPHA && dstFunc == MGL_BLEND_ONEMINUSCONSTANTALPHA)
+            || (srcFunc == MGL_BLEND_CONSTANTALPHAFAST && dstFunc == MGL_BLEND_CONSTANTALPHAFAST))
+        b->constAlpha = fx->constAlpha & 0xFF;
+    else
+        return false;
+    b->blendAlpha = (srcFunc != MGL_BLEND_SRCALPHAFAST && srcFunc != MGL_BLEND_CONSTANTALPHAFAST);
+    setupSurfaces(b,dst,surface,bytesPerLine,bitsPerPixel,pixels);
+    b->mode = BAND_BLEND;
+    b->srcPF = *pf;
+    b->srcAlpha = (b->srcBytes == 4 && pf->alphaMask != 0);
+    _MGL_initLinearLight();
+    return true;
+}
+
+/****************************************************************************
+RETURNS:
+True if the blit was done, false if it could not be handled.
+
+REMARKS:
+Clips the destination rectangle (in screen coordinates) to the destination
+clip rectangle and splits the blit into bands across the worker threads.
+Error diffusion has to run from the top down, so it is always done on the
+calling thread.
+****************************************************************************/
+static ibool runBandBlt(
+    bandBlt *b,
+    MGLDC *dst)
+{
+    int i;
+
+    if (!MGL_sectRect(dst->clipRectScreen,b->d,&b->clip))
+        return true;
+    if (b->srcWidth != (b->d.right - b->d.left) || b->srcHeight != (b->d.bottom - b->d.top)) {
+        /* Pre-compute the source pixel for every destination column */
+        if ((b->xmap = PM_malloc(sizeof(int) * (b->clip.right - b->clip.left))) == NULL)
+            return false;
+        for (i = b->clip.left; i < b->clip.right; i++) {
+            b->xmap[i - b->clip.left] = b->srcLeft + (int)(((2L * (i - b->d.left) + 1) * b->srcWidth)
+                / (2L * (b->d.right - b->d.left)));
+            }
+        }
+    if (b->useThreads && !(b->mode == BAND_DITHER && b->dither.diffuse))
+        _MGL_runBands(b->clip.top,b->clip.bottom,blitBand,b);
+    else
+        blitBand(b,b->clip.top,b->clip.bottom);
+    if (b->xmap) {
+        PM_free(b->xmap);
+        b->xmap = NULL;
+        }
+    return true;
+}
+
+/****************************************************************************
+PARAMETERS:
+dst     - Destination device context
+src     - Source device context
+left    - Left coordinate of source (clipped, viewport coordinates)
+top     - Top coordinate of source (clipped, viewport coordinates)
+right   - Right coordinate of source (clipped, viewport coordinates)
+bottom  - Bottom coordinate of source (clipped, viewport coordinates)
+dstLeft - Left coordinate of destination (viewport coordinates)
+dstTop  - Top coordinate of destination (viewport coordinates)
+op      - Write mode for the blit
+
+RETURNS:
+True if the blit was done, false if the caller needs to do it.
+
+REMARKS:
+Band split version of MGL_bitBltCoord for memory device contexts.
+****************************************************************************/
+ibool _MGL_bandBitBlt(
+    MGLDC *dst,
+    MGLDC *src,
+    int left,
+    int top,
+    int right,
+    int bottom,
+    int dstLeft,
+    int dstTop,
+    int op)
+{
+    bandBlt b;
+
+    if (src == dst || src->deviceType != MGL_MEMORY_DEVICE)
+        return false;
+    if (!setupBandBlt(&b,dst,src->surface,src->mi.bytesPerLine,src->mi.bitsPerPixel,
+            &src->pf,TO_PAL(src->colorTab),NEED_TRANSLATE_DC(src,dst),op,
+            (long)(right - left) * (bottom - top)))
+        return false;
+    b.srcLeft = left + src->viewPort.left;
+    b.srcTop = top + src->viewPort.top;
+    b.srcWidth = right - left;
+    b.srcHeight = bottom - top;
+    b.d.left = dstLeft + dst->viewPort.left;
+    b.d.top = dstTop + dst->viewPort.top;
+    b.d.right = b.d.left + b.srcWidth;
+    b.d.bottom = b.d.top + b.srcHeight;
+    return runBandBlt(&b,dst);
+}
+
+/****************************************************************************
+PARAMETERS:
+dst         - Destination device context
+src         - Source device context
+left        - Left coordinate of source (clipped, viewport coordinates)
+top         - Top coordinate of source (clipped, viewport coordinates)
+right       - Right coordinate of source (clipped, viewport coordinates)
+bottom      - Bottom coordinate of source (clipped, viewport coordinates)
+dstLeft     - Left coordinate of destination (viewport coordinates)
+dstTop      - Top coordinate of destination (viewport coordinates)
+dstRight    - Right coordinate of destination (viewport coordinates)
+dstBottom   - Bottom coordinate of destination (viewport coordinates)
+op          - Write mode for the blit
+
+RETURNS:
+True if the blit was done, false if the caller needs to do it.
+
+REMARKS:
+Band split version of MGL_stretchBltCoord for memory device contexts,
+using nearest pixel stretching.
+****************************************************************************/
+ibool _MGL_bandStretchBlt(
+    MGLDC *dst,
+    MGLDC *src,
+    int left,
+    int top,
+    int right,
+    int bottom,
+    int dstLeft,
+    int dstTop,
+    int dstRight,
+    int dstBottom,
+    int op)
+{
+    bandBlt b;
+
+    if (src == dst || src->deviceType != MGL_MEMORY_DEVICE
+            || dstRight <= dstLeft || dstBottom <= dstTop)
+        return false;
+    if (!setupBandBlt(&b,dst,src->surface,src->mi.bytesPerLine,src->mi.bitsPerPixel,
+            &src->pf,TO_PAL(src->colorTab),NEED_TRANSLATE_DC(src,dst),op,
+            (long)(dstRight - dstLeft) * (dstBottom - dstTop)))
+        return false;
+    b.srcLeft = left + src->viewPort.left;
+    b.srcTop = top + src->viewPort.top;
+    b.srcWidth = right - left;
+    b.srcHeight = bottom - top;
+    b.d.left = dstLeft + dst->viewPort.left;
+    b.d.top = dstTop + dst->viewPort.top;
+    b.d.right = dstRight + dst->viewPort.left;
+    b.d.bottom = dstBottom + dst->viewPort.top;
+    return runBandBlt(&b,dst);
+}
+
+/****************************************************************************
+PARAMETERS:
+dc          - Destination device context
+left        - Left coordinate of bitmap section (clipped)
+top         - Top coordinate of bitmap section (clipped)
+right       - Right coordinate of bitmap section (clipped)
+bottom      - Bottom coordinate of bitmap section (clipped)
+dstLeft     - Left coordinate of destination (viewport coordinates)
+dstTop      - Top coordinate of destination (viewport coordinates)
+bitmap      - Bitmap to draw
+op          - Write mode for the blit
+
+RETURNS:
+True if the blit was done, false if the caller needs to do it.
+
+REMARKS:
+Band split version of MGL_putBitmapSection for memory device contexts.
+****************************************************************************/
+ibool _MGL_bandPutBitmap(
+    MGLDC *dc,
+    int left,
+    int top,
+    int right,
+    int bottom,
+    int dstLeft,
+    int dstTop,
+    const bitmap_t *bitmap,
+    int op)
+{
+    bandBlt b;
+
+    if (!setupBandBlt(&b,dc,bitmap->surface,bitmap->bytesPerLine,bitmap->bitsPerPixel,
+            bitmap->pf,bitmap->pal,NEED_TRANSLATE_BM(bitmap,dc),op,
+            (long)(right - left) * (bottom - top)))
+        return false;
+    b.srcLeft = left;
+    b.srcTop = top;
+    b.srcWidth = right - left;
+    b.srcHeight = bottom - top;
+    b.d.left = dstLeft + dc->viewPort.left;
+    b.d.top = dstTop + dc->viewPort.top;
+    b.d.right = b.d.left + b.srcWidth;
+    b.d.bottom = b.d.top + b.srcHeight;
+    return runBandBlt(&b,dc);
+}
+
+/****************************************************************************
+PARAMETERS:
+dst     - Destination device context
+src     - Source device context
+left    - Left coordinate of source (clipped, viewport coordinates)
+top     - Top coordinate of source (clipped, viewport coordinates)
+right   - Right coordinate of source (clipped, viewport coordinates)
+bottom  - Bottom coordinate of source (clipped, viewport coordinates)
+dstLeft - Left coordinate of destination (viewport coordinates)
+dstTop  - Top coordinate of destination (viewport coordinates)
+fx      - Blit effects to apply
+
+RETURNS:
+True if the blit was done, false if the caller needs to do it.
+
+REMARKS:
+Linear light blending version of MGL_bitBltFxCoord for memory device
+contexts.
+****************************************************************************/
+ibool _MGL_bandBlendBlt(
+    MGLDC *dst,
+    MGLDC *src,
+    int left,
+    int top,
+    int right,
+    int bottom,
+    int dstLeft,
+    int dstTop,
+    bltfx_t *fx)
+{
+    bandBlt b;
+
+    if (src == dst || src->deviceType != MGL_MEMORY_DEVICE)
+        return false;
+    if (!setupBandBlend(&b,dst,src->surface,src->mi.bytesPerLine,src->mi.bitsPerPixel,
+            &src->pf,fx,(long)(right - left) * (bottom - top)))
+        return false;
+    b.srcLeft = left + src->viewPort.left;
+    b.srcTop = top + src->viewPort.top;
+    b.srcWidth = right - left;
+    b.srcHeight = bottom - top;
+    b.d.left = dstLeft + dst->viewPort.left;
+    b.d.top = dstTop + dst->viewPort.top;
+    b.d.right = b.d.left + b.srcWidth;
+    b.d.bottom = b.d.top + b.srcHeight;
+    return runBandBlt(&b,dst);
+}
+
+/****************************************************************************
+PARAMETERS:
+dc          - Destination device context
+left        - Left coordinate of bitmap section (clipped)
+top         - Top coordinate of bitmap section (clipped)
+right       - Right coordinate of bitmap section (clipped)
+bottom      - Bottom coordinate of bitmap section (clipped)
+dstLeft     - Left coordinate of destination (viewport coordinates)
+dstTop      - Top coordinate of destination (viewport coordinates)
+bitmap      - Bitmap to draw
+fx          - Blit effects to apply
+
+RETURNS:
+True if the blit was done, false if the caller needs to do it.
+
+REMARKS:
+Linear light blending version of MGL_putBitmapFxSection for memory device
+contexts.
+****************************************************************************/
+ibool _MGL_bandBlendBitmap(
+    MGLDC *dc,
+    int left,
+    int top,
+    int right,
+    int bottom,
+    int dstLeft,
+    int dstTop,
+    const bitmap_t *bitmap,
+    bltfx_t *fx)
+{
+    bandBlt b;
+
+    if (!setupBandBlend(&b,dc,bitmap->surface,bitmap->bytesPerLine,bitmap->bitsPerPixel,
+            bitmap->pf,fx,(long)(right - left) * (bottom - top)))
+        return false;
+    b.srcLeft = left;
+    b.srcTop = top;
+    b.srcWidth = right - left;
+    b.srcHeight = bottom - top;
+    b.d.left = dstLeft + dc->viewPort.left;
+    b.d.top = dstTop + dc->viewPort.top;
+    b.d.right = b.d.left + b.srcWidth;
+    b.d.bottom = b.d.top + b.srcHeight;
+    return runBandBlt(&b,dc);
+}
@@ -0,0 +1,769 @@
+/****************************************************************************
+*
+*                   SciTech Multi-platform Graphics Library
+*
+*  ========================================================================
+*
+*   Copyright (C) 1991-2004 SciTech Software, Inc. All rights reserved.
+*
+*   This file may be distributed and/or modified under the terms of the
+*   GNU General Public License version 2.0 as published by the Free
+*   Software Foundation and appearing in the file LICENSE.GPL included
+*   in the packaging of this file.
+*
+*   Licensees holding a valid Commercial License for this product from
+*   SciTech Software, Inc. may use this file in accordance with the
+*   Commercial License Agreement provided with the Software.
+*
+*   This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING
+*   THE WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+*   PURPOSE.
+*
+*   See http://www.scitechsoft.com/license/ for information about
+*   the licensing options available and how to purchase a Commercial
+*   License Agreement.
+*
+*   Contact license@scitechsoft.com if any conditions of this licensing
+*   are not clear to you, or you have questions about licensing options.
+*
+*  ========================================================================
+*
+* Language:     ANSI C
+* Environment:  Any
+*
+* Description:  Blit and fill command batching. Commands queued between
+*               MGL_beginBatch and MGL_endBatch are clipped when they are
+*               queued, and then grouped by source surface, write mode
+*               and color when the batch is submitted. A command is only
+*               ever moved ahead of commands that it does not overlap,
+*               so the final image is identical to drawing the commands
+*               in the order they were queued. Each group is then drawn
+*               with a single hardware and state setup, and adjacent
+*               fills of the same color are merged into a single fill.
+*
+****************************************************************************/
+
+#include "mgl.h"
+
+/*--------------------------- Global Variables ----------------------------*/
+
+#define BATCH_FILL      0           /* Solid rectangle fill             */
+#define BATCH_BITMAP    1           /* Section of a lightweight bitmap  */
+#define BATCH_BLT       2           /* Section of a device context      */
+
+#define BATCH_GROW      256         /* Commands to grow queue by        */
+
+typedef struct {
+    int         type;           /* Type of batched command              */
+    const void  *src;           /* Source bitmap or device context      */
+    color_t     color;          /* Color for fill commands              */
+    int         op;             /* Write mode for the command           */
+    int         srcLeft;        /* Source coordinates for the command   */
+    int         srcTop;
+    rect_t      d;              /* Clipped destination (viewport space) */
+    int         next;           /* Next command in the same group       */
+    } batchCmd;
+
+typedef struct {
+    int         first;          /* First command in the group           */
+    int         last;           /* Last command in the group            */
+    rect_t      bounds;         /* Bounding rectangle for the group     */
+    } batchGroup;
+
+static MGLDC        *batchDC = NULL;
+static rect_t       batchView;
+static rect_t       batchClip;
+static batchCmd     *cmds = NULL;
+static int          numCmds = 0;
+static int          maxCmds = 0;
+
+/*------------------------- Implementation --------------------------------*/
+
+/****************************************************************************
+REMARKS:
+Returns true if two commands can be drawn with the same state setup.
+****************************************************************************/
+static ibool sameState(
+    batchCmd *c1,
+    batchCmd *c2)
+{
+    return (c1->type == c2->type && c1->src == c2->src && c1->op == c2->op
+        && (c1->type != BATCH_FILL || c1->color == c2->color));
+}
+
+/****************************************************************************
+REMARKS:
+Appends command c to the end of group g. If the command is a fill that
+exactly abuts the last fill in the group, the two fills are merged.
+****************************************************************************/
+static void appendToGroup(
+    batchGroup *g,
+    int c)
+{
+    batchCmd    *last = &cmds[g->last],*cmd = &cmds[c];
+
+    if (cmd->type == BATCH_FILL) {
+        if (last->d.top == cmd->d.top && last->d.bottom == cmd->d.bottom
+                && (last->d.right == cmd->d.left || last->d.left == cmd->d.right)) {
+            last->d.left = MIN(last->d.left,cmd->d.left);
+            last->d.right = MAX(last->d.right,cmd->d.right);
+            MGL_unionRect(g->bounds,last->d,&g->bounds);
+            return;
+            }
+        if (last->d.left == cmd->d.left && last->d.right == cmd->d.right
+                && (last->d.bottom == cmd->d.top || last->d.top == cmd->d.bottom)) {
+            last->d.top = MIN(last->d.top,cmd->d.top);
+            last->d.bottom = MAX(last->d.bottom,cmd->d.bottom);
+            MGL_unionRect(g->bounds,last->d,&g->bounds);
+            return;
+            }
+        }
+    cmds[g->last].next = c;
+    g->last = c;
+    MGL_unionRect(g->bounds,cmd->d,&g->bounds);
+}
+
+/****************************************************************************
+PARAMETERS:
+groups  - Array of groups to build
+RETURNS:
+Number of groups built.
+
+REMARKS:
+Sorts the queued commands into groups that share the same state. Each
+command is appended to the most recent group with the same state, as long
+as it does not overlap any command in the groups that come after that
+group. Otherwise a new group is started, which preserves the drawing order
+for all overlapping commands.
+****************************************************************************/
+static int buildGroups(
+    batchGroup *groups)
+{
+    int         i,j,k,numGroups = 0;
+    batchGroup  *g;
+
+    for (i = 0; i < numCmds; i++) {
+        cmds[i].next = -1;
+        for (j = numGroups-1; j >= 0; j--) {
+            g = &groups[j];
+            if (sameState(&cmds[g->first],&cmds[i])) {
+                appendToGroup(g,i);
+                break;
+                }
+            if (!MGL_disjointRect(g->bounds,cmds[i].d)) {
+                for (k = g->first; k != -1; k = cmds[k].next) {
+                    if (!MGL_disjointRect(cmds[k].d,cmds[i].d))
+                        break;
+                    }
+                if (k != -1) {
+                    j = -1;
+                    break;
+                    }
+                }
+            }
+        if (j < 0) {
+            g = &groups[numGroups++];
+            g->first = g->last = i;
+            g->bounds = cmds[i].d;
+            }
+        }
+    return numGroups;
+}
+
+/****************************************************************************
+REMARKS:
+Draws a single solid rectangle in viewport space with the current color
+and write mode for the device context, clipped to the screen space clip
+rectangle or clip region.
+****************************************************************************/
+static void fillRect(
+    MGLDC *dc,
+    rect_t d)
+{
+    rect_t  r,clip;
+
+    MGL_offsetRect(d,dc->viewPort.left,dc->viewPort.top);
+    MARK_DIRTY(dc,d.left,d.top,d.right,d.bottom);
+    if (dc->clipRegionScreen) {
+        BEGIN_CLIP_REGION(clip,dc->clipRegionScreen);
+            if (MGL_sectRect(clip,d,&r))
+                dc->r.solid.DrawRect(r.left,r.top,r.right-r.left,r.bottom-r.top);
+        END_CLIP_REGION();
+        }
+    else if (MGL_sectRect(dc->clipRectScreen,d,&r))
+        dc->r.solid.DrawRect(r.left,r.top,r.right-r.left,r.bottom-r.top);
+}
+
+/****************************************************************************
+REMARKS:
+Draws all the fills in a group with a single state setup.
+****************************************************************************/
+static void drawFills(
+    MGLDC *dc,
+    int first)
+{
+    int     i;
+
+    BEGIN_VISIBLE_CLIP_LIST(dc);
+    dc->r.SetMix(cmds[first].op);
+    dc->r.SetForeColor(cmds[first].color);
+    for (i = first; i != -1; i = cmds[i].next)
+        fillRect(dc,cmds[i].d);
+    END_VISIBLE_CLIP_LIST(dc);
+}
+
+/****************************************************************************
+REMARKS:
+Draws all the bitmap sections in a group. If the bitmap does not need any
+translation and the destination does not need complex clipping, the
+pre-clipped sections are handed straight to the driver, otherwise they are
+drawn with MGL_putBitmapSection.
+****************************************************************************/
+static void drawBitmaps(
+    MGLDC *dc,
+    int first)
+{
+    const bitmap_t  *bitmap = cmds[first].src;
+    batchCmd        *cmd;
+    int             i,x,y,width,height;
+
+    if (bitmap->bitsPerPixel == 1 || dc->clipRegionScreen
+            || dc->deviceType == MGL_WINDOWED_DEVICE
+            || NEED_TRANSLATE_BM(bitmap,dc)) {
+        for (i = first; i != -1; i = cmd->next) {
+            cmd = &cmds[i];
+            MGL_putBitmapSection(dc,cmd->srcLeft,cmd->srcTop,
+                cmd->srcLeft + (cmd->d.right - cmd->d.left),
+                cmd->srcTop + (cmd->d.bottom - cmd->d.top),
+                cmd->d.left,cmd->d.top,bitmap,cmd->op);
+            }
+        return;
+        }
+    for (i = first; i != -1; i = cmd->next) {
+        cmd = &cmds[i];
+        x = cmd->d.left + dc->viewPort.left;
+        y = cmd->d.top + dc->viewPort.top;
+        width = cmd->d.right - cmd->d.left;
+        height = cmd->d.bottom - cmd->d.top;
+        MARK_DIRTY(dc,x,y,x+width,y+height);
+        dc->r.BitBltSys(bitmap->surface,bitmap->bytesPerLine,
+            cmd->srcLeft,cmd->srcTop,width,height,x,y,cmd->op,false);
+        }
+}
+
+/****************************************************************************
+REMARKS:
+Submits all the queued commands to the batch device context, and empties
+the command queue.
+****************************************************************************/
+static void flushBatch(void)
+{
+    MGLDC       *dc = batchDC;
+    batchGroup  *groups;
+    batchCmd    *cmd;
+    int         i,numGroups;
+    ibool       fills = false;
+
+    if (numCmds == 0)
+        return;
+
+    /* Group the commands by state. If we are out of memory we simply
+     * fall back on submitting each command as a group of its own.
+     */
+    if ((groups = PM_malloc(sizeof(batchGroup) * numCmds)) != NULL)
+        numGroups = buildGroups(groups);
+    else {
+        numGroups = 0;
+        for (i = 0; i < numCmds; i++)
+            cmds[i].next = -1;
+        }
+
+    /* Make the device context current once for all the commands, so that
+     * the individual blits below only need to bump the lock count.
+     */
+    MAKE_HARDWARE_CURRENT(dc,false);
+    for (i = 0; i < (groups ? numGroups : numCmds); i++) {
+        cmd = &cmds[groups ? groups[i].first : i];
+        switch (cmd->type) {
+            case BATCH_FILL:
+                drawFills(dc,cmd - cmds);
+                fills = true;
+                break;
+            case BATCH_BITMAP:
+                drawBitmaps(dc,cmd - cmds);
+                break;
+            case BATCH_BLT:
+                for (; cmd; cmd = (cmd->next == -1) ? NULL : &cmds[cmd->next]) {
+                    MGL_bitBltCoord(dc,(MGLDC*)cmd->src,cmd->srcLeft,cmd->srcTop,
+                        cmd->srcLeft + (cmd->d.right - cmd->d.left),
+                        cmd->srcTop + (cmd->d.bottom - cmd->d.top),
+                        cmd->d.left,cmd->d.top,cmd->op);
+                    }
+                break;
+            }
+        }
+    if (fills) {
+        dc->r.SetMix(dc->a.writeMode);
+        dc->r.SetForeColor(dc->a.color);
+        }
+    RESTORE_HARDWARE(dc,false);
+    if (groups)
+        PM_free(groups);
+    numCmds = 0;
+}
+
+/****************************************************************************
+PARAMETERS:
+dc  - Device context the command is being queued for
+
+RETURNS:
+Pointer to the new command, or NULL if the command should not be queued.
+
+REMARKS:
+Allocates a new command in the batch queue. If the viewport or clip
+rectangle for the batch device context has changed since the batch was
+started, the commands queued so far are submitted first, so that every
+command in the queue is clipped in the same way.
+****************************************************************************/
+static batchCmd *newCmd(
+    MGLDC *dc)
+{
+    batchCmd    *newCmds;
+
+    if (!batchDC || dc != batchDC)
+        return NULL;
+    if (!MGL_equalRect(dc->viewPort,batchView) || !MGL_equalRect(dc->clipRectView,batchClip)) {
+        flushBatch();
+        batchView = dc->viewPort;
+        batchClip = dc->clipRectView;
+        }
+    if (numCmds == maxCmds) {
+        if ((newCmds = PM_realloc(cmds,sizeof(batchCmd) * (maxCmds + BATCH_GROW))) == NULL) {
+            flushBatch();
+            if (maxCmds == 0)
+                return NULL;
+            }
+        else {
+            cmds = newCmds;
+            maxCmds += BATCH_GROW;
+            }
+        }
+    return &cmds[numCmds];
+}
+
+/****************************************************************************
+PARAMETERS:
+dc  - Device context whose viewport or clipping is about to change
+
+REMARKS:
+Submits the commands queued for the device context, if it is the batch
+device context. The queued commands are in viewport space and are drawn
+with the clipping in effect when the batch is flushed, so this must be
+called before the viewport or clipping for the device context changes.
+{secret}
+****************************************************************************/
+void _MGL_flushBatchDC(
+    MGLDC *dc)
+{
+    if (!batchDC || numCmds == 0)
+        return;
+    if (dc == batchDC || (dc == _MGL_dcPtr && batchDC == &DC)
+            || (dc == &DC && batchDC == _MGL_dcPtr))
+        flushBatch();
+}
+
+/****************************************************************************
+REMARKS:
+Frees the memory used by the batch command queue.
+{secret}
+****************************************************************************/
+void _MGL_freeBatch(void)
+{
+    if (cmds)
+        PM_free(cmds);
+    cmds = NULL;
+    numCmds = maxCmds = 0;
+    batchDC = NULL;
+}
+
+/****************************************************************************
+DESCRIPTION:
+Begins a batch of blit and fill commands.
+
+HEADER:
+mgraph.h
+
+PARAMETERS:
+dc  - Device context to batch commands for
+
+RETURNS:
+True if the batch was started, false if a batch is already active.
+
+REMARKS:
+This function starts a new batch of blit and fill commands for the
+specified device context. All commands queued with the MGL_batchBitBltCoord,
+MGL_batchPutBitmap, MGL_batchPutBitmapSection and MGL_batchFillRectCoord
+functions for this device context are clipped and queued, and are not
+drawn until MGL_endBatch is called.
+
+When the batch is submitted, the commands are grouped by source surface,
+write mode and color so that each group can be drawn with a single state
+setup, rather than making the device current and saving and restoring the
+drawing state for every single blit. Adjacent fills of the same color are
+also merged into a single fill. Commands are only ever reordered if they do
+not overlap, so the final image is exactly the same as if the commands had
+been drawn in the order they were queued. This makes batching ideal for
+drawing large numbers of small tiles and sprites every frame.
+
+Only one batch can be active at a time. The source bitmaps and device
+contexts for all queued commands must remain valid and unchanged until the
+batch is submitted. Other drawing functions are not batched, and are drawn
+immediately as usual, so you should not mix batched and unbatched drawing
+to overlapping areas of the device context within the same batch. If you
+change the viewport or clip rectangle for the device context during a
+batch, the commands queued so far are submitted before the change takes
+effect for new commands.
+
+SEE ALSO:
+MGL_endBatch, MGL_batchBitBltCoord, MGL_batchPutBitmap,
+MGL_batchPutBitmapSection, MGL_batchFillRectCoord
+****************************************************************************/
+ibool MGLAPI MGL_beginBatch(
+    MGLDC *dc)
+{
+    if (batchDC)
+        return false;
+    if (dc == _MGL_dcPtr)
+        dc = &DC;
+    batchDC = dc;
+    batchView = dc->viewPort;
+    batchClip = dc->clipRectView;
+    numCmds = 0;
+    return true;
+}
+
+/****************************************************************************
+DESCRIPTION:
+Ends a batch of blit and fill commands.
+
+HEADER:
+mgraph.h
+
+REMARKS:
+This function submits all the blit and fill commands queued since the
+batch was started with MGL_beginBatch, and ends the batch.
+
+SEE ALSO:
+MGL_beginBatch
+****************************************************************************/
+void MGLAPI MGL_endBatch(void)
+{
+    if (batchDC) {
+        flushBatch();
+        batchDC = NULL;
+        }
+}
+
+/****************************************************************************
+DESCRIPTION:
+Queues a solid rectangle fill in the current batch.
+
+HEADER:
+mgraph.h
+
+PARAMETERS:
+dc      - Device context to fill the rectangle on
+left    - Left coordinate of rectangle
+top     - Top coordinate of rectangle
+right   - Right coordinate of rectangle
+bottom  - Bottom coordinate of rectangle
+color   - Color to fill the rectangle with
+op      - Write mode to use for the fill
+
+REMARKS:
+This function queues a solid rectangle fill in the specified color and
+write mode in the current batch. Unlike MGL_fillRectCoord, the current color,
+write mode and pen style for the device context are not used, and the
+rectangle is always filled with a solid color. If no batch is active for
+the device context, the rectangle is filled immediately.
+
+SEE ALSO:
+MGL_beginBatch, MGL_endBatch, MGL_batchFillRect, MGL_fillRectCoord
+****************************************************************************/
+void MGLAPI MGL_batchFillRectCoord(
+    MGLDC *dc,
+    int left,
+    int top,
+    int right,
+    int bottom,
+    color_t color,
+    int op)
+{
+    batchCmd    *cmd;
+    rect_t      d;
+
+    if (dc == _MGL_dcPtr)
+        dc = &DC;
+    d.left = left;      d.top = top;
+    d.right = right;    d.bottom = bottom;
+    if ((cmd = newCmd(dc)) != NULL) {
+        if (!MGL_sectRect(dc->clipRectView,d,&cmd->d))
+            return;
+        cmd->type = BATCH_FILL;
+        cmd->src = NULL;
+        cmd->color = color;
+        cmd->op = op;
+        cmd->srcLeft = cmd->srcTop = 0;
+        numCmds++;
+        return;
+        }
+
+    /* Not batching for this device context, so fill it immediately */
+    MAKE_HARDWARE_CURRENT(dc,false);
+    BEGIN_VISIBLE_CLIP_LIST(dc);
+    if (MGL_sectRect(dc->clipRectView,d,&d)) {
+        dc->r.SetMix(op);
+        dc->r.SetForeColor(color);
+        fillRect(dc,d);
+        dc->r.SetMix(dc->a.writeMode);
+        dc->r.SetForeColor(dc->a.color);
+        }
+    END_VISIBLE_CLIP_LIST(dc);
+    RESTORE_HARDWARE(dc,false);
+}
+
+/****************************************************************************
+DESCRIPTION:
+Queues a solid rectangle fill in the current batch.
+
+HEADER:
+mgraph.h
+
+PARAMETERS:
+dc      - Device context to fill the rectangle on
+r       - Rectangle to fill
+color   - Color to fill the rectangle with
+op      - Write mode to use for the fill
+
+REMARKS:
+This function is the same as MGL_batchFillRectCoord, however it takes an
+entire rectangle as the parameter instead of coordinates.
+
+SEE ALSO:
+MGL_batchFillRectCoord
+****************************************************************************/
+void MGL_batchFillRect(
+    MGLDC *dc,
+    rect_t r,
+    color_t color,
+    int op);
+/* Implemented as a macro */
+
+/****************************************************************************
+DESCRIPTION:
+Queues a section of a lightweight bitmap in the current batch.
+
+HEADER:
+mgraph.h
+
+PARAMETERS:
+dc      - Device context to display bitmap on
+left    - Left coordinate of section to draw
+top     - Top coordinate of section to draw
+right   - Right coordinate of section to draw
+bottom  - Bottom coordinate of section to draw
+dstLeft - Left coordinate of destination of bitmap section
+dstTop  - Right coordinate for destination of bitmap section
+bitmap  - Bitmap to display
+op      - Write mode to use when drawing bitmap
+
+REMARKS:
+This function queues a section of a lightweight bitmap in the current
+batch, and is otherwise identical to MGL_putBitmapSection. The bitmap must
+remain valid and unchanged until the batch is submitted with MGL_endBatch.
+If no batch is active for the device context, the bitmap section is drawn
+immediately.
+
+SEE ALSO:
+MGL_beginBatch, MGL_endBatch, MGL_batchPutBitmap, MGL_putBitmapSection
+****************************************************************************/
+void MGLAPI MGL_batchPutBitmapSection(
+    MGLDC *dc,
+    int left,
+    int top,
+    int right,
+    int bottom,
+    int dstLeft,
+    int dstTop,
+    const bitmap_t *bitmap,
+    int op)
+{
+    batchCmd    *cmd;
+    rect_t      d;
+
+    if (dc == _MGL_dcPtr)
+        dc = &DC;
+    if ((cmd = newCmd(dc)) == NULL) {
+        MGL_putBitmapSection(dc,left,top,right,bottom,dstLeft,dstTop,bitmap,op);
+        return;
+        }
+
+    /* Clip the source to the bitmap and the destination to the DC */
+    if (!MGL_sectRectCoord(0,0,bitmap->width,bitmap->height,left,top,right,bottom,&d))
+        return;
+    dstLeft += (d.left - left);
+    dstTop += (d.top - top);
+    left = d.left;
+    top = d.top;
+    d.left = dstLeft;                       d.top = dstTop;
+    d.right = dstLeft + (d.right - left);   d.bottom = dstTop + (d.bottom - top);
+    if (!MGL_sectRect(dc->clipRectView,d,&cmd->d))
+        return;
+    cmd->type = BATCH_BITMAP;
+    cmd->src = bitmap;
+    cmd->color = 0;
+    cmd->op = op;
+    cmd->srcLeft = left + (cmd->d.left - dstLeft);
+    cmd->srcTop = top + (cmd->d.top - dstTop);
+    numCmds++;
+}
+
+/****************************************************************************
+DESCRIPTION:
+Queues a lightweight bitmap in the current batch.
+
+HEADER:
+mgraph.h
+
+PARAMETERS:
+dc      - Device context to display bitmap on
+x       - X coordinate to display bitmap at
+y       - Y coordinate to display bitmap at
+bitmap  - Bitmap to display
+op      - Write mode to use when drawing bitmap
+
+REMARKS:
+This function queues an entire lightweight bitmap in the current batch, and
+is otherwise identical to MGL_putBitmap. The bitmap must remain valid and
+unchanged until the batch is submitted with MGL_endBatch. If no batch is
+active for the device context, the bitmap is drawn immediately.
+
+SEE ALSO:
+MGL_beginBatch, MGL_endBatch, MGL_batchPutBitmapSection, MGL_putBitmap
+****************************************************************************/
+void MGLAPI MGL_batchPutBitmap(
+    MGLDC *dc,
+    int x,
+    int y,
+    const bitmap_t *bitmap,
+    int op)
+{
+    MGL_batchPutBitmapSection(dc,0,0,bitmap->width,bitmap->height,x,y,bitmap,op);
+}
+
+/****************************************************************************
+DESCRIPTION:
+Queues a block copy between device contexts in the current batch.
+
+HEADER:
+mgraph.h
+
+PARAMETERS:
+dst     - Destination device context
+src     - Source device context
+left    - Left coordinate of image to Blt from
+top     - Top coordinate of image to Blt from
+right   - Right coordinate of image to Blt from
+bottom  - Bottom coordinate of image to Blt from
+dstLeft - Left coordinate to Blt to
+dstTop  - Right coordinate to Blt to
+op      - Write mode to use during Blt
+
+REMARKS:
+This function queues a block copy from the source device context in the
+current batch, and is otherwise identical to MGL_bitBltCoord. The contents
+of the source device context must not change until the batch is submitted
+with MGL_endBatch. If no batch is active for the destination device
+context, or the source and destination device contexts are the same, the
+blit is performed immediately (after first submitting any queued commands
+in the latter case).
+
+SEE ALSO:
+MGL_beginBatch, MGL_endBatch, MGL_batchBitBlt, MGL_bitBltCoord
+****************************************************************************/
+void MGLAPI MGL_batchBitBltCoord(
+    MGLDC *dst,
+    MGLDC *src,
+    int left,
+    int top,
+    int right,
+    int bottom,
+    int dstLeft,
+    int dstTop,
+    int op)
+{
+    MGLDC       *s = (src == _MGL_dcPtr) ? &DC : src;
+    batchCmd    *cmd;
+    rect_t      d;
+
+    if (dst == _MGL_dcPtr)
+        dst = &DC;
+    if (s == dst && dst == batchDC)
+        flushBatch();
+    if (s == dst || (cmd = newCmd(dst)) == NULL) {
+        MGL_bitBltCoord(dst,src,left,top,right,bottom,dstLeft,dstTop,op);
+        return;
+        }
+
+    /* Clip to the source and destination device contexts */
+    d.left = left;      d.top = top;
+    d.right = right;    d.bottom = bottom;
+    if (!MGL_sectRect(s->clipRectView,d,&d))
+        return;
+    dstLeft += (d.left - left);
+    dstTop += (d.top - top);
+    left = d.left;
+    top = d.top;
+    d.left = dstLeft;                       d.top = dstTop;
+    d.right = dstLeft + (d.right - left);   d.bottom = dstTop + (d.bottom - top);
+    if (!MGL_sectRect(dst->clipRectView,d,&cmd->d))
+        return;
+    cmd->type = BATCH_BLT;
+    cmd->src = src;
+    cmd->color = 0;
+    cmd->op = op;
+    cmd->srcLeft = left + (cmd->d.left - dstLeft);
+    cmd->srcTop = top + (cmd->d.top - dstTop);
+    numCmds++;
+}
+
+/****************************************************************************
+DESCRIPTION:
+Queues a block copy between device contexts in the current batch.
+
+HEADER:
+mgraph.h
+
+PARAMETERS:
+dst     - Destination device context
+src     - Source device context
+r       - Rectangle defining are to Blt from
+dstLeft - Left coordinate to Blt to
+dstTop  - Right coordinate to Blt to
+op      - Write mode to use during Blt
+
+REMARKS:
+This function is the same as MGL_batchBitBltCoord, however it takes an
+entire rectangle as the parameter instead of coordinates.
+
+SEE ALSO:
+MGL_batchBitBltCoord
+****************************************************************************/
+void MGL_batchBitBlt(
+    MGLDC *dst,
+    MGLDC *src,
+    rect_t r,
+    int dstLeft,
+    int dstTop,
+    int op);
+/* Implemented as a macro */
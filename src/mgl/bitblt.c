@@ -198,6 +198,7 @@ void MGLAPI MGL_putDivot(
     memcpy(&hdr,s,sizeof(hdr));
     hdr.left += dc->size.left;  hdr.top += dc->size.top;
     hdr.right += dc->size.left; hdr.bottom += dc->size.top;
+    MARK_DIRTY(dc,hdr.left,hdr.top,hdr.right,hdr.bottom);
     s += sizeof(hdr);
     MAKE_HARDWARE_CURRENT(dc,true);
     dc->r.BitBltSys(s,hdr.bytesPerLine,0,0,hdr.right-hdr.left,hdr.bottom-hdr.top,hdr.left,hdr.top,GA_REPLACE_MIX,false);
@@ -418,9 +419,18 @@ void MGLAPI MGL_bitBltCoord(
         END_VISIBLE_CLIP_LIST(dst);
         return;
         }
+    MARK_DIRTY_VIEW(dst,d.left,d.top,d.right,d.bottom);
     left += (d.left - dstLeft); right = left + (d.right - d.left);
     top += (d.top - dstTop);    bottom = top + (d.bottom - d.top);
 
+    /* Split large blits between memory device contexts across threads,
+     * and dither RGB blits to low color depths with the span kernels.
+     */
+    if (_MGL_bandBitBlt(dst,src,left,top,right,bottom,d.left,d.top,op)) {
+        END_VISIBLE_CLIP_LIST(dst);
+        return;
+        }
+
     /* Now perform the blit operation */
     if (src->mi.bitsPerPixel == 1) {
         int         oldop = dst->a.writeMode;
@@ -859,6 +869,7 @@ void MGLAPI MGL_copyPageCoord(
         END_VISIBLE_CLIP_LIST(dc);
         return;
         }
+    MARK_DIRTY_VIEW(dc,d.left,d.top,d.right,d.bottom);
     left += (d.left - dstLeft); right = left + (d.right - d.left);
     top += (d.top - dstTop);    bottom = top + (d.bottom - d.top);
     dstLeft = d.left;   dstTop = d.top;
@@ -1040,6 +1051,7 @@ void MGLAPI MGL_srcTransBltCoord(
         END_VISIBLE_CLIP_LIST(dst);
         return;
         }
+    MARK_DIRTY_VIEW(dst,d.left,d.top,d.right,d.bottom);
     left += (d.left - dstLeft); right = left + (d.right - d.left);
     top += (d.top - dstTop);    bottom = top + (d.bottom - d.top);
     dstLeft = d.left;           dstTop = d.top;
@@ -1284,6 +1296,7 @@ void MGLAPI MGL_dstTransBltCoord(
         END_VISIBLE_CLIP_LIST(dst);
         return;
         }
+    MARK_DIRTY_VIEW(dst,d.left,d.top,d.right,d.bottom);
     left += (d.left - dstLeft); right = left + (d.right - d.left);
     top += (d.top - dstTop);    bottom = top + (d.bottom - d.top);
     dstLeft = d.left;           dstTop = d.top;
@@ -1586,6 +1599,7 @@ void MGLAPI MGL_bitBltPattCoord(
         END_VISIBLE_CLIP_LIST(dst);
         return;
         }
+    MARK_DIRTY_VIEW(dst,d.left,d.top,d.right,d.bottom);
     left += (d.left - dstLeft); right = left + (d.right - d.left);
     top += (d.top - dstTop);    bottom = top + (d.bottom - d.top);
 
@@ -1919,9 +1933,16 @@ void MGLAPI MGL_bitBltFxCoord(
         END_VISIBLE_CLIP_LIST(dst);
         return;
         }
+    MARK_DIRTY_VIEW(dst,d.left,d.top,d.right,d.bottom);
     left += (d.left - dstLeft); right = left + (d.right - d.left);
     top += (d.top - dstTop);    bottom = top + (d.bottom - d.top);
 
+    /* Blend in linear light between memory device contexts if enabled */
+    if (_MGL_bandBlendBlt(dst,src,left,top,right,bottom,d.left,d.top,fx)) {
+        END_VISIBLE_CLIP_LIST(dst);
+        return;
+        }
+
     /* Adjust clipped coordinates if we are doing X or Y flipping */
     if (fx->flags & MGL_BLT_FLIPY) {
         t = (bottom - top);
@@ -2229,6 +2250,15 @@ void MGLAPI MGL_stretchBltCoord(
     dstTop = MGL_FIXROUND(fdTop);
     dstRight = dstLeft+MGL_FIXTOINT((right-left)*zoomx);
     dstBottom = dstTop+MGL_FIXTOINT((bottom-top)*zoomy);
+    MARK_DIRTY_VIEW(dst,dstLeft,dstTop,dstRight,dstBottom);
+
+    /* Split large stretches between memory device contexts across threads,
+     * and dither RGB stretches to low color depths with the span kernels.
+     */
+    if (_MGL_bandStretchBlt(dst,src,left,top,right,bottom,dstLeft,dstTop,dstRight,dstBottom,op)) {
+        END_VISIBLE_CLIP_LIST(dst);
+        return;
+        }
 
     /* Clip the destination device context */
     d.left = dstLeft;           d.top = dstTop;
@@ -2564,6 +2594,7 @@ void MGLAPI MGL_stretchBltFxCoord(
         END_VISIBLE_CLIP_LIST(dst);
         return;
         }
+    MARK_DIRTY_VIEW(dst,d.left,d.top,d.right,d.bottom);
 
     /* Adjust clipped coordinates if we are doing X or Y flipping */
     if (fx->flags & MGL_BLT_FLIPY) {
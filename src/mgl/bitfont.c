@@ -37,8 +37,99 @@
 
 #include "mgl.h"
 
+/* Size of the buffer needed to convert an anti-aliased glyph into the four
+ * levels of monochrome bitmaps.
+ */
+
+#define AA_PLANES_SIZE(w,h)     ((long)(((w) + 7) >> 3) * (h) * 4)
+
+/* Maximum number of characters in a string that is composited into a
+ * single text run before it is drawn.
+ */
+
+#define MAX_RUN_CHARS           256
+
+/*--------------------------- Global Variables ----------------------------*/
+
+/* Shared page of empty glyph metrics for pages that are not allocated */
+
+static glyph_metrics    emptyMetrics[METRIC_PAGE_SIZE];
+
 /*------------------------- Implementation --------------------------------*/
 
+/****************************************************************************
+PARAMETERS:
+size    - Size of the scratch buffer needed
+
+RETURNS:
+Pointer to the scratch buffer, or NULL if out of memory.
+
+REMARKS:
+Returns the MGL scratch buffer if it is large enough, otherwise a temporary
+buffer is allocated that must be released with freeScratch.
+****************************************************************************/
+static uchar *allocScratch(
+    long size)
+{
+    if (size <= _MGL_bufSize)
+        return _MGL_buf;
+    return PM_malloc(size);
+}
+
+/****************************************************************************
+REMARKS:
+Releases a scratch buffer returned by allocScratch.
+****************************************************************************/
+static void freeScratch(
+    uchar *buf)
+{
+    if (buf != _MGL_buf)
+        PM_free(buf);
+}
+
+/****************************************************************************
+PARAMETERS:
+dst         - Buffer to store the rotated coverage values in
+src         - Glyph coverage values to rotate
+width       - Width of the glyph in pixels
+height      - Height of the glyph in pixels
+rotation    - Rotation direction for the glyph
+
+REMARKS:
+Rotates an 8-bit coverage glyph for drawing in the up, down or left text
+directions. Glyphs rotated up or down are height pixels wide and width
+pixels high.
+****************************************************************************/
+static void rotateCoverage(
+    uchar *dst,
+    const uchar *src,
+    int width,
+    int height,
+    int rotation)
+{
+    int     i,j;
+
+    switch (rotation) {
+        case MGL_UP_DIR:
+            for (j = 0; j < height; j++, src += width) {
+                for (i = 0; i < width; i++)
+                    dst[(long)(width-1-i) * height + j] = src[i];
+                }
+            break;
+        case MGL_DOWN_DIR:
+            for (j = 0; j < height; j++, src += width) {
+                for (i = 0; i < width; i++)
+                    dst[(long)i * height + (height-1-j)] = src[i];
+                }
+            break;
+        case MGL_LEFT_DIR:
+            dst += (long)width * height;
+            for (i = width * height; i > 0; i--)
+                *--dst = *src++;
+            break;
+        }
+}
+
 /****************************************************************************
 PARAMETERS:
 x           - x coordinate to draw from
@@ -164,32 +255,77 @@ static void drawAAGlyph(
         }
 }
 
+/****************************************************************************
+PARAMETERS:
+planes      - Buffer to store the four monochrome bitmaps in
+coverage    - Glyph coverage values, one byte per pixel
+width       - Width of the glyph in pixels
+height      - Height of the glyph in pixels
+
+REMARKS:
+Converts an 8-bit coverage glyph into the four levels of monochrome bitmaps
+drawn with the anti-aliasing palette, by rounding each coverage value to
+the nearest of the five levels. The first bitmap holds the fully covered
+pixels, followed by the 75%, 50% and 25% covered pixels.
+****************************************************************************/
+static void coverageToPlanes(
+    uchar *planes,
+    const uchar *coverage,
+    int width,
+    int height)
+{
+    int     i,j,k,level,byteWidth = (width + 7) >> 3;
+    long    offset = (long)byteWidth * height;
+    uchar   bits[5],mask;
+
+    for (j = 0; j < height; j++) {
+        for (i = 0; i < byteWidth; i++, planes++) {
+            bits[0] = bits[1] = bits[2] = bits[3] = bits[4] = 0;
+            for (k = 0, mask = 0x80; k < 8 && (i << 3) + k < width; k++, mask >>= 1) {
+                level = (*coverage++ * 4 + 127) / 255;
+                bits[level] |= mask;
+                }
+            planes[0] = bits[4];
+            planes[offset] = bits[3];
+            planes[offset*2] = bits[2];
+            planes[offset*3] = bits[1];
+            }
+        }
+}
+
 /****************************************************************************
 PARAMETERS:
 x           - x coordinate to draw from
 y           - y coordinate to draw from
 width       - Width of the glyph to draw
-byteWidth   - Byte width of the glyph to draw
 height      - Height of the glyph to draw
-buffer      - Pointer to the glyph buffer
-offset      - Offset to get to each glyph definition in list
+coverage    - Glyph coverage values, one byte per pixel
+planes      - Scratch buffer for the monochrome bitmaps
 
 REMARKS:
-This function draws an anti-aliased monochrome glyph, which is defined as
-a set of four levels of monochrome bitmaps.
+This function draws an anti-aliased glyph, which is defined as a set of
+8-bit coverage values. If the glyph can be blended directly onto the
+device context it is composited in a single pass, otherwise it is
+converted into four levels of monochrome bitmaps that are drawn with the
+anti-aliasing palette. The planes buffer must be at least AA_PLANES_SIZE
+bytes long for the glyph.
 ****************************************************************************/
 static void drawAntiAliasedGlyph(
     int x,
     int y,
     int width,
-    int byteWidth,
     int height,
-    uchar *buffer,
-    int offset)
+    uchar *coverage,
+    uchar *planes)
 {
     uchar   fR,fG,fB,bR,bG,bB,R,G,B;
     color_t colorfg,color75,color50,color25,colorbg;
     rect_t  d,r;
+    int     byteWidth,offset;
+
+    /* Composite the glyph in a single pass if we can */
+    if (_MGL_blendGlyph(x,y,width,height,coverage,width))
+        return;
 
     /* Clip to destination device context and discard if complete clipped */
     d.left = x;             d.top = y;
@@ -197,6 +333,11 @@ static void drawAntiAliasedGlyph(
     if (!MGL_sectRect(DC.clipRectScreen,d,&r))
         return;
 
+    /* Convert the glyph into four levels of monochrome bitmaps */
+    byteWidth = (width + 7) >> 3;
+    offset = byteWidth * height;
+    coverageToPlanes(planes,coverage,width,height);
+
     /* Find the glyph colors for anti-aliased rendering */
     if (!(DC.mi.modeFlags & MGL_IS_COLOR_INDEX)) {
         colorfg = DC.a.aaColor[0];
@@ -260,15 +401,15 @@ static void drawAntiAliasedGlyph(
 
         /* Draw the 25% blended pixels */
         DC.r.SetAlphaValue(63);
-        drawAAGlyph(x,y,width,byteWidth,height,buffer+offset*3);
+        drawAAGlyph(x,y,width,byteWidth,height,planes+offset*3);
 
         /* Draw the 50% blended pixels */
         DC.r.SetAlphaValue(127);
-        drawAAGlyph(x,y,width,byteWidth,height,buffer+offset*2);
+        drawAAGlyph(x,y,width,byteWidth,height,planes+offset*2);
 
         /* Draw the 75% blended pixels */
         DC.r.SetAlphaValue(191);
-        drawAAGlyph(x,y,width,byteWidth,height,buffer+offset);
+        drawAAGlyph(x,y,width,byteWidth,height,planes+offset);
 
         /* Disable pixel blending mode */
         if (DC.r.SetBlendFunc)
@@ -281,20 +422,178 @@ static void drawAntiAliasedGlyph(
     else {
         /* Draw the 25% blended pixels */
         DC.r.SetForeColor(color25);
-        drawAAGlyph(x,y,width,byteWidth,height,buffer+offset*3);
+        drawAAGlyph(x,y,width,byteWidth,height,planes+offset*3);
 
         /* Draw the 50% blended pixels */
         DC.r.SetForeColor(color50);
-        drawAAGlyph(x,y,width,byteWidth,height,buffer+offset*2);
+        drawAAGlyph(x,y,width,byteWidth,height,planes+offset*2);
 
         /* Draw the 75% blended pixels */
         DC.r.SetForeColor(color75);
-        drawAAGlyph(x,y,width,byteWidth,height,buffer+offset);
+        drawAAGlyph(x,y,width,byteWidth,height,planes+offset);
         }
 
     /* Draw the solid foreground pixels */
     DC.r.SetForeColor(colorfg);
-    drawAAGlyph(x,y,width,byteWidth,height,buffer);
+    drawAAGlyph(x,y,width,byteWidth,height,planes);
+}
+
+/****************************************************************************
+PARAMETERS:
+x           - Screen x coordinate to draw from
+y           - Screen y coordinate to draw from
+width       - Width of the glyph to draw
+height      - Height of the glyph to draw
+coverage    - Glyph coverage values, one byte per pixel
+
+REMARKS:
+Draws a single anti-aliased glyph for MGL_drawGlyph.
+{secret}
+****************************************************************************/
+void _MGL_drawAntiAliasedGlyph(
+    int x,
+    int y,
+    int width,
+    int height,
+    uchar *coverage)
+{
+    uchar   *buf;
+
+    if ((buf = allocScratch(AA_PLANES_SIZE(width,height))) != NULL) {
+        _MGL_beginGlyphBlend();
+        drawAntiAliasedGlyph(x,y,width,height,coverage,buf);
+        _MGL_endGlyphBlend();
+        freeScratch(buf);
+        }
+}
+
+/****************************************************************************
+PARAMETERS:
+bitFont     - Bitmap font to find the glyph in
+ch          - Character to find
+
+RETURNS:
+Index of the glyph to draw for the character.
+
+REMARKS:
+Finds the glyph for a character, generating the glyph metrics if it has not
+been used before and substituting the missing symbol for characters that
+are not in the font.
+****************************************************************************/
+static int findGlyphIndex(
+    bitmap_font *bitFont,
+    int ch)
+{
+    int     glyph = ch - bitFont->startGlyph;
+
+    if ((glyph >= bitFont->numGlyphs) || (ch < bitFont->startGlyph))
+        glyph = BIT_MISSINGSYMBOL(bitFont);
+    else if (!BIT_METRICS(bitFont,glyph)->valid)
+        _MGL_generateGlyph(glyph,bitFont);
+    if (BIT_ISMISSING(bitFont,glyph))
+        glyph = BIT_MISSINGSYMBOL(bitFont);
+    return glyph;
+}
+
+/****************************************************************************
+PARAMETERS:
+bitFont     - Bitmap font to find the glyph in
+ch          - Character to find
+width       - Place to store the character width
+iwidth      - Place to store the character image width
+loc         - Place to store the character image location
+
+RETURNS:
+Pointer to the glyph bitmap, or NULL if there is nothing to draw.
+
+REMARKS:
+Finds the metrics and bitmap for a character, generating the glyph if it
+has not been used before and substituting the missing symbol definition
+for characters that are not in the font.
+****************************************************************************/
+static uchar *findGlyph(
+    bitmap_font *bitFont,
+    int ch,
+    int *width,
+    int *iwidth,
+    int *loc)
+{
+    int             glyph = findGlyphIndex(bitFont,ch);
+    glyph_metrics   *m = BIT_METRICS(bitFont,glyph);
+
+    *width = m->width;
+    *iwidth = m->iwidth;
+    *loc = m->loc;
+    if (*iwidth == 0)
+        return NULL;
+    return _MGL_getGlyphBitmap(bitFont,glyph);
+}
+
+/****************************************************************************
+PARAMETERS:
+bitFont     - Bitmap font to find the glyph in
+ch          - Character to find
+dir         - Text direction to rotate the glyph for
+width       - Place to store the character width
+iwidth      - Place to store the character image width
+loc         - Place to store the character image location
+
+RETURNS:
+Pointer to the rotated glyph image, or NULL if there is nothing to draw.
+
+REMARKS:
+Finds the metrics and rotated image for a character drawn in one of the
+vertical or right to left text directions. Rotated glyphs are kept in the
+glyph cache alongside the unrotated glyphs, so each glyph is only rotated
+the first time it is drawn in each direction. Mono glyphs are rotated with
+MGL_rotateGlyph, and anti-aliased glyphs are stored as rotated coverage
+values. The returned pointer is only valid until the next glyph is added
+to the glyph cache.
+****************************************************************************/
+static uchar *findRotatedGlyph(
+    bitmap_font *bitFont,
+    int ch,
+    int dir,
+    int *width,
+    int *iwidth,
+    int *loc)
+{
+    int             glyph = findGlyphIndex(bitFont,ch);
+    int             byteWidth,height = bitFont->fontHeight;
+    long            size;
+    uchar           *bytes,*buf,*def;
+    glyph_metrics   *m = BIT_METRICS(bitFont,glyph);
+
+    *width = m->width;
+    *iwidth = m->iwidth;
+    *loc = m->loc;
+    if (*iwidth == 0)
+        return NULL;
+    if ((def = _MGL_findCachedGlyph(bitFont,glyph,dir)) != NULL)
+        return def;
+
+    /* Rotate the glyph into the scratch buffer and then copy it into the
+     * glyph cache, as adding the rotated glyph may evict the source glyph.
+     */
+    if ((bytes = _MGL_getGlyphBitmap(bitFont,glyph)) == NULL)
+        return NULL;
+    byteWidth = (*iwidth + 7) >> 3;
+    if (bitFont->antialiased)
+        size = (long)*iwidth * height;
+    else if (dir == MGL_LEFT_DIR)
+        size = (long)byteWidth * height;
+    else
+        size = (long)((height + 7) >> 3) * (byteWidth << 3);
+    if ((buf = allocScratch(size)) == NULL)
+        return NULL;
+    if (bitFont->antialiased)
+        rotateCoverage(buf,bytes,*iwidth,height,dir);
+    else
+        MGL_rotateGlyph(buf,bytes,&byteWidth,&height,dir);
+    if ((def = _MGL_addCachedGlyph(bitFont,glyph,dir,size)) != NULL)
+        memcpy(def,buf,size);
+    freeScratch(buf);
+    return def;
 }
 
 /****************************************************************************
@@ -316,38 +615,170 @@ static int drawFontGlyphRight(
     int x,
     int y)
 {
-    int     width,byteWidth,offset;
-    int     iwidth, loc, glyph;
-    uchar   *bytes;
-
-    glyph = ch - bitFont->startGlyph;
-    if ((glyph >= bitFont->numGlyphs) || (ch < bitFont->startGlyph)
-            || ((offset = bitFont->offset[glyph]) == -1)) {
-        /* Use the missing symbol definition */
-        offset = bitFont->offset[BIT_MISSINGSYMBOL(bitFont)];
-        width = bitFont->width[BIT_MISSINGSYMBOL(bitFont)];
-        iwidth = bitFont->iwidth[BIT_MISSINGSYMBOL(bitFont)];
-        glyph = BIT_MISSINGSYMBOL(bitFont);
-        }
-    else {
-        /* Find the information for the glyph */
-        if (!bitFont->valid[glyph])
-            _MGL_generateGlyph(glyph,bitFont);
-        width = bitFont->width[glyph];
-        iwidth = bitFont->iwidth[glyph];
-        }
-    loc = bitFont->loc[glyph];
-    bytes = (uchar*)bitFont->def+offset;
+    int     width,byteWidth;
+    int     iwidth, loc;
+    uchar   *bytes,*buf;
+
+    bytes = findGlyph(bitFont,ch,&width,&iwidth,&loc);
     byteWidth = (iwidth + 7) >> 3;
-    if (iwidth != 0) {
+    if (bytes) {
         if (!bitFont->antialiased)
             drawGlyph(x+loc,y,iwidth,byteWidth,bitFont->fontHeight,bytes);
-        else
-            drawAntiAliasedGlyph(x+loc,y,iwidth,byteWidth,bitFont->fontHeight,bytes, ((iwidth + 7) / 8)*bitFont->fontHeight);
+        else if ((buf = allocScratch(AA_PLANES_SIZE(iwidth,bitFont->fontHeight))) != NULL) {
+            drawAntiAliasedGlyph(x+loc,y,iwidth,bitFont->fontHeight,bytes,buf);
+            freeScratch(buf);
+            }
         }
     return (x+width+DC.a.ts.spaceExtra);
 }
 
+/****************************************************************************
+PARAMETERS:
+bitFont     - Bitmap font to composite the run for
+codes       - Character codes for the string
+count       - Number of characters in the string
+run         - Text run to composite the glyphs into
+
+REMARKS:
+Composites all the glyphs in a horizontal string into the text run mask,
+which must already be zeroed and have its metrics filled in. Mono glyphs
+are combined with a bitwise OR, and anti-aliased glyphs take the maximum
+coverage where neighbouring glyphs overlap.
+****************************************************************************/
+static void compositeTextRun(
+    bitmap_font *bitFont,
+    const uint *codes,
+    int count,
+    text_run *run)
+{
+    int             i,j,k,glyph,iwidth,byteWidth,off,shift,pen = 0;
+    uchar           *src,*dst,v,lastMask;
+    glyph_metrics   *m;
+
+    for (i = 0; i < count; i++) {
+        glyph = findGlyphIndex(bitFont,codes[i]);
+        m = BIT_METRICS(bitFont,glyph);
+        iwidth = m->iwidth;
+        off = pen + m->loc - run->left;
+        pen += m->width + DC.a.ts.spaceExtra;
+        if (iwidth == 0 || (src = _MGL_getGlyphBitmap(bitFont,glyph)) == NULL)
+            continue;
+        if (bitFont->antialiased) {
+            dst = run->mask + off;
+            for (j = 0; j < run->height; j++) {
+                for (k = 0; k < iwidth; k++) {
+                    if (src[k] > dst[k])
+                        dst[k] = src[k];
+                    }
+                src += iwidth;
+                dst += run->stride;
+                }
+            }
+        else {
+            byteWidth = (iwidth + 7) >> 3;
+            lastMask = (uchar)(0xFF << ((8 - (iwidth & 7)) & 7));
+            shift = off & 7;
+            dst = run->mask + (off >> 3);
+            for (j = 0; j < run->height; j++) {
+                for (k = 0; k < byteWidth; k++) {
+                    v = src[k];
+                    if (k == byteWidth-1)
+                        v &= lastMask;
+                    dst[k] |= (uchar)(v >> shift);
+                    if (shift)
+                        dst[k+1] |= (uchar)(v << (8 - shift));
+                    }
+                src += byteWidth;
+                dst += run->stride;
+                }
+            }
+        }
+}
+
+/****************************************************************************
+PARAMETERS:
+bitFont     - Bitmap font to draw the string with
+codes       - Character codes for the string
+count       - Number of characters in the string
+x           - x coordinate to draw from, before horizontal justification
+y           - y coordinate to draw from
+
+RETURNS:
+True if the string was drawn, false if it must be drawn a glyph at a time.
+
+REMARKS:
+Draws a horizontal string by compositing all the glyphs into a single mono
+or coverage mask, which is then clipped and drawn in one operation. If the
+text run cache is enabled, the composited mask is kept in the cache so
+that drawing the same string again in the same font only needs to draw the
+mask. The total pen advance for the string is found while measuring the
+ink extents and stored with the run, so the string is justified without
+measuring it again with MGL_textWidth.
+****************************************************************************/
+static ibool drawTextRun(
+    bitmap_font *bitFont,
+    const uint *codes,
+    int count,
+    int x,
+    int y)
+{
+    text_run        *run,tmp;
+    uchar           *buf;
+    int             i,l,r,minL,maxR,pen;
+    long            size;
+    glyph_metrics   *m;
+
+    /* Trivially reject strings that are outside the clip rectangle */
+    if (y >= DC.clipRectScreen.bottom || y + bitFont->fontHeight <= DC.clipRectScreen.top)
+        return true;
+
+    if ((run = _MGL_findTextRun((font_t*)bitFont,DC.a.ts.spaceExtra,codes,count)) == NULL) {
+        /* Measure the ink extents of the string */
+        minL = 0x7FFF;  maxR = -0x7FFF;
+        for (i = pen = 0; i < count; i++) {
+            m = BIT_METRICS(bitFont,findGlyphIndex(bitFont,codes[i]));
+            if (m->iwidth) {
+                l = pen + m->loc;
+                r = l + m->iwidth;
+                if (l < minL) minL = l;
+                if (r > maxR) maxR = r;
+                }
+            pen += m->width + DC.a.ts.spaceExtra;
+            }
+        if (minL >= maxR)
+            return true;
+
+        /* Composite the glyphs into a cached run, or the run buffer */
+        tmp.advance = pen;
+        tmp.left = minL;
+        tmp.width = maxR - minL;
+        tmp.height = bitFont->fontHeight;
+        tmp.stride = bitFont->antialiased ? tmp.width : ((tmp.width + 7) >> 3) + 1;
+        size = (long)tmp.stride * tmp.height;
+        if ((run = _MGL_addTextRun((font_t*)bitFont,DC.a.ts.spaceExtra,codes,count,size)) != NULL)
+            tmp.mask = run->mask;
+        else if ((tmp.mask = _MGL_getTextRunBuffer(size)) != NULL)
+            run = &tmp;
+        else
+            return false;
+        *run = tmp;
+        compositeTextRun(bitFont,codes,count,run);
+        }
+
+    /* Justify the string and draw the run mask in a single operation */
+    if (DC.a.ts.horizJust == MGL_CENTER_TEXT)
+        x -= run->advance/2;
+    else if (DC.a.ts.horizJust == MGL_RIGHT_TEXT)
+        x -= run->advance;
+    if (!bitFont->antialiased)
+        drawGlyph(x+run->left,y,run->width,run->stride,run->height,run->mask);
+    else if ((buf = allocScratch(AA_PLANES_SIZE(run->width,run->height))) != NULL) {
+        drawAntiAliasedGlyph(x+run->left,y,run->width,run->height,run->mask,buf);
+        freeScratch(buf);
+        }
+    return true;
+}
+
 /****************************************************************************
 PARAMETERS:
 bitFont     - Bitmap font to draw glyph for
@@ -368,52 +799,21 @@ static int drawFontGlyphUp(
     int x,
     int y)
 {
-    int     width,byteWidth,offset;
-    int     iwidth, loc, glyph, height;
-    uchar   *bytes,*buf = _MGL_buf;
-
-    glyph = ch - bitFont->startGlyph;
-    if ((glyph >= bitFont->numGlyphs) || (ch < bitFont->startGlyph)
-            || ((offset = bitFont->offset[glyph]) == -1)) {
-        /* Use the missing symbol definition */
-        offset = bitFont->offset[BIT_MISSINGSYMBOL(bitFont)];
-        width = bitFont->width[BIT_MISSINGSYMBOL(bitFont)];
-        iwidth = bitFont->iwidth[BIT_MISSINGSYMBOL(bitFont)];
-        glyph = BIT_MISSINGSYMBOL(bitFont);
-        }
-    else {
-        /* Find the information for the glyph */
-        if (!bitFont->valid[glyph])
-            _MGL_generateGlyph(glyph,bitFont);
-        width = bitFont->width[glyph];
-        iwidth = bitFont->iwidth[glyph];
-        }
-    loc = bitFont->loc[glyph];
-    bytes = (uchar*)bitFont->def+offset;
-    byteWidth = (iwidth + 7) >> 3;
+    int     width,byteWidth;
+    int     iwidth, loc, height;
+    uchar   *bytes,*buf;
+
+    bytes = findRotatedGlyph(bitFont,ch,MGL_UP_DIR,&width,&iwidth,&loc);
     height = bitFont->fontHeight;
-    if (iwidth != 0) {
+    if (bytes) {
         if (!bitFont->antialiased) {
-            MGL_rotateGlyph(buf,bytes,&byteWidth,&height,MGL_UP_DIR);
-            drawGlyph(x,y-height+1-loc,byteWidth<<3,byteWidth,height,buf);
+            byteWidth = (height + 7) >> 3;
+            height = ((iwidth + 7) >> 3) << 3;
+            drawGlyph(x,y-height+1-loc,byteWidth<<3,byteWidth,height,bytes);
             }
-        else {
-            int of2 = ((iwidth + 7) & -8)*((bitFont->fontHeight + 7) >> 3);
-            int of3 = ((iwidth + 7) / 8)*bitFont->fontHeight;
-            int bw2;
-            bw2 = byteWidth;
-            MGL_rotateGlyph(buf+of2*3,bytes+of3*3,&bw2,&height,MGL_UP_DIR);
-            //of2 = iwidth*((bitfont->fontHeight + 7) >> 3);
-            height = bitFont->fontHeight;
-            bw2 = byteWidth;
-            MGL_rotateGlyph(buf+of2*2,bytes+of3*2,&bw2,&height,MGL_UP_DIR);
-            height = bitFont->fontHeight;
-            bw2 = byteWidth;
-            MGL_rotateGlyph(buf+of2,bytes+of3,&bw2,&height,MGL_UP_DIR);
-            height = bitFont->fontHeight;
-            bw2 = byteWidth;
-            MGL_rotateGlyph(buf,bytes,&byteWidth,&height,MGL_UP_DIR);
-            drawAntiAliasedGlyph(x, y-height+1-loc,byteWidth<<3,byteWidth, height,buf, of2);
+        else if ((buf = allocScratch(AA_PLANES_SIZE(height,iwidth))) != NULL) {
+            drawAntiAliasedGlyph(x,y-iwidth+1-loc,height,iwidth,bytes,buf);
+            freeScratch(buf);
             }
         }
     return (y-width-DC.a.ts.spaceExtra);
@@ -439,50 +839,23 @@ static int drawFontGlyphDown(
     int x,
     int y)
 {
-    int     width,byteWidth,offset;
-    int     iwidth, loc, glyph, height;
-    uchar   *bytes,*buf = _MGL_buf;
-
-    glyph = ch - bitFont->startGlyph;
-    if ((glyph >= bitFont->numGlyphs) || (ch < bitFont->startGlyph)
-            || ((offset = bitFont->offset[glyph]) == -1)) {
-        /* Use the missing symbol definition */
-        offset = bitFont->offset[BIT_MISSINGSYMBOL(bitFont)];
-        width = bitFont->width[BIT_MISSINGSYMBOL(bitFont)];
-        iwidth = bitFont->iwidth[BIT_MISSINGSYMBOL(bitFont)];
-        glyph = BIT_MISSINGSYMBOL(bitFont);
-        }
-    else {
-        /* Find the information for the glyph */
-        if (!bitFont->valid[glyph])
-            _MGL_generateGlyph(glyph,bitFont);
-        width = bitFont->width[glyph];
-        iwidth = bitFont->iwidth[glyph];
-        }
-    loc = bitFont->loc[glyph];
-    bytes = (uchar*)bitFont->def+offset;
-    byteWidth = (iwidth + 7) >> 3;
+    int     width,byteWidth;
+    int     iwidth, loc, height;
+    uchar   *bytes,*buf;
+
+    bytes = findRotatedGlyph(bitFont,ch,MGL_DOWN_DIR,&width,&iwidth,&loc);
     height = bitFont->fontHeight;
-    if (iwidth != 0) {
+    if (bytes) {
         if (!bitFont->antialiased) {
-            MGL_rotateGlyph(buf,bytes,&byteWidth,&height,MGL_DOWN_DIR);
-            drawGlyph(x,y+loc,byteWidth<<3,byteWidth,iwidth,buf);
+            byteWidth = (height + 7) >> 3;
+            drawGlyph(x,y+loc,byteWidth<<3,byteWidth,iwidth,bytes);
             }
-        else {
-            int of2 = ((iwidth + 7) / 8)*bitFont->fontHeight;
-            int bw2;
-            bw2 = byteWidth;
-            MGL_rotateGlyph(buf,bytes,&bw2,&height,MGL_DOWN_DIR);
-            height = bitFont->fontHeight;
-            bw2 = byteWidth;
-            MGL_rotateGlyph(buf+of2,bytes+of2,&bw2,&height,MGL_DOWN_DIR);
-            height = bitFont->fontHeight;
-            bw2 = byteWidth;
-            MGL_rotateGlyph(buf+of2+of2,bytes+of2+of2,&bw2,&height,MGL_DOWN_DIR);
-            height = bitFont->fontHeight;
-            bw2 = byteWidth;
-            MGL_rotateGlyph(buf+of2+of2+of2,bytes+of2+of2+of2,&byteWidth,&height,MGL_DOWN_DIR);
-            drawAntiAliasedGlyph(x, y+loc,byteWidth<<3,byteWidth,iwidth,buf, of2);
+        else if ((buf = allocScratch(AA_PLANES_SIZE(height,iwidth))) != NULL) {
+            /* Mono glyphs are rotated into a byte aligned width, so we
+             * offset the glyph to draw it in the same place.
+             */
+            drawAntiAliasedGlyph(x+((height+7) & ~7)-height,y+loc,height,iwidth,bytes,buf);
+            freeScratch(buf);
             }
         }
     return (y+width+DC.a.ts.spaceExtra);
@@ -508,47 +881,143 @@ static int drawFontGlyphLeft(
     int x,
     int y)
 {
-    int     width,byteWidth,offset;
-    int     iwidth, loc, glyph, height;
-    uchar   *bytes,*buf = _MGL_buf;
-
-    glyph = ch - bitFont->startGlyph;
-    if ((glyph >= bitFont->numGlyphs) || (ch < bitFont->startGlyph)
-            || ((offset = bitFont->offset[glyph]) == -1)) {
-        /* Use the missing symbol definition */
-        offset = bitFont->offset[BIT_MISSINGSYMBOL(bitFont)];
-        width = bitFont->width[BIT_MISSINGSYMBOL(bitFont)];
-        iwidth = bitFont->iwidth[BIT_MISSINGSYMBOL(bitFont)];
-        glyph = BIT_MISSINGSYMBOL(bitFont);
-        }
-    else {
-        /* Find the information for the glyph */
-        if (!bitFont->valid[glyph])
-            _MGL_generateGlyph(glyph,bitFont);
-        width = bitFont->width[glyph];
-        iwidth = bitFont->iwidth[glyph];
-        }
-    loc = bitFont->loc[glyph];
-    bytes = (uchar*)bitFont->def+offset;
+    int     width,byteWidth;
+    int     iwidth, loc, height;
+    uchar   *bytes,*buf;
+
+    bytes = findRotatedGlyph(bitFont,ch,MGL_LEFT_DIR,&width,&iwidth,&loc);
     byteWidth = (iwidth + 7) >> 3;
     height = bitFont->fontHeight;
-    if (iwidth != 0) {
-        if (!bitFont->antialiased) {
-            _MGL_rotateBitmap180(buf,bytes,byteWidth,height);
-            drawGlyph(x-(byteWidth<<3)+1-loc,y,(byteWidth<<3),byteWidth,height,buf);
-            }
-        else {
-            int of2 = ((iwidth + 7) / 8)*bitFont->fontHeight;
-            _MGL_rotateBitmap180(buf,bytes,byteWidth,height);
-            _MGL_rotateBitmap180(buf+of2,bytes+of2,byteWidth,height);
-            _MGL_rotateBitmap180(buf+of2+of2,bytes+of2+of2,byteWidth,height);
-            _MGL_rotateBitmap180(buf+of2+of2+of2,bytes+of2+of2+of2,byteWidth,height);
-            drawAntiAliasedGlyph(x-(byteWidth<<3)+1-loc, y,(byteWidth<<3), byteWidth,height,buf, of2);
+    if (bytes) {
+        if (!bitFont->antialiased)
+            drawGlyph(x-(byteWidth<<3)+1-loc,y,(byteWidth<<3),byteWidth,height,bytes);
+        else if ((buf = allocScratch(AA_PLANES_SIZE(iwidth,height))) != NULL) {
+            drawAntiAliasedGlyph(x-iwidth+1-loc,y,iwidth,height,bytes,buf);
+            freeScratch(buf);
             }
         }
     return (x-width-DC.a.ts.spaceExtra);
 }
 
+/****************************************************************************
+PARAMETERS:
+font    - TrueType font to rasterise the glyph for
+ch      - Glyph to rasterise
+glyph   - Loaded FreeType glyph outline
+
+RETURNS:
+Pointer to the rasterised glyph bitmap, or NULL if out of memory.
+
+REMARKS:
+Rasterises a loaded glyph outline into the shared glyph cache. Monochrome
+glyphs are rasterised directly into the cache, while anti-aliased glyphs
+are stored as 8-bit coverage values, one byte per pixel. The FreeType gray
+raster only produces five levels of gray from a 2x2 oversampled bitmap, so
+we scale the outline up by two and render it with the gray raster, and
+then add up each 2x2 block of pixels to get 17 levels of coverage from 4x4
+oversampling. The outline is scaled back afterwards, which is exact since
+the scaled coordinates are all even.
+****************************************************************************/
+static uchar *rasteriseGlyph(
+    bitmap_font *font,
+    int ch,
+    TT_Glyph glyph)
+{
+    TT_Raster_Map   rasterMap;
+    TT_Outline      outline;
+    TT_Matrix       scale;
+    glyph_metrics   *m = BIT_METRICS(font,ch);
+    int             width = m->iwidth;
+    int             i,j,sum,height = font->fontHeight;
+    uchar           *def,*buf,*p;
+
+    if (font->antialiased) {
+        rasterMap.rows = height * 2;
+        rasterMap.width = width * 2;
+        rasterMap.cols = (width * 2 + 7) & -8;
+        rasterMap.size = rasterMap.cols * rasterMap.rows;
+        rasterMap.flow = TT_Flow_Down;
+        if ((buf = allocScratch(rasterMap.size)) == NULL)
+            return NULL;
+        if ((def = _MGL_addCachedGlyph(font,ch,MGL_RIGHT_DIR,width * height)) == NULL) {
+            freeScratch(buf);
+            return NULL;
+            }
+        rasterMap.bitmap = (void*)buf;
+        memset(rasterMap.bitmap, 0, rasterMap.size);
+
+        /* Render the outline at twice the size into the scratch buffer */
+        TT_Get_Glyph_Outline(glyph, &outline);
+        scale.xx = scale.yy = 0x20000L;
+        scale.xy = scale.yx = 0;
+        TT_Transform_Outline(&outline, &scale);
+        TT_Get_Glyph_Pixmap(glyph, &rasterMap, -m->loc*128, -font->descent*128);
+        scale.xx = scale.yy = 0x8000L;
+        TT_Transform_Outline(&outline, &scale);
+
+        /* Now we reduce each 2x2 block of gray levels (0-4) to coverage */
+        for (j = 0, p = def; j < height; j++, buf += rasterMap.cols * 2) {
+            for (i = 0; i < width; i++) {
+                sum = buf[i*2] + buf[i*2+1] + buf[rasterMap.cols+i*2] + buf[rasterMap.cols+i*2+1];
+                *p++ = (uchar)((sum * 255 + 8) >> 4);
+                }
+            }
+        freeScratch((uchar*)rasterMap.bitmap);
+        }
+    else {
+        if ((def = _MGL_addCachedGlyph(font,ch,MGL_RIGHT_DIR,((width + 7) / 8) * height)) == NULL)
+            return NULL;
+        rasterMap.rows = height;
+        rasterMap.width = width;
+        rasterMap.flow = TT_Flow_Down;
+        rasterMap.cols = (width + 7) / 8;
+        rasterMap.size = rasterMap.cols * height;
+        rasterMap.bitmap = (void*)def;
+        TT_Get_Glyph_Bitmap(glyph, &rasterMap, -m->loc*64, -font->descent*64);
+        }
+    return def;
+}
+
+/****************************************************************************
+PARAMETERS:
+font    - Bitmap font to find the glyph bitmap for
+glyph   - Index of the glyph to find
+
+RETURNS:
+Pointer to the glyph bitmap, or NULL if out of memory.
+
+REMARKS:
+Returns the bitmap definition for a glyph whose metrics have already been
+generated. For bitmap fonts this is simply the glyph definition in the
+font, but for TrueType fonts the glyph is looked up in the shared glyph
+cache, and rasterised again if it has been evicted from the cache. For
+TrueType fonts the offset table holds the index of the glyph whose bitmap
+is used, so that missing characters share the bitmap of the missing symbol.
+The returned pointer is only valid until the next glyph is rasterised.
+{secret}
+****************************************************************************/
+uchar *_MGL_getGlyphBitmap(
+    bitmap_font *font,
+    int glyph)
+{
+    tt_font_lib *lib = TTFONTLIB(font->lib);
+    TT_Glyph    ttGlyph;
+    uchar       *def;
+
+    if (!lib || lib->fontLibType != MGL_TRUETYPEFONT_LIB)
+        return font->def + BIT_METRICS(font,glyph)->offset;
+    glyph = BIT_METRICS(font,glyph)->offset;
+    if ((def = _MGL_findCachedGlyph(font,glyph,MGL_RIGHT_DIR)) != NULL)
+        return def;
+    if (TT_New_Glyph(lib->face,&ttGlyph))
+        return NULL;
+    if (TT_Load_Glyph(font->instance,ttGlyph,TT_Char_Index(lib->charMap,(ushort)(glyph+font->startGlyph)),TTLOAD_DEFAULT))
+        MGL_fatalError("Failure in FreeType library!");
+    def = rasteriseGlyph(font,glyph,ttGlyph);
+    TT_Done_Glyph(ttGlyph);
+    return def;
+}
+
 /****************************************************************************
 PARAMETERS:
 glyph   - Glyph to rasterise
@@ -561,6 +1030,10 @@ call the FreeType library to generate the glyph on the fly, which speeds
 up font load times as we only ever generate glyphs for the images we wish
 to display (important for Unicode fonts that may have up to 65,535
 characters!)
+
+The glyph metrics are stored in the font tables, while the glyph bitmap is
+stored in the shared glyph cache where it may later be evicted and
+rasterised again by _MGL_getGlyphBitmap.
 {secret}
 ****************************************************************************/
 void _MGL_generateGlyph(
@@ -568,12 +1041,15 @@ void _MGL_generateGlyph(
     bitmap_font *font)
 {
     ushort              idx;
-    TT_Raster_Map       rasterMap;
     TT_Glyph            glyph;
     tt_font_lib         *lib = TTFONTLIB(font->lib);
     TT_Glyph_Metrics    glyphMetrics;
+    glyph_metrics       *m,*missing;
     int                 width, height;
-    uchar               *buf = _MGL_buf;
+
+    /* Find the metrics entry to fill in, allocating the page if needed */
+    if ((m = _MGL_allocGlyphMetrics(font,ch)) == NULL)
+        return;
 
     /* fill in information for this glyph then rasterize it */
     idx = TT_Char_Index(lib->charMap,(ushort)(ch+font->startGlyph));
@@ -586,43 +1062,30 @@ void _MGL_generateGlyph(
              * definition
              */
             i = BIT_MISSINGSYMBOL(font);
-            font->iwidth[i] = 0;
-            font->width[i] = 0;
-            font->offset[i] = 0;
-            font->loc[i] = 0;
-            font->charAscent[i] = 0;
-            font->charDescent[i] = 0;
-            font->valid[i] = true;
+            if ((missing = _MGL_allocGlyphMetrics(font,i)) == NULL)
+                return;
+            memset(missing,0,sizeof(*missing));
+            missing->valid = true;
             }
 
         /* If the missing character symbol '.' is not valid, create it */
-        if (!font->valid[i])
+        if (!BIT_METRICS(font,i)->valid)
             _MGL_generateGlyph(i, font);
 
         /* Set the missing character info */
-        font->width[ch] = font->width[i];
-        font->iwidth[ch] = font->iwidth[i];
-        font->offset[ch] = font->offset[i];
-        font->loc[ch] = font->loc[i];
-        font->charAscent[ch] = font->charAscent[i];
-        font->charDescent[ch] = font->charDescent[i];
-        font->valid[ch] = true;
+        *m = *BIT_METRICS(font,i);
+        m->valid = true;
 
         /* This second definition is created for characters that are past
          * the end of the available symbols.
          */
-        font->width[BIT_MISSINGSYMBOL(font)] = font->width[i];
-        font->iwidth[BIT_MISSINGSYMBOL(font)] = font->iwidth[i];
-        font->offset[BIT_MISSINGSYMBOL(font)] = font->offset[i];
-        font->loc[BIT_MISSINGSYMBOL(font)] = font->loc[i];
-        font->charAscent[BIT_MISSINGSYMBOL(font)] = font->charAscent[i];
-        font->charDescent[BIT_MISSINGSYMBOL(font)] = font->charDescent[i];
-        font->valid[BIT_MISSINGSYMBOL(font)] = true;
+        if ((missing = _MGL_allocGlyphMetrics(font,BIT_MISSINGSYMBOL(font))) != NULL) {
+            *missing = *m;
+            missing->valid = true;
+            }
         }
     else {
-        if (!font->valid[ch]) {
-            int glyphsize;
-
+        if (!m->valid) {
             /* Load the glyph */
             TT_New_Glyph(lib->face,&glyph);
             if (TT_Load_Glyph(font->instance,glyph, idx, TTLOAD_DEFAULT))
@@ -634,87 +1097,20 @@ void _MGL_generateGlyph(
             height = (glyphMetrics.bbox.yMax / 64) - (glyphMetrics.bbox.yMin / 64) + 1;
 
             /* Fill in the tables with the info for this glyph */
-            font->width[ch] = glyphMetrics.advance/64;
-            font->iwidth[ch] = width;
-            font->charAscent[ch] = glyphMetrics.bearingY/64;
-            font->charDescent[ch] = (glyphMetrics.bearingY/64) - height;
-
-            /* check to see if we need to reallocate the size of the bitmap
-             * buffer, and if so do it in 4k chunks
+            m->width = glyphMetrics.advance/64;
+            m->iwidth = width;
+            m->charAscent = glyphMetrics.bearingY/64;
+            m->charDescent = (glyphMetrics.bearingY/64) - height;
+            m->offset = ch;
+            m->loc = glyphMetrics.bearingX/64;
+
+            /* Rasterise the glyph into the glyph cache while we have the
+             * outline loaded, as it is almost always about to be drawn.
              */
-            glyphsize = ((width + 7) / 8) * font->fontHeight;
-            if (font->antialiased)
-                glyphsize *= 4;
-            while (font->bitmapBufferSize < (font->bitmapBufferUsed + glyphsize)) {
-                /* Allocate one more 4k chunk to the buffer */
-                font->bitmapBufferSize += 4096;
-                font->def = realloc(font->def, font->bitmapBufferSize);
-                if (font->def == NULL)
-                    MGL_fatalError("Out of memory in bitfont.c!");
-                memset((void *) &((uchar *)font->def)[font->bitmapBufferSize-4096], 0, 4096);
-                }
-            font->offset[ch] = font->bitmapBufferUsed;
-            font->bitmapBufferUsed += glyphsize;
-            font->loc[ch] = glyphMetrics.bearingX/64;
-            rasterMap.rows = font->fontHeight;
-            rasterMap.width = font->iwidth[ch];
-            rasterMap.flow = TT_Flow_Down;
-            if (font->antialiased) {
-                int w = (width + 7) / 8;
-                int i, k, j;
-                uchar * map = (&font->def[font->offset[ch]]);
-                uchar * map2 = map + (glyphsize / 4);
-                uchar * map3 = map2 + (glyphsize / 4);
-                uchar * map4 = map3 + (glyphsize / 4);
-                uchar * buf2 = buf;
-
-                // TODO: check to see if the MGL_buf is large enough to hold the data
-                rasterMap.cols = (font->iwidth[ch]+7) & -8;
-                rasterMap.size = rasterMap.cols * font->fontHeight;
-                rasterMap.bitmap = (void*)buf;
-                memset(rasterMap.bitmap, 0, rasterMap.size);
-                TT_Get_Glyph_Pixmap(glyph, &rasterMap, -font->loc[ch]*64, -font->descent*64);
-
-                /* Now we convert the pixmap into a series of bitmaps */
-                for (i = 0; i < font->fontHeight; i++) {
-                    for (j = 0; j < w; j++) {
-                        uchar b1, b2, b3, b4;
-                        b1 = 0;
-                        b2 = 0;
-                        b3 = 0;
-                        b4 = 0;
-                        for (k = 0; k < 8; k++) {
-                            switch (*buf2) {
-                                case 4: b1 |= (0x80 >> k); break;
-                                case 3: b2 |= (0x80 >> k); break;
-                                case 2: b3 |= (0x80 >> k); break;
-                                case 1: b4 |= (0x80 >> k); break;
-                                }
-                            buf2++;
-                            }
-                        *map = b1;
-                        *map2 = b2;
-                        *map3 = b3;
-                        *map4 = b4;
-                        map++;
-                        map2++;
-                        map3++;
-                        map4++;
-                        }
-                   buf += rasterMap.cols;
-                   buf2 = buf;
-                   }
-                }
-            else {
-                rasterMap.cols = (font->iwidth[ch] + 7) / 8;
-                rasterMap.size = rasterMap.cols * font->fontHeight;
-                rasterMap.bitmap = (void*)(&font->def[font->offset[ch]]);
-                memset(rasterMap.bitmap, 0, rasterMap.size);
-                TT_Get_Glyph_Bitmap(glyph, &rasterMap, -font->loc[ch]*64, -font->descent*64);
-                }
+            rasteriseGlyph(font,ch,glyph);
 
             /* Indicate that the glyph is now valid */
-            font->valid[ch] = true;
+            m->valid = true;
 
             /* Compute max values for this font */
             if (width > font->maxWidth)
@@ -726,6 +1122,90 @@ void _MGL_generateGlyph(
         }
 }
 
+/****************************************************************************
+PARAMETERS:
+font        - Bitmap font to set up the metric tables for
+onDemand    - True to allocate the metric pages on demand
+
+RETURNS:
+Pointer to the memory following the glyph metric tables.
+
+REMARKS:
+Sets up the paged glyph metric tables for a bitmap font. The table of page
+pointers is stored directly after the font structure. Fonts loaded from
+disk have all their pages stored in one block directly after the page
+table, and the glyph definitions can be stored after that in the same
+allocation (which must be at least FONT_INDEX_SIZE bytes for the tables).
+For TrueType fonts with thousands of glyphs all the pages initially point
+to a shared page of empty metrics, and each page is allocated when a glyph
+in the page is first generated.
+{secret}
+****************************************************************************/
+uchar *_MGL_initGlyphMetrics(
+    bitmap_font *font,
+    ibool onDemand)
+{
+    int             i,numPages = METRIC_PAGES(font->numGlyphs);
+    glyph_metrics   *table;
+
+    font->metrics = (glyph_metrics**)(font + 1);
+    table = (glyph_metrics*)(font->metrics + numPages);
+    for (i = 0; i < numPages; i++)
+        font->metrics[i] = onDemand ? emptyMetrics : table + (i << METRIC_PAGE_SHIFT);
+    return onDemand ? (uchar*)table : (uchar*)(table + font->numGlyphs);
+}
+
+/****************************************************************************
+PARAMETERS:
+font    - Bitmap font to find the glyph metrics in
+glyph   - Index of the glyph
+
+RETURNS:
+Pointer to the glyph metrics to fill in, or NULL if out of memory.
+
+REMARKS:
+Returns the metrics for a glyph so that they can be filled in, allocating
+the page that holds the glyph if it is not yet allocated.
+{secret}
+****************************************************************************/
+glyph_metrics *_MGL_allocGlyphMetrics(
+    bitmap_font *font,
+    int glyph)
+{
+    glyph_metrics   **page = &font->metrics[(uint)glyph >> METRIC_PAGE_SHIFT];
+    glyph_metrics   *p;
+
+    if (*page == emptyMetrics) {
+        if ((p = PM_calloc(METRIC_PAGE_SIZE,sizeof(glyph_metrics))) == NULL)
+            return NULL;
+        *page = p;
+        }
+    return *page + ((uint)glyph & (METRIC_PAGE_SIZE-1));
+}
+
+/****************************************************************************
+PARAMETERS:
+font    - Bitmap font to free the glyph metrics for
+
+REMARKS:
+Frees the glyph metric pages that were allocated on demand for a TrueType
+font. The metrics for fonts loaded from disk are part of the font memory
+block and are freed with the font.
+{secret}
+****************************************************************************/
+void _MGL_freeGlyphMetrics(
+    bitmap_font *font)
+{
+    int     i;
+
+    if (!font->lib || font->lib->fontLibType != MGL_TRUETYPEFONT_LIB)
+        return;
+    for (i = 0; i < METRIC_PAGES(font->numGlyphs); i++) {
+        if (font->metrics[i] != emptyMetrics)
+            PM_free(font->metrics[i]);
+        }
+}
+
 /****************************************************************************
 PARAMETERS:
 x   - X coordinate to draw at
@@ -745,7 +1225,8 @@ void _MGL_drawStrBitmap(
     const char *str)
 {
     int             i,width,height,ascent,descent;
-    int             fontAscent,bitmapHeight,ch;
+    int             fontAscent,bitmapHeight,ch,count;
+    uint            codes[MAX_RUN_CHARS];
     text_settings_t ts = DC.a.ts;
     font_t          *font = ts.font;
     bitmap_font     *bitFont = BITFONT(font);
@@ -792,8 +1273,24 @@ void _MGL_drawStrBitmap(
     /* Now draw the string using a different loop for each of the four
      * text drawing directions. Note that we maintain a character clipping
      * rectangle through each loop, and check to see if the character can
-     * be entirely rejected.
+     * be entirely rejected. Anti-aliased glyphs are blended directly
+     * onto the device context if possible.
      */
+    if (bitFont->antialiased)
+        _MGL_beginGlyphBlend();
+    if (ts.dir == MGL_RIGHT_DIR && DC.a.backMode == MGL_TRANSPARENT_BACKGROUND) {
+        /* Composite transparent strings into a single text run */
+        for (count = 0; str[count] && count < MAX_RUN_CHARS; count++) {
+            ch = (uchar)str[count];
+            if (ch > 127 && enc)
+                ch = enc[ch - 128];
+            codes[count] = ch;
+            }
+        if (!str[count] && drawTextRun(bitFont, codes, count, x, y)) {
+            _MGL_endGlyphBlend();
+            return;
+            }
+        }
     width = MGL_textWidth(str);
     switch (ts.dir) {
         case MGL_RIGHT_DIR:
@@ -845,6 +1342,7 @@ void _MGL_drawStrBitmap(
                 }
             break;
         }
+    _MGL_endGlyphBlend();
 }
 
 /****************************************************************************
@@ -866,7 +1364,8 @@ void _MGL_drawStrBitmap_W(
     const wchar_t *str)
 {
     int             i,width,height,ascent,descent;
-    int             fontAscent,bitmapHeight,ch;
+    int             fontAscent,bitmapHeight,ch,count;
+    uint            codes[MAX_RUN_CHARS];
     text_settings_t ts = DC.a.ts;
     font_t          *font = ts.font;
     bitmap_font     *bitFont = BITFONT(font);
@@ -912,8 +1411,20 @@ void _MGL_drawStrBitmap_W(
     /* Now draw the string using a different loop for each of the four
      * text drawing directions. Note that we maintain a character clipping
      * rectangle through each loop, and check to see if the character can
-     * be entirely rejected.
+     * be entirely rejected. Anti-aliased glyphs are blended directly
+     * onto the device context if possible.
      */
+    if (bitFont->antialiased)
+        _MGL_beginGlyphBlend();
+    if (ts.dir == MGL_RIGHT_DIR && DC.a.backMode == MGL_TRANSPARENT_BACKGROUND) {
+        /* Composite transparent strings into a single text run */
+        for (count = 0; str[count] && count < MAX_RUN_CHARS; count++)
+            codes[count] = str[count];
+        if (!str[count] && drawTextRun(bitFont, codes, count, x, y)) {
+            _MGL_endGlyphBlend();
+            return;
+            }
+        }
     width = MGL_textWidth_W(str);
     switch (ts.dir) {
         case MGL_RIGHT_DIR:
@@ -957,5 +1468,6 @@ void _MGL_drawStrBitmap_W(
                 }
             break;
         }
+    _MGL_endGlyphBlend();
 }
 
@@ -44,10 +44,13 @@
 /****************************************************************************
 REMARKS:
 Global variables and macros for BMP helper functions to read and decode
-RLE bitmap data from file buffer.
+RLE bitmap data from file buffer. The decoder state is carried between
+scanlines so that runs and delta escapes spanning scanlines work.
 ****************************************************************************/
-static int      gcount,gdata,bufSize;
-static uchar    *bufStart,*cStart,*cEnd;
+static MGL_THREAD_LOCAL int   gcount,gdata,gskip,gcol,bufSize;
+static MGL_THREAD_LOCAL ibool gabsolute,gpad,geol,bufAlloc;
+static MGL_THREAD_LOCAL long  bytesLeft;
+static MGL_THREAD_LOCAL uchar *bufStart,*cStart,*cEnd;
 
 #define BMP_RUN_MASK    0x03            /* Mask bottom 2 bits       */
 #define BMP_CNT_MASK    0xFF            /* Mask out pixel count     */
@@ -59,16 +62,23 @@ PARAMETERS:
 f   - File to read data from
 
 REMARKS:
-Reads a large chunk of data from disk into the MGL scratch buffer for
-decoding our BMP bitmap data from. Because we read large chunks at a time
-(32Kb for protected mode) it vastly speeds up the time to read and
-decode a BMP file from disk.
+Reads a large chunk of data from disk into the decode buffer for decoding
+our BMP bitmap data from. We never read past the end of the compressed
+data, and if the file is truncated we return a chunk of zeros which
+decodes as end of line escapes so the remaining scanlines are cleared.
 ****************************************************************************/
 static void readChunk(
     FILE *f)
 {
-    size_t size;
-    size = fread(bufStart,1,bufSize,f);
+    size_t size = 0;
+
+    if (bytesLeft > 0)
+        size = __MGL_fread(bufStart,1,MIN(bytesLeft,bufSize),f);
+    if (size == 0) {
+        size = MIN(bufSize,256);
+        memset(bufStart,0,size);
+        }
+    bytesLeft -= size;
     cStart = bufStart;
     cEnd = cStart + size;
 }
@@ -78,6 +88,45 @@ static void readChunk(
         readChunk(f);       \
     (data) = *cStart++
 
+/****************************************************************************
+PARAMETERS:
+f       - File to read data from
+size    - Size of the compressed data in the file
+
+REMARKS:
+Prepares for decoding RLE data from the file. For large images we allocate
+a decode buffer big enough to read the compressed data in a few large
+reads, falling back on the MGL scratch buffer if memory is low.
+****************************************************************************/
+static void beginDecode(
+    FILE *f,
+    long size)
+{
+    bytesLeft = (size > 0) ? size : 0x7FFFFFFFL;
+    bufSize = MIN(bytesLeft,RLE_CHUNK_SIZE);
+    bufAlloc = false;
+    if (bufSize > _MGL_bufSize && (bufStart = PM_malloc(bufSize)) != NULL)
+        bufAlloc = true;
+    else {
+        bufStart = (uchar*)_MGL_buf;
+        bufSize = _MGL_bufSize;
+        }
+    gcount = gdata = gskip = gcol = 0;
+    gabsolute = gpad = geol = false;
+    readChunk(f);
+}
+
+/****************************************************************************
+REMARKS:
+Releases the decode buffer allocated by beginDecode.
+****************************************************************************/
+static void endDecode(void)
+{
+    if (bufAlloc)
+        PM_free(bufStart);
+    bufAlloc = false;
+}
+
 /****************************************************************************
 PARAMETERS:
 f           - File to read data from
@@ -85,73 +134,105 @@ p           - Pointer to buffer to decode into
 rowbyte     - Number of bytes in a row to decode
 
 REMARKS:
-Decodes a single scanline of data from the BMP file. Note that this routine
-properly handles runs that cross a scanline boundary, which the BMP file
-format allows.
+Decodes a single scanline of data from the BMP file. Encoded runs are
+expanded with memset and literal runs are copied straight out of the
+decode buffer with memcpy. Pixels skipped by end of line, end of bitmap
+and delta escapes are cleared to zero. Note that this routine properly
+handles runs that cross a scanline boundary, and scanlines that fill the
+entire row without an end of line escape.
 ****************************************************************************/
 static void decodeScan(
     FILE *f,
     uchar *p,
     int rowbytes)
 {
-    int data = gdata;
-    int count = gcount;
-    int bytecnt = 0;
-    ibool endline, endbmp, absolute;
-
-    while (bytecnt < rowbytes) {
-        endline = endbmp = absolute = false;
-        /* Read another run from the file */
-        if (count < 1) {
+    int     x = 0,n,data;
+
+    /* Skip scanlines jumped over by a delta or end of bitmap escape */
+    if (gskip > 0) {
+        gskip--;
+        memset(p,0,rowbytes);
+        return;
+        }
+    if (gcol > 0) {
+        x = MIN(gcol,rowbytes);
+        memset(p,0,x);
+        gcol = 0;
+        }
+
+    for (;;) {
+        /* Expand the current run into the scanline */
+        while (gcount > 0 && x < rowbytes) {
+            n = MIN(gcount,rowbytes - x);
+            if (gabsolute) {
+                if (cStart == cEnd)
+                    readChunk(f);
+                n = MIN(n,cEnd - cStart);
+                memcpy(p + x,cStart,n);
+                cStart += n;
+                }
+            else
+                memset(p + x,gdata,n);
+            x += n;
+            gcount -= n;
+            }
+        if (gcount == 0 && gpad) {
+            /* Literal runs are padded to a word boundary */
             BMP_GETC(data,f);
-            /* RLE encoded sequence? */
-            if (data != 0) {
-                /* 1st byte = count, 2nd byte = data */
-                count = data & BMP_CNT_MASK;
+            gpad = false;
+            }
+        if (x == rowbytes) {
+            /* Scanline is full, so swallow the end of line that follows */
+            geol = (gcount == 0);
+            return;
+            }
+
+        /* Read the next run or escape sequence from the file */
+        BMP_GETC(data,f);
+        if (data != 0) {
+            gcount = data & BMP_CNT_MASK;
+            BMP_GETC(gdata,f);
+            gabsolute = false;
+            geol = false;
+            continue;
+            }
+        BMP_GETC(data,f);
+        if (data == 0 && geol && x == 0) {
+            /* End of line for the previous full scanline */
+            geol = false;
+            continue;
+            }
+        geol = false;
+        switch (data) {
+            case 0: /* end of line */
+                memset(p + x,0,rowbytes - x);
+                return;
+            case 1: /* end of bitmap */
+                memset(p + x,0,rowbytes - x);
+                gskip = 0x7FFFFFFF;
+                return;
+            case 2: /* delta XY bitmap cursor */
                 BMP_GETC(data,f);
-                }
-            else {
-                /* escape sequence */
+                n = MIN(data,rowbytes - x);
                 BMP_GETC(data,f);
-                switch (data) {
-                    case 0: /* end of line */
-                        endline = true;
-                        break;
-                    case 1: /* end of bitmap */
-                        endbmp = true;
-                        break;
-                    case 2: /* delta XY bitmap cursor */
-                        BMP_GETC(data,f);
-                        p += data;
-                        BMP_GETC(data,f);
-                        p += data * rowbytes;
-                        endline = true;
-                        break;
-                    default: /* absolute literal sequence */
-                        absolute = true;
-                        count = data & BMP_CNT_MASK;
-                        BMP_GETC(data,f);
-                        break;
+                if (data == 0) {
+                    memset(p + x,0,n);
+                    x += n;
+                    }
+                else {
+                    memset(p + x,0,rowbytes - x);
+                    gskip = data - 1;
+                    gcol = x + n;
+                    return;
                     }
-                }
-            }
-        if (endline)
-            continue;
-        if (endbmp)
-            break;
-        /* Decode the run into the bitmap */
-        while (count--) {
-            *p++ = data;
-            if (++bytecnt == rowbytes)
                 break;
-            if (absolute) {
-                BMP_GETC(data,f);
-                }
+            default: /* absolute literal sequence */
+                gcount = data;
+                gabsolute = true;
+                gpad = (data & 1);
+                break;
             }
         }
-    /* Update global data for subsequent pass */
-    gdata = data;
-    gcount = count;
 }
 
 /****************************************************************************
@@ -235,6 +316,53 @@ static FILE *openBitmapFile(
     return f;
 }
 
+/****************************************************************************
+PARAMETERS:
+bitmap      - Bitmap header with the bitsPerPixel field filled in
+pf          - Place to store the pixel format
+bitfields   - True if the bitmap has BI_BITFIELDS color masks
+masks       - Red, green and blue color masks for BI_BITFIELDS bitmaps
+
+REMARKS:
+Determines the pixel format for a 15 bit and higher DIB from the color
+masks stored in the file. 16 bit bitmaps without RGB 5:6:5 masks are
+flagged as 15 bits per pixel.
+****************************************************************************/
+static void getBitmapPixelFormat(
+    bitmap_t *bitmap,
+    pixel_format_t *pf,
+    ibool bitfields,
+    M_uint32 *masks)
+{
+    switch (bitmap->bitsPerPixel) {
+        case 16:
+            if (bitfields && masks[1] == 0x7E0UL)
+                *pf = _MGL_pixelFormats[pfRGB565];
+            else {
+                *pf = _MGL_pixelFormats[pfRGB555];
+                bitmap->bitsPerPixel = 15;
+                }
+            break;
+        case 24:
+            if (bitfields && masks[0] == 0xFFUL)
+                *pf = _MGL_pixelFormats[pfBGR24];
+            else *pf = _MGL_pixelFormats[pfRGB24];
+            break;
+        case 32:
+            if (bitfields) {
+                if (masks[0] == 0xFFUL)
+                    *pf = _MGL_pixelFormats[pfABGR32];
+                else if (masks[0] == 0xFF0000UL)
+                    *pf = _MGL_pixelFormats[pfARGB32];
+                else if (masks[0] == 0xFF00UL)
+                    *pf = _MGL_pixelFormats[pfBGRA32];
+                else *pf = _MGL_pixelFormats[pfRGBA32];
+                }
+            else *pf = _MGL_pixelFormats[pfARGB32];
+            break;
+        }
+}
+
 /****************************************************************************
 RETURNS:
 Pointer to file for reading bitmap bits
@@ -311,35 +439,7 @@ static ibool readBitmapHeaderExt(
     bitmap->bytesPerLine = (bytesPerLine + 3) & ~3;
 
     /* Create a pixel format block for 15 bit and higher bitmaps */
-    if (bitmap->bitsPerPixel > 8) {
-        switch (bitmap->bitsPerPixel) {
-            case 16:
-                if (getLELong(bmInfo.biCompression) == winBI_BITFIELDS && masks[1] == 0x7E0UL)
-                    *pf = _MGL_pixelFormats[pfRGB565];
-                else {
-                    *pf = _MGL_pixelFormats[pfRGB555];
-                    bitmap->bitsPerPixel = 15;
-                    }
-                break;
-            case 24:
-                if (getLELong(bmInfo.biCompression) == winBI_BITFIELDS && masks[0] == 0xFFUL)
-                    *pf = _MGL_pixelFormats[pfBGR24];
-                else *pf = _MGL_pixelFormats[pfRGB24];
-                break;
-            case 32:
-                if (getLELong(bmInfo.biCompression) == winBI_BITFIELDS) {
-                    if (masks[0] == 0xFFUL)
-                        *pf = _MGL_pixelFormats[pfABGR32];
-                    else if (masks[0] == 0xFF0000UL)
-                        *pf = _MGL_pixelFormats[pfARGB32];
-                    else if (masks[0] == 0xFF00UL)
-                        *pf = _MGL_pixelFormats[pfBGRA32];
-                    else *pf = _MGL_pixelFormats[pfRGBA32];
-                    }
-                else *pf = _MGL_pixelFormats[pfARGB32];
-                break;
-            }
-        }
+    getBitmapPixelFormat(bitmap,pf,getLELong(bmInfo.biCompression) == winBI_BITFIELDS,masks);
     return true;
 }
 
@@ -415,17 +515,15 @@ bitmap_t * MGLAPI MGL_loadBitmapExt(
 
     /* Now read in the bits in the bitmap. We need to handle both cases
      * of bottom up and top down DIB's. We can also decode RLE bitmaps
-     * (which are always bottom up DIB format) via MGL scratch buffer.
+     * (which are always bottom up DIB format) via a decode buffer.
      */
     if (isRLE) {
-        bufStart = (uchar*)_MGL_buf;
-        bufSize = _MGL_bufSize;
-        readChunk(f);
-        gcount = gdata = 0;
+        beginDecode(f,(long)dwSize - (__MGL_ftell(f) - (long)dwOffset));
         p = (uchar *)bitmap->surface + (long)bitmap->bytesPerLine * (bitmap->height-1);
         for (i = 0; i < bitmap->height; i++, p -= bitmap->bytesPerLine) {
             decodeScan(f,(uchar*)p,bitmap->bytesPerLine);
             }
+        endDecode();
         }
     else if (bitmap->height < 0) {
         bitmap->height = -bitmap->height;
@@ -440,7 +538,6 @@ bitmap_t * MGLAPI MGL_loadBitmapExt(
             __MGL_fread(p,1,bitmap->bytesPerLine,f);
             }
         }
-    (void)dwSize;
     return bitmap;
 }
 
@@ -607,6 +704,212 @@ ibool MGLAPI MGL_getBitmapSize(
     return ret;
 }
 
+/****************************************************************************
+PARAMETERS:
+mb          - Mapped bitmap to fill in from the file mapping
+loadPalette - True if the palette should also be loaded
+
+RETURNS:
+True if the bitmap bits can be used directly from the mapping.
+
+REMARKS:
+Parses the bitmap headers from the file mapping and checks that the pixel
+data is stored in a layout that the MGL can use directly. This is the case
+for all uncompressed DIB's as the rows are always DWORD aligned, but we also
+require the pixel data for 16 and 32 bit bitmaps to be naturally aligned.
+Bottom up DIB's are handled by pointing the surface at the last row in the
+file and using a negative bytesPerLine value.
+****************************************************************************/
+static ibool mapBitmapHeader(
+    mappedBitmap *mb,
+    ibool loadPalette)
+{
+    winBITMAPFILEHEADER *h = (winBITMAPFILEHEADER*)mb->base;
+    winBITMAPINFOHEADER *b = (winBITMAPINFOHEADER*)(h+1);
+    uchar               *colors = (uchar*)(b+1);
+    M_uint32            masks[3];
+    M_int32             height;
+    ulong               offBits,bytesPerLine,compression,clrUsed;
+    int                 bitsPerPixel;
+
+    /* Verify the bitmap headers, and only accept uncompressed bitmaps */
+    if (mb->size < sizeof(winBITMAPFILEHEADER) + sizeof(winBITMAPINFOHEADER)
+            || h->bfType[0] != 'B'
+            || h->bfType[1] != 'M'
+            || getLELong(b->biSize) != 0x28
+            || getLEShort(b->biPlanes) != 1)
+        return false;
+    bitsPerPixel = getLEShort(b->biBitCount);
+    compression = getLELong(b->biCompression);
+    if (compression != winBI_RGB && !(compression == winBI_BITFIELDS && bitsPerPixel > 8))
+        return false;
+    switch (bitsPerPixel) {
+        case 1:
+        case 4:
+        case 8:
+        case 24:
+            break;
+        case 16:
+        case 32:
+            if (getLELong(h->bfOffBits) & (bitsPerPixel/8 - 1))
+                return false;
+            break;
+        default:
+            return false;
+        }
+
+    /* Make sure the pixel data is all present in the file */
+    mb->bm.width = (M_int32)getLELong(b->biWidth);
+    height = (M_int32)getLELong(b->biHeight);
+    if (mb->bm.width <= 0 || mb->bm.width > 0xFFFFFFL || height == 0 || height < -0xFFFFFFL || height > 0xFFFFFFL)
+        return false;
+    mb->bm.height = ABS(height);
+    bytesPerLine = (((ulong)mb->bm.width * bitsPerPixel + 31) / 32) * 4;
+    offBits = getLELong(h->bfOffBits);
+    if (offBits > mb->size || bytesPerLine > (mb->size - offBits) / mb->bm.height)
+        return false;
+
+    /* Copy the palette or pixel format information into the header block */
+    mb->bm.bitsPerPixel = bitsPerPixel;
+    mb->bm.pal = NULL;
+    mb->bm.pf = NULL;
+    if (bitsPerPixel <= 8) {
+        if (loadPalette) {
+            if ((clrUsed = getLELong(b->biClrUsed)) == 0 || clrUsed > (1UL << bitsPerPixel))
+                clrUsed = 1UL << bitsPerPixel;
+            if (colors + clrUsed * sizeof(palette_t) > (uchar*)mb->base + mb->size)
+                return false;
+            memcpy(mb->pal,colors,clrUsed * sizeof(palette_t));
+            mb->bm.pal = mb->pal;
+            }
+        }
+    else {
+        if (compression == winBI_BITFIELDS) {
+            if (colors + sizeof(masks) > (uchar*)mb->base + mb->size)
+                return false;
+            memcpy(masks,colors,sizeof(masks));
+            }
+        getBitmapPixelFormat(&mb->bm,&mb->pf,compression == winBI_BITFIELDS,masks);
+        mb->bm.pf = &mb->pf;
+        }
+
+    /* Point the surface at the pixel data in the mapping */
+    if (height < 0) {
+        mb->bm.surface = (uchar*)mb->base + offBits;
+        mb->bm.bytesPerLine = bytesPerLine;
+        }
+    else {
+        mb->bm.surface = (uchar*)mb->base + offBits + bytesPerLine * (mb->bm.height-1);
+        mb->bm.bytesPerLine = -(M_int32)bytesPerLine;
+        }
+    return true;
+}
+
+/****************************************************************************
+DESCRIPTION:
+Maps a lightweight bitmap file from disk directly into memory.
+
+HEADER:
+mgraph.h
+
+PARAMETERS:
+bitmapName  - Name of bitmap file to map
+loadPalette - True if the palette should also be loaded
+
+RETURNS:
+Pointer to the mapped bitmap, NULL on error.
+
+REMARKS:
+This function is similar to MGL_loadBitmap, however for uncompressed bitmap
+files the bitmap surface points directly into a memory mapping of the file
+rather than a copy of the pixels. This avoids reading the entire file up
+front and allows multiple processes using the same bitmap files to share
+the physical memory for the pixels, which makes it useful for large
+background images and texture sets that are drawn straight from disk.
+
+Windows bitmap files are usually stored bottom up, in which case the
+surface of the returned bitmap points at the last row in the file and the
+bytesPerLine field is negative. Such bitmaps can be drawn with all the
+MGL_putBitmap family of functions, but code that accesses the surface
+directly must step through the rows using the signed bytesPerLine value.
+The mapping is private to the application, so writing to the surface does
+not change the file on disk.
+
+If the bitmap file is compressed, the pixel data is not suitably aligned,
+the platform does not support mapping files or the file I/O functions have
+been overridden with MGL_setFileIO, the bitmap is loaded into memory with
+MGL_loadBitmap instead. Either way the bitmap must be released with
+MGL_unmapBitmap and not MGL_unloadBitmap.
+
+SEE ALSO:
+MGL_unmapBitmap, MGL_loadBitmap, MGL_putBitmap
+****************************************************************************/
+bitmap_t * MGLAPI MGL_mapBitmap(
+    const char *bitmapName,
+    ibool loadPalette)
+{
+    mappedBitmap    *mb;
+    char            path[PM_MAX_PATH];
+
+    __MGL_result = grOK;
+    if ((mb = PM_calloc(1,sizeof(mappedBitmap))) == NULL) {
+        FATALERROR(grNoMem);
+        return NULL;
+        }
+
+    /* We can only map the file if it lives on disk where the standard C
+     * file I/O functions can find it.
+     */
+    if (__MGL_fopen == fopen && _MGL_findFile(path,MGL_BITMAPS,bitmapName,"rb")) {
+        if ((mb->base = _MGL_mapFile(path,&mb->size)) != NULL) {
+            if (mapBitmapHeader(mb,loadPalette))
+                return &mb->bm;
+            _MGL_unmapFile(mb->base,mb->size);
+            mb->base = NULL;
+            }
+        }
+
+    /* Fall back on loading a copy of the bitmap into memory */
+    if ((mb->copy = MGL_loadBitmap(bitmapName,loadPalette)) == NULL) {
+        PM_free(mb);
+        return NULL;
+        }
+    mb->bm = *mb->copy;
+    return &mb->bm;
+}
+
+/****************************************************************************
+DESCRIPTION:
+Unmaps a bitmap mapped with MGL_mapBitmap.
+
+HEADER:
+mgraph.h
+
+PARAMETERS:
+bitmap  - Pointer to bitmap to unmap
+
+REMARKS:
+Releases the file mapping (or the memory for the copy of the bitmap if the
+file could not be mapped) and the bitmap header returned by MGL_mapBitmap
+or MGL_mapSurface.
+
+SEE ALSO:
+MGL_mapBitmap, MGL_mapSurface
+****************************************************************************/
+void MGLAPI MGL_unmapBitmap(
+    bitmap_t *bitmap)
+{
+    mappedBitmap    *mb = (mappedBitmap*)bitmap;
+
+    if (!mb)
+        return;
+    if (mb->base)
+        _MGL_unmapFile(mb->base,mb->size);
+    if (mb->copy)
+        MGL_unloadBitmap(mb->copy);
+    PM_free(mb);
+}
+
 /****************************************************************************
 DESCRIPTION:
 Locates the specified bitmap file and loads it into a device context.
@@ -682,16 +985,14 @@ ibool MGLAPI MGL_loadBitmapIntoDCExt(
      */
     height = bmh.height;
     if (isRLE) {
-        /* Decode RLE bottom up DIB via MGL scratch buffer */
-        bufStart = (uchar*)_MGL_buf;
-        bufSize = _MGL_bufSize;
-        readChunk(f);
-        gcount = gdata = 0;
+        /* Decode RLE bottom up DIB via a decode buffer */
+        beginDecode(f,(long)dwSize - (__MGL_ftell(f) - (long)dwOffset));
         bmh.height = 1;
         for (i = height-1; i >= 0; i--) {
             decodeScan(f,bmh.surface,bmh.bytesPerLine);
             MGL_putBitmap(dc,dstLeft,dstTop+i,&bmh,MGL_REPLACE_MODE);
             }
+        endDecode();
         }
     else if (height < 0) {
         /* Top down DIB */
@@ -712,7 +1013,6 @@ ibool MGLAPI MGL_loadBitmapIntoDCExt(
         }
     PM_free(bmh.surface);
     MGL_checkIdentityPalette(oldCheckId);
-    (void)dwSize;
     return true;
 }
 
@@ -783,6 +1083,33 @@ ibool MGLAPI MGL_loadBitmapIntoDC(
     return ret;
 }
 
+/****************************************************************************
+PARAMETERS:
+band    - Band of decoded scanlines
+top     - Index of the first scanline in the band
+cookie  - Pointer to the putbandinfo_t for the destination
+
+RETURNS:
+True to continue decoding.
+
+REMARKS:
+Band callback used by the image loaders to stream decoded scanlines
+straight into a device context. Each band is blitted in a single call so
+the pixel format conversion to the destination is done as the band is
+handed off, and a full size copy of the image is never needed.
+{secret}
+****************************************************************************/
+ibool MGLAPI _MGL_putBand(
+    const bitmap_t *band,
+    int top,
+    void *cookie)
+{
+    putbandinfo_t   *info = (putbandinfo_t*)cookie;
+
+    MGL_putBitmap(info->dc,info->dstLeft,info->dstTop+top,band,MGL_REPLACE_MODE);
+    return true;
+}
+
 /****************************************************************************
 PARAMETERS:
 dc      - Device context to create bitmap from
@@ -96,13 +96,14 @@ Note:   The MGL automatically manages offscreen display memory, and if you
         flag). Hence you should allocate your important buffers first,
         to ensure they end up in offscreen memory for speedy drawing.
 
-Note:   This function is only valid for display device contexts, and
-        will fail if you call it for a different device context type
-        with an error code of grInvalidDC.
+Note:   This function is only valid for display device contexts, or
+        device contexts with a software buffer heap created with
+        MGL_createBufferHeap. It will fail if you call it for a different
+        device context type with an error code of grInvalidDC.
 
 SEE ALSO:
 MGL_createBuffer, MGL_lockBuffer, MGL_unlockBuffer, MGL_destroyBuffer,
-MGL_createOffscreenDC, MGL_putBuffer, MGL_stretchBuffer, MGL_putBufferSrcTrans,
+MGL_createBufferHeap, MGL_createOffscreenDC, MGL_putBuffer, MGL_stretchBuffer, MGL_putBufferSrcTrans,
 MGL_putBufferDstTrans, MGL_copyToBuffer, MGL_copyBitmapToBuffer,
 MGL_updateBufferCache, MGL_updateFromBufferCache
 ****************************************************************************/
@@ -116,6 +117,8 @@ MGLBUF * MGLAPI MGL_createBuffer(
 
     /* Check that the DC is valid, and create the buffer */
     CHECK(dc != NULL);
+    if (dc->bufHeap)
+        return _MGL_allocHeapBuffer(dc,width,height,flags);
     if (dc->r.AllocBuffer) {
         if ((buf = (MGLBUF*)dc->r.AllocBuffer(width,height,flags)) != NULL)
             buf->dc = dc;
@@ -498,6 +501,7 @@ void MGLAPI MGL_putBuffer(
         END_VISIBLE_CLIP_LIST(dc);
         return;
         }
+    MARK_DIRTY_VIEW(dc,d.left,d.top,d.right,d.bottom);
 
     /* Adjust to buffer coordinates */
     MGL_offsetRect(d,-x,-y);
@@ -604,6 +608,7 @@ void MGLAPI MGL_putBufferSection(
         END_VISIBLE_CLIP_LIST(dc);
         return;
         }
+    MARK_DIRTY_VIEW(dc,d.left,d.top,d.right,d.bottom);
     left += (d.left - dstLeft); right = left + (d.right - d.left);
     top += (d.top - dstTop);    bottom = top + (d.bottom - d.top);
     dstLeft = d.left;           dstTop = d.top;
@@ -702,6 +707,7 @@ void MGLAPI MGL_putBufferSrcTrans(
         END_VISIBLE_CLIP_LIST(dc);
         return;
         }
+    MARK_DIRTY_VIEW(dc,d.left,d.top,d.right,d.bottom);
 
     /* Adjust to buffer coordinates */
     MGL_offsetRect(d,-x,-y);
@@ -818,6 +824,7 @@ void MGLAPI MGL_putBufferSrcTransSection(
         END_VISIBLE_CLIP_LIST(dc);
         return;
         }
+    MARK_DIRTY_VIEW(dc,d.left,d.top,d.right,d.bottom);
     left += (d.left - dstLeft); right = left + (d.right - d.left);
     top += (d.top - dstTop);    bottom = top + (d.bottom - d.top);
     dstLeft = d.left;           dstTop = d.top;
@@ -920,6 +927,7 @@ void MGLAPI MGL_putBufferDstTrans(
         END_VISIBLE_CLIP_LIST(dc);
         return;
         }
+    MARK_DIRTY_VIEW(dc,d.left,d.top,d.right,d.bottom);
 
     /* Adjust to buffer coordinates */
     MGL_offsetRect(d,-x,-y);
@@ -1039,6 +1047,7 @@ void MGLAPI MGL_putBufferDstTransSection(
         END_VISIBLE_CLIP_LIST(dc);
         return;
         }
+    MARK_DIRTY_VIEW(dc,d.left,d.top,d.right,d.bottom);
     left += (d.left - dstLeft); right = left + (d.right - d.left);
     top += (d.top - dstTop);    bottom = top + (d.bottom - d.top);
     dstLeft = d.left;           dstTop = d.top;
@@ -1131,6 +1140,7 @@ void MGLAPI MGL_putBufferPatt(
         END_VISIBLE_CLIP_LIST(dc);
         return;
         }
+    MARK_DIRTY_VIEW(dc,d.left,d.top,d.right,d.bottom);
 
     /* Adjust to buffer coordinates */
     MGL_offsetRect(d,-x,-y);
@@ -1258,6 +1268,7 @@ void MGLAPI MGL_putBufferPattSection(
         END_VISIBLE_CLIP_LIST(dc);
         return;
         }
+    MARK_DIRTY_VIEW(dc,d.left,d.top,d.right,d.bottom);
     left += (d.left - dstLeft); right = left + (d.right - d.left);
     top += (d.top - dstTop);    bottom = top + (d.bottom - d.top);
     dstLeft = d.left;           dstTop = d.top;
@@ -1420,6 +1431,7 @@ void MGLAPI MGL_putBufferFx(
         END_VISIBLE_CLIP_LIST(dc);
         return;
         }
+    MARK_DIRTY_VIEW(dc,d.left,d.top,d.right,d.bottom);
 
     /* Setup effect blit structure. The MGL flags are a subset of
      * the SciTech SNAP Graphics flags so we can simply copy them across and add
@@ -1550,6 +1562,7 @@ void MGLAPI MGL_putBufferFxSection(
         END_VISIBLE_CLIP_LIST(dc);
         return;
         }
+    MARK_DIRTY_VIEW(dc,d.left,d.top,d.right,d.bottom);
     left += (d.left - dstLeft); right = left + (d.right - d.left);
     top += (d.top - dstTop);    bottom = top + (d.bottom - d.top);
     dstLeft = d.left;           dstTop = d.top;
@@ -1668,6 +1681,7 @@ void MGLAPI MGL_stretchBuffer(
         END_VISIBLE_CLIP_LIST(dc);
         return;
         }
+    MARK_DIRTY_VIEW(dc,d.left,d.top,d.right,d.bottom);
     if ((d.left != dstLeft) || (d.right  != dstRight) || (d.top != dstTop) || (d.bottom != dstBottom))
         clipIt = true;
 
@@ -1811,6 +1825,7 @@ void MGLAPI MGL_stretchBufferSection(
         END_VISIBLE_CLIP_LIST(dc);
         return;
         }
+    MARK_DIRTY_VIEW(dc,d.left,d.top,d.right,d.bottom);
     if ((d.left != dstLeft) || (d.right  != dstRight) || (d.top != dstTop) || (d.bottom != dstBottom))
         clipIt = true;
 
@@ -1915,6 +1930,7 @@ void MGLAPI MGL_stretchBufferFx(
         END_VISIBLE_CLIP_LIST(dc);
         return;
         }
+    MARK_DIRTY_VIEW(dc,d.left,d.top,d.right,d.bottom);
 
     /* Setup effect blit structure. The MGL flags are a subset of
      * the SciTech SNAP Graphics flags so we can simply copy them across and add
@@ -2094,6 +2110,7 @@ void MGLAPI MGL_stretchBufferFxSection(
         END_VISIBLE_CLIP_LIST(dc);
         return;
         }
+    MARK_DIRTY_VIEW(dc,d.left,d.top,d.right,d.bottom);
 
     /* Setup effect blit structure. The MGL flags are a subset of
      * the SciTech SNAP Graphics flags so we can simply copy them across and add
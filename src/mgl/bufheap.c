@@ -0,0 +1,866 @@
+/****************************************************************************
+*
+*                   SciTech Multi-platform Graphics Library
+*
+*  ========================================================================
+*
+*   Copyright (C) 1991-2004 SciTech Software, Inc. All rights reserved.
+*
+*   This file may be distributed and/or modified under the terms of the
+*   GNU General Public License version 2.0 as published by the Free
+*   Software Foundation and appearing in the file LICENSE.GPL included
+*   in the packaging of this file.
+*
+*   Licensees holding a valid Commercial License for this product from
+*   SciTech Software, Inc. may use this file in accordance with the
+*   Commercial License Agreement provided with the Software.
+*
+*   This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING
+*   THE WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+*   PURPOSE.
+*
+*   See http://www.scitechsoft.com/license/ for information about
+*   the licensing options available and how to purchase a Commercial
+*   License Agreement.
+*
+*   Contact license@scitechsoft.com if any conditions of this licensing
+*   are not clear to you, or you have questions about licensing options.
+*
+*  ========================================================================
+*
+* Language:     ANSI C
+* Environment:  Any
+*
+* Description:  Software buffer heap manager. Provides MGL buffers for
+*               device contexts that do not have a hardware buffer
+*               manager (such as memory device contexts), allocated from
+*               a fixed size heap arena. When the arena runs out of space
+*               the heap is compacted by sliding moveable buffers down
+*               over the holes, and if that is not enough the least
+*               recently used pageable buffers are paged out to their
+*               system memory surface cache. Pageable buffers are paged
+*               back into the heap the next time they are used.
+*
+****************************************************************************/
+
+#include "mgl.h"
+
+/*--------------------------- Global Variables ----------------------------*/
+
+/* Buffer allocated from the software buffer heap. The public MGLBUF
+ * structure must come first so we can cast between the two.
+ */
+typedef struct _swbuf {
+    MGLBUF          buf;            /* Public buffer structure          */
+    long            size;           /* Size of the buffer surface       */
+    int             lockCount;      /* Lock count for direct access     */
+    ibool           resident;       /* True if resident in the heap     */
+    void            *sysMem;        /* Uncached system memory surface   */
+    struct _swbuf   *prev;          /* Previous resident buffer in heap */
+    struct _swbuf   *next;          /* Next resident buffer in heap     */
+    struct _swbuf   *older;         /* Next older buffer in LRU list    */
+    struct _swbuf   *newer;         /* Next newer buffer in LRU list    */
+    } swbuf;
+
+struct _MGL_bufHeap {
+    uchar           *arena;         /* Memory for the heap arena        */
+    long            size;           /* Size of the heap arena           */
+    swbuf           *first;         /* Resident buffers in heap order   */
+    swbuf           *oldest;        /* Least recently used buffer       */
+    swbuf           *newest;        /* Most recently used buffer        */
+    int             numBuffers;     /* Number of buffers allocated      */
+    int             numPriority;    /* Number of priority buffers       */
+    ulong           hits;           /* Uses of resident buffers         */
+    ulong           misses;         /* Uses of non-resident buffers     */
+    ulong           evictions;      /* Buffers paged out of the heap    */
+    ulong           compactions;    /* Times the heap was compacted     */
+    ulong           bytesMoved;     /* Bytes moved by compaction        */
+    };
+
+/*------------------------- Implementation --------------------------------*/
+
+/****************************************************************************
+REMARKS:
+Moves a buffer to the most recently used end of the LRU list.
+****************************************************************************/
+static void touchBuffer(
+    MGL_bufHeap *heap,
+    swbuf *b)
+{
+    if (heap->newest == b)
+        return;
+    if (b->older)
+        b->older->newer = b->newer;
+    else if (heap->oldest == b)
+        heap->oldest = b->newer;
+    if (b->newer)
+        b->newer->older = b->older;
+    b->older = heap->newest;
+    b->newer = NULL;
+    if (heap->newest)
+        heap->newest->newer = b;
+    heap->newest = b;
+    if (!heap->oldest)
+        heap->oldest = b;
+}
+
+/****************************************************************************
+REMARKS:
+Removes a buffer from the LRU list.
+****************************************************************************/
+static void unlinkLRU(
+    MGL_bufHeap *heap,
+    swbuf *b)
+{
+    if (b->older)
+        b->older->newer = b->newer;
+    else
+        heap->oldest = b->newer;
+    if (b->newer)
+        b->newer->older = b->older;
+    else
+        heap->newest = b->older;
+    b->older = b->newer = NULL;
+}
+
+/****************************************************************************
+REMARKS:
+Places a buffer in the heap arena at the specified offset, after the
+resident buffer prev (or at the start of the heap if prev is NULL).
+****************************************************************************/
+static void makeResident(
+    MGL_bufHeap *heap,
+    swbuf *b,
+    long offset,
+    swbuf *prev)
+{
+    b->prev = prev;
+    b->next = prev ? prev->next : heap->first;
+    if (b->next)
+        b->next->prev = b;
+    if (prev)
+        prev->next = b;
+    else
+        heap->first = b;
+    b->resident = true;
+    b->buf.offset = offset;
+    b->buf.surface = heap->arena + offset;
+    b->buf.flags &= ~MGL_BUF_SYSMEM;
+}
+
+/****************************************************************************
+REMARKS:
+Removes a buffer from the heap arena. The caller is responsible for
+pointing the buffer surface at system memory.
+****************************************************************************/
+static void removeResident(
+    MGL_bufHeap *heap,
+    swbuf *b)
+{
+    if (b->prev)
+        b->prev->next = b->next;
+    else
+        heap->first = b->next;
+    if (b->next)
+        b->next->prev = b->prev;
+    b->prev = b->next = NULL;
+    b->resident = false;
+    b->buf.flags |= MGL_BUF_SYSMEM;
+}
+
+/****************************************************************************
+PARAMETERS:
+heap    - Buffer heap to search
+size    - Size of the block to find
+prev    - Place to store the resident buffer preceding the block
+
+RETURNS:
+Offset of the first free block big enough, or -1 if none found.
+****************************************************************************/
+static long findFreeBlock(
+    MGL_bufHeap *heap,
+    long size,
+    swbuf **prev)
+{
+    swbuf   *b,*last = NULL;
+    long    pos = 0;
+
+    for (b = heap->first; b; last = b, b = b->next) {
+        if (b->buf.offset - pos >= size) {
+            *prev = last;
+            return pos;
+            }
+        pos = b->buf.offset + b->size;
+        }
+    if (heap->size - pos >= size) {
+        *prev = last;
+        return pos;
+        }
+    return -1;
+}
+
+/****************************************************************************
+REMARKS:
+Returns the total number of free bytes in the heap arena, and optionally
+the size of the largest free block and the number of free blocks.
+****************************************************************************/
+static long freeSpace(
+    MGL_bufHeap *heap,
+    long *largest,
+    int *blocks)
+{
+    swbuf   *b;
+    long    pos = 0,hole,total = 0,maxHole = 0;
+    int     count = 0;
+
+    for (b = heap->first; ; b = b->next) {
+        hole = (b ? b->buf.offset : heap->size) - pos;
+        if (hole > 0) {
+            total += hole;
+            maxHole = MAX(maxHole,hole);
+            count++;
+            }
+        if (!b)
+            break;
+        pos = b->buf.offset + b->size;
+        }
+    if (largest)
+        *largest = maxHole;
+    if (blocks)
+        *blocks = count;
+    return total;
+}
+
+/****************************************************************************
+RETURNS:
+Number of bytes moved to compact the heap.
+
+REMARKS:
+Compacts the heap arena by sliding all moveable buffers that are not
+locked down to the end of the preceding buffer. Fixed and locked buffers
+stay where they are, so free space in front of them remains.
+****************************************************************************/
+static long compactHeap(
+    MGL_bufHeap *heap)
+{
+    swbuf   *b;
+    long    pos = 0,moved = 0;
+
+    for (b = heap->first; b; b = b->next) {
+        if (b->buf.offset > pos && (b->buf.flags & MGL_BUF_MOVEABLE) && !b->lockCount) {
+            memmove(heap->arena + pos,heap->arena + b->buf.offset,b->size);
+            b->buf.offset = pos;
+            b->buf.surface = heap->arena + pos;
+            moved += b->size;
+            }
+        pos = b->buf.offset + b->size;
+        }
+    if (moved) {
+        heap->compactions++;
+        heap->bytesMoved += moved;
+        }
+    return moved;
+}
+
+/****************************************************************************
+REMARKS:
+Pages a resident buffer out of the heap arena into its system memory
+surface cache, so that the space can be used by another buffer.
+****************************************************************************/
+static void evictBuffer(
+    MGL_bufHeap *heap,
+    swbuf *b)
+{
+    memcpy(b->buf.surfaceCache,b->buf.surface,b->size);
+    removeResident(heap,b);
+    b->buf.surface = b->buf.surfaceCache;
+    heap->evictions++;
+}
+
+/****************************************************************************
+PARAMETERS:
+heap    - Buffer heap to allocate from
+size    - Size of the block to allocate
+keep    - Buffer that must not be evicted (NULL for none)
+prev    - Place to store the resident buffer preceding the block
+
+RETURNS:
+Offset of the allocated block, or -1 if there is no room in the heap.
+
+REMARKS:
+Finds space in the heap arena for a new block. If there is no free block
+big enough, we first try to compact the heap, and then page out the least
+recently used pageable buffers one at a time until the block fits.
+****************************************************************************/
+static long allocBlock(
+    MGL_bufHeap *heap,
+    long size,
+    swbuf *keep,
+    swbuf **prev)
+{
+    swbuf   *b;
+    long    offset;
+
+    if (size > heap->size)
+        return -1;
+    for (;;) {
+        if ((offset = findFreeBlock(heap,size,prev)) != -1)
+            return offset;
+        if (freeSpace(heap,NULL,NULL) >= size && compactHeap(heap) > 0)
+            continue;
+        for (b = heap->oldest; b; b = b->newer) {
+            if (b->resident && b != keep && !b->lockCount
+                    && (b->buf.flags & MGL_BUF_PAGEABLE))
+                break;
+            }
+        if (!b)
+            return -1;
+        evictBuffer(heap,b);
+        }
+}
+
+/****************************************************************************
+RETURNS:
+Pointer to the buffer that was used.
+
+REMARKS:
+Records a use of a buffer for the LRU list and the heap statistics. If the
+buffer has been paged out it is paged back into the heap if there is room,
+unless there are high priority buffers allocated.
+****************************************************************************/
+static MGLBUF *useBuffer(
+    GA_buf *buf)
+{
+    swbuf       *b = (swbuf*)buf,*prev;
+    MGL_bufHeap *heap = b->buf.dc->bufHeap;
+    long        offset;
+
+    if (b->resident)
+        heap->hits++;
+    else {
+        heap->misses++;
+        if ((b->buf.flags & MGL_BUF_PAGEABLE) && heap->numPriority == 0
+                && (offset = allocBlock(heap,b->size,b,&prev)) != -1) {
+            memcpy(heap->arena + offset,b->buf.surfaceCache,b->size);
+            makeResident(heap,b,offset,prev);
+            }
+        }
+    b->buf.useageCount++;
+    touchBuffer(heap,b);
+    return &b->buf;
+}
+
+/****************************************************************************
+REMARKS:
+Frees a buffer allocated from the buffer heap.
+****************************************************************************/
+static ibool MGLAPI SW_FreeBuffer(
+    GA_buf *buf)
+{
+    swbuf       *b = (swbuf*)buf;
+    MGL_bufHeap *heap = b->buf.dc->bufHeap;
+
+    if (b->resident)
+        removeResident(heap,b);
+    unlinkLRU(heap,b);
+    if (b->buf.flags & MGL_BUF_PRIORITY)
+        heap->numPriority--;
+    heap->numBuffers--;
+    if (b->buf.surfaceCache)
+        PM_free(b->buf.surfaceCache);
+    if (b->sysMem)
+        PM_free(b->sysMem);
+    PM_free(b);
+    return true;
+}
+
+/****************************************************************************
+REMARKS:
+Locks a buffer for direct surface access. The buffer is paged back into
+the heap if possible, and will not be moved or paged out until unlocked.
+****************************************************************************/
+static N_uint32 MGLAPI SW_LockBuffer(
+    GA_buf *buf)
+{
+    useBuffer(buf);
+    ((swbuf*)buf)->lockCount++;
+    return 0;
+}
+
+/****************************************************************************
+REMARKS:
+Unlocks a buffer after direct surface access.
+****************************************************************************/
+static void MGLAPI SW_UnlockBuffer(
+    GA_buf *buf)
+{
+    swbuf   *b = (swbuf*)buf;
+
+    if (b->lockCount)
+        b->lockCount--;
+}
+
+/****************************************************************************
+REMARKS:
+Updates the system memory cache from the heap copy of the buffer.
+****************************************************************************/
+static void MGLAPI SW_UpdateCache(
+    GA_buf *buf)
+{
+    swbuf   *b = (swbuf*)buf;
+
+    if (b->buf.surfaceCache && b->resident)
+        memcpy(b->buf.surfaceCache,b->buf.surface,b->size);
+}
+
+/****************************************************************************
+REMARKS:
+Updates the heap copy of the buffer from the system memory cache.
+****************************************************************************/
+static void MGLAPI SW_UpdateFromCache(
+    GA_buf *buf)
+{
+    swbuf   *b = (swbuf*)buf;
+
+    if (b->buf.surfaceCache && b->resident)
+        memcpy(b->buf.surface,b->buf.surfaceCache,b->size);
+}
+
+/****************************************************************************
+REMARKS:
+Blits from a heap buffer using the system memory blit vectors for the
+device context.
+****************************************************************************/
+static void MGLAPI SW_BitBltBuf(
+    GA_buf *buf,
+    N_int32 srcLeft,
+    N_int32 srcTop,
+    N_int32 width,
+    N_int32 height,
+    N_int32 dstLeft,
+    N_int32 dstTop,
+    N_int32 mix)
+{
+    MGLBUF  *b = useBuffer(buf);
+
+    b->dc->r.BitBltSys(b->surface,b->bytesPerLine,
+        srcLeft,srcTop,width,height,dstLeft,dstTop,mix,false);
+}
+
+/****************************************************************************
+REMARKS:
+Pattern blits from a heap buffer using the system memory blit vectors.
+****************************************************************************/
+static void MGLAPI SW_BitBltPattBuf(
+    GA_buf *buf,
+    N_int32 srcLeft,
+    N_int32 srcTop,
+    N_int32 width,
+    N_int32 height,
+    N_int32 dstLeft,
+    N_int32 dstTop,
+    N_int32 rop3)
+{
+    MGLBUF  *b = useBuffer(buf);
+
+    b->dc->r.BitBltPattSys(b->surface,b->bytesPerLine,
+        srcLeft,srcTop,width,height,dstLeft,dstTop,rop3,false);
+}
+
+/****************************************************************************
+REMARKS:
+Color pattern blits from a heap buffer using the system memory blit
+vectors.
+****************************************************************************/
+static void MGLAPI SW_BitBltColorPattBuf(
+    GA_buf *buf,
+    N_int32 srcLeft,
+    N_int32 srcTop,
+    N_int32 width,
+    N_int32 height,
+    N_int32 dstLeft,
+    N_int32 dstTop,
+    N_int32 rop3)
+{
+    MGLBUF  *b = useBuffer(buf);
+
+    b->dc->r.BitBltColorPattSys(b->surface,b->bytesPerLine,
+        srcLeft,srcTop,width,height,dstLeft,dstTop,rop3,false);
+}
+
+/****************************************************************************
+REMARKS:
+Source transparent blits from a heap buffer using the system memory blit
+vectors.
+****************************************************************************/
+static void MGLAPI SW_SrcTransBltBuf(
+    GA_buf *buf,
+    N_int32 srcLeft,
+    N_int32 srcTop,
+    N_int32 width,
+    N_int32 height,
+    N_int32 dstLeft,
+    N_int32 dstTop,
+    N_int32 mix,
+    GA_color transparent)
+{
+    MGLBUF  *b = useBuffer(buf);
+
+    b->dc->r.SrcTransBltSys(b->surface,b->bytesPerLine,
+        srcLeft,srcTop,width,height,dstLeft,dstTop,mix,transparent,false);
+}
+
+/****************************************************************************
+REMARKS:
+Destination transparent blits from a heap buffer using the system memory
+blit vectors.
+****************************************************************************/
+static void MGLAPI SW_DstTransBltBuf(
+    GA_buf *buf,
+    N_int32 srcLeft,
+    N_int32 srcTop,
+    N_int32 width,
+    N_int32 height,
+    N_int32 dstLeft,
+    N_int32 dstTop,
+    N_int32 mix,
+    GA_color transparent)
+{
+    MGLBUF  *b = useBuffer(buf);
+
+    b->dc->r.DstTransBltSys(b->surface,b->bytesPerLine,
+        srcLeft,srcTop,width,height,dstLeft,dstTop,mix,transparent,false);
+}
+
+/****************************************************************************
+REMARKS:
+Stretch blits from a heap buffer using the system memory blit vectors.
+****************************************************************************/
+static void MGLAPI SW_StretchBltBuf(
+    GA_buf *buf,
+    N_int32 srcLeft,
+    N_int32 srcTop,
+    N_int32 srcWidth,
+    N_int32 srcHeight,
+    N_int32 dstLeft,
+    N_int32 dstTop,
+    N_int32 dstWidth,
+    N_int32 dstHeight,
+    N_int32 doClip,
+    N_int32 clipLeft,
+    N_int32 clipTop,
+    N_int32 clipRight,
+    N_int32 clipBottom,
+    N_int32 mix)
+{
+    MGLBUF  *b = useBuffer(buf);
+
+    b->dc->r.StretchBltSys(b->surface,b->bytesPerLine,
+        srcLeft,srcTop,srcWidth,srcHeight,dstLeft,dstTop,dstWidth,dstHeight,
+        doClip,clipLeft,clipTop,clipRight,clipBottom,mix,false);
+}
+
+/****************************************************************************
+REMARKS:
+Effects blits from a heap buffer using the system memory blit vectors.
+****************************************************************************/
+static void MGLAPI SW_BitBltFxBuf(
+    GA_buf *buf,
+    N_int32 srcLeft,
+    N_int32 srcTop,
+    N_int32 srcWidth,
+    N_int32 srcHeight,
+    N_int32 dstLeft,
+    N_int32 dstTop,
+    N_int32 dstWidth,
+    N_int32 dstHeight,
+    GA_bltFx *fx)
+{
+    MGLBUF  *b = useBuffer(buf);
+
+    b->dc->r.BitBltFxSys(b->surface,b->bytesPerLine,
+        srcLeft,srcTop,srcWidth,srcHeight,dstLeft,dstTop,dstWidth,dstHeight,fx);
+}
+
+/****************************************************************************
+REMARKS:
+Attaches a buffer heap to a device context, and installs the buffer
+vectors that draw from heap buffers with the system memory blit vectors.
+****************************************************************************/
+static void installHeap(
+    MGLDC *dc,
+    MGL_bufHeap *heap)
+{
+    dc->bufHeap = heap;
+    dc->r.FreeBuffer            = SW_FreeBuffer;
+    dc->r.LockBuffer            = SW_LockBuffer;
+    dc->r.UnlockBuffer          = SW_UnlockBuffer;
+    dc->r.UpdateCache           = SW_UpdateCache;
+    dc->r.UpdateFromCache       = SW_UpdateFromCache;
+    dc->r.BitBltBuf             = SW_BitBltBuf;
+    dc->r.BitBltPattBuf         = SW_BitBltPattBuf;
+    dc->r.BitBltColorPattBuf    = SW_BitBltColorPattBuf;
+    dc->r.SrcTransBltBuf        = SW_SrcTransBltBuf;
+    dc->r.DstTransBltBuf        = SW_DstTransBltBuf;
+    dc->r.StretchBltBuf         = SW_StretchBltBuf;
+    dc->r.BitBltFxBuf           = SW_BitBltFxBuf;
+}
+
+/****************************************************************************
+PARAMETERS:
+dc      - Device context with a buffer heap
+width   - Width of the buffer in pixels
+height  - Height of the buffer in scanlines
+flags   - Flags to use when creating the buffer (MGL_bufferFlagsType)
+
+RETURNS:
+Pointer to the allocated buffer, NULL on failure.
+
+REMARKS:
+Allocates a new buffer from the software buffer heap for the device
+context. If there is no room in the heap even after compacting it and
+paging out the least recently used pageable buffers, the buffer is placed
+in system memory unless the MGL_BUF_NOSYSMEM flag is set.
+{secret}
+****************************************************************************/
+MGLBUF *_MGL_allocHeapBuffer(
+    MGLDC *dc,
+    int width,
+    int height,
+    M_uint32 flags)
+{
+    MGL_bufHeap *heap = dc->bufHeap;
+    swbuf       *b,*prev;
+    long        offset = -1;
+
+    if (flags & MGL_BUF_PAGEABLE)
+        flags |= MGL_BUF_CACHED;
+    if ((b = PM_calloc(1,sizeof(swbuf))) == NULL) {
+        SETERROR(grNoMem);
+        return NULL;
+        }
+    b->buf.dwSize = sizeof(MGLBUF);
+    b->buf.width = width;
+    b->buf.height = height;
+    b->buf.bytesPerLine = (BYTESPERLINE(width,dc->mi.bitsPerPixel) + 3) & ~3;
+    b->buf.cacheBytesPerLine = b->buf.bytesPerLine;
+    b->buf.flags = flags & ~MGL_BUF_SYSMEM;
+    b->buf.dc = dc;
+    b->size = (long)b->buf.bytesPerLine * height;
+
+    /* Allocate the system memory surface cache */
+    if ((flags & MGL_BUF_CACHED) && (b->buf.surfaceCache = PM_calloc(1,b->size)) == NULL) {
+        PM_free(b);
+        SETERROR(grNoMem);
+        return NULL;
+        }
+
+    /* Find room for the buffer in the heap, or fall back on system memory */
+    if (!(flags & MGL_BUF_SYSMEM))
+        offset = allocBlock(heap,b->size,NULL,&prev);
+    if (offset != -1) {
+        makeResident(heap,b,offset,prev);
+        memset(b->buf.surface,0,b->size);
+        }
+    else if (flags & MGL_BUF_NOSYSMEM) {
+        if (b->buf.surfaceCache)
+            PM_free(b->buf.surfaceCache);
+        PM_free(b);
+        __MGL_result = grNoOffscreenMem;
+        return NULL;
+        }
+    else {
+        b->buf.flags |= MGL_BUF_SYSMEM;
+        if (b->buf.surfaceCache)
+            b->buf.surface = b->buf.surfaceCache;
+        else if ((b->buf.surface = b->sysMem = PM_calloc(1,b->size)) == NULL) {
+            PM_free(b);
+            SETERROR(grNoMem);
+            return NULL;
+            }
+        }
+    if (flags & MGL_BUF_PRIORITY)
+        heap->numPriority++;
+    heap->numBuffers++;
+    touchBuffer(heap,b);
+    return &b->buf;
+}
+
+/****************************************************************************
+REMARKS:
+Destroys the buffer heap for a device context, including all buffers that
+are still allocated from it.
+{secret}
+****************************************************************************/
+void _MGL_destroyBufferHeap(
+    MGLDC *dc)
+{
+    MGL_bufHeap *heap = dc->bufHeap;
+
+    if (!heap)
+        return;
+    while (heap->newest)
+        SW_FreeBuffer(TO_BUF(&heap->newest->buf));
+    PM_free(heap->arena);
+    PM_free(heap);
+    dc->bufHeap = NULL;
+}
+
+/****************************************************************************
+DESCRIPTION:
+Creates a software buffer heap for a device context.
+
+HEADER:
+mgraph.h
+
+PARAMETERS:
+dc          - Device context to create the buffer heap for
+heapSize    - Size of the buffer heap in bytes
+
+RETURNS:
+True on success, false on failure.
+
+REMARKS:
+This function creates a software managed buffer heap of the specified size
+for a device context that does not have a hardware buffer manager, such as
+a memory device context. Once the heap has been created, MGL_createBuffer
+can be used to allocate MGL buffers for the device context, and all the
+MGL_putBuffer family of functions can be used to draw them.
+
+The buffer heap follows the same residency rules as the hardware buffer
+manager. When there is not enough contiguous free space in the heap for
+a new buffer, the heap is first compacted by moving all buffers created
+with the MGL_BUF_MOVEABLE flag, and if that is not enough the least
+recently used buffers created with the MGL_BUF_PAGEABLE flag are paged out
+to their system memory surface cache. Paged out buffers can still be drawn
+from system memory, and are paged back into the heap the next time they
+are used (unless there are any buffers created with the MGL_BUF_PRIORITY
+flag still allocated). If a buffer cannot be placed in the heap at all it
+is allocated in system memory, unless the MGL_BUF_NOSYSMEM flag is set in
+which case MGL_createBuffer will fail. Buffers are never moved or paged
+out while they are locked with MGL_lockBuffer.
+
+Use MGL_getBufferHeapInfo to find out how fragmented the heap is, and how
+well the heap is performing.
+
+Note:   This function will fail with an error code of grInvalidDC if the
+        device context has a hardware buffer manager, and will fail if a
+        buffer heap already exists for the device context.
+
+SEE ALSO:
+MGL_compactBufferHeap, MGL_getBufferHeapInfo, MGL_createBuffer
+****************************************************************************/
+ibool MGLAPI MGL_createBufferHeap(
+    MGLDC *dc,
+    long heapSize)
+{
+    MGL_bufHeap *heap;
+
+    if (dc->r.AllocBuffer || dc->bufHeap || heapSize <= 0) {
+        SETERROR(grInvalidDC);
+        return false;
+        }
+    if ((heap = PM_calloc(1,sizeof(MGL_bufHeap))) == NULL) {
+        SETERROR(grNoMem);
+        return false;
+        }
+    heap->size = heapSize & ~3;
+    if ((heap->arena = PM_malloc(heap->size)) == NULL) {
+        PM_free(heap);
+        SETERROR(grNoMem);
+        return false;
+        }
+    installHeap(dc,heap);
+    if (dc == _MGL_dcPtr)
+        installHeap(&DC,heap);
+    return true;
+}
+
+/****************************************************************************
+DESCRIPTION:
+Compacts the software buffer heap for a device context.
+
+HEADER:
+mgraph.h
+
+PARAMETERS:
+dc  - Device context with a buffer heap
+
+RETURNS:
+Number of bytes moved to compact the heap.
+
+REMARKS:
+This function compacts the software buffer heap for a device context,
+by moving all buffers that were created with the MGL_BUF_MOVEABLE flag
+and are not currently locked down to the start of the heap. The heap is
+compacted automatically when necessary, however compacting the heap at a
+convenient time (such as after loading a new level in a game) can avoid
+the cost of compacting the heap in the middle of drawing a frame.
+
+SEE ALSO:
+MGL_createBufferHeap, MGL_getBufferHeapInfo
+****************************************************************************/
+long MGLAPI MGL_compactBufferHeap(
+    MGLDC *dc)
+{
+    if (dc == _MGL_dcPtr)
+        dc = &DC;
+    if (!dc->bufHeap)
+        return 0;
+    return compactHeap(dc->bufHeap);
+}
+
+/****************************************************************************
+DESCRIPTION:
+Returns information about the software buffer heap for a device context.
+
+HEADER:
+mgraph.h
+
+PARAMETERS:
+dc      - Device context with a buffer heap
+info    - Place to store the buffer heap information
+
+RETURNS:
+True on success, false if the device context does not have a buffer heap.
+
+REMARKS:
+This function returns information about the current state of the software
+buffer heap for a device context, including how fragmented the heap is
+and the hit, miss and eviction counts for the heap. A use of a buffer that
+is resident in the heap counts as a hit, while a use of a buffer that has
+been paged out to system memory counts as a miss. If the largest free block
+is much smaller than the total free space, the heap is badly fragmented and
+you may wish to compact it with MGL_compactBufferHeap.
+
+SEE ALSO:
+MGL_createBufferHeap, MGL_compactBufferHeap
+****************************************************************************/
+ibool MGLAPI MGL_getBufferHeapInfo(
+    MGLDC *dc,
+    bufheapinfo_t *info)
+{
+    MGL_bufHeap *heap;
+    swbuf       *b;
+    long        largest;
+    int         blocks;
+
+    if (dc == _MGL_dcPtr)
+        dc = &DC;
+    if ((heap = dc->bufHeap) == NULL)
+        return false;
+    info->heapSize = heap->size;
+    info->bytesFree = freeSpace(heap,&largest,&blocks);
+    info->largestFree = largest;
+    info->freeBlocks = blocks;
+    info->numBuffers = heap->numBuffers;
+    info->numResident = 0;
+    for (b = heap->first; b; b = b->next)
+        info->numResident++;
+    info->hits = heap->hits;
+    info->misses = heap->misses;
+    info->evictions = heap->evictions;
+    info->compactions = heap->compactions;
+    info->bytesMoved = heap->bytesMoved;
+    return true;
+}
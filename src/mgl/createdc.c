@@ -634,6 +634,12 @@ MGLDC * MGLAPI MGL_createOffscreenDC(
     MGLBUF  *buf;
     MGLDC   *oldDC = _MGL_dcPtr;
 
+    /* Offscreen DC's need a hardware buffer manager */
+    if (!dc->r.AllocBuffer) {
+        FATALERROR(grInvalidDC);
+        return NULL;
+        }
+
     /* Create an offscreen buffer for the DC */
     __MGL_result = grOK;
     if ((buf = MGL_createBuffer(dc,width,height,MGL_BUF_NOSYSMEM)) == NULL) {
@@ -671,10 +677,15 @@ MGLDC * MGLAPI MGL_createOffscreenDC(
     offDC->mi.bytesPerLine = buf->bytesPerLine;
     offDC->surface = buf->surface;
     offDC->offBuf = buf;
+    offDC->bufHeap = NULL;
+    offDC->invCMap = NULL;
     offDC->clipRegionUser = NULL;
     offDC->visRegionWM = NULL;
     offDC->visRegionWin = NULL;
     offDC->clipRegionScreen = NULL;
+    offDC->dirtyRegion = NULL;
+    offDC->dirtyRect.left = offDC->dirtyRect.right = 0;
+    offDC->dirtyRect.top = offDC->dirtyRect.bottom = 0;
     offDC->activeBuf = TO_BUF(buf);
     if ((offDC->colorTab = PM_malloc(sizeof(color_t) * 256)) == NULL) {
         FATALERROR(grNoMem);
@@ -897,6 +908,12 @@ static void _MGL_freeInternalDCVars(
         MGL_freeRegion(dc->visRegionWM);
     if (dc->visRegionWin)
         MGL_freeRegion(dc->visRegionWin);
+    if (dc->dirtyRegion)
+        MGL_freeRegion(dc->dirtyRegion);
+    if (dc->bufHeap)
+        _MGL_destroyBufferHeap(dc);
+    if (dc->invCMap)
+        PM_free(dc->invCMap);
     PM_free(dc->colorTab);
 }
 
@@ -350,7 +350,7 @@ cursor_t * MGLAPI MGL_loadCursor(
         cursor = LoadCursor32x32(&h,f);
     else
         cursor = LoadCursor64x64(&h,f);
-    fclose(f);
+    __MGL_fclose(f);
     if (!cursor)
         return NULL;
     return cursor;
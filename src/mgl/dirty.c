@@ -0,0 +1,440 @@
+/****************************************************************************
+*
+*                   SciTech Multi-platform Graphics Library
+*
+*  ========================================================================
+*
+*   Copyright (C) 1991-2004 SciTech Software, Inc. All rights reserved.
+*
+*   This file may be distributed and/or modified under the terms of the
+*   GNU General Public License version 2.0 as published by the Free
+*   Software Foundation and appearing in the file LICENSE.GPL included
+*   in the packaging of this file.
+*
+*   Licensees holding a valid Commercial License for this product from
+*   SciTech Software, Inc. may use this file in accordance with the
+*   Commercial License Agreement provided with the Software.
+*
+*   This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING
+*   THE WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+*   PURPOSE.
+*
+*   See http://www.scitechsoft.com/license/ for information about
+*   the licensing options available and how to purchase a Commercial
+*   License Agreement.
+*
+*   Contact license@scitechsoft.com if any conditions of this licensing
+*   are not clear to you, or you have questions about licensing options.
+*
+*  ========================================================================
+*
+* Language:     ANSI C
+* Environment:  Any
+*
+* Description:  Damage tracking for device contexts. When enabled, all
+*               the drawing primitives add the bounds of the pixels they
+*               touch to a per DC dirty region, so that only the parts of
+*               a memory back buffer that actually changed need to be
+*               copied to the display each frame.
+*
+*               To keep the cost of tracking small for primitives that
+*               draw lots of small pieces (pixels, lines and glyphs),
+*               new rectangles are first coalesced into a single pending
+*               rectangle, and only added to the real dirty region when
+*               merging would waste too much area.
+*
+****************************************************************************/
+
+#include "mgl.h"
+
+/*------------------------- Implementation --------------------------------*/
+
+/* Compute the area of a rectangle */
+
+#define AREA(r) ((long)((r).right - (r).left) * ((r).bottom - (r).top))
+
+/****************************************************************************
+PARAMETERS:
+dc      - Device context to add the dirty rectangle to
+left    - Left coordinate of dirty rectangle (screen space)
+top     - Top coordinate of dirty rectangle (screen space)
+right   - Right coordinate of dirty rectangle (screen space)
+bottom  - Bottom coordinate of dirty rectangle (screen space)
+
+REMARKS:
+Adds a rectangle in screen space to the dirty region for the device
+context. The rectangle is clipped to the bounds of the device surface, and
+merged with the pending dirty rectangle if the union of the two does not
+cover more than twice the area of the two rectangles. Otherwise the pending
+rectangle is flushed to the dirty region, and the new rectangle becomes
+the pending rectangle.
+{secret}
+****************************************************************************/
+void _MGL_markDirty(
+    MGLDC *dc,
+    int left,
+    int top,
+    int right,
+    int bottom)
+{
+    rect_t  r,u;
+
+    if (!MGL_sectRectCoord(left,top,right,bottom,0,0,dc->mi.xRes+1,dc->mi.yRes+1,&r))
+        return;
+    if (MGL_emptyRect(dc->dirtyRect)) {
+        dc->dirtyRect = r;
+        return;
+        }
+    MGL_unionRect(dc->dirtyRect,r,&u);
+    if (MGL_equalRect(u,dc->dirtyRect))
+        return;
+    if (AREA(u) <= 2 * (AREA(dc->dirtyRect) + AREA(r))) {
+        dc->dirtyRect = u;
+        return;
+        }
+    (void)MGL_unionRegionRect(dc->dirtyRegion,&dc->dirtyRect);
+    dc->dirtyRect = r;
+}
+
+/****************************************************************************
+PARAMETERS:
+dc      - Device context to add the dirty rectangle to
+left    - Left coordinate of dirty rectangle (viewport space)
+top     - Top coordinate of dirty rectangle (viewport space)
+right   - Right coordinate of dirty rectangle (viewport space)
+bottom  - Bottom coordinate of dirty rectangle (viewport space)
+
+REMARKS:
+Adds a rectangle in viewport space to the dirty region for the device
+context, after clipping it to the current clip rectangle.
+{secret}
+****************************************************************************/
+void _MGL_markDirtyView(
+    MGLDC *dc,
+    int left,
+    int top,
+    int right,
+    int bottom)
+{
+    rect_t  r;
+
+    if (MGL_sectRectCoord(left,top,right,bottom,dc->clipRectView.left,
+            dc->clipRectView.top,dc->clipRectView.right,
+            dc->clipRectView.bottom,&r)) {
+        _MGL_markDirty(dc,r.left + dc->viewPort.left,r.top + dc->viewPort.top,
+            r.right + dc->viewPort.left,r.bottom + dc->viewPort.top);
+        }
+}
+
+/****************************************************************************
+REMARKS:
+Flushes the pending dirty rectangle into the dirty region for the DC.
+****************************************************************************/
+static void flushDirty(
+    MGLDC *dc)
+{
+    if (!MGL_emptyRect(dc->dirtyRect)) {
+        (void)MGL_unionRegionRect(dc->dirtyRegion,&dc->dirtyRect);
+        dc->dirtyRect.left = dc->dirtyRect.right = 0;
+        dc->dirtyRect.top = dc->dirtyRect.bottom = 0;
+        }
+}
+
+/****************************************************************************
+DESCRIPTION:
+Enables or disables damage tracking for a device context.
+
+HEADER:
+mgraph.h
+
+PARAMETERS:
+dc      - Device context to enable damage tracking for
+enable  - True to enable damage tracking, false to disable it
+
+RETURNS:
+True if damage tracking was enabled, false if out of memory.
+
+REMARKS:
+This function enables or disables damage tracking for a device context.
+When damage tracking is enabled, all the MGL drawing functions that draw on
+the device context add the bounds of the area they have modified to a
+dirty region maintained for the device context. You can then call
+MGL_bitBltDirty or MGL_presentDirty to copy only the parts of the device
+context that have changed since the last time it was presented.
+
+Damage tracking is intended for memory device contexts used as system
+memory back buffers, where the application renders each frame into the
+memory device context and then copies it to the display. For mostly static
+screens where only small parts of the image change from frame to frame,
+this drastically reduces the amount of data that needs to be copied to the
+display every frame.
+
+The dirty region is initially empty when damage tracking is enabled, so if
+you need the entire surface to be presented the first time, call
+MGL_markDirtyCoord to mark the entire surface as dirty. If you modify the
+device context surface directly via the surface pointer, or via OpenGL, the
+MGL cannot know what has changed, so you must call MGL_markDirtyCoord
+yourself for the areas that you have modified.
+
+Damage tracking is disabled by default.
+
+SEE ALSO:
+MGL_markDirtyCoord, MGL_getDirtyRegion, MGL_clearDirty, MGL_bitBltDirty,
+MGL_presentDirty
+****************************************************************************/
+ibool MGLAPI MGL_setDirtyTracking(
+    MGLDC *dc,
+    ibool enable)
+{
+    if (dc == _MGL_dcPtr)
+        dc = &DC;
+    if (enable) {
+        if (!dc->dirtyRegion) {
+            if ((dc->dirtyRegion = MGL_newRegion()) == NULL) {
+                SETERROR(grNoMem);
+                return false;
+                }
+            }
+        }
+    else if (dc->dirtyRegion) {
+        MGL_freeRegion(dc->dirtyRegion);
+        dc->dirtyRegion = NULL;
+        }
+    dc->dirtyRect.left = dc->dirtyRect.right = 0;
+    dc->dirtyRect.top = dc->dirtyRect.bottom = 0;
+    return true;
+}
+
+/****************************************************************************
+DESCRIPTION:
+Marks a rectangle in a device context as dirty.
+
+HEADER:
+mgraph.h
+
+PARAMETERS:
+dc      - Device context to mark as dirty
+left    - Left coordinate of rectangle to mark dirty
+top     - Top coordinate of rectangle to mark dirty
+right   - Right coordinate of rectangle to mark dirty
+bottom  - Bottom coordinate of rectangle to mark dirty
+
+REMARKS:
+This function adds the specified rectangle to the dirty region for the
+device context, if damage tracking is enabled. The coordinates are in the
+viewport space for the device context, but unlike the drawing functions
+the rectangle is not clipped to the current clip rectangle, so you can
+use this function to mark the entire surface as dirty regardless of the
+current viewport and clip rectangle settings.
+
+You only need to call this function if you have modified the surface of
+the device context without using the MGL drawing functions, as all the
+MGL drawing functions automatically mark the areas they draw as dirty.
+
+SEE ALSO:
+MGL_markDirty, MGL_setDirtyTracking, MGL_bitBltDirty
+****************************************************************************/
+void MGLAPI MGL_markDirtyCoord(
+    MGLDC *dc,
+    int left,
+    int top,
+    int right,
+    int bottom)
+{
+    if (dc == _MGL_dcPtr)
+        dc = &DC;
+    MARK_DIRTY(dc,left + dc->viewPort.left,top + dc->viewPort.top,
+        right + dc->viewPort.left,bottom + dc->viewPort.top);
+}
+
+/****************************************************************************
+DESCRIPTION:
+Marks a rectangle in a device context as dirty.
+
+HEADER:
+mgraph.h
+
+PARAMETERS:
+dc  - Device context to mark as dirty
+r   - Rectangle to mark as dirty
+
+REMARKS:
+This function is the same as MGL_markDirtyCoord, however it takes an
+entire rectangle as the parameter instead of coordinates.
+
+SEE ALSO:
+MGL_markDirtyCoord
+****************************************************************************/
+void MGL_markDirty(
+    MGLDC *dc,
+    rect_t r);
+/* Implemented as a macro */
+
+/****************************************************************************
+DESCRIPTION:
+Returns the current dirty region for a device context.
+
+HEADER:
+mgraph.h
+
+PARAMETERS:
+dc      - Device context to get the dirty region for
+region  - Place to store the dirty region
+
+REMARKS:
+This function copies the current dirty region for the device context into
+the passed in region. The dirty region is in screen space for the device
+context, which for memory device contexts is the same as the coordinates
+of the pixels in the surface. If damage tracking is not enabled, the
+returned region will be empty.
+
+SEE ALSO:
+MGL_setDirtyTracking, MGL_clearDirty, MGL_bitBltDirty
+****************************************************************************/
+void MGLAPI MGL_getDirtyRegion(
+    MGLDC *dc,
+    region_t *region)
+{
+    if (dc == _MGL_dcPtr)
+        dc = &DC;
+    if (dc->dirtyRegion) {
+        flushDirty(dc);
+        MGL_optimizeRegion(dc->dirtyRegion);
+        MGL_copyIntoRegion(region,dc->dirtyRegion);
+        }
+    else
+        MGL_clearRegion(region);
+}
+
+/****************************************************************************
+DESCRIPTION:
+Clears the dirty region for a device context.
+
+HEADER:
+mgraph.h
+
+PARAMETERS:
+dc  - Device context to clear the dirty region for
+
+REMARKS:
+This function resets the dirty region for the device context to be empty.
+You would normally call this function after you have presented the dirty
+parts of the device context yourself using the region returned by
+MGL_getDirtyRegion. MGL_bitBltDirty automatically clears the dirty region
+after it has copied it.
+
+SEE ALSO:
+MGL_setDirtyTracking, MGL_getDirtyRegion, MGL_bitBltDirty
+****************************************************************************/
+void MGLAPI MGL_clearDirty(
+    MGLDC *dc)
+{
+    if (dc == _MGL_dcPtr)
+        dc = &DC;
+    if (dc->dirtyRegion) {
+        MGL_clearRegion(dc->dirtyRegion);
+        dc->dirtyRect.left = dc->dirtyRect.right = 0;
+        dc->dirtyRect.top = dc->dirtyRect.bottom = 0;
+        }
+}
+
+/****************************************************************************
+DESCRIPTION:
+Copies the dirty parts of a device context to another device context.
+
+HEADER:
+mgraph.h
+
+PARAMETERS:
+dst     - Destination device context
+src     - Source device context with damage tracking enabled
+dstLeft - Left coordinate of the source surface in the destination
+dstTop  - Top coordinate of the source surface in the destination
+op      - Write mode to use during Blt
+
+REMARKS:
+This function copies only those parts of the source device context that
+have been modified since the dirty region was last cleared to the
+destination device context, and then clears the dirty region. The top
+left corner of the source surface is placed at (dstLeft,dstTop) in the
+destination, so a full screen memory back buffer can be presented to
+the display by passing in (0,0).
+
+Each rectangle in the dirty region is copied with MGL_bitBltCoord, so the
+same pixel format conversions and clipping rules apply. Since the dirty
+region is in screen space for the source device context, the rectangles
+are converted to the viewport space of the source before the blits are
+performed, and will be clipped to the source clip rectangle. For best
+results the source should have the default full screen viewport and clip
+rectangle when it is presented.
+
+If damage tracking is not enabled for the source device context, the
+entire source device context is copied.
+
+SEE ALSO:
+MGL_presentDirty, MGL_setDirtyTracking, MGL_markDirtyCoord,
+MGL_bitBltCoord
+****************************************************************************/
+void MGLAPI MGL_bitBltDirty(
+    MGLDC *dst,
+    MGLDC *src,
+    int dstLeft,
+    int dstTop,
+    int op)
+{
+    MGLDC       *s = (src == _MGL_dcPtr) ? &DC : src;
+    region_t    *rgn;
+    rect_t      clip;
+    int         xOfs,yOfs;
+
+    xOfs = s->viewPort.left;
+    yOfs = s->viewPort.top;
+    if (!s->dirtyRegion) {
+        MGL_bitBltCoord(dst,src,-xOfs,-yOfs,s->mi.xRes+1-xOfs,
+            s->mi.yRes+1-yOfs,dstLeft,dstTop,op);
+        return;
+        }
+    flushDirty(s);
+    rgn = s->dirtyRegion;
+    if (MGL_emptyRect(rgn->rect))
+        return;
+    MGL_optimizeRegion(rgn);
+    if (!rgn->spans) {
+        MGL_bitBltCoord(dst,src,rgn->rect.left-xOfs,rgn->rect.top-yOfs,
+            rgn->rect.right-xOfs,rgn->rect.bottom-yOfs,
+            dstLeft+rgn->rect.left,dstTop+rgn->rect.top,op);
+        }
+    else {
+        BEGIN_CLIP_REGION(clip,rgn);
+            MGL_bitBltCoord(dst,src,clip.left-xOfs,clip.top-yOfs,
+                clip.right-xOfs,clip.bottom-yOfs,
+                dstLeft+clip.left,dstTop+clip.top,op);
+        END_CLIP_REGION();
+        }
+    MGL_clearDirty(s);
+}
+
+/****************************************************************************
+DESCRIPTION:
+Presents the dirty parts of a back buffer to the display.
+
+HEADER:
+mgraph.h
+
+PARAMETERS:
+dst - Destination device context to present to
+src - Source back buffer device context with damage tracking enabled
+
+REMARKS:
+This function is the same as MGL_bitBltDirty, however it always copies the
+source surface to the top left corner of the destination in
+MGL_REPLACE_MODE. This is the common case of presenting a full screen
+system memory back buffer to the display.
+
+SEE ALSO:
+MGL_bitBltDirty, MGL_setDirtyTracking
+****************************************************************************/
+void MGL_presentDirty(
+    MGLDC *dst,
+    MGLDC *src);
+/* Implemented as a macro */
@@ -0,0 +1,554 @@
+/****************************************************************************
+*
+*                   SciTech Multi-platform Graphics Library
+*
+*  ========================================================================
+*
+*   Copyright (C) 1991-2004 SciTech Software, Inc. All rights reserved.
+*
+*   This file may be distributed and/or modified under the terms of the
+*   GNU General Public License version 2.0 as published by the Free
+*   Software Foundation and appearing in the file LICENSE.GPL included
+*   in the packaging of this file.
+*
+*   Licensees holding a valid Commercial License for this product from
+*   SciTech Software, Inc. may use this file in accordance with the
+*   Commercial License Agreement provided with the Software.
+*
+*   This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING
+*   THE WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+*   PURPOSE.
+*
+*   See http://www.scitechsoft.com/license/ for information about
+*   the licensing options available and how to purchase a Commercial
+*   License Agreement.
+*
+*   Contact license@scitechsoft.com if any conditions of this licensing
+*   are not clear to you, or you have questions about licensing options.
+*
+*  ========================================================================
+*
+* Language:     ANSI C
+* Environment:  Any
+*
+* Description:  Scanline dithering kernels for converting runs of RGB
+*               pixels to 8 bits per pixel halftone, 15 bits per pixel
+*               5:5:5 and 16 bits per pixel 5:6:5 destinations. Both the
+*               ordered halftone dither and Floyd-Steinberg error
+*               diffusion are supported. The ordered dither kernels have
+*               SSE2 versions that process four or eight pixels at a time
+*               and produce identical results to the lookup table code.
+*
+****************************************************************************/
+
+#include "mgl.h"
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define DITHER_SSE2
+#include <emmintrin.h>
+#endif
+
+/*--------------------------- Global Variables ----------------------------*/
+
+/* Error diffusion state. The error terms for the next scanline are kept
+ * for every column of the destination surface, so a blit that is done one
+ * scanline at a time (such as by the image loaders) carries the error
+ * down from one call to the next.
+ */
+
+static struct {
+    short   *err;               /* Error terms, three per column        */
+    int     columns;            /* Number of columns allocated          */
+    void    *surface;           /* Surface the error terms belong to    */
+    int     format;             /* Format the error terms belong to     */
+    int     y;                  /* Last scanline diffused               */
+    int     nextX;              /* Column following the last span       */
+    int     cur[3];             /* Error carried to the right           */
+    int     below[3];           /* Error for the pixel below            */
+    int     belowPrev[3];       /* Error for the pixel below and left   */
+    } fs;
+
+static ibool    haveLevels = false;
+static uchar    level5[256],value5[256];    /* 5 bit components         */
+static uchar    level6[256],value6[256];    /* 6 bit components         */
+static uchar    level51[256],value51[256];  /* Halftone palette levels  */
+
+/*------------------------- Implementation --------------------------------*/
+
+/****************************************************************************
+REMARKS:
+Dithers a span of RGB pixels to the MGL halftone palette using the 8x8
+ordered dither. Each color component is reduced to one of six levels with
+(C + 50 - dither) / 51, which is the same as the division and modulo
+lookup tables used by the halftone macros, so we can compute it with a
+multiply in the SIMD code. If xlat is not NULL the resulting halftone
+palette indices are translated through it.
+****************************************************************************/
+static void halfToneSpan8(
+    uchar *d,
+    const M_uint32 *s,
+    int x,
+    int y,
+    int count,
+    const uchar *xlat)
+{
+    uchar   *dp = &_MGL_dither8x8[(y & 7) << 3];
+    uint    R,G,B,dither;
+#ifdef DITHER_SSE2
+    short   bias[32];
+    int     i;
+
+    if (count >= 8) {
+        __m128i bias0,bias1,bias2,bias3,p,lo,hi,r0,r1;
+        __m128i zero = _mm_setzero_si128();
+        __m128i mul51 = _mm_set1_epi16(1286);
+        __m128i weights = _mm_set_epi16(0,1,6,36,0,1,6,36);
+        __m128i ones = _mm_set1_epi16(1);
+        __m128i base = _mm_set1_epi32(20);
+
+        /* The dither pattern repeats every 8 pixels, so we can build the
+         * bias for 8 pixels (2 pixels per register) once for the span.
+         */
+        for (i = 0; i < 8; i++) {
+            dither = 50 - dp[(x + i) & 7];
+            bias[i*4+0] = bias[i*4+1] = bias[i*4+2] = (short)dither;
+            bias[i*4+3] = 0;
+            }
+        bias0 = _mm_loadu_si128((__m128i*)&bias[0]);
+        bias1 = _mm_loadu_si128((__m128i*)&bias[8]);
+        bias2 = _mm_loadu_si128((__m128i*)&bias[16]);
+        bias3 = _mm_loadu_si128((__m128i*)&bias[24]);
+        for (; count >= 8; count -= 8, s += 8, d += 8) {
+            p = _mm_loadu_si128((__m128i*)s);
+            lo = _mm_mulhi_epu16(_mm_add_epi16(_mm_unpacklo_epi8(p,zero),bias0),mul51);
+            hi = _mm_mulhi_epu16(_mm_add_epi16(_mm_unpackhi_epi8(p,zero),bias1),mul51);
+            r0 = _mm_madd_epi16(_mm_packs_epi32(_mm_madd_epi16(lo,weights),_mm_madd_epi16(hi,weights)),ones);
+            p = _mm_loadu_si128((__m128i*)(s+4));
+            lo = _mm_mulhi_epu16(_mm_add_epi16(_mm_unpacklo_epi8(p,zero),bias2),mul51);
+            hi = _mm_mulhi_epu16(_mm_add_epi16(_mm_unpackhi_epi8(p,zero),bias3),mul51);
+            r1 = _mm_madd_epi16(_mm_packs_epi32(_mm_madd_epi16(lo,weights),_mm_madd_epi16(hi,weights)),ones);
+            r0 = _mm_packs_epi32(_mm_add_epi32(r0,base),_mm_add_epi32(r1,base));
+            _mm_storel_epi64((__m128i*)d,_mm_packus_epi16(r0,r0));
+            if (xlat) {
+                for (i = 0; i < 8; i++)
+                    d[i] = xlat[d[i]];
+                }
+            }
+        }
+#endif
+    for (; count > 0; count--, x++) {
+        R = (uchar)(*s >> 16);
+        G = (uchar)(*s >> 8);
+        B = (uchar)(*s++);
+        dither = dp[x & 7];
+        R = 20 + _MGL_div51[R] + (_MGL_mod51[R] > dither) +
+            _MGL_mul6[_MGL_div51[G] + (_MGL_mod51[G] > dither)] +
+            _MGL_mul36[_MGL_div51[B] + (_MGL_mod51[B] > dither)];
+        *d++ = (uchar)(xlat ? xlat[R] : R);
+        }
+}
+
+/****************************************************************************
+REMARKS:
+Dithers a span of RGB pixels to 5:5:5 or 5:6:5 using the 4x4 ordered
+dither. Each component is reduced with (C + 7 - dither) >> 3 using an
+unsigned saturating add, which matches the division and modulo lookup
+tables used by the halftone macros exactly.
+****************************************************************************/
+static void halfToneSpan16(
+    ushort *d,
+    const M_uint32 *s,
+    int x,
+    int y,
+    int count,
+    ibool is565)
+{
+    uchar   *dp = &_MGL_dither4x4[(y & 3) << 2];
+    uint    R,G,B,dither;
+#ifdef DITHER_SSE2
+    M_uint32 bias[4];
+    int     i;
+
+    if (count >= 4) {
+        __m128i p,r,g,b,vbias;
+        __m128i rmask = _mm_set1_epi32(is565 ? 0xF800 : 0x7C00);
+        __m128i gmask = _mm_set1_epi32(is565 ? 0x07E0 : 0x03E0);
+        __m128i bmask = _mm_set1_epi32(0x001F);
+
+        for (i = 0; i < 4; i++) {
+            dither = dp[(x + i) & 3];
+            G = is565 ? 3 - (dither >> 1) : 7 - dither;
+            bias[i] = ((7 - dither) << 16) | (G << 8) | (7 - dither);
+            }
+        vbias = _mm_loadu_si128((__m128i*)bias);
+        for (; count >= 4; count -= 4, s += 4, d += 4) {
+            p = _mm_adds_epu8(_mm_loadu_si128((__m128i*)s),vbias);
+            if (is565) {
+                r = _mm_srli_epi32(p,8);
+                g = _mm_srli_epi32(p,5);
+                }
+            else {
+                r = _mm_srli_epi32(p,9);
+                g = _mm_srli_epi32(p,6);
+                }
+            b = _mm_srli_epi32(p,3);
+            p = _mm_or_si128(_mm_or_si128(_mm_and_si128(r,rmask),_mm_and_si128(g,gmask)),_mm_and_si128(b,bmask));
+            p = _mm_srai_epi32(_mm_slli_epi32(p,16),16);
+            _mm_storel_epi64((__m128i*)d,_mm_packs_epi32(p,p));
+            }
+        }
+#endif
+    for (; count > 0; count--, x++) {
+        R = (uchar)(*s >> 16);
+        G = (uchar)(*s >> 8);
+        B = (uchar)(*s++);
+        dither = dp[x & 3];
+        if (is565) {
+            *d++ = (ushort)
+               (((_MGL_div8[R] + (_MGL_mod8[R] > dither)) << 11) +
+                ((_MGL_div4[G] + (_MGL_mod4[G] > (dither>>1))) << 5) +
+                ((_MGL_div8[B] + (_MGL_mod8[B] > dither)) << 0));
+            }
+        else {
+            *d++ = (ushort)
+               (((_MGL_div8[R] + (_MGL_mod8[R] > dither)) << 10) +
+                ((_MGL_div8[G] + (_MGL_mod8[G] > dither)) << 5) +
+                ((_MGL_div8[B] + (_MGL_mod8[B] > dither)) << 0));
+            }
+        }
+}
+
+/****************************************************************************
+REMARKS:
+Builds the tables used to find the closest level for each component and
+the color that level represents, for error diffusion.
+****************************************************************************/
+static void buildLevels(void)
+{
+    int i,l;
+
+    for (i = 0; i < 256; i++) {
+        l = (i * 31 + 127) / 255;
+        level5[i] = (uchar)l;
+        value5[i] = (uchar)((l << 3) | (l >> 2));
+        l = (i * 63 + 127) / 255;
+        level6[i] = (uchar)l;
+        value6[i] = (uchar)((l << 2) | (l >> 4));
+        l = (i * 5 + 127) / 255;
+        level51[i] = (uchar)l;
+        value51[i] = (uchar)(l * 51);
+        }
+    haveLevels = true;
+}
+
+/* Diffuses the error for a single color component, using the single
+ * scanline error buffer method from the IJG JPEG library. The error terms
+ * are kept scaled by 16, and ep points to the entry for the pixel to the
+ * left of the current pixel.
+ */
+
+#define DIFFUSE(ch,C,levels,values,L)                           \
+{                                                               \
+    int cur = (fs.cur[ch] + ep[3+ch] + 8) >> 4;                 \
+    int next,delta;                                             \
+    cur += (C);                                                 \
+    if (cur < 0) cur = 0; else if (cur > 255) cur = 255;        \
+    (L) = (levels)[cur];                                        \
+    cur -= (values)[cur];                                       \
+    next = cur;                                                 \
+    delta = cur * 2;                                            \
+    cur += delta;                                               \
+    ep[ch] = (short)(fs.belowPrev[ch] + cur);                   \
+    cur += delta;                                               \
+    fs.belowPrev[ch] = fs.below[ch] + cur;                      \
+    fs.below[ch] = next;                                        \
+    fs.cur[ch] = cur + delta;                                   \
+}
+
+/****************************************************************************
+RETURNS:
+True if the span was diffused, false if the error buffer could not be
+allocated.
+
+REMARKS:
+Dithers a span of RGB pixels using Floyd-Steinberg error diffusion. If the
+span continues on from the last one (the same scanline or the one below
+it on the same surface), the error terms are carried over, otherwise they
+are cleared.
+****************************************************************************/
+static ibool diffuseSpan(
+    MGL_dither *dt,
+    void *dst,
+    const M_uint32 *s,
+    int x,
+    int y,
+    int count)
+{
+    uchar   *levels,*values,*gLevels,*gValues,*d8 = dst;
+    ushort  *d16 = dst;
+    short   *ep;
+    int     i,R,G,B;
+
+    if (!haveLevels)
+        buildLevels();
+    if (fs.columns < dt->columns) {
+        PM_free(fs.err);
+        if ((fs.err = PM_malloc((dt->columns + 2) * 3 * sizeof(short))) == NULL) {
+            fs.columns = 0;
+            return false;
+            }
+        fs.columns = dt->columns;
+        fs.surface = NULL;
+        }
+    if (fs.surface != dt->surface || fs.format != dt->format
+            || (y != fs.y && y != fs.y+1)) {
+        memset(fs.err,0,(fs.columns + 2) * 3 * sizeof(short));
+        fs.surface = dt->surface;
+        fs.format = dt->format;
+        fs.nextX = -1;
+        }
+    if (y != fs.y || x != fs.nextX) {
+        for (i = 0; i < 3; i++)
+            fs.cur[i] = fs.below[i] = fs.belowPrev[i] = 0;
+        }
+    fs.y = y;
+    fs.nextX = x + count;
+
+    if (dt->format == DITHER_8) {
+        levels = gLevels = level51;
+        values = gValues = value51;
+        }
+    else {
+        levels = level5;
+        values = value5;
+        gLevels = (dt->format == DITHER_565) ? level6 : level5;
+        gValues = (dt->format == DITHER_565) ? value6 : value5;
+        }
+    for (ep = fs.err + x * 3; count > 0; count--, s++, ep += 3) {
+        DIFFUSE(0,(uchar)(*s >> 16),levels,values,R);
+        DIFFUSE(1,(uchar)(*s >> 8),gLevels,gValues,G);
+        DIFFUSE(2,(uchar)*s,levels,values,B);
+        switch (dt->format) {
+            case DITHER_8:
+                *d8++ = dt->xlat[20 + R + G*6 + B*36];
+                break;
+            case DITHER_555:
+                *d16++ = (ushort)((R << 10) | (G << 5) | B);
+                break;
+            case DITHER_565:
+                *d16++ = (ushort)((R << 11) | (G << 5) | B);
+                break;
+            }
+        }
+    for (i = 0; i < 3; i++)
+        ep[i] = (short)fs.belowPrev[i];
+    return true;
+}
+
+/****************************************************************************
+PARAMETERS:
+dt              - Dither information to set up
+dst             - Destination device context
+bitsPerPixel    - Color depth of the RGB source pixels
+
+RETURNS:
+True if the conversion should be dithered with the span kernels, false if
+the regular blit code should handle it.
+
+REMARKS:
+Works out if a conversion from RGB source pixels to the destination device
+context needs dithering and if the destination is a format the span
+kernels can handle, following the same rules as SETUP_DITHER_MODE. When
+the identity palette checking is turned off we assume the halftone palette
+has been loaded into the destination, otherwise the halftone colors are
+mapped to the closest colors in the destination palette.
+{secret}
+****************************************************************************/
+ibool _MGL_setupDither(
+    MGLDC *dst,
+    MGL_dither *dt,
+    int bitsPerPixel)
+{
+    MGL_invCMap     *icm;
+    pixel_format_t  *pf = &dst->pf;
+    int             i;
+
+    if (bitsPerPixel < 15)
+        return false;
+    if (dst->mi.modeFlags & MGL_IS_COLOR_INDEX) {
+        if (dst->mi.bitsPerPixel != 8)
+            return false;
+        if (!_MGL_checkIdentityPal) {
+            for (i = 0; i < 256; i++)
+                dt->xlat[i] = (uchar)_MGL_halfToneTranslate[i];
+            }
+        else {
+            if (!dst->a.ditherMode || (icm = _MGL_getInverseColorMap(dst)) == NULL)
+                return false;
+            for (i = 0; i < 256; i++)
+                dt->xlat[i] = icm->map[INVCMAP_INDEX(_MGL_halftonePal[i].red,
+                    _MGL_halftonePal[i].green,_MGL_halftonePal[i].blue)];
+            }
+        dt->format = DITHER_8;
+        }
+    else {
+        if (!dst->a.ditherMode || bitsPerPixel < 24
+                || pf->redMask != 0x1F || pf->blueMask != 0x1F || pf->bluePos != 0)
+            return false;
+        if (dst->mi.bitsPerPixel == 15 && pf->greenMask == 0x1F && pf->redPos == 10)
+            dt->format = DITHER_555;
+        else if (dst->mi.bitsPerPixel == 16 && pf->greenMask == 0x3F && pf->redPos == 11)
+            dt->format = DITHER_565;
+        else
+            return false;
+        }
+    dt->diffuse = (dst->a.ditherMode == MGL_DITHER_DIFFUSE);
+    dt->surface = dst->surface;
+    dt->columns = dst->mi.xRes+1;
+    return true;
+}
+
+/****************************************************************************
+PARAMETERS:
+dt      - Dither information from _MGL_setupDither
+dst     - Destination address of the first pixel
+src     - Source pixels in packed 0x00RRGGBB format
+x       - Destination x coordinate of the first pixel
+y       - Destination y coordinate of the span
+count   - Number of pixels in the span
+
+REMARKS:
+Dithers a span of RGB pixels to the destination format. Error diffusion
+must be done from top to bottom on a single thread, but the ordered dither
+only depends on the destination coordinates so spans can be dithered in
+any order.
+{secret}
+****************************************************************************/
+void _MGL_ditherSpan(
+    MGL_dither *dt,
+    void *dst,
+    const M_uint32 *src,
+    int x,
+    int y,
+    int count)
+{
+    if (dt->diffuse && diffuseSpan(dt,dst,src,x,y,count))
+        return;
+    if (dt->format == DITHER_8)
+        halfToneSpan8(dst,src,x,y,count,dt->xlat);
+    else
+        halfToneSpan16(dst,src,x,y,count,dt->format == DITHER_565);
+}
+
+/****************************************************************************
+REMARKS:
+Frees the error diffusion buffer when the MGL is shut down.
+{secret}
+****************************************************************************/
+void _MGL_freeDither(void)
+{
+    PM_free(fs.err);
+    fs.err = NULL;
+    fs.columns = 0;
+    fs.surface = NULL;
+}
+
+/****************************************************************************
+DESCRIPTION:
+Dithers a scanline of RGB pixels to the halftone palette.
+
+HEADER:
+mgraph.h
+
+PARAMETERS:
+dst     - Place to store the color index pixels
+src     - Source pixels in packed 0x00RRGGBB format
+x       - x coordinate of the first pixel (need only be relative)
+y       - y coordinate of the scanline (need only be relative)
+count   - Number of pixels to convert
+
+REMARKS:
+This function converts a run of 24 bit RGB pixel values to color indices
+in the MGL halftone palette, using the same 8x8 ordered dither that the
+MGL uses when blitting RGB bitmaps to 8 bits per pixel device contexts.
+This is much faster than calling MGL_halfTonePixel for every pixel, and
+uses SIMD instructions where available.
+
+SEE ALSO:
+MGL_halfTonePixel, MGL_halfToneSpan555, MGL_halfToneSpan565,
+MGL_getHalfTonePalette
+****************************************************************************/
+void MGLAPI MGL_halfToneSpan(
+    uchar *dst,
+    const M_uint32 *src,
+    int x,
+    int y,
+    int count)
+{
+    halfToneSpan8(dst,src,x,y,count,NULL);
+}
+
+/****************************************************************************
+DESCRIPTION:
+Dithers a scanline of RGB pixels to 5:5:5 format.
+
+HEADER:
+mgraph.h
+
+PARAMETERS:
+dst     - Place to store the packed 5:5:5 pixels
+src     - Source pixels in packed 0x00RRGGBB format
+x       - x coordinate of the first pixel (need only be relative)
+y       - y coordinate of the scanline (need only be relative)
+count   - Number of pixels to convert
+
+REMARKS:
+This function converts a run of 24 bit RGB pixel values to RGB 5:5:5
+format using a 4x4 ordered dither. The results are the same as calling
+MGL_halfTonePixel555 for each pixel, but the conversion is much faster
+and uses SIMD instructions where available.
+
+SEE ALSO:
+MGL_halfTonePixel555, MGL_halfToneSpan565, MGL_halfToneSpan
+****************************************************************************/
+void MGLAPI MGL_halfToneSpan555(
+    ushort *dst,
+    const M_uint32 *src,
+    int x,
+    int y,
+    int count)
+{
+    halfToneSpan16(dst,src,x,y,count,false);
+}
+
+/****************************************************************************
+DESCRIPTION:
+Dithers a scanline of RGB pixels to 5:6:5 format.
+
+HEADER:
+mgraph.h
+
+PARAMETERS:
+dst     - Place to store the packed 5:6:5 pixels
+src     - Source pixels in packed 0x00RRGGBB format
+x       - x coordinate of the first pixel (need only be relative)
+y       - y coordinate of the scanline (need only be relative)
+count   - Number of pixels to convert
+
+REMARKS:
+This function converts a run of 24 bit RGB pixel values to RGB 5:6:5
+format using a 4x4 ordered dither. The results are the same as calling
+MGL_halfTonePixel565 for each pixel, but the conversion is much faster
+and uses SIMD instructions where available.
+
+SEE ALSO:
+MGL_halfTonePixel565, MGL_halfToneSpan555, MGL_halfToneSpan
+****************************************************************************/
+void MGLAPI MGL_halfToneSpan565(
+    ushort *dst,
+    const M_uint32 *src,
+    int x,
+    int y,
+    int count)
+{
+    halfToneSpan16(dst,src,x,y,count,true);
+}
@@ -557,6 +557,7 @@ void MGLAPI OPENGL_drawStrBitmap(int x,int y,const char *str)
     int             i,width,byteWidth,height,ascent,descent,offset;
     int             fontAscent,iwidth,bitmapHeight;
     uchar           *bytes,*buf = _MGL_buf;
+    glyph_metrics   *gm;
     text_settings_t ts = DC.a.ts;
     font_t          *font = ts.font;
 
@@ -618,13 +619,13 @@ void MGLAPI OPENGL_drawStrBitmap(int x,int y,const char *str)
                     x - width));
 
             while (*str) {
-                width = BITFONT(font)->width[(uchar)*str];
-                iwidth = BITFONT(font)->iwidth[(uchar)*str];
-                if ((offset = BITFONT(font)->offset[(uchar)*str++]) == -1) {
-                    offset = BITFONT(font)->offset[MISSINGSYMBOL];
-                    width = BITFONT(font)->width[MISSINGSYMBOL];
-                    iwidth = BITFONT(font)->iwidth[MISSINGSYMBOL];
-                    }
+                gm = BIT_METRICS(font,(uchar)*str);
+                str++;
+                if (gm->offset == -1)
+                    gm = BIT_METRICS(font,MISSINGSYMBOL);
+                width = gm->width;
+                iwidth = gm->iwidth;
+                offset = gm->offset;
                 bytes = (uchar *)&BITFONT(font)->def[offset];
                 byteWidth = (iwidth + 7) >> 3;
                 if (iwidth != 0) {
@@ -642,13 +643,13 @@ void MGLAPI OPENGL_drawStrBitmap(int x,int y,const char *str)
                     y + width));
 
             while (*str) {
-                width = BITFONT(font)->width[(uchar)*str];
-                iwidth = BITFONT(font)->iwidth[(uchar)*str];
-                if ((offset = BITFONT(font)->offset[(uchar)*str++]) == -1) {
-                    offset = BITFONT(font)->offset[MISSINGSYMBOL];
-                    width = BITFONT(font)->width[MISSINGSYMBOL];
-                    iwidth = BITFONT(font)->iwidth[MISSINGSYMBOL];
-                    }
+                gm = BIT_METRICS(font,(uchar)*str);
+                str++;
+                if (gm->offset == -1)
+                    gm = BIT_METRICS(font,MISSINGSYMBOL);
+                width = gm->width;
+                iwidth = gm->iwidth;
+                offset = gm->offset;
                 bytes = (uchar *)&BITFONT(font)->def[offset];
                 byteWidth = (iwidth + 7) >> 3;
                 if (iwidth != 0) {
@@ -667,13 +668,13 @@ void MGLAPI OPENGL_drawStrBitmap(int x,int y,const char *str)
                     y - width));
 
             while (*str) {
-                width = BITFONT(font)->width[(uchar)*str];
-                iwidth = BITFONT(font)->iwidth[(uchar)*str];
-                if ((offset = BITFONT(font)->offset[(uchar)*str++]) == -1) {
-                    offset = BITFONT(font)->offset[MISSINGSYMBOL];
-                    width = BITFONT(font)->width[MISSINGSYMBOL];
-                    iwidth = BITFONT(font)->iwidth[MISSINGSYMBOL];
-                    }
+                gm = BIT_METRICS(font,(uchar)*str);
+                str++;
+                if (gm->offset == -1)
+                    gm = BIT_METRICS(font,MISSINGSYMBOL);
+                width = gm->width;
+                iwidth = gm->iwidth;
+                offset = gm->offset;
                 bytes = (uchar *)&BITFONT(font)->def[offset];
                 byteWidth = (iwidth + 7) >> 3;
                 if (iwidth != 0) {
@@ -692,13 +693,13 @@ void MGLAPI OPENGL_drawStrBitmap(int x,int y,const char *str)
                     x + width));
 
             while (*str) {
-                width = BITFONT(font)->width[(uchar)*str];
-                iwidth = BITFONT(font)->iwidth[(uchar)*str];
-                if ((offset = BITFONT(font)->offset[(uchar)*str++]) == -1) {
-                    offset = BITFONT(font)->offset[MISSINGSYMBOL];
-                    width = BITFONT(font)->width[MISSINGSYMBOL];
-                    iwidth = BITFONT(font)->iwidth[MISSINGSYMBOL];
-                    }
+                gm = BIT_METRICS(font,(uchar)*str);
+                str++;
+                if (gm->offset == -1)
+                    gm = BIT_METRICS(font,MISSINGSYMBOL);
+                width = gm->width;
+                iwidth = gm->iwidth;
+                offset = gm->offset;
                 bytes = (uchar *)&BITFONT(font)->def[offset];
                 byteWidth = (iwidth + 7) >> 3;
                 if (iwidth != 0) {
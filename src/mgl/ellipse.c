@@ -481,8 +481,10 @@ void MGLAPI MGL_ellipse(
     r = extentRect;
     r.right += DC.a.penWidth;
     r.bottom += DC.a.penHeight;
-    if (MGL_sectRect(DC.clipRectView,r,&r))
+    if (MGL_sectRect(DC.clipRectView,r,&r)) {
         clipit = !MGL_equalRect(extentRect,r);
+        MARK_DIRTY_VIEW(&DC,r.left,r.top,r.right,r.bottom);
+        }
     else {
         /* Trivially reject ellipse */
         END_VISIBLE_CLIP_LIST(&DC);
@@ -659,8 +661,10 @@ void MGLAPI MGL_fillEllipse(
      * scan convert without clipping (a lot faster).
      */
     BEGIN_VISIBLE_CLIP_LIST(&DC);
-    if (MGL_sectRect(DC.clipRectView,extentRect,&r))
+    if (MGL_sectRect(DC.clipRectView,extentRect,&r)) {
         clipit = !MGL_equalRect(extentRect,r);
+        MARK_DIRTY_VIEW(&DC,r.left,r.top,r.right,r.bottom);
+        }
     else {
         /* Trivially reject ellipse             */
         END_VISIBLE_CLIP_LIST(&DC);
@@ -1268,8 +1268,10 @@ void MGLAPI MGL_ellipseArc(
 
     /* Determine if the ellipse arc needs to be clipped.    */
     BEGIN_VISIBLE_CLIP_LIST(&DC);
-    if (MGL_sectRect(DC.clipRectView,extentRect,&r))
+    if (MGL_sectRect(DC.clipRectView,extentRect,&r)) {
         clipit = !MGL_equalRect(extentRect,r);
+        MARK_DIRTY_VIEW(&DC,r.left,r.top,r.right+DC.a.penWidth,r.bottom+DC.a.penHeight);
+        }
     else {
         /* Trivially reject ellipse             */
         END_VISIBLE_CLIP_LIST(&DC);
@@ -1496,8 +1498,10 @@ void MGLAPI MGL_fillEllipseArc(
 
     /* Determine if the elliptical wedge needs to be clipped.   */
     BEGIN_VISIBLE_CLIP_LIST(&DC);
-    if (MGL_sectRect(DC.clipRectView,extentRect,&r))
+    if (MGL_sectRect(DC.clipRectView,extentRect,&r)) {
         clipit = !MGL_equalRect(extentRect,r);
+        MARK_DIRTY_VIEW(&DC,r.left,r.top,r.right+DC.a.penWidth,r.bottom+DC.a.penHeight);
+        }
     else {
         /* Trivially reject ellipse             */
         END_VISIBLE_CLIP_LIST(&DC);
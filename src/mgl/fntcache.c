@@ -0,0 +1,622 @@
+/****************************************************************************
+*
+*                   SciTech Multi-platform Graphics Library
+*
+*  ========================================================================
+*
+*   Copyright (C) 1991-2004 SciTech Software, Inc. All rights reserved.
+*
+*   This file may be distributed and/or modified under the terms of the
+*   GNU General Public License version 2.0 as published by the Free
+*   Software Foundation and appearing in the file LICENSE.GPL included
+*   in the packaging of this file.
+*
+*   Licensees holding a valid Commercial License for this product from
+*   SciTech Software, Inc. may use this file in accordance with the
+*   Commercial License Agreement provided with the Software.
+*
+*   This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING
+*   THE WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+*   PURPOSE.
+*
+*   See http://www.scitechsoft.com/license/ for information about
+*   the licensing options available and how to purchase a Commercial
+*   License Agreement.
+*
+*   Contact license@scitechsoft.com if any conditions of this licensing
+*   are not clear to you, or you have questions about licensing options.
+*
+*  ========================================================================
+*
+*
+* Language:     ANSI C
+* Environment:  Any
+*
+* Description:  Shared glyph cache for TrueType font instances. Glyphs are
+*               rasterised on demand and stored in a single cache that is
+*               shared by all font instances, keyed by the font face, the
+*               instance size, the glyph index and the anti-aliasing mode,
+*               so instances of the same face and size share one copy of
+*               each glyph. The cache also holds the rotated images of
+*               bitmap and TrueType glyphs for the vertical and right to
+*               left text directions, keyed by the direction as well. The
+*               glyph bitmaps are packed into fixed size atlas pages, each
+*               divided into slots of a single power of two size, and the
+*               least recently used glyphs are evicted when the cache grows
+*               past its memory budget.
+*
+****************************************************************************/
+
+#include "mgl.h"
+
+/*--------------------------- Global Variables ----------------------------*/
+
+#define GLYPH_PAGE_SIZE     (16 * 1024L)    /* Size of each atlas page     */
+#define GLYPH_MIN_SLOT      16              /* Smallest slot in a page     */
+#define NUM_SLOT_SIZES      10              /* Slot sizes from 16b to 8Kb  */
+#define DEF_CACHE_SIZE      (1024 * 1024L)  /* Default memory budget       */
+#define MIN_HASH_SIZE       256
+
+/* Glyphs for TrueType fonts are shared by all instances of the same font
+ * library, but glyphs for bitmap fonts belong to the font itself.
+ */
+
+#define GLYPH_FACE(f)   ((f)->lib && (f)->lib->fontLibType == MGL_TRUETYPEFONT_LIB \
+                            ? (void*)(f)->lib : (void*)(f))
+
+/* {secret} */
+typedef struct glyphPage {
+    struct glyphPage    *prev;      /* Previous page with free slots       */
+    struct glyphPage    *next;      /* Next page with free slots           */
+    uchar               *freeSlot;  /* First free slot in the page         */
+    int                 slotSize;   /* Size class index (-1 if dedicated)  */
+    int                 used;       /* Number of slots in use              */
+    ulong               bytes;      /* Total memory used by the page       */
+    } glyphPage;
+
+/* {secret} */
+typedef struct glyphEntry {
+    struct glyphEntry   *hashNext;  /* Next entry in the hash chain        */
+    struct glyphEntry   *lruPrev;   /* Previous (more recently used) entry */
+    struct glyphEntry   *lruNext;   /* Next (less recently used) entry     */
+    void                *face;      /* Font library the glyph belongs to   */
+    long                charSize;   /* Instance character size (26.6)      */
+    int                 height;     /* Instance font height in pixels      */
+    int                 glyph;      /* Glyph index within the font         */
+    int                 dir;        /* Text direction the glyph is for     */
+    ibool               antialiased;/* True for anti-aliased glyphs        */
+    ulong               hash;       /* Hash value for the key              */
+    glyphPage           *page;      /* Atlas page holding the glyph        */
+    uchar               *data;      /* Glyph bitmap data                   */
+    } glyphEntry;
+
+static glyphEntry   **hashTable = NULL;
+static ulong        hashSize = 0;
+static glyphEntry   *lruHead = NULL;
+static glyphEntry   *lruTail = NULL;
+static glyphPage    *freePages[NUM_SLOT_SIZES];
+static ulong        budget = DEF_CACHE_SIZE;
+static ulong        bytesUsed = 0;
+static int          numGlyphs = 0;
+static int          numPages = 0;
+static ulong        hits = 0;
+static ulong        misses = 0;
+static ulong        evictions = 0;
+
+/*------------------------- Implementation --------------------------------*/
+
+/****************************************************************************
+PARAMETERS:
+font    - Font instance the glyph belongs to
+glyph   - Index of the glyph within the font
+dir     - Text direction the glyph is rotated for
+
+RETURNS:
+Hash value for the glyph key.
+****************************************************************************/
+static ulong hashGlyph(
+    bitmap_font *font,
+    int glyph,
+    int dir)
+{
+    ulong   hash = 2166136261UL;
+
+    hash = (hash ^ (ulong)GLYPH_FACE(font)) * 16777619UL;
+    hash = (hash ^ (ulong)font->charSize) * 16777619UL;
+    hash = (hash ^ (ulong)font->fontHeight) * 16777619UL;
+    hash = (hash ^ (ulong)glyph) * 16777619UL;
+    hash = (hash ^ (ulong)font->antialiased) * 16777619UL;
+    hash = (hash ^ (ulong)dir) * 16777619UL;
+    return hash & 0xFFFFFFFFUL;
+}
+
+/****************************************************************************
+PARAMETERS:
+e   - Entry to unlink
+
+REMARKS:
+Removes an entry from the LRU list.
+****************************************************************************/
+static void lruRemove(
+    glyphEntry *e)
+{
+    if (e->lruPrev)
+        e->lruPrev->lruNext = e->lruNext;
+    else
+        lruHead = e->lruNext;
+    if (e->lruNext)
+        e->lruNext->lruPrev = e->lruPrev;
+    else
+        lruTail = e->lruPrev;
+}
+
+/****************************************************************************
+PARAMETERS:
+e   - Entry to link in
+
+REMARKS:
+Adds an entry to the front of the LRU list as the most recently used glyph.
+****************************************************************************/
+static void lruAdd(
+    glyphEntry *e)
+{
+    e->lruPrev = NULL;
+    e->lruNext = lruHead;
+    if (lruHead)
+        lruHead->lruPrev = e;
+    else
+        lruTail = e;
+    lruHead = e;
+}
+
+/****************************************************************************
+PARAMETERS:
+page    - Page to add to the free list for its slot size
+
+REMARKS:
+Adds a page with free slots to the list of pages for its slot size.
+****************************************************************************/
+static void addFreePage(
+    glyphPage *page)
+{
+    page->prev = NULL;
+    page->next = freePages[page->slotSize];
+    if (page->next)
+        page->next->prev = page;
+    freePages[page->slotSize] = page;
+}
+
+/****************************************************************************
+PARAMETERS:
+page    - Page to remove from the free list for its slot size
+****************************************************************************/
+static void removeFreePage(
+    glyphPage *page)
+{
+    if (page->prev)
+        page->prev->next = page->next;
+    else
+        freePages[page->slotSize] = page->next;
+    if (page->next)
+        page->next->prev = page->prev;
+}
+
+/****************************************************************************
+PARAMETERS:
+slotSize    - Size class index for the new page
+
+RETURNS:
+Pointer to the new page, or NULL if out of memory.
+
+REMARKS:
+Allocates a new atlas page and threads all of its slots onto the free
+slot list for the page.
+****************************************************************************/
+static glyphPage *newPage(
+    int slotSize)
+{
+    glyphPage   *page;
+    uchar       *slot;
+    long        size = (long)GLYPH_MIN_SLOT << slotSize;
+    int         i,count = GLYPH_PAGE_SIZE / size;
+
+    if ((page = PM_malloc(sizeof(glyphPage) + GLYPH_PAGE_SIZE)) == NULL)
+        return NULL;
+    page->slotSize = slotSize;
+    page->used = 0;
+    page->bytes = sizeof(glyphPage) + GLYPH_PAGE_SIZE;
+    page->freeSlot = NULL;
+    for (i = count-1, slot = (uchar*)(page+1) + i*size; i >= 0; i--, slot -= size) {
+        *((uchar**)slot) = page->freeSlot;
+        page->freeSlot = slot;
+        }
+    addFreePage(page);
+    bytesUsed += page->bytes;
+    numPages++;
+    return page;
+}
+
+/****************************************************************************
+PARAMETERS:
+page    - Page to free
+****************************************************************************/
+static void freePage(
+    glyphPage *page)
+{
+    if (page->slotSize >= 0)
+        removeFreePage(page);
+    bytesUsed -= page->bytes;
+    numPages--;
+    PM_free(page);
+}
+
+/****************************************************************************
+PARAMETERS:
+e   - Entry to free
+
+REMARKS:
+Removes a glyph from the cache and releases its slot in the atlas page. If
+this was the last glyph in the page, the page is freed.
+****************************************************************************/
+static void freeEntry(
+    glyphEntry *e)
+{
+    glyphEntry  **prev;
+    glyphPage   *page = e->page;
+
+    for (prev = &hashTable[e->hash & (hashSize-1)]; *prev != e; prev = &(*prev)->hashNext)
+        ;
+    *prev = e->hashNext;
+    lruRemove(e);
+    if (page->slotSize >= 0) {
+        if (!page->freeSlot)
+            addFreePage(page);
+        *((uchar**)e->data) = page->freeSlot;
+        page->freeSlot = e->data;
+        }
+    if (--page->used == 0)
+        freePage(page);
+    bytesUsed -= sizeof(glyphEntry);
+    numGlyphs--;
+    PM_free(e);
+}
+
+/****************************************************************************
+PARAMETERS:
+bytes   - Number of bytes about to be allocated
+
+REMARKS:
+Evicts the least recently used glyph if adding the bytes would take the
+cache over its memory budget.
+
+RETURNS:
+True if a glyph was evicted, false if there is room or the cache is empty.
+****************************************************************************/
+static ibool evictGlyph(
+    ulong bytes)
+{
+    if (!lruTail || bytesUsed + bytes <= budget)
+        return false;
+    freeEntry(lruTail);
+    evictions++;
+    return true;
+}
+
+/****************************************************************************
+PARAMETERS:
+size    - Size of the glyph bitmap in bytes
+page    - Place to store the page the glyph was allocated from
+
+RETURNS:
+Pointer to the glyph storage, or NULL if out of memory.
+
+REMARKS:
+Allocates storage for a glyph bitmap. Small glyphs are allocated from a
+slot in an atlas page for the smallest slot size that will hold the glyph,
+and glyphs larger than half a page get a page of their own. Least recently
+used glyphs are evicted until there is a free slot of the right size or a
+new page fits within the memory budget.
+****************************************************************************/
+static uchar *allocGlyph(
+    long size,
+    glyphPage **page)
+{
+    glyphPage   *p;
+    uchar       *slot;
+    int         slotSize;
+
+    for (slotSize = 0; slotSize < NUM_SLOT_SIZES && ((long)GLYPH_MIN_SLOT << slotSize) < size; slotSize++)
+        ;
+    if (slotSize == NUM_SLOT_SIZES) {
+        while (evictGlyph(sizeof(glyphPage) + size + sizeof(glyphEntry)))
+            ;
+        if ((p = PM_malloc(sizeof(glyphPage) + size)) == NULL)
+            return NULL;
+        p->slotSize = -1;
+        p->used = 1;
+        p->bytes = sizeof(glyphPage) + size;
+        bytesUsed += p->bytes;
+        numPages++;
+        *page = p;
+        return (uchar*)(p+1);
+        }
+    while (!freePages[slotSize] && evictGlyph(sizeof(glyphPage) + GLYPH_PAGE_SIZE + sizeof(glyphEntry)))
+        ;
+    if ((p = freePages[slotSize]) == NULL && (p = newPage(slotSize)) == NULL)
+        return NULL;
+    slot = p->freeSlot;
+    p->freeSlot = *((uchar**)slot);
+    if (!p->freeSlot)
+        removeFreePage(p);
+    p->used++;
+    *page = p;
+    return slot;
+}
+
+/****************************************************************************
+REMARKS:
+Doubles the size of the hash table once the average chain length reaches
+two entries, so that lookups stay fast as the cache grows.
+****************************************************************************/
+static void growHashTable(void)
+{
+    glyphEntry  **table,*e,*next;
+    ulong       i,size = hashSize ? hashSize * 2 : MIN_HASH_SIZE;
+
+    if ((table = PM_calloc(size,sizeof(glyphEntry*))) == NULL)
+        return;
+    for (i = 0; i < hashSize; i++) {
+        for (e = hashTable[i]; e; e = next) {
+            next = e->hashNext;
+            e->hashNext = table[e->hash & (size-1)];
+            table[e->hash & (size-1)] = e;
+            }
+        }
+    if (hashTable)
+        PM_free(hashTable);
+    hashTable = table;
+    hashSize = size;
+}
+
+/****************************************************************************
+PARAMETERS:
+font    - Font instance to find the glyph for
+glyph   - Index of the glyph within the font
+dir     - Text direction the glyph is rotated for
+
+RETURNS:
+Pointer to the cached glyph bitmap, or NULL if the glyph is not cached.
+
+REMARKS:
+Looks up a rasterised glyph in the shared glyph cache, and marks it as the
+most recently used glyph. Unrotated glyphs are cached with a direction of
+MGL_RIGHT_DIR. The returned pointer is only valid until the next glyph is
+added to the cache.
+{secret}
+****************************************************************************/
+uchar *_MGL_findCachedGlyph(
+    bitmap_font *font,
+    int glyph,
+    int dir)
+{
+    glyphEntry  *e;
+    ulong       hash;
+
+    if (!hashSize)
+        return NULL;
+    hash = hashGlyph(font,glyph,dir);
+    for (e = hashTable[hash & (hashSize-1)]; e; e = e->hashNext) {
+        if (e->hash == hash && e->glyph == glyph && e->dir == dir
+                && e->face == GLYPH_FACE(font) && e->charSize == font->charSize
+                && e->height == font->fontHeight && e->antialiased == font->antialiased) {
+            if (e != lruHead) {
+                lruRemove(e);
+                lruAdd(e);
+                }
+            hits++;
+            return e->data;
+            }
+        }
+    return NULL;
+}
+
+/****************************************************************************
+PARAMETERS:
+font    - Font instance to add the glyph for
+glyph   - Index of the glyph within the font
+dir     - Text direction the glyph is rotated for
+size    - Size of the glyph bitmap in bytes
+
+RETURNS:
+Pointer to the zeroed storage for the glyph bitmap, or NULL if out of memory.
+
+REMARKS:
+Allocates space in the shared glyph cache for a newly rasterised glyph,
+evicting the least recently used glyphs if necessary to stay within the
+memory budget. The glyph must not already be in the cache. The caller
+rasterises the glyph directly into the returned storage, which is only
+valid until the next glyph is added to the cache.
+{secret}
+****************************************************************************/
+uchar *_MGL_addCachedGlyph(
+    bitmap_font *font,
+    int glyph,
+    int dir,
+    long size)
+{
+    glyphEntry  *e;
+    glyphPage   *page;
+    uchar       *data;
+
+    misses++;
+    if (size < (long)sizeof(uchar*))
+        size = sizeof(uchar*);
+    if ((ulong)numGlyphs >= hashSize * 2)
+        growHashTable();
+    if (!hashSize)
+        return NULL;
+    if ((data = allocGlyph(size,&page)) == NULL)
+        return NULL;
+    if ((e = PM_malloc(sizeof(glyphEntry))) == NULL) {
+        if (page->slotSize >= 0) {
+            if (!page->freeSlot)
+                addFreePage(page);
+            *((uchar**)data) = page->freeSlot;
+            page->freeSlot = data;
+            }
+        if (--page->used == 0)
+            freePage(page);
+        return NULL;
+        }
+    e->face = GLYPH_FACE(font);
+    e->charSize = font->charSize;
+    e->height = font->fontHeight;
+    e->glyph = glyph;
+    e->dir = dir;
+    e->antialiased = font->antialiased;
+    e->hash = hashGlyph(font,glyph,dir);
+    e->page = page;
+    e->data = data;
+    e->hashNext = hashTable[e->hash & (hashSize-1)];
+    hashTable[e->hash & (hashSize-1)] = e;
+    lruAdd(e);
+    bytesUsed += sizeof(glyphEntry);
+    numGlyphs++;
+    memset(data,0,size);
+    return data;
+}
+
+/****************************************************************************
+PARAMETERS:
+face    - Font library or bitmap font to flush the glyphs for
+
+REMARKS:
+Removes all the glyphs for a font library from the cache. This is called
+when a font library is closed, or a bitmap font is unloaded, so that a new
+library or font allocated at the same address cannot find the old glyphs.
+{secret}
+****************************************************************************/
+void _MGL_flushCachedGlyphs(
+    void *face)
+{
+    glyphEntry  *e,*next;
+
+    for (e = lruHead; e; e = next) {
+        next = e->lruNext;
+        if (e->face == face)
+            freeEntry(e);
+        }
+}
+
+/****************************************************************************
+DESCRIPTION:
+Sets the memory budget for the TrueType glyph cache.
+
+HEADER:
+mgraph.h
+
+PARAMETERS:
+maxBytes    - Maximum number of bytes of memory to use for cached glyphs
+
+REMARKS:
+TrueType glyphs are rasterised the first time they are drawn, and are kept
+in a glyph cache that is shared by all the loaded TrueType font instances.
+Glyphs are shared between all instances of the same font library at the
+same point size and anti-aliasing mode, so loading the same font size more
+than once does not use any more memory for the glyphs. When the cache grows
+past its memory budget, the least recently used glyphs are freed and will
+be rasterised again if they are needed later.
+
+Text drawn in the vertical and right to left directions uses rotated
+copies of the glyphs, and these are also kept in the glyph cache for both
+bitmap and TrueType fonts, so each glyph is only rotated the first time it
+is drawn in each direction.
+
+This function sets the memory budget for the glyph cache. The default
+budget is 1Mb, which is enough for several thousand glyphs at typical user
+interface sizes. Applications that draw text using very large fonts or
+with thousands of different glyphs (such as CJK text) may want to increase
+the budget to avoid rasterising the same glyphs over and over.
+
+SEE ALSO:
+MGL_getGlyphCacheStats, MGL_flushGlyphCache, MGL_loadFontInstance
+****************************************************************************/
+void MGLAPI MGL_setGlyphCacheSize(
+    ulong maxBytes)
+{
+    budget = maxBytes;
+    while (evictGlyph(0))
+        ;
+}
+
+/****************************************************************************
+DESCRIPTION:
+Frees all the glyphs in the TrueType glyph cache.
+
+HEADER:
+mgraph.h
+
+REMARKS:
+This function frees all the rasterised glyphs in the glyph cache. Glyphs
+will be rasterised again the next time they are drawn.
+
+SEE ALSO:
+MGL_setGlyphCacheSize, MGL_getGlyphCacheStats
+****************************************************************************/
+void MGLAPI MGL_flushGlyphCache(void)
+{
+    while (lruHead)
+        freeEntry(lruHead);
+}
+
+/****************************************************************************
+DESCRIPTION:
+Returns statistics about the TrueType glyph cache.
+
+HEADER:
+mgraph.h
+
+PARAMETERS:
+stats   - Place to store the cache statistics
+reset   - True to reset the hit, miss and eviction counters
+
+REMARKS:
+This function returns the number of glyph cache hits, misses and evictions
+since the counters were last reset, along with the current memory usage of
+the cache. A miss is counted every time a glyph has to be rasterised. If
+reset is true, the hit, miss and eviction counters are reset back to zero
+after they are returned.
+
+SEE ALSO:
+MGL_setGlyphCacheSize, MGL_flushGlyphCache
+****************************************************************************/
+void MGLAPI MGL_getGlyphCacheStats(
+    glyphcache_stats_t *stats,
+    ibool reset)
+{
+    stats->hits = hits;
+    stats->misses = misses;
+    stats->evictions = evictions;
+    stats->bytesUsed = bytesUsed;
+    stats->maxBytes = budget;
+    stats->numGlyphs = numGlyphs;
+    stats->numPages = numPages;
+    if (reset)
+        hits = misses = evictions = 0;
+}
+
+/****************************************************************************
+REMARKS:
+Frees all the memory used by the glyph cache when the MGL is shut down.
+{secret}
+****************************************************************************/
+void _MGL_destroyGlyphCache(void)
+{
+    MGL_flushGlyphCache();
+    if (hashTable) {
+        PM_free(hashTable);
+        hashTable = NULL;
+        }
+    hashSize = 0;
+    hits = misses = evictions = 0;
+}
@@ -43,8 +43,8 @@
 /*--------------------------- Global Variables ----------------------------*/
 
 int     _VARAPI _MGL_bufSize = DEF_MGL_BUFSIZE;
-void    * _VARAPI _MGL_buf;
-int     _VARAPI __MGL_result;
+MGL_THREAD_LOCAL void * _MGL_buf;
+MGL_THREAD_LOCAL int __MGL_result;
 char    _VARAPI _MGL_path[PM_MAX_PATH] = "";
 char    fontname[PM_MAX_PATH];
 char    copyright[PM_MAX_PATH];
@@ -123,6 +123,7 @@ font_t * MGLAPI MGL_loadFontExt(
     size_t          size,allocSize;
     bitmap_font_old *oldFont = NULL;
     bitmap_font     *bitFont = NULL;
+    glyph_metrics   *m,*table;
     font_header     header;
 
     /* Try and load a Windows font file */
@@ -133,7 +134,7 @@ font_t * MGLAPI MGL_loadFontExt(
     numChars = _MAXVEC+1;
     oldFont = (bitmap_font_old*)_MGL_buf;
     size = dwSize - sizeof(font_header) - sizeof(bitmap_font_old) + _MGL_FNAMESIZE + 1;
-    allocSize = sizeof(bitmap_font) + (numChars*FONT_INDEX_SIZE) + size;
+    allocSize = sizeof(bitmap_font) + FONT_INDEX_SIZE(numChars) + size;
     if ((bitFont = PM_calloc(allocSize,1)) == NULL) {
         __MGL_result = grLoadMem;
         return NULL;
@@ -158,28 +159,29 @@ font_t * MGLAPI MGL_loadFontExt(
     bitFont->startGlyph = 0;
     bitFont->numGlyphs  = numChars;
 
-    /* Set up pointers to the tables within the allocated memory space */
-    bitFont->width = (short*)((char*)bitFont + sizeof(bitmap_font));
-    bitFont->offset = (long*)((char*)bitFont->width + bitFont->numGlyphs*sizeof(*bitFont->width));
-    bitFont->iwidth = (short*)((char*)bitFont->offset + bitFont->numGlyphs*sizeof(*bitFont->offset));
-    bitFont->loc = (short*)((char*)bitFont->iwidth + bitFont->numGlyphs*sizeof(*bitFont->iwidth));
-    bitFont->charAscent = (short*)((char*)bitFont->loc + bitFont->numGlyphs*sizeof(*bitFont->loc));
-    bitFont->charDescent = (short*)((char*)bitFont->charAscent + bitFont->numGlyphs*sizeof(*bitFont->charAscent));
-    bitFont->valid = (char*)bitFont->charDescent + bitFont->numGlyphs*sizeof(*bitFont->charDescent);
-    bitFont->def = (char*)bitFont->valid + bitFont->numGlyphs*sizeof(*bitFont->valid);
+    /* Set up pointers to the tables within the allocated memory space. The
+     * metric pages are stored in one block after the page table, followed
+     * by the glyph definitions.
+     */
+    bitFont->metrics = (glyph_metrics**)(bitFont + 1);
+    table = (glyph_metrics*)(bitFont->metrics + METRIC_PAGES(numChars));
+    for (i = 0; i < METRIC_PAGES(numChars); i++)
+        bitFont->metrics[i] = table + (i << METRIC_PAGE_SHIFT);
+    bitFont->def = (char*)(table + numChars);
 
     /* Read the bitmap definitions from disk */
     __MGL_fread(bitFont->def,1,size,f);
 
     /* Copy font index data from oldFont to our new font */
     for (i = 0; i < numChars-1; i++) {
-        bitFont->width[i] = oldFont->width[i];
-        bitFont->offset[i] = oldFont->offset[i];
-        bitFont->iwidth[i] = oldFont->iwidth[i];
-        bitFont->loc[i] = oldFont->loc[i];
-        bitFont->valid[i] = true;
-        bitFont->charAscent[i] = 0;
-        bitFont->charDescent[i] = 0;
+        m = BIT_METRICS(bitFont,i);
+        m->width = oldFont->width[i];
+        m->offset = oldFont->offset[i];
+        m->iwidth = oldFont->iwidth[i];
+        m->loc = oldFont->loc[i];
+        m->valid = true;
+        m->charAscent = 0;
+        m->charDescent = 0;
         }
 
     /* Find real point size for the font (based on the font height and
@@ -189,11 +191,8 @@ font_t * MGLAPI MGL_loadFontExt(
 
     /* Create the missing symbol definition (set it to a period) */
     i = '.';
-    bitFont->width[bitFont->numGlyphs-1] = bitFont->width[i];
-    bitFont->iwidth[bitFont->numGlyphs-1] = bitFont->iwidth[i];
-    bitFont->offset[bitFont->numGlyphs-1] = bitFont->offset[i];
-    bitFont->loc[bitFont->numGlyphs-1] = bitFont->loc[i];
-    bitFont->valid[bitFont->numGlyphs-1] = true;
+    *BIT_METRICS(bitFont,bitFont->numGlyphs-1) = *BIT_METRICS(bitFont,i);
+    BIT_METRICS(bitFont,bitFont->numGlyphs-1)->valid = true;
     return (font_t*)bitFont;
 }
 
@@ -448,8 +447,8 @@ void WriteWin2xFont(
     /* Find the size of the objects in the file */
     glyphSize = 0;
     for (i = 0; i < font->numGlyphs-1; i++) {
-        if (i > 0 && font->offset[i] != -1) {
-            width = (font->width[i]+7)/8;
+        if (i > 0 && BIT_METRICS(font,i)->offset != -1) {
+            width = (BIT_METRICS(font,i)->width+7)/8;
             gSize = width * font->fontHeight;
             glyphSize += gSize;
             }
@@ -493,7 +492,7 @@ void WriteWin2xFont(
     else {
         putLEShort(fi.ft.dfPixWidth,0);
         fi.ft.dfPitchAndFamily = 0x01;
-        putLEShort(fi.ft.dfAvgWidth,font->width['X']);
+        putLEShort(fi.ft.dfAvgWidth,BIT_METRICS(font,'X')->width);
         putLEShort(fi.ft.dfMaxWidth,font->fontWidth);
         }
     putLEShort(fi.ft.dfPixHeight,font->fontHeight);
@@ -506,7 +505,7 @@ void WriteWin2xFont(
 
     /* Build the font misc record */
     if ((font->fontType & MGL_FONTTYPEMASK) == MGL_FIXEDFONT)
-        putLEShort(fi.fm.dfWidthBytes,font->iwidth['x'-font->startGlyph]/8);
+        putLEShort(fi.fm.dfWidthBytes,BIT_METRICS(font,'x'-font->startGlyph)->iwidth/8);
     else
         putLEShort(fi.fm.dfWidthBytes,0);   //??
     putLELong(fi.fm.dfDevice,0);
@@ -522,10 +521,10 @@ void WriteWin2xFont(
     if (gOffset != bitsOffset)
         PM_fatalError("Offsets not the same!");
     for (i = 0; i < font->numGlyphs-1; i++) {
-        if (i > 0 && font->offset[i] != -1) {
-            putLEShort(g.gWidth,font->width[i]);
+        if (i > 0 && BIT_METRICS(font,i)->offset != -1) {
+            putLEShort(g.gWidth,BIT_METRICS(font,i)->width);
             putLEShort(g.gOffset,gOffset);
-            width = (font->width[i]+7)/8;
+            width = (BIT_METRICS(font,i)->width+7)/8;
             gSize = width * font->fontHeight;
             gOffset += gSize;
             }
@@ -538,12 +537,12 @@ void WriteWin2xFont(
 
     /* Write the gyph bitmaps to disk */
     for (i = 0; i < font->numGlyphs-1; i++) {
-        if (i > 0 && font->offset[i] != -1) {
-            width = (font->width[i]+7)/8;
+        if (i > 0 && BIT_METRICS(font,i)->offset != -1) {
+            width = (BIT_METRICS(font,i)->width+7)/8;
             gSize = width * font->fontHeight;
             memset(_MGL_buf,0,gSize);
-            if (font->iwidth[i])
-                swapGlyph(_MGL_buf,&font->def[font->offset[i]],(font->iwidth[i]+7)/8,font->fontHeight);
+            if (BIT_METRICS(font,i)->iwidth)
+                swapGlyph(_MGL_buf,&font->def[BIT_METRICS(font,i)->offset],(BIT_METRICS(font,i)->iwidth+7)/8,font->fontHeight);
             __MGL_fwrite(_MGL_buf,1,gSize,f);
             }
         }
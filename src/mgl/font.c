@@ -271,9 +271,7 @@ static void swapGlyph(
 /****************************************************************************
 PARAMETERS:
 bitFont     - Bitmap font to measure
-ch          - Chararacter to measure
-charAscent  - Place to store the character ascent value
-charDescent - Place to store the character descent value
+m           - Metrics for the character to measure
 
 REMARKS:
 This function finds the character ascent and descent values for a glyphs,
@@ -285,16 +283,14 @@ up font rendering.
 ****************************************************************************/
 static void getCharMetrics(
     bitmap_font *bitFont,
-    int glyph,
-    short *charAscent,
-    short *charDescent)
+    glyph_metrics *m)
 {
     int     i,j,offset,dx,byteWidth,fontAscent;
     uchar   *bytes;
 
     /* Find the address of our glyph in the font tables */
-    byteWidth = (bitFont->iwidth[glyph] + 7) / 8;
-    offset = bitFont->offset[glyph];
+    byteWidth = (m->iwidth + 7) / 8;
+    offset = m->offset;
     bytes = (uchar*)&bitFont->def[offset];
 
     /* Measure the char ascent value from the top of the bitFont glyph */
@@ -309,7 +305,7 @@ static void getCharMetrics(
         if (dx == true)
             break;
         }
-    *charAscent = fontAscent - i;
+    m->charAscent = fontAscent - i;
 
     /* Measure the char descent value from the bottom of the bitFont glyph */
     offset = (bitFont->fontHeight-1) * byteWidth + byteWidth-1;
@@ -323,7 +319,7 @@ static void getCharMetrics(
         if (dx == true)
             break;
         }
-    *charDescent = fontAscent - i;
+    m->charDescent = fontAscent - i;
 }
 
 /****************************************************************************
@@ -343,10 +339,11 @@ static font_t *loadWinFontFileExt(
     FILE *f,
     ulong dwOffset)
 {
-    int         i,numChars,glyphSize,offset,dpi;
-    bitmap_font *font;
-    winGLYPH    *g;
-    winFONTINFO fi;
+    int             i,numChars,glyphSize,offset,dpi;
+    bitmap_font     *font;
+    glyph_metrics   *m;
+    winGLYPH        *g;
+    winFONTINFO     fi;
 
     /* Open the font file header */
     if (!openWinFontFileExt(&fi,f,dwOffset))
@@ -358,7 +355,7 @@ static font_t *loadWinFontFileExt(
     if ((int)(sizeof(*g) * numChars) > _MGL_bufSize)
         MGL_fatalError("MGL internal buffer is too small!");
     g = _MGL_buf;
-    if ((font = PM_calloc(sizeof(bitmap_font) + (numChars*FONT_INDEX_SIZE) + glyphSize, 1)) == NULL) {
+    if ((font = PM_calloc(sizeof(bitmap_font) + FONT_INDEX_SIZE(numChars) + glyphSize, 1)) == NULL) {
         FATALERROR(grLoadMem);
         return NULL;
         }
@@ -390,14 +387,7 @@ static font_t *loadWinFontFileExt(
     font->pointSize = (getLEShort(fi.fs.dfPoints) * dpi) / 96;
 
     /* Set up pointers to the tables within the allocated memory space */
-    font->width = (short*)((char*)font + sizeof(bitmap_font));
-    font->offset = (long*)((char*)font->width + font->numGlyphs*sizeof(*font->width));
-    font->iwidth = (short*)((char*)font->offset + font->numGlyphs*sizeof(*font->offset));
-    font->loc = (short*)((char*)font->iwidth + font->numGlyphs*sizeof(*font->iwidth));
-    font->charAscent = (short*)((char*)font->loc + font->numGlyphs*sizeof(*font->loc));
-    font->charDescent = (short*)((char*)font->charAscent + font->numGlyphs*sizeof(*font->charAscent));
-    font->valid = (char*)font->charDescent + font->numGlyphs*sizeof(*font->charDescent);
-    font->def = (uchar*)font->valid + font->numGlyphs*sizeof(*font->valid);
+    font->def = _MGL_initGlyphMetrics(font,false);
 
     /* Read the glyph table from disk */
     __MGL_fseek(f,sizeof(winFONTINFO) + dwOffset,SEEK_SET);
@@ -408,30 +398,30 @@ static font_t *loadWinFontFileExt(
     __MGL_fread(font->def,1,glyphSize,f);
 
     for (i = offset = 0; i < font->numGlyphs-1; i++) {
-        font->width[i] = getLEShort(g[i].gWidth);
-        font->iwidth[i] = font->width[i];
-        font->offset[i] = offset;
-        font->valid[i] = true;
-        if (font->width[i] == 0) {
+        m = BIT_METRICS(font,i);
+        m->width = getLEShort(g[i].gWidth);
+        m->iwidth = m->width;
+        m->offset = offset;
+        m->valid = true;
+        if (m->width == 0) {
             /* Missing symbol */
-            font->offset[i] = -1;
-            font->charAscent[i] = 0;
-            font->charDescent[i] = 0;
+            m->offset = -1;
+            m->charAscent = 0;
+            m->charDescent = 0;
             }
         else
-            getCharMetrics(font,i,&font->charAscent[i],&font->charDescent[i]);
-        font->loc[i] = 0;
-        swapGlyph(font->def+offset,(font->iwidth[i]+7)/8,font->fontHeight);
+            getCharMetrics(font,m);
+        m->loc = 0;
+        swapGlyph(font->def+offset,(m->iwidth+7)/8,font->fontHeight);
         offset += (getLEShort(g[i+1].gOffset) - getLEShort(g[i].gOffset));
         }
 
     /* Create the missing symbol definition */
     i = '.' - fi.fc.dfFirstChar;
-    font->width[font->numGlyphs-1] = font->width[i];
-    font->iwidth[font->numGlyphs-1] = font->iwidth[i];
-    font->offset[font->numGlyphs-1] = font->offset[i];
-    font->loc[font->numGlyphs-1] = font->loc[i];
-    font->valid[font->numGlyphs-1] = true;
+    m = BIT_METRICS(font,font->numGlyphs-1);
+    *m = *BIT_METRICS(font,i);
+    m->charAscent = m->charDescent = 0;
+    m->valid = true;
     return (font_t*)font;
 }
 
@@ -470,6 +460,7 @@ font_t * MGLAPI MGL_loadFontExt(
     vec_font        *vecFont;
     bitmap_font_old *oldFont;
     bitmap_font     *bitFont;
+    glyph_metrics   *m;
     font_header     header;
 
     /* Try and load a Windows font file */
@@ -529,7 +520,7 @@ font_t * MGLAPI MGL_loadFontExt(
         numChars = _MAXVEC+1;
         oldFont = (bitmap_font_old*)font;
         size = dwSize - sizeof(font_header) - sizeof(bitmap_font_old) + _MGL_FNAMESIZE + 1;
-        allocSize = sizeof(bitmap_font) + (numChars*FONT_INDEX_SIZE) + size;
+        allocSize = sizeof(bitmap_font) + FONT_INDEX_SIZE(numChars) + size;
         if ((bitFont = PM_calloc(allocSize,1)) == NULL) {
             FATALERROR(grLoadMem);
             return NULL;
@@ -563,31 +554,25 @@ font_t * MGLAPI MGL_loadFontExt(
         bitFont->numGlyphs  = numChars;
 
         /* Set up pointers to the tables within the allocated memory space */
-        bitFont->width = (short*)((char*)bitFont + sizeof(bitmap_font));
-        bitFont->offset = (long*)((char*)bitFont->width + bitFont->numGlyphs*sizeof(*bitFont->width));
-        bitFont->iwidth = (short*)((char*)bitFont->offset + bitFont->numGlyphs*sizeof(*bitFont->offset));
-        bitFont->loc = (short*)((char*)bitFont->iwidth + bitFont->numGlyphs*sizeof(*bitFont->iwidth));
-        bitFont->charAscent = (short*)((char*)bitFont->loc + bitFont->numGlyphs*sizeof(*bitFont->loc));
-        bitFont->charDescent = (short*)((char*)bitFont->charAscent + bitFont->numGlyphs*sizeof(*bitFont->charAscent));
-        bitFont->valid = (char*)bitFont->charDescent + bitFont->numGlyphs*sizeof(*bitFont->charDescent);
-        bitFont->def = (uchar*)bitFont->valid + bitFont->numGlyphs*sizeof(*bitFont->valid);
+        bitFont->def = _MGL_initGlyphMetrics(bitFont,false);
 
         /* Read the bitmap definitions from disk */
         __MGL_fread(bitFont->def,1,size,f);
 
         /* Copy font index data from oldFont to our new font */
         for (i = 0; i < numChars-1; i++) {
-            bitFont->width[i] = oldFont->width[i];
-            bitFont->offset[i] = oldFont->offset[i];
-            bitFont->iwidth[i] = oldFont->iwidth[i];
-            bitFont->loc[i] = oldFont->loc[i];
-            bitFont->valid[i] = true;
-            if (bitFont->offset[i] == -1) {
-                bitFont->charAscent[i] = 0;
-                bitFont->charDescent[i] = 0;
+            m = BIT_METRICS(bitFont,i);
+            m->width = oldFont->width[i];
+            m->offset = oldFont->offset[i];
+            m->iwidth = oldFont->iwidth[i];
+            m->loc = oldFont->loc[i];
+            m->valid = true;
+            if (m->offset == -1) {
+                m->charAscent = 0;
+                m->charDescent = 0;
                 }
             else
-                getCharMetrics(bitFont,i,&bitFont->charAscent[i],&bitFont->charDescent[i]);
+                getCharMetrics(bitFont,m);
             }
 
         /* Find real point size for the font (based on the font height and
@@ -597,11 +582,10 @@ font_t * MGLAPI MGL_loadFontExt(
 
         /* Create the missing symbol definition (set it to a period) */
         i = '.';
-        bitFont->width[bitFont->numGlyphs-1] = bitFont->width[i];
-        bitFont->iwidth[bitFont->numGlyphs-1] = bitFont->iwidth[i];
-        bitFont->offset[bitFont->numGlyphs-1] = bitFont->offset[i];
-        bitFont->loc[bitFont->numGlyphs-1] = bitFont->loc[i];
-        bitFont->valid[bitFont->numGlyphs-1] = true;
+        m = BIT_METRICS(bitFont,bitFont->numGlyphs-1);
+        *m = *BIT_METRICS(bitFont,i);
+        m->charAscent = m->charDescent = 0;
+        m->valid = true;
         bitFont->antialiased = false;
         return (font_t*)bitFont;
         }
@@ -718,10 +702,10 @@ void MGLAPI MGL_unloadFont(
     font_t *font)
 {
     if (font) {
-        if ((font->fontType & MGL_FONTTYPEMASK) != MGL_VECTORFONT) {
-            if (BITFONT(font)->lib && BITFONT(font)->lib->fontLibType == MGL_TRUETYPEFONT_LIB)
-                PM_free(BITFONT(font)->def);
-            }
+        _MGL_flushTextRuns(font);
+        _MGL_flushCachedGlyphs(font);
+        if ((font->fontType & MGL_FONTTYPEMASK) != MGL_VECTORFONT)
+            _MGL_freeGlyphMetrics(BITFONT(font));
         PM_free(font);
         }
 }
@@ -1194,6 +1178,7 @@ static font_t * loadTTFontInstance(
     ushort              platform,encoding,charMapIdx,idx;
     tt_font_lib         *lib = (tt_font_lib*)fontlib;
     bitmap_font         tmp,*font;
+    glyph_metrics       *m;
     TT_Face_Properties  props;
     TT_Instance_Metrics metrics;
     TT_Glyph            glyph;
@@ -1266,32 +1251,17 @@ static font_t * loadTTFontInstance(
     /* Increment the number of glyphs to account for the missing symbol */
     tmp.numGlyphs++;
 
-    /* Check _MGL_bufSize for enough memory in temporary buffer */
-    if ((int)(tmp.numGlyphs*FONT_INDEX_SIZE) > _MGL_bufSize) {
-        FATALERROR(grLoadMem);
-        return NULL;
-        }
-
-    /* Set up temporary pointer in _MGL_buf */
-    tmp.width = (short*)((char*)_MGL_buf);
-    tmp.offset = (long*)((char*)tmp.width + tmp.numGlyphs*sizeof(*tmp.width));
-    tmp.iwidth = (short*)((char*)tmp.offset + tmp.numGlyphs*sizeof(*tmp.offset));
-    tmp.loc = (short*)((char*)tmp.iwidth + tmp.numGlyphs*sizeof(*tmp.iwidth));
-    tmp.charAscent = (short*)((char*)tmp.loc + tmp.numGlyphs*sizeof(*tmp.loc));
-    tmp.charDescent = (short*)((char*)tmp.charAscent + tmp.numGlyphs*sizeof(*tmp.charAscent));
-    tmp.valid = (char*)tmp.charDescent + tmp.numGlyphs*sizeof(*tmp.charDescent);
-
-    /* Loop through all glyphs marking them as invalid. We don't actually
-     * load and rasterise the glyphs until they are needed.
+    /* We don't actually load and rasterise the glyphs until they are
+     * needed, so the maximum width is found as the glyphs are generated.
      */
-    maxWidth = 0;
-    for (i = 0; i < tmp.numGlyphs-1; i++)
-        tmp.valid[i] = false;
     TT_Done_Glyph(glyph);
-    tmp.maxWidth = maxWidth;
+    tmp.maxWidth = 0;
 
-    /* Allocate memory for the font file */
-    if ((font = PM_calloc(sizeof(bitmap_font) + (tmp.numGlyphs*FONT_INDEX_SIZE), 1)) == NULL) {
+    /* Allocate memory for the font file. The glyph metric pages are only
+     * allocated as the glyphs are used, so we only need space for the
+     * table of page pointers.
+     */
+    if ((font = PM_calloc(sizeof(bitmap_font) + METRIC_PAGES(tmp.numGlyphs)*sizeof(glyph_metrics*), 1)) == NULL) {
         FATALERROR(grLoadMem);
         return NULL;
         }
@@ -1299,27 +1269,13 @@ static font_t * loadTTFontInstance(
     /* Copy the TEMP header information to the MGL font header */
     *font = tmp;
 
-    if ((font->def = PM_calloc(4096, 1)) == NULL) {
-        FATALERROR(grLoadMem);
-        return NULL;
-        }
-    font->bitmapBufferUsed = 0;
-    font->bitmapBufferSize = 4096;
-
     /* Set up pointers to the tables within the allocated memory space */
     font->pointSize = (int)(pointSize+0.5);
-    font->width = (short*)((char*)font + sizeof(bitmap_font));
-    font->offset = (long*)((char*)font->width + font->numGlyphs*sizeof(*font->width));
-    font->iwidth = (short*)((char*)font->offset + font->numGlyphs*sizeof(*font->offset));
-    font->loc = (short*)((char*)font->iwidth + font->numGlyphs*sizeof(*font->iwidth));
-    font->charAscent = (short*)((char*)font->loc + font->numGlyphs*sizeof(*font->loc));
-    font->charDescent = (short*)((char*)font->charAscent + font->numGlyphs*sizeof(*font->charAscent));
-    font->valid = (char*)font->charDescent + font->numGlyphs*sizeof(*font->charDescent);
-    /* Font->def is defined above as ttf now uses 2 seperate areas */
+    font->charSize = (long)(pointSize*64);
+    _MGL_initGlyphMetrics(font,true);
+    /* The glyph bitmaps are stored in the shared glyph cache */
+    font->def = NULL;
     font->lib = (bitmap_font_lib*)fontlib;
-
-    /* Copy the font table data from _MGL_buf */
-    memcpy(font->width,_MGL_buf,font->numGlyphs*FONT_INDEX_SIZE);
     memcpy(font->name,fontlib->name,sizeof(font->name));
 
     /* Copy TrueType instance to font */
@@ -1329,13 +1285,12 @@ static font_t * loadTTFontInstance(
      * not defined yet, since the character '.' may not exist
      * within the font
      */
-    font->iwidth[BIT_MISSINGSYMBOL(font)] = 0;
-    font->width[BIT_MISSINGSYMBOL(font)] = 0;
-    font->offset[BIT_MISSINGSYMBOL(font)] = 0;
-    font->loc[BIT_MISSINGSYMBOL(font)] = 0;
-    font->charAscent[BIT_MISSINGSYMBOL(font)] = 0;
-    font->charDescent[BIT_MISSINGSYMBOL(font)] = 0;
-    font->valid[BIT_MISSINGSYMBOL(font)] = true;
+    if ((m = _MGL_allocGlyphMetrics(font,BIT_MISSINGSYMBOL(font))) == NULL) {
+        PM_free(font);
+        FATALERROR(grLoadMem);
+        return NULL;
+        }
+    m->valid = true;
     return (font_t*)font;
 }
 
@@ -1412,8 +1367,10 @@ void MGLAPI MGL_closeFontLib(
     font_lib_t *lib)
 {
     if (lib) {
-        if (lib->fontLibType == MGL_TRUETYPEFONT_LIB)
+        if (lib->fontLibType == MGL_TRUETYPEFONT_LIB) {
+            _MGL_flushCachedGlyphs(lib);
             TT_Close_Face(((tt_font_lib*)lib)->face);
+            }
         if (lib->ownHandle)
             __MGL_fclose(lib->f);
         PM_free(lib);
@@ -51,32 +51,80 @@ static fontEnumCache     *_MGL_fontEnumCache = NULL;
 
 /*------------------------- Implementation --------------------------------*/
 
-#define CACHE_FILE           "fntcache.inf"
+#define CACHE_FILE           "fntcache.dat"
+#define CACHE_MAGIC          0x4346474DUL
+#define CACHE_VERSION        1
 #define CACHE_BLOCK_SIZE     32
-#define CACHE_LINE_SIZE      512
+#define MIN_PARALLEL_FILES   64
+#define MAX_FACE_NAME        256        /* Size of the font_info_t faces */
+
+#define CACHE_BOLD           0x01
+#define CACHE_ITALIC         0x02
+#define CACHE_FIXED          0x04
+
+/* {secret} */
+typedef struct {
+    M_uint32       magic;          /* Identifies the file and byte order   */
+    M_uint32       version;        /* Version of the cache file format     */
+    M_uint32       numFiles;       /* Number of font file records          */
+    M_uint32       stringSize;     /* Size of the string table in bytes    */
+    } cacheHeader;
+
+/* {secret} */
+typedef struct {
+    M_int32        fileSize;       /* Size of the font file                */
+    M_int32        fileTime;       /* Modification time of the font file   */
+    M_uint32       fileName;       /* Offset of file name in string table  */
+    M_uint32       familyName;     /* Offset of family name in string table*/
+    uchar          fontLibType;    /* Font library type                    */
+    uchar          flags;          /* CACHE_BOLD, CACHE_ITALIC etc         */
+    uchar          res[2];
+    } cacheRecord;
 
 /* {secret} */
 typedef struct {
     char           *fileName;
     short          fontLibType;
     char           *familyName;
+    M_int32        fileSize;
+    M_int32        fileTime;
     ibool          isBold;
     ibool          isItalic;
     ibool          isFixed;
     ibool          exists;
+    ibool          ownStrings;
     } fileCache;
 
 /* {secret} */
 typedef struct {
-#if 0 // TODO: missing PM_getFileTime under Unix and DOS
-    PM_time        timestamp;
-#endif
     size_t         filesCnt;
     size_t         validCnt;
     size_t         filesBlocks;
     fileCache      *files;
+    fileCache      **byFamily;
+    char           *strings;
+    ibool          dirty;
     } dirCache;
 
+/* {secret} */
+typedef struct {
+    char           *fileName;
+    int            entry;
+    M_int32        fileSize;
+    M_int32        fileTime;
+    ibool          changed;
+    ibool          checked;
+    } scanFile;
+
+/* {secret} */
+typedef struct {
+    const char     *path;
+    dirCache       *cache;
+    size_t         filesCnt;
+    size_t         filesBlocks;
+    scanFile       *files;
+    } dirScan;
+
 static int comparFileCache(
     const void *i1,
     const void *i2)
@@ -88,7 +136,13 @@ static int comparFileCacheByFamily(
     const void *i1,
     const void *i2)
 {
-    return strcmp(((fileCache*)i1)->familyName, ((fileCache*)i2)->familyName);
+    fileCache   *f1 = *(fileCache**)i1;
+    fileCache   *f2 = *(fileCache**)i2;
+    int         cmp;
+
+    if ((cmp = strcmp(f1->familyName, f2->familyName)) != 0)
+        return cmp;
+    return strcmp(f1->fileName, f2->fileName);
 }
 
 static int searchFileCache(
@@ -98,6 +152,24 @@ static int searchFileCache(
     return strcmp((const char*)key, ((fileCache*)item)->fileName);
 }
 
+/****************************************************************************
+PARAMETERS:
+file    - cache entry to free
+
+REMARKS:
+Frees the strings for a cache entry, unless they live in the string table
+loaded from the cache file.
+{secret}
+****************************************************************************/
+static void freeFileCache(
+    fileCache *file)
+{
+    if (file->ownStrings) {
+        PM_free(file->fileName);
+        PM_free(file->familyName);
+        }
+}
+
 /****************************************************************************
 PARAMETERS:
 cache   - cache to free
@@ -111,141 +183,210 @@ static void freeFontCache(
 {
     size_t i;
 
-    for (i = 0; i < cache->filesCnt; i++) {
-        PM_free(cache->files[i].fileName);
-        PM_free(cache->files[i].familyName);
-        }
+    for (i = 0; i < cache->filesCnt; i++)
+        freeFileCache(&cache->files[i]);
     PM_free(cache->files);
+    PM_free(cache->byFamily);
+    PM_free(cache->strings);
 }
 
 /****************************************************************************
 PARAMETERS:
-dir   - path to look for fntcache.inf in
+cache   - cache to build the family index for
+
+REMARKS:
+Builds the index of the cache entries sorted by family name, which is used
+to merge the faces of each family together. Entries with the same family
+are sorted by file name so the index is the same every time it is built.
+{secret}
+****************************************************************************/
+static void sortFontCacheByFamily(
+    dirCache *cache)
+{
+    size_t i;
+
+    PM_free(cache->byFamily);
+    cache->byFamily = NULL;
+    if (cache->filesCnt == 0)
+        return;
+    if ((cache->byFamily = PM_malloc(sizeof(fileCache*) * cache->filesCnt)) == NULL)
+        FATALERROR(grNoMem);
+    for (i = 0; i < cache->filesCnt; i++)
+        cache->byFamily[i] = &cache->files[i];
+    qsort(cache->byFamily, cache->filesCnt, sizeof(fileCache*),
+          comparFileCacheByFamily);
+}
+
+/****************************************************************************
+PARAMETERS:
+dir   - path to look for fntcache.dat in
 cache - cache structure to save loaded data to
 
 REMARKS:
-Initializes dirCache structure and tries to load fntcache.inf file from
-given directory. Silently fails if such file does not exist.
-
-fntcache.inf is text file in the following format: first line contains
-number of entries in decimal format, which indicates the number of file lines
-to follow. Each file line contains three column delimined by '\t'. Font file
-name is in the first column. Second column has fixed "T-F-B-I" format where
-T is '0', '1' or '2' (as numerical values of MGL_fontLibType are), F is
-'f' for fixed size fonts and 'p' for proportional, B is
-'b' for bold face and 'n' otherwise and I is 'i' for italic face and 'n'
-otherwise. Third column contains family name.
-
-The cache is sorted alphabetically by file name.
-
-Example file:
-9
-1979rg__.ttf    1-p-n-n 1979
-1stgrade.ttf    1-p-n-n FirstGrader-Normal
-39smooth.ttf    1-p-n-n 39 Smooth
-7hours.ttf      1-p-n-n 7 hours
-Scot000.ttf     1-p-n-n Scott
-verdana.ttf     1-p-n-n Verdana
-verdanab.ttf    1-p-b-n Verdana
-verdanai.ttf    1-p-n-i Verdana
-verdanaz.ttf    1-p-b-i Verdana
+Initializes dirCache structure and tries to load fntcache.dat file from
+given directory. Silently fails if such file does not exist, or if it is
+not a valid cache file for this version of the MGL.
+
+fntcache.dat is a binary file in native byte order. It starts with a
+cacheHeader structure, followed by one cacheRecord for every font file in
+the directory sorted by file name. After the records is an index of the
+record numbers sorted by family name, stored as 32-bit values, and then
+the string table holding the zero terminated file and family names. The
+records store the size and modification time of each font file, so that
+only the files that have changed need to be opened again.
+
+The whole string table is loaded as a single block and the cache entries
+point directly into it, so loading the cache only needs a few reads and
+memory allocations regardless of the number of fonts.
 {secret}
 ****************************************************************************/
 static void loadFontCache(
     const char *dir,
     dirCache *cache)
 {
-    char       filename[PM_MAX_PATH];
-    char       buf[CACHE_LINE_SIZE];
-    char       *c1, *c2;
-    char       bufType, bufFixed, bufBold, bufItalic;
-    fileCache  *file;
-    FILE       *f;
-    size_t     i;
+    char        filename[PM_MAX_PATH];
+    cacheHeader hdr;
+    cacheRecord *recs = NULL;
+    M_uint32    *index = NULL;
+    uchar       *seen = NULL;
+    fileCache   *file;
+    FILE        *f;
+    long        fileSize;
+    size_t      i,n;
 
     /* empty cache: */
     cache->filesCnt = 0;
     cache->validCnt = 0;
     cache->filesBlocks = 0;
     cache->files = NULL;
+    cache->byFamily = NULL;
+    cache->strings = NULL;
+    cache->dirty = true;
 
     /* try to load fonts cache file from directory, silently fail
        if it doesn't exist: */
     strcpy(filename, dir);
     PM_backslash(filename);
     strcat(filename, CACHE_FILE);
-    f = __MGL_fopen(filename, "rt");
+    f = __MGL_fopen(filename, "rb");
     if (f == NULL)
         return;
-#if 0 // TODO: missing PM_getFileTime under Unix and DOS
-    PM_getFileTime(filename, true, &cache->timestamp);
-#endif
-    if (fgets(buf, CACHE_LINE_SIZE, f) == NULL) {
+
+    /* check that the cache is valid and is not truncated. The counts are
+       bounded by the file size first, so the size check cannot overflow: */
+    fileSize = _MGL_fileSize(f);
+    if (fileSize < (long)sizeof(hdr) ||
+        __MGL_fread(&hdr, 1, sizeof(hdr), f) != sizeof(hdr) ||
+        hdr.magic != CACHE_MAGIC || hdr.version != CACHE_VERSION ||
+        hdr.numFiles == 0 || hdr.stringSize == 0 ||
+        hdr.numFiles > (ulong)fileSize / (sizeof(cacheRecord) + sizeof(M_uint32)) ||
+        hdr.stringSize > (ulong)fileSize ||
+        fileSize != (long)(sizeof(hdr) + hdr.stringSize +
+            hdr.numFiles * (sizeof(cacheRecord) + sizeof(M_uint32)))) {
         __MGL_fclose(f);
         return;
         }
 
-    /* get number of items in the cache:  */
-    if (sscanf(buf, "%li", &cache->filesCnt) != 1 ||
-        cache->filesCnt == 0) {
-        __MGL_fclose(f);
-        return;
+    /* read the records, family index and string table: */
+    n = hdr.numFiles;
+    recs = PM_malloc(sizeof(cacheRecord) * n);
+    index = PM_malloc(sizeof(M_uint32) * n);
+    cache->strings = PM_malloc(hdr.stringSize);
+    if (!recs || !index || !cache->strings)
+        FATALERROR(grNoMem);
+    if (__MGL_fread(recs, sizeof(cacheRecord), n, f) != n ||
+        __MGL_fread(index, sizeof(M_uint32), n, f) != n ||
+        __MGL_fread(cache->strings, 1, hdr.stringSize, f) != hdr.stringSize ||
+        cache->strings[hdr.stringSize-1] != '\0')
+        goto Error;
+
+    /* check that the names fit in the font enumeration records and that
+       the family index is a permutation of the records: */
+    if ((seen = PM_calloc(n, 1)) == NULL)
+        FATALERROR(grNoMem);
+    for (i = 0; i < n; i++) {
+        if (recs[i].fileName >= hdr.stringSize ||
+            recs[i].familyName >= hdr.stringSize || index[i] >= n ||
+            seen[index[i]])
+            goto Error;
+        if (strlen(cache->strings + recs[i].fileName) >= MAX_FACE_NAME ||
+            strlen(cache->strings + recs[i].familyName) >= _MGL_FNAMESIZE)
+            goto Error;
+        seen[index[i]] = true;
         }
+    PM_free(seen);
 
-    cache->filesBlocks = ((cache->filesCnt - 1) / CACHE_BLOCK_SIZE) + 1;
+    cache->filesBlocks = ((n - 1) / CACHE_BLOCK_SIZE) + 1;
     cache->files =
         PM_malloc(sizeof(fileCache) * cache->filesBlocks * CACHE_BLOCK_SIZE);
-    if (cache->files == NULL)
+    cache->byFamily = PM_malloc(sizeof(fileCache*) * n);
+    if (cache->files == NULL || cache->byFamily == NULL)
         FATALERROR(grNoMem);
-
-    /* read entries. Each font file has one entry, there's one entry per
-       line. The cache is sorted alphabetically by filename. */
-    for (i = 0; i < cache->filesCnt; i++) {
+    for (i = 0; i < n; i++) {
         file = cache->files + i;
+        file->fileName = cache->strings + recs[i].fileName;
+        file->familyName = cache->strings + recs[i].familyName;
+        file->fontLibType = recs[i].fontLibType;
+        file->fileSize = recs[i].fileSize;
+        file->fileTime = recs[i].fileTime;
+        file->isBold = (recs[i].flags & CACHE_BOLD) != 0;
+        file->isItalic = (recs[i].flags & CACHE_ITALIC) != 0;
+        file->isFixed = (recs[i].flags & CACHE_FIXED) != 0;
         file->exists = false;
-        if (fgets(buf, CACHE_LINE_SIZE, f) == NULL) {
-            cache->filesCnt = i;
-            __MGL_fclose(f);
-            return;
-            }
-
-        c1 = buf;
-        for (c2 = c1; *c2 != '\0' && *c2 != '\t'; c2++) {}
-        *c2 = '\0';
-        if ((file->fileName = PM_malloc(strlen(c1) + 1)) == NULL)
-            FATALERROR(grNoMem);
-        strcpy(file->fileName, c1);
-
-        c1 = c2 + 1;
-        for (c2 = c1; *c2 != '\0' && *c2 != '\t'; c2++) {}
-        *c2 = '\0';
-        if (sscanf(c1, "%c-%c-%c-%c",
-                   &bufType, &bufFixed, &bufBold, &bufItalic) != 4)
-            continue;
-        file->isBold = (bufBold == 'b');
-        file->isItalic = (bufItalic == 'i');
-        file->isFixed = (bufFixed == 'f');
-        file->fontLibType = bufType - '0';
-
-        c1 = c2 + 1;
-        for (c2 = c1; *c2 != '\0'; c2++)
-            if (*c2 == '\n' || *c2 == '\r') *c2 = '\0';
-        if ((file->familyName = PM_malloc(strlen(c1) + 1)) == NULL)
-            FATALERROR(grNoMem);
-        strcpy(file->familyName, c1);
+        file->ownStrings = false;
+        cache->byFamily[i] = cache->files + index[i];
         }
+    cache->filesCnt = n;
+    cache->dirty = false;
+    PM_free(recs);
+    PM_free(index);
+    __MGL_fclose(f);
+    return;
+
+Error:
+    PM_free(seen);
+    PM_free(recs);
+    PM_free(index);
+    PM_free(cache->strings);
+    cache->strings = NULL;
     __MGL_fclose(f);
 }
 
+/****************************************************************************
+PARAMETERS:
+cache - cache structure to prune
+
+REMARKS:
+Removes the entries for font files that no longer exist from the cache,
+and sorts the remaining entries by file name and by family name.
+{secret}
+****************************************************************************/
+static void pruneFontCache(
+    dirCache *cache)
+{
+    size_t i,j;
+
+    for (i = j = 0; i < cache->filesCnt; i++) {
+        if (cache->files[i].exists)
+            cache->files[j++] = cache->files[i];
+        else
+            freeFileCache(&cache->files[i]);
+        }
+    cache->filesCnt = j;
+    if (cache->filesCnt > 1)
+        qsort(cache->files, cache->filesCnt, sizeof(fileCache), comparFileCache);
+    sortFontCacheByFamily(cache);
+}
 
 /****************************************************************************
 PARAMETERS:
-dir   - path to store fntcache.inf in
+dir   - path to store fntcache.dat in
 cache - cache structure to save
 
 REMARKS:
-Attempt to save fonts cache information to file fntcache.inf in the directory.
-Silently fails if the directory is not writeable.
+Attempt to save fonts cache information to file fntcache.dat in the directory.
+Silently fails if the directory is not writeable. The cache must have been
+pruned with pruneFontCache first.
 
 SEE ALSO:
 loadFontCache
@@ -255,34 +396,63 @@ static void saveFontCache(
     const char *dir,
     dirCache *cache)
 {
-    char       filename[PM_MAX_PATH];
-    FILE       *f;
-    size_t     i;
-
-    if (cache->validCnt == 0)
+    char        filename[PM_MAX_PATH];
+    char        *strings,*p;
+    cacheHeader hdr;
+    cacheRecord *recs;
+    M_uint32    *index;
+    fileCache   *file;
+    FILE        *f;
+    size_t      i,n = cache->filesCnt;
+
+    if (n == 0)
         return;
     strcpy(filename, dir);
     PM_backslash(filename);
     strcat(filename, CACHE_FILE);
-    f = __MGL_fopen(filename, "wt");
+    f = __MGL_fopen(filename, "wb");
     if (f == NULL)
         return;
 
-    qsort(cache->files, cache->filesCnt, sizeof(fileCache), comparFileCache);
-
-    fprintf(f, "%li\n", cache->validCnt);
-    for (i = 0; i < cache->filesCnt; i++) {
-        if (!cache->files[i].exists)
-            continue;
-        fprintf(f, "%s\t%c-%c-%c-%c\t%s\n",
-                    cache->files[i].fileName,
-                    cache->files[i].fontLibType + '0',
-                    cache->files[i].isFixed ? 'f' : 'p',
-                    cache->files[i].isBold ? 'b' : 'n',
-                    cache->files[i].isItalic ? 'i' : 'n',
-                    cache->files[i].familyName);
+    /* build the records and string table in memory: */
+    hdr.magic = CACHE_MAGIC;
+    hdr.version = CACHE_VERSION;
+    hdr.numFiles = n;
+    hdr.stringSize = 0;
+    for (i = 0; i < n; i++) {
+        hdr.stringSize += strlen(cache->files[i].fileName) + 1;
+        hdr.stringSize += strlen(cache->files[i].familyName) + 1;
+        }
+    recs = PM_calloc(n, sizeof(cacheRecord));
+    index = PM_malloc(sizeof(M_uint32) * n);
+    strings = PM_malloc(hdr.stringSize);
+    if (!recs || !index || !strings)
+        FATALERROR(grNoMem);
+    for (i = 0, p = strings; i < n; i++) {
+        file = &cache->files[i];
+        recs[i].fileSize = file->fileSize;
+        recs[i].fileTime = file->fileTime;
+        recs[i].fontLibType = (uchar)file->fontLibType;
+        recs[i].flags = (file->isBold ? CACHE_BOLD : 0) |
+                        (file->isItalic ? CACHE_ITALIC : 0) |
+                        (file->isFixed ? CACHE_FIXED : 0);
+        recs[i].fileName = p - strings;
+        strcpy(p, file->fileName);
+        p += strlen(p) + 1;
+        recs[i].familyName = p - strings;
+        strcpy(p, file->familyName);
+        p += strlen(p) + 1;
+        index[i] = cache->byFamily[i] - cache->files;
         }
+
+    __MGL_fwrite(&hdr, 1, sizeof(hdr), f);
+    __MGL_fwrite(recs, sizeof(cacheRecord), n, f);
+    __MGL_fwrite(index, sizeof(M_uint32), n, f);
+    __MGL_fwrite(strings, 1, hdr.stringSize, f);
     __MGL_fclose(f);
+    PM_free(recs);
+    PM_free(index);
+    PM_free(strings);
 }
 
 /****************************************************************************
@@ -307,14 +477,15 @@ static int getWidthOfChar(
                 return VECFONT(font)->width[ch];
         case MGL_PROPFONT:
             glyph = ch - BITFONT(font)->startGlyph;
-            if (!BITFONT(font)->valid[glyph] && (glyph < BITFONT(font)->numGlyphs))
-                _MGL_generateGlyph(glyph,BITFONT(font));
-            if ((BIT_ISMISSING(font,glyph)) ||
-                (ch < BITFONT(font)->startGlyph) ||
+            if ((ch < BITFONT(font)->startGlyph) ||
                 (glyph >= BITFONT(font)->numGlyphs))
-                return BITFONT(font)->width[BIT_MISSINGSYMBOL(font)];
+                return BIT_METRICS(font,BIT_MISSINGSYMBOL(font))->width;
+            if (!BIT_METRICS(font,glyph)->valid)
+                _MGL_generateGlyph(glyph,BITFONT(font));
+            if (BIT_ISMISSING(font,glyph))
+                return BIT_METRICS(font,BIT_MISSINGSYMBOL(font))->width;
             else
-                return BITFONT(font)->width[glyph];
+                return BIT_METRICS(font,glyph)->width;
         default:
             return 0;
         }
@@ -342,13 +513,13 @@ static ibool fontIsFixed(
 /****************************************************************************
 PARAMETERS:
 path        - directory with font file
-filename    - filename of the font file
+sf          - scanned font file to update the cache entry for
 cache       - local cache for one directory
 
 REMARKS:
-Updates cache entry for given font file. If such file is not in the
-cache, loads it with MGL_openFontLib and extracts information about font
-library type, family and face from it.
+Updates cache entry for a font file that is not in the cache or has changed
+since the cache was saved. Loads the file with MGL_openFontLib and extracts
+information about font library type, family and face from it.
 
 A font is marked as bold if its name ends with " Bold", as italic if it ends
 with " Italic". Suffixes are cumulative. Family name is face name with
@@ -358,72 +529,49 @@ recognized suffixes stripped off. For example, cache entry for font
 ****************************************************************************/
 static void enumFontFile(
     const char *path,
-    const char *filename,
+    scanFile *sf,
     dirCache *cache)
 {
     char          fullname[PM_MAX_PATH];
     font_lib_t    *fontLib;
     fileCache     *entry;
-    ibool         isNewer;
     ibool         foundSuffix;
-#if 0 // TODO: missing PM_getFileTime under Unix and DOS
-    PM_time       time;
-    long          ytimef, ytimec;
-#endif
     char          *buf;
     size_t        buflen;
 
     strcpy(fullname, path);
     PM_backslash(fullname);
-    strcat(fullname, filename);
-
-    /* Try to find entry in cache: */
-    entry = (fileCache*) bsearch(filename, cache->files, cache->filesCnt,
-                                    sizeof(fileCache), searchFileCache);
-
-    isNewer = (entry == NULL);
-
-#if 0 // TODO: missing PM_getFileTime under Unix and DOS
-    if (!isNewer && PM_getFileTime(fullname, true, &time)) {
-        ytimef = time.sec + 60 * (time.min + 60 * (time.hour + 24 * (time.day +
-                    31 * time.mon)));
-        ytimec = cache->timestamp.sec + 60 * (cache->timestamp.min + 60 * (
-                    cache->timestamp.hour + 24 * (cache->timestamp.day +
-                    31 * cache->timestamp.mon)));
-        isNewer = time.year > cache->timestamp.year ||
-                    (time.year == cache->timestamp.year && ytimef > ytimec);
-        }
-#endif
+    strcat(fullname, sf->fileName);
 
-    if (!isNewer) {
-        cache->validCnt++;
-        entry->exists = true;
-        return;
-        }
-
-    /* Nothing in cache, we have to open the font: */
+    /* Nothing valid in cache, we have to open the font: */
     fontLib = MGL_openFontLib(fullname);
     if (fontLib == NULL)
         return;
+    cache->dirty = true;
 
-    if (entry == NULL) {
+    if (sf->entry < 0) {
         if (cache->filesCnt % CACHE_BLOCK_SIZE == 0) {
             cache->filesBlocks++;
             cache->files = PM_realloc(cache->files,
                     sizeof(fileCache) * cache->filesBlocks * CACHE_BLOCK_SIZE);
+            if (cache->files == NULL)
+                FATALERROR(grNoMem);
             }
         entry = cache->files + cache->filesCnt;
         cache->filesCnt++;
         }
     else {
-        PM_free(entry->fileName);
-        PM_free(entry->familyName);
+        entry = cache->files + sf->entry;
+        freeFileCache(entry);
         }
 
     /* Try to determine family name and face type from facename: */
-    if ((entry->fileName = PM_malloc(strlen(filename) + 1)) == NULL)
+    if ((entry->fileName = PM_malloc(strlen(sf->fileName) + 1)) == NULL)
         FATALERROR(grNoMem);
-    strcpy(entry->fileName, filename);
+    strcpy(entry->fileName, sf->fileName);
+    entry->ownStrings = true;
+    entry->fileSize = sf->fileSize;
+    entry->fileTime = sf->fileTime;
     entry->fontLibType = fontLib->fontLibType;
     buflen = strlen(fontLib->name);
     if ((buf = PM_malloc(buflen + 1)) == NULL)
@@ -446,9 +594,9 @@ static void enumFontFile(
             }
         } while (buflen > 0 && foundSuffix);
     if (buflen == 0) {
-        if ((entry->familyName = PM_malloc(strlen(filename) + 1)) == NULL)
+        if ((entry->familyName = PM_malloc(strlen(sf->fileName) + 1)) == NULL)
             FATALERROR(grNoMem);
-        strcpy(entry->familyName, filename);
+        strcpy(entry->familyName, sf->fileName);
         }
     else {
         if ((entry->familyName = PM_malloc(strlen(buf) + 1)) == NULL)
@@ -471,21 +619,24 @@ static void enumFontFile(
 PARAMETERS:
 path        - directory to scan for fonts
 wildcard    - wildcard to match.
-cache       - local cache for one directory
+scan        - list of font files found in the directory
 
 REMARKS:
-Enumerates fonts in path matching wildard and puts information about them into
-directory cache cache.
+Enumerates fonts in path matching wildard and adds them to the list of
+files in the directory, along with the index of the cache entry for each
+file (or -1 if the file is not in the cache).
 {secret}
 ****************************************************************************/
 static void enumFontsByWildcard(
     const char *path,
     const char *wildcard,
-    dirCache *cache)
+    dirScan *scan)
 {
     char          fullwild[PM_MAX_PATH];
     PM_findData   findData;
     void          *handle;
+    fileCache     *entry;
+    scanFile      *sf;
 
     strcpy(fullwild, path);
     PM_backslash(fullwild);
@@ -497,12 +648,97 @@ static void enumFontsByWildcard(
         return;
 
     do {
-        enumFontFile(path, findData.name, cache);
+        if (scan->filesCnt % CACHE_BLOCK_SIZE == 0) {
+            scan->filesBlocks++;
+            scan->files = PM_realloc(scan->files,
+                    sizeof(scanFile) * scan->filesBlocks * CACHE_BLOCK_SIZE);
+            if (scan->files == NULL)
+                FATALERROR(grNoMem);
+            }
+        sf = scan->files + scan->filesCnt++;
+        if ((sf->fileName = PM_malloc(strlen(findData.name) + 1)) == NULL)
+            FATALERROR(grNoMem);
+        strcpy(sf->fileName, findData.name);
+        entry = NULL;
+        if (scan->cache->filesCnt)
+            entry = (fileCache*) bsearch(sf->fileName, scan->cache->files,
+                    scan->cache->filesCnt, sizeof(fileCache), searchFileCache);
+        sf->entry = entry ? (int)(entry - scan->cache->files) : -1;
+        sf->changed = true;
         } while (PM_findNextFile(handle, &findData));
 
     PM_findClose(handle);
 }
 
+/****************************************************************************
+PARAMETERS:
+scan        - directory scan the file belongs to
+sf          - scanned file to check
+statOnly    - true to only look the file up with stat
+
+REMARKS:
+Gets the size and modification time of a file, and checks them against the
+cache entry for the file. If statOnly is true and stat cannot find the
+file, the file is marked as changed and left unchecked, so that the
+calling thread can check it again with the MGL file I/O functions.
+{secret}
+****************************************************************************/
+static void checkFontFile(
+    dirScan *scan,
+    scanFile *sf,
+    ibool statOnly)
+{
+    char          fullname[PM_MAX_PATH];
+    fileCache     *entry;
+    long          fileSize,fileTime;
+
+    strcpy(fullname, scan->path);
+    PM_backslash(fullname);
+    strcat(fullname, sf->fileName);
+    if (statOnly) {
+        if (!_MGL_statFile(fullname, &fileSize, &fileTime)) {
+            sf->changed = true;
+            sf->checked = false;
+            return;
+            }
+        }
+    else if (!_MGL_getFileInfo(fullname, &fileSize, &fileTime))
+        fileSize = fileTime = 0;
+    sf->fileSize = (M_int32)fileSize;
+    sf->fileTime = (M_int32)fileTime;
+    sf->checked = true;
+    if (sf->entry >= 0) {
+        entry = scan->cache->files + sf->entry;
+        sf->changed = (entry->fileSize != sf->fileSize ||
+                       entry->fileTime != sf->fileTime);
+        }
+}
+
+/****************************************************************************
+PARAMETERS:
+ctx     - directory scan to check
+first   - index of first file to check
+last    - index after the last file to check
+
+REMARKS:
+Checks each file in the range with stat against its cache entry. This is
+called in parallel by the band worker threads for large directories, so it
+only touches the scanned files in the range, does not modify the cache and
+does not call the MGL file I/O functions.
+{secret}
+****************************************************************************/
+static void checkFontFiles(
+    void *ctx,
+    int first,
+    int last)
+{
+    dirScan       *scan = ctx;
+    int           i;
+
+    for (i = first; i < last; i++)
+        checkFontFile(scan, scan->files + i, true);
+}
+
 /****************************************************************************
 PARAMETERS:
 dcache  - local cache for one directory
@@ -512,7 +748,7 @@ REMARKS:
 Extracts information from dcache and translates it to cache.
 
 This involves finding fonts with same family name and merging them into
-one entry in cache.
+one entry in cache, which is done by walking the family index.
 
 Called exclusively by enumFontsInDir.
 {secret}
@@ -527,11 +763,14 @@ static void buildFontEnumCache(
 
     if (dcache->filesCnt == 0)
         return;
-    qsort(dcache->files, dcache->filesCnt, sizeof(fileCache),
-          comparFileCacheByFamily);
+    if (dcache->byFamily == NULL)
+        sortFontCacheByFamily(dcache);
 
     tail = ecache = NULL;
-    for (i = 0, f = dcache->files; i < dcache->filesCnt; i++, f++) {
+    for (i = 0; i < dcache->filesCnt; i++) {
+        f = dcache->byFamily[i];
+        if (!f->exists)
+            continue;
         /* new family: */
         if (tail == NULL ||
                     strcmp(tail->info.familyName, f->familyName) != 0) {
@@ -563,6 +802,8 @@ static void buildFontEnumCache(
         else if (f->isBold && f->isItalic)
             strcpy(tail->info.boldItalicFace, f->fileName);
         }
+    if (tail == NULL)
+        return;
 
     tail->next = *cache;
     *cache = ecache;
@@ -574,9 +815,15 @@ path    - directory to scan for fonts
 cache   - pointer to variable that holds list of found families
 
 REMARKS:
-Scans given directory for fonts, taking advantage of fntcache.inf if present
+Scans given directory for fonts, taking advantage of fntcache.dat if present
 and updating it if the directory is writeable. Updates linked list pointed
 to by cache argument by prepending information about fonts in path to it.
+
+Only the font files that are not in the cache, or whose size or
+modification time has changed, are opened. For large directories the file
+checks are split across the band worker threads, while the fonts that need
+to be opened are always processed on the calling thread. The cache file is
+only written if something in the directory has changed.
 {secret}
 ****************************************************************************/
 static void enumFontsInDir(
@@ -584,14 +831,49 @@ static void enumFontsInDir(
     fontEnumCache **cache)
 {
     dirCache       dcache;
+    dirScan        scan;
+    size_t         i;
 
     /* get list of all fonts in directory: */
     loadFontCache(path, &dcache);
-    enumFontsByWildcard(path, "*.ttf", &dcache);
-    enumFontsByWildcard(path, "*.fon", &dcache);
+    scan.path = path;
+    scan.cache = &dcache;
+    scan.filesCnt = 0;
+    scan.filesBlocks = 0;
+    scan.files = NULL;
+    enumFontsByWildcard(path, "*.ttf", &scan);
+    enumFontsByWildcard(path, "*.fon", &scan);
+
+    /* check which files have changed since the cache was saved. Files that
+       stat cannot find are checked again here on the calling thread: */
+    if (scan.filesCnt >= MIN_PARALLEL_FILES)
+        _MGL_runBands(0, (int)scan.filesCnt, checkFontFiles, &scan);
+    else
+        checkFontFiles(&scan, 0, (int)scan.filesCnt);
+    for (i = 0; i < scan.filesCnt; i++) {
+        if (!scan.files[i].checked)
+            checkFontFile(&scan, &scan.files[i], false);
+        }
+
+    /* open the new and changed files: */
+    for (i = 0; i < scan.filesCnt; i++) {
+        if (scan.files[i].changed)
+            enumFontFile(path, &scan.files[i], &dcache);
+        else {
+            dcache.files[scan.files[i].entry].exists = true;
+            dcache.validCnt++;
+            }
+        PM_free(scan.files[i].fileName);
+        }
+    PM_free(scan.files);
 
     /* save the cache back (if directory is writeable): */
-    saveFontCache(path, &dcache);
+    if (dcache.validCnt != dcache.filesCnt)
+        dcache.dirty = true;
+    if (dcache.dirty) {
+        pruneFontCache(&dcache);
+        saveFontCache(path, &dcache);
+        }
 
     /* Build font enum cache from dir one: */
     buildFontEnumCache(&dcache, cache);
@@ -686,10 +968,12 @@ This function will scan directories for fonts when called for the first time.
 All subsequent calls are more efficient, because MGL_enumerateFonts will use
 font cache stored in memory.
 
-MGL_enumerateFonts will attempt to create file named fntcache.inf in
+MGL_enumerateFonts will attempt to create file named fntcache.dat in
 directories it scans for fonts. This file contains information about all
 fonts in the directory and will subsequently be used to further speed up
-fonts enumeration.
+fonts enumeration. The size and modification time of every font file is
+stored in the cache, so only fonts that have been added or changed since
+the cache was written need to be opened again.
 
 SEE ALSO:
 font_info_t
@@ -444,14 +444,14 @@ void MGLAPI MGL_drawGlyph(
     uchar glyph)
 {
     rect_t  d,r,clip;
-    int     offset,width,byteWidth,height = font->fontHeight;
+    int     index = glyph,width,byteWidth,height = font->fontHeight;
     uchar   *bytes;
 
     /* Find the height of the glyph */
-    if ((width = BITFONT(font)->iwidth[glyph]) != 0) {
-        if ((offset = BITFONT(font)->offset[glyph]) == -1) {
-            offset = BITFONT(font)->offset[BIT_MISSINGSYMBOL(font)];
-            width = BITFONT(font)->iwidth[BIT_MISSINGSYMBOL(font)];
+    if ((width = BIT_METRICS(font,glyph)->iwidth) != 0) {
+        if (BIT_ISMISSING(font,glyph)) {
+            index = BIT_MISSINGSYMBOL(font);
+            width = BIT_METRICS(font,index)->iwidth;
             }
 
         /* Clip to destination device context */
@@ -462,9 +462,19 @@ void MGLAPI MGL_drawGlyph(
             END_VISIBLE_CLIP_LIST(&DC);
             return;
             }
+        MARK_DIRTY_VIEW(&DC,r.left,r.top,r.right,r.bottom);
 
         /* Now draw the glyph */
-        bytes = (uchar *)&BITFONT(font)->def[offset];
+        if ((bytes = _MGL_getGlyphBitmap(BITFONT(font),index)) == NULL) {
+            END_VISIBLE_CLIP_LIST(&DC);
+            return;
+            }
+        if (BITFONT(font)->antialiased) {
+            /* Anti-aliased glyphs are stored as 8-bit coverage values */
+            _MGL_drawAntiAliasedGlyph(x+DC.viewPort.left,y+DC.viewPort.top,width,height,bytes);
+            END_VISIBLE_CLIP_LIST(&DC);
+            return;
+            }
         byteWidth = (width + 7) >> 3;
         if (DC.clipRegionScreen) {
             /* Draw it clipped to a complex clip region */
@@ -523,7 +533,7 @@ int MGLAPI MGL_getGlyphWidth(
     font_t *font,
     uchar glyph)
 {
-    return BITFONT(font)->iwidth[glyph];
+    return BIT_METRICS(font,glyph)->iwidth;
 }
 
 /****************************************************************************
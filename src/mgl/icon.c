@@ -290,10 +290,8 @@ icon_t * MGLAPI MGL_loadIcon(
 
     if ((f = openIconFile(&h,&b,iconName)) == NULL)
         return NULL;
-    if ((icon = LoadIcon(&h,&b,f,loadPalette)) == NULL) {
-        fclose(f);
-        return NULL;
-        }
+    icon = LoadIcon(&h,&b,f,loadPalette);
+    __MGL_fclose(f);
     return icon;
 }
 
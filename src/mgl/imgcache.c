@@ -0,0 +1,668 @@
+/****************************************************************************
+*
+*                   SciTech Multi-platform Graphics Library
+*
+*  ========================================================================
+*
+*   Copyright (C) 1991-2004 SciTech Software, Inc. All rights reserved.
+*
+*   This file may be distributed and/or modified under the terms of the
+*   GNU General Public License version 2.0 as published by the Free
+*   Software Foundation and appearing in the file LICENSE.GPL included
+*   in the packaging of this file.
+*
+*   Licensees holding a valid Commercial License for this product from
+*   SciTech Software, Inc. may use this file in accordance with the
+*   Commercial License Agreement provided with the Software.
+*
+*   This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING
+*   THE WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+*   PURPOSE.
+*
+*   See http://www.scitechsoft.com/license/ for information about
+*   the licensing options available and how to purchase a Commercial
+*   License Agreement.
+*
+*   Contact license@scitechsoft.com if any conditions of this licensing
+*   are not clear to you, or you have questions about licensing options.
+*
+*  ========================================================================
+*
+* Language:     ANSI C
+* Environment:  Any
+*
+* Description:  Decoded image cache. Images loaded through the cache are
+*               shared between all users with a reference count, and are
+*               kept in memory after they are released until the cache
+*               exceeds its memory budget, at which point the least
+*               recently used images are freed. Images are keyed by the
+*               resolved path, offset and loader parameters, and are
+*               reloaded if the size or modification time of the file on
+*               disk changes.
+*
+****************************************************************************/
+
+#include "mgl.h"
+
+/*--------------------------- Global Variables ----------------------------*/
+
+#define HASH_SIZE       256
+
+typedef struct cacheEntry {
+    struct cacheEntry   *keyNext;       /* Next entry in key hash chain     */
+    struct cacheEntry   *bmpNext;       /* Next entry in bitmap hash chain  */
+    struct cacheEntry   *lruPrev;       /* Previous unreferenced entry      */
+    struct cacheEntry   *lruNext;       /* Next unreferenced entry          */
+    bitmap_t            *bitmap;        /* Decoded image                    */
+    ulong               hash;           /* Hash value for the key           */
+    int                 type;           /* Type of image (MGL_asyncLoadType)*/
+    int                 param;          /* Loader parameter for the image   */
+    ulong               dwOffset;       /* Offset of image within the file  */
+    ulong               dwSize;         /* Size of the image in bytes       */
+    long                fileSize;       /* Size of the file when loaded     */
+    long                fileTime;       /* Modification time when loaded    */
+    ulong               bytes;          /* Memory used by the decoded image */
+    int                 refCount;       /* Number of users of the image     */
+    ibool               stale;          /* True if replaced by a new version*/
+    char                path[PM_MAX_PATH];  /* Resolved path to the file    */
+    } cacheEntry;
+
+typedef struct pathEntry {
+    struct pathEntry    *next;          /* Next entry in hash chain         */
+    ulong               hash;           /* Hash value for the name          */
+    char                name[PM_MAX_PATH];  /* Name passed by application   */
+    char                path[PM_MAX_PATH];  /* Resolved path to the file    */
+    } pathEntry;
+
+static cacheEntry   *keyHash[HASH_SIZE];
+static cacheEntry   *bmpHash[HASH_SIZE];
+static pathEntry    *pathHash[HASH_SIZE];
+static cacheEntry   *lruHead = NULL;
+static cacheEntry   *lruTail = NULL;
+static ulong        budget = 0;
+static ulong        bytesUsed = 0;
+static int          numImages = 0;
+static ulong        hits = 0;
+static ulong        misses = 0;
+static ulong        evictions = 0;
+
+/*------------------------- Implementation --------------------------------*/
+
+/****************************************************************************
+PARAMETERS:
+str     - String to hash
+hash    - Initial hash value
+
+RETURNS:
+Updated hash value.
+
+REMARKS:
+Simple FNV-1a hash used for the cache keys.
+****************************************************************************/
+static ulong hashString(
+    const char *str,
+    ulong hash)
+{
+    while (*str) {
+        hash ^= (uchar)*str++;
+        hash *= 16777619UL;
+        }
+    return hash & 0xFFFFFFFFUL;
+}
+
+/****************************************************************************
+PARAMETERS:
+bitmap  - Bitmap to find the hash bucket for
+
+RETURNS:
+Index of the bitmap hash bucket.
+****************************************************************************/
+static int bitmapBucket(
+    bitmap_t *bitmap)
+{
+    return (int)(((ulong)bitmap >> 4) % HASH_SIZE);
+}
+
+/****************************************************************************
+PARAMETERS:
+bitmap  - Bitmap to compute the size of
+
+RETURNS:
+Number of bytes of memory used by the bitmap.
+****************************************************************************/
+static ulong bitmapBytes(
+    bitmap_t *bitmap)
+{
+    ulong   bytes = sizeof(bitmap_t) + (ulong)bitmap->bytesPerLine * bitmap->height;
+
+    if (bitmap->pal)
+        bytes += sizeof(palette_t) * 256;
+    if (bitmap->pf)
+        bytes += sizeof(pixel_format_t);
+    return bytes;
+}
+
+/****************************************************************************
+PARAMETERS:
+name    - Name of the file passed by the application
+path    - Place to store the resolved path to the file
+refresh - True to search for the file again
+
+RETURNS:
+True if the file was found, false if not.
+
+REMARKS:
+Resolves the name of an image file to the full path using the standard MGL
+search rules. The resolved paths are remembered, so that we only search for
+each file once.
+****************************************************************************/
+static ibool resolvePath(
+    const char *name,
+    char *path,
+    ibool refresh)
+{
+    ulong       hash = hashString(name,2166136261UL);
+    pathEntry   *p,**prev;
+
+    for (prev = &pathHash[hash % HASH_SIZE]; (p = *prev) != NULL; prev = &p->next) {
+        if (p->hash == hash && !strcmp(p->name,name))
+            break;
+        }
+    if (p && !refresh) {
+        strcpy(path,p->path);
+        return true;
+        }
+    if (p) {
+        *prev = p->next;
+        PM_free(p);
+        }
+    if (!_MGL_findFile(path,MGL_BITMAPS,name,"rb"))
+        return false;
+    if ((p = PM_malloc(sizeof(pathEntry))) != NULL) {
+        p->hash = hash;
+        strcpy(p->name,name);
+        strcpy(p->path,path);
+        p->next = pathHash[hash % HASH_SIZE];
+        pathHash[hash % HASH_SIZE] = p;
+        }
+    return true;
+}
+
+/****************************************************************************
+PARAMETERS:
+e   - Entry to add to the LRU list
+
+REMARKS:
+Adds an unreferenced entry to the most recently used end of the LRU list.
+****************************************************************************/
+static void lruAdd(
+    cacheEntry *e)
+{
+    e->lruNext = NULL;
+    e->lruPrev = lruTail;
+    if (lruTail)
+        lruTail->lruNext = e;
+    else
+        lruHead = e;
+    lruTail = e;
+}
+
+/****************************************************************************
+PARAMETERS:
+e   - Entry to remove from the LRU list
+
+REMARKS:
+Removes an entry from the LRU list when it is referenced again.
+****************************************************************************/
+static void lruRemove(
+    cacheEntry *e)
+{
+    if (e->lruPrev)
+        e->lruPrev->lruNext = e->lruNext;
+    else
+        lruHead = e->lruNext;
+    if (e->lruNext)
+        e->lruNext->lruPrev = e->lruPrev;
+    else
+        lruTail = e->lruPrev;
+    e->lruPrev = e->lruNext = NULL;
+}
+
+/****************************************************************************
+PARAMETERS:
+e   - Entry to remove from the key hash table
+
+REMARKS:
+Removes an entry from the key hash table, so that it will no longer be
+found by lookups. The entry is still found by its bitmap until it is freed.
+****************************************************************************/
+static void unlinkKey(
+    cacheEntry *e)
+{
+    cacheEntry  **prev;
+
+    if (e->stale)
+        return;
+    for (prev = &keyHash[e->hash % HASH_SIZE]; *prev; prev = &(*prev)->keyNext) {
+        if (*prev == e) {
+            *prev = e->keyNext;
+            break;
+            }
+        }
+    e->stale = true;
+}
+
+/****************************************************************************
+PARAMETERS:
+e   - Entry to free
+
+REMARKS:
+Removes an entry from all the cache lists and frees the entry along with
+the decoded image.
+****************************************************************************/
+static void freeEntry(
+    cacheEntry *e)
+{
+    cacheEntry  **prev;
+    ibool       unused = (e->refCount == 0 && !e->stale);
+
+    unlinkKey(e);
+    for (prev = &bmpHash[bitmapBucket(e->bitmap)]; *prev; prev = &(*prev)->bmpNext) {
+        if (*prev == e) {
+            *prev = e->bmpNext;
+            break;
+            }
+        }
+    if (unused)
+        lruRemove(e);
+    bytesUsed -= e->bytes;
+    numImages--;
+    MGL_unloadBitmap(e->bitmap);
+    PM_free(e);
+}
+
+/****************************************************************************
+REMARKS:
+Frees the least recently used unreferenced images until the cache is back
+within its memory budget.
+****************************************************************************/
+static void trimCache(void)
+{
+    while (bytesUsed > budget && lruHead) {
+        freeEntry(lruHead);
+        evictions++;
+        }
+}
+
+/****************************************************************************
+PARAMETERS:
+type        - Type of image to load
+path        - Resolved path to the file
+dwOffset    - Offset of the image within the file
+dwSize      - Size of the image in bytes (0 for the rest of the file)
+param       - Parameter for the image loader
+
+RETURNS:
+Pointer to the loaded bitmap, NULL on error.
+
+REMARKS:
+Loads an image from the resolved path using the regular MGL image loaders.
+****************************************************************************/
+static bitmap_t *loadImage(
+    int type,
+    const char *path,
+    ulong dwOffset,
+    ulong dwSize,
+    int param)
+{
+    FILE        *f;
+    bitmap_t    *bitmap = NULL;
+
+    if ((f = __MGL_fopen(path,"rb")) == NULL) {
+        __MGL_result = grBitmapNotFound;
+        return NULL;
+        }
+    if (dwSize == 0)
+        dwSize = _MGL_fileSize(f) - dwOffset;
+    switch (type) {
+        case MGL_ASYNC_BITMAP:
+            bitmap = MGL_loadBitmapExt(f,dwOffset,dwSize,param);
+            break;
+        case MGL_ASYNC_PCX:
+            bitmap = MGL_loadPCXExt(f,dwOffset,dwSize,param);
+            break;
+        case MGL_ASYNC_JPEG:
+            bitmap = MGL_loadJPEGExt(f,dwOffset,dwSize,param);
+            break;
+        case MGL_ASYNC_PNG:
+            bitmap = MGL_loadPNGExt(f,dwOffset,dwSize,param);
+            break;
+        case MGL_ASYNC_SURFACE:
+            bitmap = MGL_loadSurfaceExt(f,dwOffset,dwSize,param);
+            break;
+        }
+    __MGL_fclose(f);
+    return bitmap;
+}
+
+/****************************************************************************
+DESCRIPTION:
+Loads an image embedded in a larger file through the image cache.
+
+HEADER:
+mgraph.h
+
+PARAMETERS:
+type        - Type of image to load (MGL_asyncLoadType)
+name        - Name of the file containing the image
+dwOffset    - Offset to start of the image within the file
+dwSize      - Size of the image in bytes (0 for the rest of the file)
+param       - Parameter for the image loader
+
+RETURNS:
+Pointer to the shared bitmap, NULL on error.
+
+REMARKS:
+This function is the same as MGL_loadCachedImage, however it loads an image
+that is embedded at the specified offset within a larger file. This allows
+you to cache images stored in your own large files with multiple images
+embedded in them. Each image in the file is cached separately.
+
+SEE ALSO:
+MGL_loadCachedImage, MGL_unloadCachedImage
+****************************************************************************/
+bitmap_t * MGLAPI MGL_loadCachedImageExt(
+    int type,
+    const char *name,
+    ulong dwOffset,
+    ulong dwSize,
+    int param)
+{
+    char        path[PM_MAX_PATH];
+    ulong       hash;
+    long        fileSize,fileTime;
+    cacheEntry  *e;
+    bitmap_t    *bitmap;
+    int         bucket;
+
+    __MGL_result = grOK;
+    if ((type < MGL_ASYNC_BITMAP || type > MGL_ASYNC_PNG) && type != MGL_ASYNC_SURFACE) {
+        SETERROR(grError);
+        return NULL;
+        }
+    if (strlen(name) >= PM_MAX_PATH) {
+        SETERROR(grInvalidName);
+        return NULL;
+        }
+
+    /* Find the file, searching again if it has moved since last time */
+    if (!resolvePath(name,path,false) || !_MGL_getFileInfo(path,&fileSize,&fileTime)) {
+        if (!resolvePath(name,path,true) || !_MGL_getFileInfo(path,&fileSize,&fileTime)) {
+            __MGL_result = grBitmapNotFound;
+            return NULL;
+            }
+        }
+
+    /* Look for the image in the cache */
+    hash = hashString(path,2166136261UL) ^ (dwOffset * 31 + type * 7 + param);
+    for (e = keyHash[hash % HASH_SIZE]; e; e = e->keyNext) {
+        if (e->hash == hash && e->type == type && e->param == param
+                && e->dwOffset == dwOffset && e->dwSize == dwSize
+                && !strcmp(e->path,path))
+            break;
+        }
+    if (e) {
+        if (e->fileSize == fileSize && e->fileTime == fileTime) {
+            if (e->refCount++ == 0)
+                lruRemove(e);
+            hits++;
+            return e->bitmap;
+            }
+
+        /* The file has changed, so drop the old version from the cache. If
+         * it is still in use it is freed when the last user releases it.
+         */
+        if (e->refCount == 0)
+            freeEntry(e);
+        else
+            unlinkKey(e);
+        }
+
+    /* Load the image and add it to the cache */
+    misses++;
+    if ((e = PM_calloc(1,sizeof(cacheEntry))) == NULL) {
+        FATALERROR(grNoMem);
+        return NULL;
+        }
+    if ((bitmap = loadImage(type,path,dwOffset,dwSize,param)) == NULL) {
+        PM_free(e);
+        return NULL;
+        }
+    e->bitmap = bitmap;
+    e->hash = hash;
+    e->type = type;
+    e->param = param;
+    e->dwOffset = dwOffset;
+    e->dwSize = dwSize;
+    e->fileSize = fileSize;
+    e->fileTime = fileTime;
+    e->bytes = bitmapBytes(bitmap);
+    e->refCount = 1;
+    strcpy(e->path,path);
+    e->keyNext = keyHash[hash % HASH_SIZE];
+    keyHash[hash % HASH_SIZE] = e;
+    bucket = bitmapBucket(bitmap);
+    e->bmpNext = bmpHash[bucket];
+    bmpHash[bucket] = e;
+    bytesUsed += e->bytes;
+    numImages++;
+    trimCache();
+    return bitmap;
+}
+
+/****************************************************************************
+DESCRIPTION:
+Loads an image file through the image cache.
+
+HEADER:
+mgraph.h
+
+PARAMETERS:
+type    - Type of image to load (MGL_asyncLoadType)
+name    - Name of image file to load
+param   - Parameter for the image loader
+
+RETURNS:
+Pointer to the shared bitmap, NULL on error.
+
+REMARKS:
+This function loads an image file into a lightweight bitmap the same as
+MGL_loadBitmap, MGL_loadPCX, MGL_loadJPEG, MGL_loadPNG and MGL_loadSurface,
+but returns a shared copy of the image if it has already been loaded
+through the cache. The type of image is one of MGL_ASYNC_BITMAP,
+MGL_ASYNC_PCX, MGL_ASYNC_JPEG, MGL_ASYNC_PNG or MGL_ASYNC_SURFACE from the
+MGL_asyncLoadType enumeration, and the param
+value is passed on to the image loader as the loadPalette parameter, or as
+the num8BitColors parameter for JPEG files. Loading the same file with
+different parameters caches separate copies of the image.
+
+The returned bitmap is shared by everyone that loads the same image, so it
+must be treated as read only. When you are done with it you must release it
+with MGL_unloadCachedImage, and not with MGL_unloadBitmap. Released images
+stay in the cache until the cache exceeds the memory budget set with
+MGL_setImageCacheSize, when the least recently used images are freed.
+
+Each file is only searched for once using the standard MGL search rules,
+and the resolved path is remembered for later loads. Cached images are
+checked against the size and modification time of the file each time they
+are loaded, and are reloaded if the file has changed.
+
+SEE ALSO:
+MGL_loadCachedImageExt, MGL_unloadCachedImage, MGL_setImageCacheSize,
+MGL_getImageCacheStats
+****************************************************************************/
+bitmap_t * MGLAPI MGL_loadCachedImage(
+    int type,
+    const char *name,
+    int param)
+{
+    return MGL_loadCachedImageExt(type,name,0,0,param);
+}
+
+/****************************************************************************
+DESCRIPTION:
+Releases an image loaded through the image cache.
+
+HEADER:
+mgraph.h
+
+PARAMETERS:
+bitmap  - Bitmap returned by MGL_loadCachedImage
+
+REMARKS:
+This function releases a reference to a bitmap returned by
+MGL_loadCachedImage or MGL_loadCachedImageExt. Once all the references to
+an image are released, the image is kept in the cache for later use until
+it is evicted to keep the cache within its memory budget.
+
+SEE ALSO:
+MGL_loadCachedImage, MGL_flushImageCache
+****************************************************************************/
+void MGLAPI MGL_unloadCachedImage(
+    bitmap_t *bitmap)
+{
+    cacheEntry  *e;
+
+    if (!bitmap)
+        return;
+    for (e = bmpHash[bitmapBucket(bitmap)]; e; e = e->bmpNext) {
+        if (e->bitmap == bitmap)
+            break;
+        }
+    if (!e || e->refCount == 0)
+        return;
+    if (--e->refCount == 0) {
+        if (e->stale) {
+            freeEntry(e);
+            return;
+            }
+        lruAdd(e);
+        trimCache();
+        }
+}
+
+/****************************************************************************
+DESCRIPTION:
+Sets the memory budget for the image cache.
+
+HEADER:
+mgraph.h
+
+PARAMETERS:
+maxBytes    - Maximum number of bytes of decoded images to keep
+
+REMARKS:
+This function sets the maximum amount of memory used by the decoded images
+in the image cache. When the cache exceeds this budget, the least recently
+used images that are no longer referenced are freed. Images that are still
+in use are never freed, so the cache may exceed the budget if the images in
+use are larger than the budget. The default budget is 0, which keeps
+images only while they are in use.
+
+SEE ALSO:
+MGL_loadCachedImage, MGL_getImageCacheStats, MGL_flushImageCache
+****************************************************************************/
+void MGLAPI MGL_setImageCacheSize(
+    ulong maxBytes)
+{
+    budget = maxBytes;
+    trimCache();
+}
+
+/****************************************************************************
+DESCRIPTION:
+Frees all the unreferenced images in the image cache.
+
+HEADER:
+mgraph.h
+
+REMARKS:
+This function frees all the images in the image cache that are no longer
+in use, along with the remembered paths to all image files. Images that
+are still in use are left in the cache.
+
+SEE ALSO:
+MGL_loadCachedImage, MGL_setImageCacheSize
+****************************************************************************/
+void MGLAPI MGL_flushImageCache(void)
+{
+    pathEntry   *p;
+    int         i;
+
+    while (lruHead)
+        freeEntry(lruHead);
+    for (i = 0; i < HASH_SIZE; i++) {
+        while ((p = pathHash[i]) != NULL) {
+            pathHash[i] = p->next;
+            PM_free(p);
+            }
+        }
+}
+
+/****************************************************************************
+DESCRIPTION:
+Returns statistics about the image cache.
+
+HEADER:
+mgraph.h
+
+PARAMETERS:
+stats   - Place to store the cache statistics
+reset   - True to reset the hit, miss and eviction counters
+
+REMARKS:
+This function returns the number of cache hits, misses and evictions since
+the cache was last reset, along with the current memory usage of the
+cache. The hit rate of the cache is the number of hits divided by the sum
+of the hits and misses. If reset is true, the hit, miss and eviction
+counters are reset back to zero after they are returned.
+
+SEE ALSO:
+MGL_loadCachedImage, MGL_setImageCacheSize
+****************************************************************************/
+void MGLAPI MGL_getImageCacheStats(
+    imagecache_stats_t *stats,
+    ibool reset)
+{
+    cacheEntry  *e;
+
+    stats->hits = hits;
+    stats->misses = misses;
+    stats->evictions = evictions;
+    stats->bytesUsed = bytesUsed;
+    stats->maxBytes = budget;
+    stats->numImages = numImages;
+    stats->numUnused = 0;
+    for (e = lruHead; e; e = e->lruNext)
+        stats->numUnused++;
+    if (reset)
+        hits = misses = evictions = 0;
+}
+
+/****************************************************************************
+REMARKS:
+Frees all the images in the cache, including images that are still in use,
+when the MGL is shut down.
+****************************************************************************/
+void _MGL_destroyImageCache(void)
+{
+    cacheEntry  *e;
+    int         i;
+
+    MGL_flushImageCache();
+    for (i = 0; i < HASH_SIZE; i++) {
+        while ((e = bmpHash[i]) != NULL)
+            freeEntry(e);
+        }
+    hits = misses = evictions = 0;
+}
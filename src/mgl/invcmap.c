@@ -0,0 +1,289 @@
+/****************************************************************************
+*
+*                   SciTech Multi-platform Graphics Library
+*
+*  ========================================================================
+*
+*   Copyright (C) 1991-2004 SciTech Software, Inc. All rights reserved.
+*
+*   This file may be distributed and/or modified under the terms of the
+*   GNU General Public License version 2.0 as published by the Free
+*   Software Foundation and appearing in the file LICENSE.GPL included
+*   in the packaging of this file.
+*
+*   Licensees holding a valid Commercial License for this product from
+*   SciTech Software, Inc. may use this file in accordance with the
+*   Commercial License Agreement provided with the Software.
+*
+*   This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING
+*   THE WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+*   PURPOSE.
+*
+*   See http://www.scitechsoft.com/license/ for information about
+*   the licensing options available and how to purchase a Commercial
+*   License Agreement.
+*
+*   Contact license@scitechsoft.com if any conditions of this licensing
+*   are not clear to you, or you have questions about licensing options.
+*
+*  ========================================================================
+*
+* Language:     ANSI C
+* Environment:  Any
+*
+* Description:  Inverse color map support. An inverse color map is a
+*               32x32x32 lookup table that maps a 15-bit RGB color
+*               directly to the closest color in a palette, so mapping
+*               RGB colors to a color index palette costs a single table
+*               lookup rather than a search of the entire palette. The
+*               map for the palette of a device context is built on
+*               demand and cached with the device context, and is only
+*               rebuilt when the palette changes.
+*
+****************************************************************************/
+
+#include "mgl.h"
+
+/*------------------------- Implementation --------------------------------*/
+
+/****************************************************************************
+PARAMETERS:
+icm - Inverse color map to build (palette must already be filled in)
+
+REMARKS:
+Builds the inverse color map for the palette stored in the map. Each cell
+maps to the palette entry closest to the center of the cell, using the
+same distance metric and tie breaking as _MGL_closestColor. To avoid
+testing every palette entry for every cell, the palette is sorted by red
+and searched outwards from the red value of the cell, stopping in each
+direction as soon as the red difference alone exceeds the best distance.
+{secret}
+****************************************************************************/
+void _MGL_buildInverseColorMap(
+    MGL_invCMap *icm)
+{
+    palette_t   *pal = icm->pal,*p;
+    uchar       order[256],*map = icm->map;
+    int         palSize = icm->palSize;
+    int         i,j,t,start,r,g,b,R,G,B,d,dr,best,closest;
+
+    /* Sort the palette entries by red component */
+    for (i = 0; i < palSize; i++) {
+        for (j = i; j > 0 && pal[order[j-1]].red > pal[i].red; j--)
+            order[j] = order[j-1];
+        order[j] = (uchar)i;
+        }
+
+    for (r = 0, start = 0; r < 32; r++) {
+        R = (r << 3) | 4;
+        while (start < palSize && pal[order[start]].red < R)
+            start++;
+        for (g = 0; g < 32; g++) {
+            G = (g << 3) | 4;
+            for (b = 0; b < 32; b++) {
+                B = (b << 3) | 4;
+                best = 0x7FFF;
+                closest = 0;
+                for (j = start; j < palSize; j++) {
+                    p = &pal[t = order[j]];
+                    if ((dr = p->red - R) > best)
+                        break;
+                    d = dr + ABS(G - (int)p->green) + ABS(B - (int)p->blue);
+                    if (d < best || (d == best && t < closest)) {
+                        best = d;
+                        closest = t;
+                        }
+                    }
+                for (j = start-1; j >= 0; j--) {
+                    p = &pal[t = order[j]];
+                    if ((dr = R - p->red) > best)
+                        break;
+                    d = dr + ABS(G - (int)p->green) + ABS(B - (int)p->blue);
+                    if (d < best || (d == best && t < closest)) {
+                        best = d;
+                        closest = t;
+                        }
+                    }
+                *map++ = (uchar)closest;
+                }
+            }
+        }
+}
+
+/****************************************************************************
+PARAMETERS:
+dc  - Color index device context to get the inverse color map for
+
+RETURNS:
+Pointer to the inverse color map, or NULL if out of memory.
+
+REMARKS:
+Returns the inverse color map for the current palette of a color index
+device context. The map is cached with the device context, and is only
+rebuilt if the palette has changed since the map was last built. Use the
+INVCMAP_INDEX macro to look up colors in the map.
+{secret}
+****************************************************************************/
+MGL_invCMap *_MGL_getInverseColorMap(
+    MGLDC *dc)
+{
+    MGL_invCMap *icm = dc->invCMap;
+    int         palSize = MIN(dc->mi.maxColor+1,256);
+
+    if (icm && icm->palSize == palSize
+            && memcmp(icm->pal,dc->colorTab,palSize * sizeof(palette_t)) == 0)
+        return icm;
+    if (!icm && (icm = dc->invCMap = PM_malloc(sizeof(MGL_invCMap))) == NULL)
+        return NULL;
+    memcpy(icm->pal,dc->colorTab,palSize * sizeof(palette_t));
+    icm->palSize = palSize;
+    _MGL_buildInverseColorMap(icm);
+    return icm;
+}
+
+/****************************************************************************
+PARAMETERS:
+bitmap  - Bitmap to map (8 bits per pixel with a palette, or 15+ bits)
+icm     - Inverse color map to map the bitmap through
+
+RETURNS:
+Pointer to the new 8 bits per pixel bitmap, NULL if out of memory.
+
+REMARKS:
+Creates a new 8 bits per pixel bitmap by mapping every pixel in the source
+bitmap through an inverse color map. The palette the inverse color map
+was built for is stored with the new bitmap.
+{secret}
+****************************************************************************/
+bitmap_t *_MGL_mapBitmapToInverseColorMap(
+    const bitmap_t *bitmap,
+    MGL_invCMap *icm)
+{
+    bitmap_t        *newBmp;
+    pixel_format_t  *pf = bitmap->pf;
+    palette_t       *pal;
+    uchar           xlat[256],*s,*d,*map = icm->map,R,G,B;
+    int             x,y,width = bitmap->width;
+    M_uint32        c;
+
+    /* Allocate the new bitmap with the inverse color map palette */
+    if ((newBmp = PM_malloc(sizeof(bitmap_t) + 256 * sizeof(palette_t)
+            + (long)((width + 3) & ~3) * bitmap->height)) == NULL)
+        return NULL;
+    newBmp->width = width;
+    newBmp->height = bitmap->height;
+    newBmp->bitsPerPixel = 8;
+    newBmp->bytesPerLine = (width + 3) & ~3;
+    newBmp->pf = NULL;
+    newBmp->pal = (palette_t*)(newBmp + 1);
+    newBmp->surface = newBmp->pal + 256;
+    memset(newBmp->pal,0,256 * sizeof(palette_t));
+    memcpy(newBmp->pal,icm->pal,icm->palSize * sizeof(palette_t));
+
+    /* 8 bits per pixel bitmaps only need a 256 entry translation table */
+    if (bitmap->bitsPerPixel == 8) {
+        for (x = 0, pal = bitmap->pal; x < 256; x++, pal++)
+            xlat[x] = map[INVCMAP_INDEX(pal->red,pal->green,pal->blue)];
+        }
+
+    /* Map every pixel in the bitmap through the inverse color map */
+    for (y = 0; y < bitmap->height; y++) {
+        s = (uchar*)bitmap->surface + (long)y * bitmap->bytesPerLine;
+        d = (uchar*)newBmp->surface + (long)y * newBmp->bytesPerLine;
+        switch (bitmap->bitsPerPixel) {
+            case 8:
+                for (x = 0; x < width; x++)
+                    *d++ = xlat[*s++];
+                break;
+            case 15:
+            case 16:
+                for (x = 0; x < width; x++, s += 2) {
+                    c = *((ushort*)s);
+                    MGL_unpackColorFast(pf,c,R,G,B);
+                    *d++ = map[INVCMAP_INDEX(R,G,B)];
+                    }
+                break;
+            case 24:
+                for (x = 0; x < width; x++, s += 3) {
+                    c = s[0] | ((M_uint32)s[1] << 8) | ((M_uint32)s[2] << 16);
+                    MGL_unpackColorFast(pf,c,R,G,B);
+                    *d++ = map[INVCMAP_INDEX(R,G,B)];
+                    }
+                break;
+            case 32:
+                for (x = 0; x < width; x++, s += 4) {
+                    c = *((M_uint32*)s);
+                    MGL_unpackColorFast(pf,c,R,G,B);
+                    *d++ = map[INVCMAP_INDEX(R,G,B)];
+                    }
+                break;
+            }
+        }
+    return newBmp;
+}
+
+/****************************************************************************
+DESCRIPTION:
+Maps an RGB bitmap to the palette of a color index device context.
+
+HEADER:
+mgraph.h
+
+PARAMETERS:
+dc      - 8 bits per pixel color index device context to map to
+bitmap  - Bitmap to map to the device context palette
+
+RETURNS:
+Pointer to the new 8 bits per pixel bitmap, NULL on error.
+
+REMARKS:
+This function converts a 15, 16, 24 or 32 bits per pixel RGB bitmap, or an
+8 bits per pixel bitmap with its own palette, into a new 8 bits per pixel
+bitmap that uses the current palette of the device context. Every pixel is
+mapped to the closest color in the device context palette, and the device
+context palette is stored with the new bitmap. The original bitmap is left
+unchanged, and the new bitmap should be freed with MGL_unloadBitmap when it
+is no longer needed.
+
+Colors are mapped using an inverse color map, which is a 32x32x32 lookup
+table that is built when the palette of the device context changes and
+cached with the device context. Hence mapping any number of bitmaps to the
+same palette only requires a single table lookup per pixel, which is much
+faster than searching the palette for every color. Since the lookup table
+uses 5 bits per color channel, colors that are very close together may
+occasionally map to a slightly different palette entry than
+MGL_rgbColor would return.
+
+If this function fails, it will return NULL and you can get the error code
+from the MGL_result function. The function fails with grInvalidDC if the
+device context is not an 8 bits per pixel color index device context, and
+with grInvalidBitmap if the bitmap is less than 8 bits per pixel or is an
+8 bits per pixel bitmap without a palette.
+
+SEE ALSO:
+MGL_mapToPalette, MGL_rgbColor, MGL_unloadBitmap
+****************************************************************************/
+bitmap_t * MGLAPI MGL_mapBitmapToPalette(
+    MGLDC *dc,
+    const bitmap_t *bitmap)
+{
+    MGL_invCMap     *icm;
+    bitmap_t        *newBmp;
+
+    if (dc == _MGL_dcPtr)
+        dc = &DC;
+    if (!(dc->mi.modeFlags & MGL_IS_COLOR_INDEX) || dc->mi.bitsPerPixel != 8) {
+        SETERROR(grInvalidDC);
+        return NULL;
+        }
+    if (bitmap->bitsPerPixel < 8 || (bitmap->bitsPerPixel == 8 && !bitmap->pal)) {
+        SETERROR(grInvalidBitmap);
+        return NULL;
+        }
+    if ((icm = _MGL_getInverseColorMap(dc)) == NULL
+            || (newBmp = _MGL_mapBitmapToInverseColorMap(bitmap,icm)) == NULL) {
+        SETERROR(grNoMem);
+        return NULL;
+        }
+    return newBmp;
+}
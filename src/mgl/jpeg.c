@@ -75,6 +75,26 @@ typedef struct {
 
 /* {secret} */
 typedef my_error_mgr *my_error_ptr;
+
+/* The JPEG library's standard stdio data source reads directly with the C
+ * library fread function, so we provide our own data source that reads
+ * through the MGL file I/O functions. This allows JPEG files to be loaded
+ * from pack files or any other file I/O functions installed with
+ * MGL_setFileIO.
+ */
+
+#define INPUT_BUF_SIZE  4096
+
+/* {secret} */
+typedef struct {
+    struct jpeg_source_mgr pub;
+    FILE    *infile;
+    JOCTET  buffer[INPUT_BUF_SIZE];
+    ibool   start_of_file;
+    } my_source_mgr;
+
+/* {secret} */
+typedef my_source_mgr *my_src_ptr;
 /* {secret} */
 typedef struct jpeg_compress_struct jpeg_compress;
 /* {secret} */
@@ -111,6 +131,120 @@ static void PMAPI my_error_exit(
     longjmp(myerr->setjmp_buffer, 1);
 }
 
+/****************************************************************************
+PARAMETERS:
+cinfo   - Pointer to the JPEG decompression object
+
+REMARKS:
+Initialises the data source before any data is read.
+****************************************************************************/
+static void PMAPI my_init_source(
+    j_decompress_ptr cinfo)
+{
+    ((my_src_ptr)cinfo->src)->start_of_file = true;
+}
+
+/****************************************************************************
+PARAMETERS:
+cinfo   - Pointer to the JPEG decompression object
+
+RETURNS:
+Always returns true, as we never suspend.
+
+REMARKS:
+Refills the input buffer from the file. If we run out of data a fake EOI
+marker is inserted so that the JPEG library can finish gracefully with
+whatever it has already decoded.
+****************************************************************************/
+static boolean PMAPI my_fill_input_buffer(
+    j_decompress_ptr cinfo)
+{
+    my_src_ptr  src = (my_src_ptr)cinfo->src;
+    size_t      nbytes;
+
+    nbytes = __MGL_fread(src->buffer,1,INPUT_BUF_SIZE,src->infile);
+    if (nbytes == 0) {
+        if (src->start_of_file)
+            ERREXIT(cinfo, JERR_INPUT_EMPTY);
+        WARNMS(cinfo, JWRN_JPEG_EOF);
+        src->buffer[0] = (JOCTET)0xFF;
+        src->buffer[1] = (JOCTET)JPEG_EOI;
+        nbytes = 2;
+        }
+    src->pub.next_input_byte = src->buffer;
+    src->pub.bytes_in_buffer = nbytes;
+    src->start_of_file = false;
+    return true;
+}
+
+/****************************************************************************
+PARAMETERS:
+cinfo       - Pointer to the JPEG decompression object
+num_bytes   - Number of bytes to skip
+
+REMARKS:
+Skips over data in the input stream, seeking past anything that is not
+already in the input buffer.
+****************************************************************************/
+static void PMAPI my_skip_input_data(
+    j_decompress_ptr cinfo,
+    long num_bytes)
+{
+    my_src_ptr  src = (my_src_ptr)cinfo->src;
+
+    if (num_bytes <= 0)
+        return;
+    if (num_bytes > (long)src->pub.bytes_in_buffer) {
+        __MGL_fseek(src->infile,num_bytes - (long)src->pub.bytes_in_buffer,SEEK_CUR);
+        src->pub.bytes_in_buffer = 0;
+        }
+    else {
+        src->pub.next_input_byte += (size_t)num_bytes;
+        src->pub.bytes_in_buffer -= (size_t)num_bytes;
+        }
+}
+
+/****************************************************************************
+PARAMETERS:
+cinfo   - Pointer to the JPEG decompression object
+
+REMARKS:
+Terminates the data source. Nothing needs to be done, as the file is owned
+by the caller.
+****************************************************************************/
+static void PMAPI my_term_source(
+    j_decompress_ptr cinfo)
+{
+    (void)cinfo;
+}
+
+/****************************************************************************
+PARAMETERS:
+cinfo   - Pointer to the JPEG decompression object
+f       - Open file to read the JPEG data from
+
+REMARKS:
+Sets up the JPEG decompression object to read from a file using the MGL
+file I/O functions. This is a replacement for jpeg_stdio_src.
+****************************************************************************/
+static void my_jpeg_src(
+    j_decompress_ptr cinfo,
+    FILE *f)
+{
+    my_src_ptr  src;
+
+    src = (my_src_ptr)(*cinfo->mem->alloc_small)((j_common_ptr)cinfo,JPOOL_PERMANENT,sizeof(my_source_mgr));
+    src->pub.init_source = my_init_source;
+    src->pub.fill_input_buffer = my_fill_input_buffer;
+    src->pub.skip_input_data = my_skip_input_data;
+    src->pub.resync_to_restart = jpeg_resync_to_restart;
+    src->pub.term_source = my_term_source;
+    src->pub.bytes_in_buffer = 0;
+    src->pub.next_input_byte = NULL;
+    src->infile = f;
+    cinfo->src = &src->pub;
+}
+
 /****************************************************************************
 DESCRIPTION:
 Obtain the dimensions of a JPEG file from an opened file.
@@ -171,7 +305,7 @@ ibool MGLAPI MGL_getJPEGSizeExt(
     /* Initialize the JPEG decompression object and read header */
     __MGL_fseek(f,dwOffset,SEEK_SET);
     jpeg_create_decompress(&cinfo);
-    jpeg_stdio_src(&cinfo, f);
+    my_jpeg_src(&cinfo, f);
     jpeg_read_header(&cinfo, TRUE);
     if (cinfo.num_components != 1 && cinfo.num_components != 3) {
         /* Only support 24-bit or grayscale images! */
@@ -243,34 +377,63 @@ ibool MGLAPI MGL_getJPEGSize(
 }
 
 /****************************************************************************
-DESCRIPTION:
-Load a JPEG bitmap file from disk using an open file.
+PARAMETERS:
+f           - Open binary file to read bitmap from
+dwOffset    - Offset to start of JPEG file within open file
+dwSize      - Size of JPEG file in bytes
+width       - Width the image will be scaled to
+height      - Height the image will be scaled to
 
-HEADER:
-mgraph.h
+RETURNS:
+DCT scaling denominator to use, or 0 if the JPEG header is invalid.
+
+REMARKS:
+Picks the largest DCT domain reduction (1/2, 1/4 or 1/8) that still
+produces an image at least as large as the requested size, so that the
+final resample is always a reduction of less than a factor of two.
+****************************************************************************/
+static int findScale(
+    FILE *f,
+    ulong dwOffset,
+    ulong dwSize,
+    int width,
+    int height)
+{
+    int             scale,imageWidth,imageHeight,bitsPerPixel;
+    pixel_format_t  pf;
+
+    if (!MGL_getJPEGSizeExt(f,dwOffset,dwSize,&imageWidth,&imageHeight,&bitsPerPixel,&pf))
+        return 0;
+    for (scale = 8; scale > 1; scale /= 2) {
+        if ((imageWidth + scale-1) / scale >= width && (imageHeight + scale-1) / scale >= height)
+            break;
+        }
+    return scale;
+}
 
+/****************************************************************************
 PARAMETERS:
 f               - Open binary file to read bitmap from
 dwOffset        - Offset to start of JPEG file within open file
 dwSize          - Size of JPEG file in bytes
 num8BitColors   - Number of colors for 8-bit image, 0 for RGB images, -1 for grayscale
+scale           - DCT scaling denominator (1, 2, 4 or 8)
 
 RETURNS:
 Pointer to the loaded bitmap file
 
 REMARKS:
-This function is the same as MGL_loadJPEG, however it loads the file from a
-previously open file. This allows you to create your own large files with
-multiple files embedded in them.
-
-SEE ALSO:
-MGL_loadJPEG, MGL_loadBitmap
+Internal function to load a JPEG file into a lightweight bitmap. If the
+scale is larger than 1 the image is reduced in the DCT domain by the JPEG
+decoder as it is decoded, which is much faster than decoding the image at
+full size and scaling it down afterwards.
 ****************************************************************************/
-bitmap_t * MGLAPI MGL_loadJPEGExt(
+static bitmap_t *loadJPEG(
     FILE *f,
     ulong dwOffset,
     ulong dwSize,
-    int num8BitColors)
+    int num8BitColors,
+    int scale)
 {
     bitmap_t        *bitmap;    /* MGL bitmap file being created        */
     ulong           size;       /* Size of the bitmap image             */
@@ -298,7 +461,7 @@ bitmap_t * MGLAPI MGL_loadJPEGExt(
     /* Initialize the JPEG decompression object and read header */
     __MGL_fseek(f,dwOffset,SEEK_SET);
     jpeg_create_decompress(&cinfo);
-    jpeg_stdio_src(&cinfo, f);
+    my_jpeg_src(&cinfo, f);
     jpeg_read_header(&cinfo, TRUE);
     if (cinfo.num_components != 1 && cinfo.num_components != 3) {
         /* Only support 24-bit or grayscale images! */
@@ -309,15 +472,39 @@ bitmap_t * MGLAPI MGL_loadJPEGExt(
     if (cinfo.num_components == 1)
         num8BitColors = -1;
 
+    /* Set parameters for decompression to 8-bits per pixel */
+    if (num8BitColors > 0) {
+        cinfo.quantize_colors = true;
+        cinfo.desired_number_of_colors = num8BitColors;
+        cinfo.two_pass_quantize = true;
+        cinfo.dither_mode = JDITHER_FS;
+        }
+    else if (num8BitColors == -1) {
+        /* Decode to a grayscale image */
+        cinfo.out_color_space = JCS_GRAYSCALE;
+        }
+
+    /* Reduce the image in the DCT domain if requested. Scaled images are
+     * used for thumbnails and previews, so we also use the fast integer
+     * IDCT and skip the fancy chroma upsampling.
+     */
+    if (scale > 1) {
+        cinfo.scale_num = 1;
+        cinfo.scale_denom = scale;
+        cinfo.dct_method = JDCT_IFAST;
+        cinfo.do_fancy_upsampling = false;
+        }
+    jpeg_calc_output_dimensions(&cinfo);
+
     /* Allocate memory for the bitmap */
     if (num8BitColors != 0) {
         size = sizeof(bitmap_t) + sizeof(pixel_format_t)
              + sizeof(palette_t)*256
-             + cinfo.image_width * cinfo.image_height;
+             + cinfo.output_width * cinfo.output_height;
         }
     else {
         size = sizeof(bitmap_t) + sizeof(pixel_format_t)
-             + cinfo.image_width * 3 * cinfo.image_height;
+             + cinfo.output_width * 3 * cinfo.output_height;
         }
     if ((bitmap = PM_malloc(size)) == NULL) {
         jpeg_destroy_decompress(&cinfo);
@@ -325,12 +512,12 @@ bitmap_t * MGLAPI MGL_loadJPEGExt(
         return NULL;
         }
     size = sizeof(bitmap_t);
-    bitmap->width = cinfo.image_width;
-    bitmap->height = cinfo.image_height;
+    bitmap->width = cinfo.output_width;
+    bitmap->height = cinfo.output_height;
     if (num8BitColors != 0) {
         /* 8-bits per pixel with a palette */
         bitmap->bitsPerPixel = 8;
-        bitmap->bytesPerLine = cinfo.image_width;
+        bitmap->bytesPerLine = cinfo.output_width;
         bitmap->pal = (palette_t*)((uchar*)bitmap + size);
         bitmap->pf = NULL;
         size += sizeof(palette_t) * 256;
@@ -339,7 +526,7 @@ bitmap_t * MGLAPI MGL_loadJPEGExt(
     else {
         /* 24-bit RGB */
         bitmap->bitsPerPixel = 24;
-        bitmap->bytesPerLine = cinfo.image_width * 3;
+        bitmap->bytesPerLine = cinfo.output_width * 3;
         bitmap->pal = NULL;
         bitmap->pf = (pixel_format_t*)((uchar*)bitmap + size);
         memcpy(bitmap->pf,&_MGL_pixelFormats[pfRGB24],sizeof(pixel_format_t));
@@ -347,18 +534,6 @@ bitmap_t * MGLAPI MGL_loadJPEGExt(
         }
     bitmap->surface = (uchar*)bitmap + size;
 
-    /* Set parameters for decompression to 8-bits per pixel */
-    if (num8BitColors > 0) {
-        cinfo.quantize_colors = true;
-        cinfo.desired_number_of_colors = num8BitColors;
-        cinfo.two_pass_quantize = true;
-        cinfo.dither_mode = JDITHER_FS;
-        }
-    else if (num8BitColors == -1) {
-        /* Decode to a grayscale image */
-        cinfo.out_color_space = JCS_GRAYSCALE;
-        }
-
     /* Start decompressor and decode the image a scanline at a time */
     jpeg_start_decompress(&cinfo);
     p = bitmap->surface;
@@ -381,7 +556,7 @@ bitmap_t * MGLAPI MGL_loadJPEGExt(
         /* Swap the RGB ordering as our default is the reverse */
         while (cinfo.output_scanline < cinfo.output_height) {
             jpeg_read_scanlines(&cinfo, buffer, 1);
-            for (i = 0,pb = buffer[0]; i < (int)cinfo.image_width; i++,pb += 3,p += 3) {
+            for (i = 0,pb = buffer[0]; i < (int)cinfo.output_width; i++,pb += 3,p += 3) {
                 p[0] = pb[2];
                 p[1] = pb[1];
                 p[2] = pb[0];
@@ -409,6 +584,39 @@ bitmap_t * MGLAPI MGL_loadJPEGExt(
     return bitmap;
 }
 
+/****************************************************************************
+DESCRIPTION:
+Load a JPEG bitmap file from disk using an open file.
+
+HEADER:
+mgraph.h
+
+PARAMETERS:
+f               - Open binary file to read bitmap from
+dwOffset        - Offset to start of JPEG file within open file
+dwSize          - Size of JPEG file in bytes
+num8BitColors   - Number of colors for 8-bit image, 0 for RGB images, -1 for grayscale
+
+RETURNS:
+Pointer to the loaded bitmap file
+
+REMARKS:
+This function is the same as MGL_loadJPEG, however it loads the file from a
+previously open file. This allows you to create your own large files with
+multiple files embedded in them.
+
+SEE ALSO:
+MGL_loadJPEG, MGL_loadBitmap
+****************************************************************************/
+bitmap_t * MGLAPI MGL_loadJPEGExt(
+    FILE *f,
+    ulong dwOffset,
+    ulong dwSize,
+    int num8BitColors)
+{
+    return loadJPEG(f,dwOffset,dwSize,num8BitColors,1);
+}
+
 /****************************************************************************
 DESCRIPTION:
 Load a JPEG bitmap file from disk.
@@ -492,39 +700,166 @@ bitmap_t * MGLAPI MGL_loadJPEG(
 
 /****************************************************************************
 DESCRIPTION:
-Loads a JPEG file directly into an existing device context using an open file.
+Load a JPEG bitmap file from disk scaled to a specific size using an open
+file.
 
 HEADER:
 mgraph.h
 
 PARAMETERS:
-dc              - Device context to load bitmap into
+f           - Open binary file to read bitmap from
+dwOffset    - Offset to start of JPEG file within open file
+dwSize      - Size of JPEG file in bytes
+width       - Width of the bitmap to create
+height      - Height of the bitmap to create
+
+RETURNS:
+Pointer to the loaded bitmap file, NULL on error.
+
+REMARKS:
+This function is the same as MGL_loadJPEGScaled, however it loads the file
+from a previously open file. This allows you to create your own large files
+with multiple files embedded in them.
+
+SEE ALSO:
+MGL_loadJPEGScaled, MGL_loadJPEGExt
+****************************************************************************/
+bitmap_t * MGLAPI MGL_loadJPEGScaledExt(
+    FILE *f,
+    ulong dwOffset,
+    ulong dwSize,
+    int width,
+    int height)
+{
+    bitmap_t    *bitmap,*scaled;
+    MGLDC       *memDC;
+    ulong       size;
+    int         scale;
+
+    /* Decode the image at the smallest DCT scale that is large enough */
+    __MGL_result = grOK;
+    if (width <= 0 || height <= 0) {
+        SETERROR(grInvalidBitmap);
+        return NULL;
+        }
+    if ((scale = findScale(f,dwOffset,dwSize,width,height)) == 0)
+        return NULL;
+    if ((bitmap = loadJPEG(f,dwOffset,dwSize,0,scale)) == NULL)
+        return NULL;
+    if (bitmap->width == width && bitmap->height == height && bitmap->bitsPerPixel == 24)
+        return bitmap;
+
+    /* Allocate the final bitmap and resample the decoded image into it */
+    size = sizeof(bitmap_t) + sizeof(pixel_format_t) + (ulong)width * 3 * height;
+    if ((scaled = PM_malloc(size)) == NULL) {
+        MGL_unloadBitmap(bitmap);
+        FATALERROR(grNoMem);
+        return NULL;
+        }
+    scaled->width = width;
+    scaled->height = height;
+    scaled->bitsPerPixel = 24;
+    scaled->bytesPerLine = width * 3;
+    scaled->pal = NULL;
+    scaled->pf = (pixel_format_t*)((uchar*)scaled + sizeof(bitmap_t));
+    memcpy(scaled->pf,&_MGL_pixelFormats[pfRGB24],sizeof(pixel_format_t));
+    scaled->surface = (uchar*)scaled->pf + sizeof(pixel_format_t);
+    if ((memDC = MGL_createCustomDC(width,height,24,scaled->pf,scaled->bytesPerLine,scaled->surface,NULL)) == NULL) {
+        MGL_unloadBitmap(bitmap);
+        PM_free(scaled);
+        return NULL;
+        }
+    MGL_resampleBitmap(memDC,0,0,width,height,bitmap,MGL_RESAMPLE_FAST,MGL_REPLACE_MODE);
+    MGL_destroyDC(memDC);
+    MGL_unloadBitmap(bitmap);
+    return scaled;
+}
+
+/****************************************************************************
+DESCRIPTION:
+Load a JPEG bitmap file from disk scaled to a specific size.
+
+HEADER:
+mgraph.h
+
+PARAMETERS:
+JPEGName    - Name of JPEG file to load
+width       - Width of the bitmap to create
+height      - Height of the bitmap to create
+
+RETURNS:
+Pointer to the loaded JPEG file, NULL on error.
+
+REMARKS:
+Locates the specified JPEG file and loads it into a 24-bit RGB lightweight
+bitmap of exactly the specified size. This function is intended for
+generating thumbnails and previews, and is much faster than loading the
+full size image with MGL_loadJPEG and then reducing it.
+
+The JPEG decoder can reduce the image by a factor of 2, 4 or 8 in the DCT
+domain as it is decoded, which avoids most of the work of decoding the full
+size image. The largest reduction that still produces an image at least as
+large as the requested size is used, and the result is then resampled to
+the final size with the MGL_RESAMPLE_FAST filter. Images reduced in the
+DCT domain are also decoded with the fast integer IDCT, which is more than
+good enough for reduced size images.
+
+See MGL_loadJPEG for more information on the algorithm that MGL uses when
+searching for bitmap files on disk.
+
+SEE ALSO:
+MGL_loadJPEG, MGL_loadJPEGScaledExt, MGL_loadJPEGIntoDCScaled,
+MGL_resampleBitmap, MGL_unloadBitmap
+****************************************************************************/
+bitmap_t * MGLAPI MGL_loadJPEGScaled(
+    const char *JPEGName,
+    int width,
+    int height)
+{
+    FILE        *f;
+    bitmap_t    *b;
+
+    __MGL_result = grOK;
+    if ((f = _MGL_openFile(MGL_BITMAPS, JPEGName, "rb")) == NULL) {
+        __MGL_result = grBitmapNotFound;
+        return NULL;
+        }
+    b = MGL_loadJPEGScaledExt(f,0,_MGL_fileSize(f),width,height);
+    __MGL_fclose(f);
+    return b;
+}
+
+/****************************************************************************
+PARAMETERS:
+dc              - Device context being loaded into (NULL if none)
 f               - Open binary file to read bitmap from
 dwOffset        - Offset to start of JPEG file within open file
 dwSize          - Size of JPEG file in bytes
-dstLeft         - Left coordinate to load JPEG at
-dstTop          - Top coordinate to load JPEG at
 num8BitColors   - Number of colors for 8-bit image, 0 for RGB images, -1 for grayscale
+bandHeight      - Number of scanlines in each band (0 for default)
+callback        - Callback to receive each decoded band
+cookie          - Cookie passed to the callback
 
 RETURNS:
-Pointer to the loaded JPEG file, NULL on error.
+True on success, false on error or if the callback aborted decoding.
 
 REMARKS:
-This function is the same as MGL_loadJPEGIntoDC, however it loads the file from
-a previously open file. This allows you to create your own large files with
-multiple files embedded in them.
-
-SEE ALSO:
-MGL_loadJPEGIntoDC, MGL_loadBitmapIntoDC
+Internal function to decode a JPEG file a band of scanlines at a time.
+Only a single band of scanlines is ever allocated, and the scanlines are
+decoded directly into the band in the native RGB byte order of the decoder
+so no intermediate conversion is required. When a device context is passed
+in it supplies the palette for 8-bit quantized decoding, and receives the
+grayscale palette for grayscale images.
 ****************************************************************************/
-ibool MGLAPI MGL_loadJPEGIntoDCExt(
+static ibool streamJPEG(
     MGLDC *dc,
     FILE *f,
     ulong dwOffset,
     ulong dwSize,
-    int dstLeft,
-    int dstTop,
-    int num8BitColors)
+    int num8BitColors,
+    int bandHeight,
+    bandcallback_t callback,
+    void *cookie)
 {
     bitmap_t        bmp;
     jpeg_decompress cinfo;      /* Main JPEG decompressor object        */
@@ -534,8 +869,8 @@ ibool MGLAPI MGL_loadJPEGIntoDCExt(
     uchar           cmap_green[256];
     uchar           cmap_blue[256];
     uchar           *colormap[3];
-    ibool           oldCheckId;
-    int             i;
+    ibool           ok = true;
+    int             i,top;
     uchar           *p;
 
     /* We set up the normal JPEG error routines, then override error_exit */
@@ -558,7 +893,7 @@ ibool MGLAPI MGL_loadJPEGIntoDCExt(
     /* Initialize the JPEG decompression object and read header */
     __MGL_fseek(f,dwOffset,SEEK_SET);
     jpeg_create_decompress(&cinfo);
-    jpeg_stdio_src(&cinfo, f);
+    my_jpeg_src(&cinfo, f);
     jpeg_read_header(&cinfo, TRUE);
     if (cinfo.num_components != 1 && cinfo.num_components != 3) {
         /* Only support 24-bit or grayscale images! */
@@ -569,27 +904,31 @@ ibool MGLAPI MGL_loadJPEGIntoDCExt(
     if (cinfo.num_components == 1)
         num8BitColors = -1;
 
-    /* Allocate a temporary bitmap for the bitmap scanlines */
+    /* Allocate a temporary bitmap for a single band of scanlines */
+    if (bandHeight <= 0)
+        bandHeight = (int)MAX(1L,STREAM_BAND_PIXELS / (long)cinfo.image_width);
+    bandHeight = MIN(bandHeight,(int)cinfo.image_height);
     bmp.width = cinfo.image_width;
-    bmp.height = 1;
+    bmp.height = bandHeight;
     if (num8BitColors != 0) {
         bmp.bitsPerPixel = 8;
         bmp.bytesPerLine = cinfo.image_width;
         bmp.pal = pal;
+        bmp.pf = NULL;
         }
     else {
         bmp.bitsPerPixel = 24;
         bmp.bytesPerLine = cinfo.image_width*3;
+        bmp.pal = NULL;
         bmp.pf = &_MGL_pixelFormats[pfBGR24];
         }
-    if ((bmp.surface = PM_malloc(bmp.bytesPerLine)) == NULL) {
+    if ((bmp.surface = PM_malloc((long)bmp.bytesPerLine * bandHeight)) == NULL) {
         jpeg_destroy_decompress(&cinfo);
         FATALERROR(grNoMem);
         return false;
         }
-    oldCheckId = MGL_checkIdentityPalette(false);
 
-    /* Store the grayscale palette in the destination DC */
+    /* Build the grayscale palette and store it in the destination DC */
     if (num8BitColors == -1) {
         for (i = 0; i < 256; i++) {
             pal[i].red = i;
@@ -597,7 +936,7 @@ ibool MGLAPI MGL_loadJPEGIntoDCExt(
             pal[i].blue = i;
             pal[i].alpha = 0;
             }
-        if (dc->mi.modeFlags & MGL_IS_COLOR_INDEX) {
+        if (dc && (dc->mi.modeFlags & MGL_IS_COLOR_INDEX)) {
             MGL_setPalette(dc,pal,256,0);
             if (MGL_getVisualPage(dc) == MGL_getActivePage(dc))
                 MGL_realizePalette(dc,256,0,false);
@@ -629,21 +968,78 @@ ibool MGLAPI MGL_loadJPEGIntoDCExt(
         cinfo.out_color_space = JCS_GRAYSCALE;
         }
 
-    /* Start decompressor and decode the image a scanline at a time */
+    /* Start decompressor and decode the image a band at a time */
     jpeg_start_decompress(&cinfo);
-    p = bmp.surface;
     while (cinfo.output_scanline < cinfo.output_height) {
-        jpeg_read_scanlines(&cinfo, &p, 1);
-        MGL_putBitmap(dc,dstLeft,dstTop+cinfo.output_scanline,&bmp,MGL_REPLACE_MODE);
+        top = cinfo.output_scanline;
+        for (i = 0; i < bandHeight && cinfo.output_scanline < cinfo.output_height; i++) {
+            p = (uchar*)bmp.surface + (long)i * bmp.bytesPerLine;
+            jpeg_read_scanlines(&cinfo, &p, 1);
+            }
+        bmp.height = i;
+        if (!callback(&bmp,top,cookie)) {
+            ok = false;
+            break;
+            }
         }
 
     /* Finish decompression and clean up */
-    jpeg_finish_decompress(&cinfo);
+    if (ok)
+        jpeg_finish_decompress(&cinfo);
+    else
+        jpeg_abort_decompress(&cinfo);
     jpeg_destroy_decompress(&cinfo);
     PM_free(bmp.surface);
-    MGL_checkIdentityPalette(oldCheckId);
     __MGL_fseek(f,dwSize,SEEK_SET);
-    return true;
+    return ok;
+}
+
+/****************************************************************************
+DESCRIPTION:
+Loads a JPEG file directly into an existing device context using an open file.
+
+HEADER:
+mgraph.h
+
+PARAMETERS:
+dc              - Device context to load bitmap into
+f               - Open binary file to read bitmap from
+dwOffset        - Offset to start of JPEG file within open file
+dwSize          - Size of JPEG file in bytes
+dstLeft         - Left coordinate to load JPEG at
+dstTop          - Top coordinate to load JPEG at
+num8BitColors   - Number of colors for 8-bit image, 0 for RGB images, -1 for grayscale
+
+RETURNS:
+True if the JPEG file was loaded, false on error.
+
+REMARKS:
+This function is the same as MGL_loadJPEGIntoDC, however it loads the file from
+a previously open file. This allows you to create your own large files with
+multiple files embedded in them.
+
+SEE ALSO:
+MGL_loadJPEGIntoDC, MGL_loadBitmapIntoDC
+****************************************************************************/
+ibool MGLAPI MGL_loadJPEGIntoDCExt(
+    MGLDC *dc,
+    FILE *f,
+    ulong dwOffset,
+    ulong dwSize,
+    int dstLeft,
+    int dstTop,
+    int num8BitColors)
+{
+    putbandinfo_t   info;
+    ibool           oldCheckId,ret;
+
+    info.dc = dc;
+    info.dstLeft = dstLeft;
+    info.dstTop = dstTop;
+    oldCheckId = MGL_checkIdentityPalette(false);
+    ret = streamJPEG(dc,f,dwOffset,dwSize,num8BitColors,0,_MGL_putBand,&info);
+    MGL_checkIdentityPalette(oldCheckId);
+    return ret;
 }
 
 /****************************************************************************
@@ -721,6 +1117,214 @@ ibool MGLAPI MGL_loadJPEGIntoDC(
     return ret;
 }
 
+/****************************************************************************
+DESCRIPTION:
+Loads a JPEG file scaled to a destination rectangle in an existing device
+context using an open file.
+
+HEADER:
+mgraph.h
+
+PARAMETERS:
+dc          - Device context to load bitmap into
+f           - Open binary file to read bitmap from
+dwOffset    - Offset to start of JPEG file within open file
+dwSize      - Size of JPEG file in bytes
+dstLeft     - Left coordinate of destination rectangle
+dstTop      - Top coordinate of destination rectangle
+dstRight    - Right coordinate of destination rectangle
+dstBottom   - Bottom coordinate of destination rectangle
+
+RETURNS:
+True if the JPEG file was loaded, false on error.
+
+REMARKS:
+This function is the same as MGL_loadJPEGIntoDCScaled, however it loads the
+file from a previously open file. This allows you to create your own large
+files with multiple files embedded in them.
+
+SEE ALSO:
+MGL_loadJPEGIntoDCScaled, MGL_loadJPEGIntoDCExt
+****************************************************************************/
+ibool MGLAPI MGL_loadJPEGIntoDCScaledExt(
+    MGLDC *dc,
+    FILE *f,
+    ulong dwOffset,
+    ulong dwSize,
+    int dstLeft,
+    int dstTop,
+    int dstRight,
+    int dstBottom)
+{
+    bitmap_t    *bitmap;
+    int         scale,width = dstRight - dstLeft,height = dstBottom - dstTop;
+
+    __MGL_result = grOK;
+    if (width <= 0 || height <= 0)
+        return true;
+    if ((scale = findScale(f,dwOffset,dwSize,width,height)) == 0)
+        return false;
+    if ((bitmap = loadJPEG(f,dwOffset,dwSize,0,scale)) == NULL)
+        return false;
+    if (bitmap->width == width && bitmap->height == height)
+        MGL_putBitmap(dc,dstLeft,dstTop,bitmap,MGL_REPLACE_MODE);
+    else
+        MGL_resampleBitmap(dc,dstLeft,dstTop,dstRight,dstBottom,bitmap,MGL_RESAMPLE_FAST,MGL_REPLACE_MODE);
+    MGL_unloadBitmap(bitmap);
+    return true;
+}
+
+/****************************************************************************
+DESCRIPTION:
+Loads a JPEG file scaled to a destination rectangle in an existing device
+context.
+
+HEADER:
+mgraph.h
+
+PARAMETERS:
+dc          - Device context to load bitmap into
+JPEGName    - Name of JPEG file to load
+dstLeft     - Left coordinate of destination rectangle
+dstTop      - Top coordinate of destination rectangle
+dstRight    - Right coordinate of destination rectangle
+dstBottom   - Bottom coordinate of destination rectangle
+
+RETURNS:
+True if the JPEG file was loaded, false on error.
+
+REMARKS:
+Locates the specified JPEG file and draws it scaled to the destination
+rectangle in the specified device context. The image is reduced in the DCT
+domain as it is decoded and then resampled to the final size, so this is
+much faster than loading the full size image and stretching it when
+drawing thumbnails and previews. See MGL_loadJPEGScaled for more details.
+
+See MGL_loadJPEG for more information on the algorithm that MGL uses when
+searching for bitmap files on disk.
+
+SEE ALSO:
+MGL_loadJPEGScaled, MGL_loadJPEGIntoDC, MGL_resampleBitmap
+****************************************************************************/
+ibool MGLAPI MGL_loadJPEGIntoDCScaled(
+    MGLDC *dc,
+    const char *JPEGName,
+    int dstLeft,
+    int dstTop,
+    int dstRight,
+    int dstBottom)
+{
+    FILE    *f;
+    ibool   ret;
+
+    __MGL_result = grOK;
+    if ((f = _MGL_openFile(MGL_BITMAPS, JPEGName, "rb")) == NULL) {
+        __MGL_result = grBitmapNotFound;
+        return false;
+        }
+    ret = MGL_loadJPEGIntoDCScaledExt(dc,f,0,_MGL_fileSize(f),dstLeft,dstTop,dstRight,dstBottom);
+    __MGL_fclose(f);
+    return ret;
+}
+
+/****************************************************************************
+DESCRIPTION:
+Decodes a JPEG file a band of scanlines at a time using an open file.
+
+HEADER:
+mgraph.h
+
+PARAMETERS:
+f           - Open binary file to read bitmap from
+dwOffset    - Offset to start of JPEG file within open file
+dwSize      - Size of JPEG file in bytes
+bandHeight  - Number of scanlines in each band (0 for default)
+callback    - Callback to receive each decoded band
+cookie      - Cookie passed to the callback
+
+RETURNS:
+True if the JPEG file was decoded, false on error or if aborted.
+
+REMARKS:
+This function is the same as MGL_streamJPEG, however it loads the file from
+a previously open file. This allows you to create your own large files with
+multiple files embedded in them.
+
+SEE ALSO:
+MGL_streamJPEG, MGL_loadJPEGIntoDCExt
+****************************************************************************/
+ibool MGLAPI MGL_streamJPEGExt(
+    FILE *f,
+    ulong dwOffset,
+    ulong dwSize,
+    int bandHeight,
+    bandcallback_t callback,
+    void *cookie)
+{
+    return streamJPEG(NULL,f,dwOffset,dwSize,0,bandHeight,callback,cookie);
+}
+
+/****************************************************************************
+DESCRIPTION:
+Decodes a JPEG file a band of scanlines at a time.
+
+HEADER:
+mgraph.h
+
+PARAMETERS:
+JPEGName    - Name of JPEG file to decode
+bandHeight  - Number of scanlines in each band (0 for default)
+callback    - Callback to receive each decoded band
+cookie      - Cookie passed to the callback
+
+RETURNS:
+True if the JPEG file was decoded, false on error or if aborted.
+
+REMARKS:
+Locates the specified JPEG file and decodes it from top to bottom, calling
+the callback function with each band of scanlines as soon as it has been
+decoded. Only a single band of scanlines is ever held in memory, so this
+function can be used to process images that are much larger than would fit
+in memory as a single bitmap, or to display an image while it is still being
+decoded.
+
+The band passed to the callback is only valid for the duration of the
+callback, and the top parameter is the index of the first scanline in the
+band. The width of the band is always the width of the image, and the height
+is bandHeight scanlines except for the last band which may be shorter. If
+bandHeight is 0, a default band height is chosen that keeps the band to
+around 64Kb pixels. Color images are delivered in the native format of the
+decoder as 24-bit bitmaps with the pixel format describing the byte order,
+and grayscale images are delivered as 8-bit bitmaps with a grayscale palette.
+If the callback returns false, decoding is stopped and this function returns
+false.
+
+To decode into your own buffer in a different pixel format, wrap the buffer
+with MGL_createCustomDC and use MGL_loadJPEGIntoDC, which streams the bands
+into the device context and converts each band as it is handed off.
+
+SEE ALSO:
+MGL_streamJPEGExt, MGL_loadJPEGIntoDC, MGL_streamPNG
+****************************************************************************/
+ibool MGLAPI MGL_streamJPEG(
+    const char *JPEGName,
+    int bandHeight,
+    bandcallback_t callback,
+    void *cookie)
+{
+    FILE    *f;
+    ibool   ret;
+
+    __MGL_result = grOK;
+    if ((f = _MGL_openFile(MGL_BITMAPS, JPEGName, "rb")) == NULL) {
+        __MGL_result = grBitmapNotFound;
+        return false;
+        }
+    ret = MGL_streamJPEGExt(f,0,_MGL_fileSize(f),bandHeight,callback,cookie);
+    __MGL_fclose(f);
+    return ret;
+}
+
 /****************************************************************************
 DESCRIPTION:
 Save a portion of a device context to JPEG on disk.
@@ -781,7 +1385,7 @@ ibool MGLAPI MGL_saveJPEGFromDC(
 
     /* Allocate a temporary buffer in the correct format for compression */
     if ((memDC = MGL_createMemoryDC(right-left,1,24,&_MGL_pixelFormats[pfBGR24])) == NULL) {
-        fclose(f);
+        __MGL_fclose(f);
         __MGL_result = grNoMem;
         return false;
         }
@@ -799,7 +1403,7 @@ ibool MGLAPI MGL_saveJPEGFromDC(
          * We need to clean up the JPEG object, close the output file, and
          * return.
          */
-        fclose(f);
+        __MGL_fclose(f);
         MGL_destroyDC(memDC);
         jpeg_destroy_compress(&cinfo);
         __MGL_result = grErrorBPD;
@@ -836,7 +1440,7 @@ ibool MGLAPI MGL_saveJPEGFromDC(
     /* Finish compression and clean up */
     jpeg_finish_compress(&cinfo);
     jpeg_destroy_compress(&cinfo);
-    fclose(f);
+    __MGL_fclose(f);
     MGL_destroyDC(memDC);
     return true;
 }
@@ -875,3 +1479,17 @@ ibool MGLAPI MGL_availableJPEG(
     __MGL_fclose(f);
     return true;
 }
+
+/****************************************************************************
+REMARKS:
+Makes sure the JPEG library has been loaded. The library is loaded on the
+first call into it, which is not thread safe, so this is called before any
+asynchronous loader threads are started.
+{secret}
+****************************************************************************/
+void _MGL_loadJPEGLibrary(void)
+{
+    struct jpeg_error_mgr   jerr;
+
+    jpeg_std_error(&jerr);
+}
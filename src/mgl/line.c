@@ -410,6 +410,8 @@ void MGLAPI MGL_lineCoordExt(
             drawClippedLine = _MGL_drawClippedLineInt;
         else
             drawClippedLine = _MGL_drawClippedFatLineInt;
+        MARK_DIRTY_VIEW(&DC,MIN(x1,x2),MIN(y1,y2),
+            MAX(x1,x2)+DC.a.penWidth+1,MAX(y1,y2)+DC.a.penHeight+1);
         BEGIN_VISIBLE_CLIP_LIST(&DC);
         if (DC.clipRegionScreen) {
             x1 += DC.viewPort.left;   y1 += DC.viewPort.top;
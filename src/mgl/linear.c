@@ -0,0 +1,187 @@
+/****************************************************************************
+*
+*                   SciTech Multi-platform Graphics Library
+*
+*  ========================================================================
+*
+*   Copyright (C) 1991-2004 SciTech Software, Inc. All rights reserved.
+*
+*   This file may be distributed and/or modified under the terms of the
+*   GNU General Public License version 2.0 as published by the Free
+*   Software Foundation and appearing in the file LICENSE.GPL included
+*   in the packaging of this file.
+*
+*   Licensees holding a valid Commercial License for this product from
+*   SciTech Software, Inc. may use this file in accordance with the
+*   Commercial License Agreement provided with the Software.
+*
+*   This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING
+*   THE WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+*   PURPOSE.
+*
+*   See http://www.scitechsoft.com/license/ for information about
+*   the licensing options available and how to purchase a Commercial
+*   License Agreement.
+*
+*   Contact license@scitechsoft.com if any conditions of this licensing
+*   are not clear to you, or you have questions about licensing options.
+*
+*  ========================================================================
+*
+* Language:     ANSI C
+* Environment:  Any
+*
+* Description:  Conversion between sRGB encoded pixels and linear light
+*               values, used by the software blending and resampling code
+*               when linear light mode is enabled. The conversions are
+*               done with an 8 bit to 16 bit lookup table to decode and a
+*               4096 entry table (indexed by the top 12 bits of the linear
+*               value) to encode, so they cost little more than unpacking
+*               and packing the pixels. Any 8 bit value converted to
+*               linear light and back is returned unchanged.
+*
+****************************************************************************/
+
+#include "mgl.h"
+#include <math.h>
+
+/*--------------------------- Global Variables ----------------------------*/
+
+static ushort  toLinear[256];          /* sRGB to 16 bit linear light  */
+static uchar   fromLinear[4096];       /* 12 bit linear light to sRGB  */
+static ibool   haveTables = false;
+
+/*------------------------- Implementation --------------------------------*/
+
+/****************************************************************************
+REMARKS:
+Builds the linear light conversion tables the first time they are needed.
+{secret}
+****************************************************************************/
+void _MGL_initLinearLight(void)
+{
+    double  v;
+    int     i;
+
+    if (haveTables)
+        return;
+    for (i = 0; i < 256; i++) {
+        v = i / 255.0;
+        v = (v <= 0.04045) ? v / 12.92 : pow((v + 0.055) / 1.055,2.4);
+        toLinear[i] = (ushort)(v * 65535.0 + 0.5);
+        }
+    for (i = 0; i < 4096; i++) {
+        v = (i * 16 + 8) / 65535.0;
+        v = (v <= 0.0031308) ? v * 12.92 : 1.055 * pow(v,1.0 / 2.4) - 0.055;
+        fromLinear[i] = (uchar)(v >= 1.0 ? 255 : (int)(v * 255.0 + 0.5));
+        }
+    haveTables = true;
+}
+
+/****************************************************************************
+PARAMETERS:
+src     - Source pixels in packed ARGB format
+dst     - Place to store the linear light pixels (B,G,R,A order)
+count   - Number of pixels to convert
+
+REMARKS:
+Converts a run of ARGB pixels to 16 bits per component linear light. The
+alpha channel is not gamma encoded, so it is simply scaled up to 16 bits.
+{secret}
+****************************************************************************/
+void _MGL_spanToLinear(
+    const M_uint32 *src,
+    ushort *dst,
+    int count)
+{
+    M_uint32    c;
+
+    for (; count > 0; count--, dst += 4) {
+        c = *src++;
+        dst[0] = toLinear[c & 0xFF];
+        dst[1] = toLinear[(c >> 8) & 0xFF];
+        dst[2] = toLinear[(c >> 16) & 0xFF];
+        dst[3] = (ushort)((c >> 24) * 257);
+        }
+}
+
+/****************************************************************************
+PARAMETERS:
+src     - Source pixels in linear light (B,G,R,A order)
+dst     - Place to store the packed ARGB pixels
+count   - Number of pixels to convert
+
+REMARKS:
+Converts a run of 16 bits per component linear light pixels back to
+packed ARGB pixels.
+{secret}
+****************************************************************************/
+void _MGL_spanFromLinear(
+    const ushort *src,
+    M_uint32 *dst,
+    int count)
+{
+    for (; count > 0; count--, src += 4) {
+        *dst++ = ((M_uint32)(src[3] >> 8) << 24)
+            | ((M_uint32)fromLinear[src[2] >> 4] << 16)
+            | ((M_uint32)fromLinear[src[1] >> 4] << 8)
+            | fromLinear[src[0] >> 4];
+        }
+}
+
+/* Blend a single sRGB component in linear light, dividing by 255 with the
+ * usual (x + 128 + ((x + 128) >> 8)) >> 8 approximation.
+ */
+
+#define BLEND_LINEAR(c,s,d,a,ia)                                        \
+{                                                                       \
+    M_uint32 t = toLinear[s] * (a) + toLinear[d] * (ia) + 128; \
+    (c) = fromLinear[((t + (t >> 8)) >> 8) >> 4];                  \
+}
+
+/****************************************************************************
+PARAMETERS:
+dst         - Destination pixels in packed ARGB format, blended in place
+src         - Source pixels in packed ARGB format
+count       - Number of pixels to blend
+constAlpha  - Constant alpha (0-255), or -1 to use the source alpha
+blendAlpha  - True to blend the alpha channel, false to leave it alone
+
+REMARKS:
+Blends a run of source pixels over the destination pixels in linear light
+with DstColor = SrcColor * Alpha + DstColor * (1-Alpha). If blendAlpha is
+true the destination alpha is computed with the same formula (alpha is
+not gamma encoded, so it is blended directly).
+{secret}
+****************************************************************************/
+void _MGL_blendLinearSpan(
+    M_uint32 *dst,
+    const M_uint32 *src,
+    int count,
+    int constAlpha,
+    ibool blendAlpha)
+{
+    M_uint32    s,d,a,ia,t,da,R,G,B;
+
+    for (; count > 0; count--, dst++) {
+        s = *src++;
+        a = (constAlpha < 0) ? (s >> 24) : (M_uint32)constAlpha;
+        if (a == 0)
+            continue;
+        if (a == 255) {
+            *dst = blendAlpha ? s : ((s & 0x00FFFFFFUL) | (*dst & 0xFF000000UL));
+            continue;
+            }
+        d = *dst;
+        ia = 255 - a;
+        da = d & 0xFF000000UL;
+        if (blendAlpha) {
+            t = (s >> 24) * a + (d >> 24) * ia + 128;
+            da = ((t + (t >> 8)) >> 8) << 24;
+            }
+        BLEND_LINEAR(R,(s >> 16) & 0xFF,(d >> 16) & 0xFF,a,ia);
+        BLEND_LINEAR(G,(s >> 8) & 0xFF,(d >> 8) & 0xFF,a,ia);
+        BLEND_LINEAR(B,s & 0xFF,d & 0xFF,a,ia);
+        *dst = da | (R << 16) | (G << 8) | B;
+        }
+}
@@ -86,10 +86,29 @@
 #define RESET_DEFAULT_CW()
 #endif
 
+/* Storage class for globals that must be private to each thread, such as
+ * the result code and scratch buffer used by the resource loaders. On
+ * compilers without thread local storage MGL_NO_THREAD_LOCAL is defined
+ * and the asynchronous loader never creates any worker threads.
+ */
+
+#if defined(__GNUC__)
+#define MGL_THREAD_LOCAL    __thread
+#elif defined(_MSC_VER) || (defined(__WATCOMC__) && defined(__WINDOWS32__))
+#define MGL_THREAD_LOCAL    __declspec(thread)
+#else
+#define MGL_THREAD_LOCAL
+#define MGL_NO_THREAD_LOCAL
+#endif
+
 /* Define the default size of the MGL scratch buffer    */
 
 #define DEF_MGL_BUFSIZE 32*1024
 
+/* Define the largest chunk read at a time when decoding RLE images */
+
+#define RLE_CHUNK_SIZE  (256*1024L)
+
 /* Flags to ignore VBE drivers to speed up detection process */
 
 #define grIGNORE_VBE    0xFD
@@ -236,6 +255,29 @@ typedef struct {
 
 #define SENTINEL    32767       /* Very large sentinel value            */
 
+/* Default number of pixels in each band for streaming bitmap decoding */
+
+#define STREAM_BAND_PIXELS  (256L * 256L)
+
+/* Destination for streamed bitmap bands loaded into a device context */
+
+typedef struct {
+    MGLDC   *dc;            /* Device context to load into          */
+    int     dstLeft;        /* Left coordinate to load image at     */
+    int     dstTop;         /* Top coordinate to load image at      */
+    } putbandinfo_t;
+
+/* Header block for bitmaps returned by MGL_mapBitmap and MGL_mapSurface */
+
+typedef struct {
+    bitmap_t        bm;             /* Bitmap header returned to caller */
+    pixel_format_t  pf;             /* Pixel format for RGB bitmaps     */
+    palette_t       pal[256];       /* Copy of the bitmap palette       */
+    void            *base;          /* Base of file mapping (or NULL)   */
+    ulong           size;           /* Size of the file mapping         */
+    bitmap_t        *copy;          /* Copy loaded if mapping failed    */
+    } mappedBitmap;
+
 /* Internal structures for region manipulation */
 
 #define DEF_NUM_SEGMENTS    500
@@ -328,6 +370,18 @@ typedef struct {
 
 #define T1FONTLIB(lib)  ((t1_font_lib *)lib)
 
+/* Packed metrics for a single glyph in a bitmap font */
+
+typedef struct {
+    M_int32         offset;         /* Offset into character definition */
+    short           width;          /* Character width                  */
+    short           iwidth;         /* Character image width            */
+    short           loc;            /* Character location               */
+    short           charAscent;     /* Character ascent value           */
+    short           charDescent;    /* Character descent value          */
+    char            valid;          /* True if the glyph is valid       */
+    } glyph_metrics;
+
 /* Internal MGL bitmap font structure */
 
 typedef struct {
@@ -341,26 +395,47 @@ typedef struct {
     short           descent;        /* Font descent value               */
     short           leading;        /* Font leading value               */
     short           pointSize;      /* Point size for the font          */
-    short           startGlyph;     /* The index of the first character */
-    short           numGlyphs;      /* The amount of glyphs in this font*/
-    short           *width;         /* Character width table            */
-    long            *offset;        /* Offset table into character defn.*/
-    short           *iwidth;        /* Character image width table      */
-    short           *loc;           /* Character location table         */
-    short           *charAscent;    /* Character ascent value           */
-    short           *charDescent;   /* Character descent value          */
-    char            *valid;         /* True if the glyph is valid       */
+    int             startGlyph;     /* The index of the first character */
+    int             numGlyphs;      /* The amount of glyphs in this font*/
+    glyph_metrics   **metrics;      /* Paged glyph metric tables        */
     uchar           *def;           /* Bitmap definitions for font      */
     bitmap_font_lib *lib;           /* Pointer to the library for font  */
-    long            bitmapBufferSize;/* Size of memory buffer for glyphs */
-    long            bitmapBufferUsed;/* How much of the bitmap buffer memory is in use ie: last index for insertion */
+    long            charSize;       /* Character size in 26.6 points    */
     ibool           antialiased;     /* Font is antialiased             */
     TT_Instance     instance;        /* TrueType font instance handle  */
     } bitmap_font;
 
-/* Define the overhead per character for the font index tables */
+/* Composited text run for a horizontal string. The mask is a mono bitmap
+ * for bitmap fonts, or an 8-bit coverage map for anti-aliased fonts.
+ */
+
+typedef struct {
+    int             left;           /* Left edge of mask from pen start */
+    int             width;          /* Width of the mask in pixels      */
+    int             height;         /* Height of the mask in pixels     */
+    int             stride;         /* Bytes per line in the mask       */
+    int             advance;        /* Total pen advance for the string */
+    uchar           *mask;          /* Mono or coverage mask for run    */
+    } text_run;
+
+/* The glyph metrics for bitmap fonts are stored in pages of 256 glyphs.
+ * Fonts loaded from disk have all their pages allocated in one block with
+ * the font, but for TrueType fonts each page is only allocated when a glyph
+ * in the page is first generated, and pages that are not yet allocated
+ * point to a shared page of empty (invalid) glyph metrics.
+ */
+
+#define METRIC_PAGE_SHIFT   8
+#define METRIC_PAGE_SIZE    (1 << METRIC_PAGE_SHIFT)
+#define METRIC_PAGES(n)     (((n) + METRIC_PAGE_SIZE-1) >> METRIC_PAGE_SHIFT)
 
-#define FONT_INDEX_SIZE (5 * sizeof(short) + sizeof(long) + sizeof(char))
+/* Define the overhead for the font index tables for a font with n glyphs */
+
+#define FONT_INDEX_SIZE(n)  (METRIC_PAGES(n) * sizeof(glyph_metrics*) + (n) * sizeof(glyph_metrics))
+
+/* Macro to find the metrics for a glyph in a bitmap font */
+
+#define BIT_METRICS(fnt,ch) (&BITFONT(fnt)->metrics[(uint)(ch) >> METRIC_PAGE_SHIFT][(uint)(ch) & (METRIC_PAGE_SIZE-1)])
 
 /* Missing symbol for bitmap fonts is index numGlyphs-1 */
 
@@ -377,7 +452,7 @@ typedef struct {
 /* Macros to test for the missing symbol */
 
 #define VEC_ISMISSING(fnt,ch)   (VECFONT(fnt)->offset[(uint)ch] == -1)
-#define BIT_ISMISSING(fnt,ch)   (BITFONT(fnt)->offset[(uint)ch] == -1)
+#define BIT_ISMISSING(fnt,ch)   (BIT_METRICS(fnt,ch)->offset == -1)
 
 /* Macros to swap two values */
 
@@ -433,6 +508,7 @@ typedef void (MGLAPIP ellipseArcFunc)(int left,int top,int A,int B,int startangl
 typedef void (MGLAPIP fillEllipseArcFunc)(int left,int top,int A,int B,int startangle,int endangle,int clip);
 typedef void (*clippedLineIntFunc)(int x1,int y1,int x2,int y2,ibool drawLast,int clipLeft,int clipTop,int clipRight,int clipBottom);
 typedef void (*clippedLineFXFunc)(fix32_t x1,fix32_t y1,fix32_t x2,fix32_t y2,int clipLeft,int clipTop,int clipRight,int clipBottom);
+typedef void (*bandFunc)(void *ctx,int top,int bottom);
 
 /* Macro to compute the address of a pixel with a device surface. This
  * works for all packed pixel modes (the only ones that can be directly
@@ -718,6 +794,56 @@ typedef enum {
         (dc)->r.EndVisibleClipRegion(dc);           \
 }
 
+/* Inverse color map structure, which maps 15-bit RGB colors to the closest
+ * color in a color index palette. The map is cached with the device
+ * context along with a copy of the palette it was built for.
+ */
+
+struct _MGL_invCMap {
+    palette_t   pal[256];           /* Palette the map was built for    */
+    int         palSize;            /* Number of entries in the palette */
+    uchar       map[32768];         /* 5:5:5 RGB to color index map     */
+    };
+
+/* Macro to compute the index into an inverse color map for an RGB color */
+
+#define INVCMAP_INDEX(R,G,B)                                    \
+    ((((uint)(R) >> 3) << 10) | (((uint)(G) >> 3) << 5) | ((uint)(B) >> 3))
+
+/* Span dithering information, set up by _MGL_setupDither for converting
+ * RGB pixels to an 8, 15 or 16 bits per pixel destination.
+ */
+
+#define DITHER_8        0               /* 8bpp halftone palette        */
+#define DITHER_555      1               /* 15bpp 5:5:5 RGB              */
+#define DITHER_565      2               /* 16bpp 5:6:5 RGB              */
+
+typedef struct {
+    int         format;                 /* Destination format           */
+    ibool       diffuse;                /* True for error diffusion     */
+    void        *surface;               /* Destination surface          */
+    int         columns;                /* Destination surface width    */
+    uchar       xlat[256];              /* Halftone to destination index*/
+    } MGL_dither;
+
+/* Macros to add the bounds of a drawing operation to the dirty region
+ * for a device context when damage tracking is enabled. MARK_DIRTY takes
+ * the coordinates in screen space, while MARK_DIRTY_VIEW takes them in
+ * viewport space and clips them to the current clip rectangle.
+ */
+
+#define MARK_DIRTY(dc,l,t,r,b)                      \
+{                                                   \
+    if ((dc)->dirtyRegion)                          \
+        _MGL_markDirty(dc,l,t,r,b);                 \
+}
+
+#define MARK_DIRTY_VIEW(dc,l,t,r,b)                 \
+{                                                   \
+    if ((dc)->dirtyRegion)                          \
+        _MGL_markDirtyView(dc,l,t,r,b);             \
+}
+
 /* Macros to make the hardware current with a specific DC, and to
  * restore the hardware to the old DC if it was also a display device
  * context. This handles cases where a blit is made from a hardware
@@ -833,7 +959,7 @@ typedef enum {
 extern LIST             *_MGL_memDCList;
 extern LIST             *_MGL_winDCList;
 extern uint             _MGL_cw_default;
-extern int              __MGL_result;
+extern MGL_THREAD_LOCAL int __MGL_result;
 extern ibool            __MGL_useLinearBlits;
 extern char             _MGL_path[PM_MAX_PATH];
 extern device_entry     _MGL_deviceTable[MAX_DISPLAY_DEVICES];
@@ -841,7 +967,7 @@ extern int              _MGL_cntDevice;
 extern int              _MGL_glDevice;
 extern int              _MGL_numDevices;
 extern MGLDC            *_MGL_dcPtr;
-extern void             *_MGL_buf;
+extern MGL_THREAD_LOCAL void *_MGL_buf;
 extern int              _MGL_bufSize;
 extern segmentList_t    _MGL_segList;
 extern spanList_t       _MGL_spanList;
@@ -906,6 +1032,14 @@ void    _MGL_hookWindowProc(MGLDC *dc);
 void    _MGL_unhookWindowProc(MGLDC *dc);
 void    _MGL_unlockStaticPalette(MGLDC *dc);
 void    _MGL_lockStaticPalette(MGLDC *dc);
+int     _MGL_numProcessors(void);
+ibool   _MGL_createThread(void (*func)(void *arg),void *arg);
+void *  _MGL_createEvent(void);
+void    _MGL_signalEvent(void *event);
+void    _MGL_waitEvent(void *event);
+void    _MGL_destroyEvent(void *event);
+void *  _MGL_mapFile(const char *filename,ulong *size);
+void    _MGL_unmapFile(void *base,ulong size);
 
 /* Private platform independant routines */
 
@@ -917,7 +1051,10 @@ ibool   _MGL_destroyWindowedDC(MGLDC *dc);
 driverent *_MGL_findStaticDriver(const char *name);
 void    MGLAPI _MGL_setRenderingVectors(void);
 long    _MGL_fileSize(FILE *f);
+ibool   _MGL_statFile(const char *path,long *fileSize,long *fileTime);
+ibool   _MGL_getFileInfo(const char *path,long *fileSize,long *fileTime);
 FILE *  _MGL_openFile(const char *dir, const char *name, const char *mode);
+ibool   MGLAPI _MGL_putBand(const bitmap_t *band,int top,void *cookie);
 void    _MGL_initMalloc(void);
 void    _MGL_scratchTooSmall(void);
 void    _MGL_updateCurrentDC(MGLDC *dc);
@@ -972,6 +1109,11 @@ void    __MGL_findTextBounds(int x,int y,int width,rect_t *bounds);
 void    __MGL_getCharMetrics(wchar_t ch,metrics_t *m);
 void    __MGL_findUnderScoreLocation(int *x,int *y,int width);
 void    _MGL_generateGlyph(int ch, bitmap_font *font);
+uchar * _MGL_initGlyphMetrics(bitmap_font *font,ibool onDemand);
+glyph_metrics * _MGL_allocGlyphMetrics(bitmap_font *font,int glyph);
+void    _MGL_freeGlyphMetrics(bitmap_font *font);
+uchar * _MGL_getGlyphBitmap(bitmap_font *font,int glyph);
+void    _MGL_drawAntiAliasedGlyph(int x,int y,int width,int height,uchar *coverage);
 
 /* Text rendering functions */
 
@@ -979,6 +1121,87 @@ void    _MGL_drawStrVec(int x,int y,const char *str);
 void    _MGL_drawStrBitmap(int x,int y,const char *str);
 void    _MGL_drawStrBitmap_W(int x,int y,const wchar_t *str);
 
+/* Multi-threaded band blitting functions */
+
+ibool   _MGL_useBandThreads(long pixels);
+void    _MGL_runBands(int top,int bottom,bandFunc func,void *ctx);
+void    _MGL_destroyBandThreads(void);
+void    _MGL_destroyLoaderThreads(void);
+ibool   _MGL_bandBitBlt(MGLDC *dst,MGLDC *src,int left,int top,int right,int bottom,int dstLeft,int dstTop,int op);
+ibool   _MGL_bandStretchBlt(MGLDC *dst,MGLDC *src,int left,int top,int right,int bottom,int dstLeft,int dstTop,int dstRight,int dstBottom,int op);
+ibool   _MGL_bandPutBitmap(MGLDC *dc,int left,int top,int right,int bottom,int dstLeft,int dstTop,const bitmap_t *bitmap,int op);
+ibool   _MGL_bandBlendBlt(MGLDC *dst,MGLDC *src,int left,int top,int right,int bottom,int dstLeft,int dstTop,bltfx_t *fx);
+ibool   _MGL_bandBlendBitmap(MGLDC *dc,int left,int top,int right,int bottom,int dstLeft,int dstTop,const bitmap_t *bitmap,bltfx_t *fx);
+
+/* Decoded image cache functions */
+
+void    _MGL_destroyImageCache(void);
+
+/* Glyph cache functions */
+
+uchar * _MGL_findCachedGlyph(bitmap_font *font,int glyph,int dir);
+uchar * _MGL_addCachedGlyph(bitmap_font *font,int glyph,int dir,long size);
+void    _MGL_flushCachedGlyphs(void *face);
+void    _MGL_destroyGlyphCache(void);
+
+/* Anti-aliased glyph blending functions */
+
+ibool   _MGL_beginGlyphBlend(void);
+ibool   _MGL_blendGlyph(int x,int y,int width,int height,const uchar *coverage,int stride);
+void    _MGL_endGlyphBlend(void);
+
+/* Text run cache functions */
+
+text_run * _MGL_findTextRun(font_t *font,int spaceExtra,const uint *codes,int count);
+text_run * _MGL_addTextRun(font_t *font,int spaceExtra,const uint *codes,int count,long maskSize);
+uchar * _MGL_getTextRunBuffer(long size);
+void    _MGL_flushTextRuns(font_t *font);
+void    _MGL_destroyTextRunCache(void);
+
+/* Image library loading functions */
+
+void    _MGL_loadPNGLibrary(void);
+void    _MGL_loadJPEGLibrary(void);
+
+/* Pack file functions */
+
+void    _MGL_closePackFiles(void);
+
+/* Damage tracking functions */
+
+void    _MGL_markDirty(MGLDC *dc,int left,int top,int right,int bottom);
+void    _MGL_markDirtyView(MGLDC *dc,int left,int top,int right,int bottom);
+void    _MGL_markTextDirty(int x,int y,int width);
+
+/* Blit batching functions */
+
+void    _MGL_flushBatchDC(MGLDC *dc);
+void    _MGL_freeBatch(void);
+
+/* Software buffer heap functions */
+
+MGLBUF  *_MGL_allocHeapBuffer(MGLDC *dc,int width,int height,M_uint32 flags);
+void    _MGL_destroyBufferHeap(MGLDC *dc);
+
+/* Inverse color map functions */
+
+void    _MGL_buildInverseColorMap(MGL_invCMap *icm);
+MGL_invCMap *_MGL_getInverseColorMap(MGLDC *dc);
+bitmap_t *_MGL_mapBitmapToInverseColorMap(const bitmap_t *bitmap,MGL_invCMap *icm);
+
+/* Span dithering functions */
+
+ibool   _MGL_setupDither(MGLDC *dst,MGL_dither *dt,int bitsPerPixel);
+void    _MGL_ditherSpan(MGL_dither *dt,void *dst,const M_uint32 *src,int x,int y,int count);
+void    _MGL_freeDither(void);
+
+/* Linear light conversion functions */
+
+void    _MGL_initLinearLight(void);
+void    _MGL_spanToLinear(const M_uint32 *src,ushort *dst,int count);
+void    _MGL_spanFromLinear(const ushort *src,M_uint32 *dst,int count);
+void    _MGL_blendLinearSpan(M_uint32 *dst,const M_uint32 *src,int count,int constAlpha,ibool blendAlpha);
+
 /* Font enumeration helper functions */
 
 void    _MGL_initFontEnumCache(void);
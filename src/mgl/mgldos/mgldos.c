@@ -302,3 +302,101 @@ void _MGL_unlockStaticPalette(
 {
 }
 
+
+/****************************************************************************
+RETURNS:
+Number of processors available in the system.
+
+REMARKS:
+Threads are not supported on this platform, so the MGL always runs
+everything on the calling thread.
+{secret}
+****************************************************************************/
+int _MGL_numProcessors(void)
+{
+    return 1;
+}
+
+/****************************************************************************
+REMARKS:
+Threads are not supported on this platform.
+{secret}
+****************************************************************************/
+ibool _MGL_createThread(
+    void (*func)(void *arg),
+    void *arg)
+{
+    (void)func;
+    (void)arg;
+    return false;
+}
+
+/****************************************************************************
+REMARKS:
+Threads are not supported on this platform.
+{secret}
+****************************************************************************/
+void *_MGL_createEvent(void)
+{
+    return NULL;
+}
+
+/****************************************************************************
+REMARKS:
+Threads are not supported on this platform.
+{secret}
+****************************************************************************/
+void _MGL_signalEvent(
+    void *event)
+{
+    (void)event;
+}
+
+/****************************************************************************
+REMARKS:
+Threads are not supported on this platform.
+{secret}
+****************************************************************************/
+void _MGL_waitEvent(
+    void *event)
+{
+    (void)event;
+}
+
+/****************************************************************************
+REMARKS:
+Threads are not supported on this platform.
+{secret}
+****************************************************************************/
+void _MGL_destroyEvent(
+    void *event)
+{
+    (void)event;
+}
+
+/****************************************************************************
+REMARKS:
+Memory mapped files are not supported on this platform.
+{secret}
+****************************************************************************/
+void *_MGL_mapFile(
+    const char *filename,
+    ulong *size)
+{
+    (void)filename;
+    (void)size;
+    return NULL;
+}
+
+/****************************************************************************
+REMARKS:
+Memory mapped files are not supported on this platform.
+{secret}
+****************************************************************************/
+void _MGL_unmapFile(
+    void *base,
+    ulong size)
+{
+    (void)base;
+    (void)size;
+}
@@ -36,6 +36,7 @@
 ****************************************************************************/
 
 #include "mgl.h"
+#include <sys/stat.h>
 
 /*--------------------------- Global Variables ----------------------------*/
 
@@ -73,6 +74,69 @@ long _MGL_fileSize(
     return size;                    /* Return the size of the file      */
 }
 
+/****************************************************************************
+PARAMETERS:
+path        - Resolved path to the file
+fileSize    - Place to store the size of the file
+fileTime    - Place to store the modification time of the file
+
+RETURNS:
+True if the file was found with stat, false if not.
+
+REMARKS:
+Gets the size and modification time of a file with stat only. Unlike
+_MGL_getFileInfo this never calls the MGL file I/O functions, so it is
+safe to call from the band worker threads.
+{secret}
+****************************************************************************/
+ibool _MGL_statFile(
+    const char *path,
+    long *fileSize,
+    long *fileTime)
+{
+    struct stat st;
+
+    if (stat(path,&st) != 0)
+        return false;
+    *fileSize = (long)st.st_size;
+    *fileTime = (long)st.st_mtime;
+    return true;
+}
+
+/****************************************************************************
+PARAMETERS:
+path        - Resolved path to the file
+fileSize    - Place to store the size of the file
+fileTime    - Place to store the modification time of the file
+
+RETURNS:
+True if the file exists, false if not.
+
+REMARKS:
+Gets the size and modification time of a file, used to check if cached
+information about the file is still valid. If the file cannot be found with
+stat (for instance when the MGL file I/O functions have been replaced), we
+open it with the MGL file I/O functions to get the size, and the
+modification time is left as 0.
+{secret}
+****************************************************************************/
+ibool _MGL_getFileInfo(
+    const char *path,
+    long *fileSize,
+    long *fileTime)
+{
+    FILE        *f;
+
+    if (_MGL_statFile(path,fileSize,fileTime))
+        return true;
+    if ((f = __MGL_fopen(path,"rb")) == NULL)
+        return false;
+    *fileSize = _MGL_fileSize(f);
+    *fileTime = 0;
+    __MGL_fclose(f);
+    return true;
+}
+
 /****************************************************************************
 DESCRIPTION:
 Restricts the output from the display device context to a specified output
@@ -38,4 +38,12 @@
 #ifndef __MGLLINUX_INTERNAL_H
 #define __MGLLINUX_INTERNAL_H
 
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
 #endif  /* __MGLLINUX_INTERNAL_H */
@@ -292,3 +292,143 @@ void _MGL_unlockStaticPalette(
 {
 }
 
+
+/****************************************************************************
+RETURNS:
+Number of processors available in the system.
+****************************************************************************/
+int _MGL_numProcessors(void)
+{
+    ULONG   count = 1;
+
+    if (DosQuerySysInfo(QSV_NUMPROCESSORS,QSV_NUMPROCESSORS,&count,sizeof(count)) != NO_ERROR)
+        count = 1;
+    return (count > 0) ? (int)count : 1;
+}
+
+/* Start information passed to new threads */
+
+typedef struct {
+    void        (*func)(void *arg);
+    void        *arg;
+    } threadStart;
+
+/****************************************************************************
+REMARKS:
+Entry point for all threads created by the MGL.
+****************************************************************************/
+static VOID APIENTRY threadEntry(
+    ULONG arg)
+{
+    threadStart start = *((threadStart*)arg);
+
+    PM_free((void*)arg);
+    start.func(start.arg);
+}
+
+/****************************************************************************
+PARAMETERS:
+func    - Function to run on the new thread
+arg     - Argument to pass to the thread function
+
+RETURNS:
+True if the thread was created, false on failure.
+
+REMARKS:
+Creates a new thread to run the specified function.
+****************************************************************************/
+ibool _MGL_createThread(
+    void (*func)(void *arg),
+    void *arg)
+{
+    TID         tid;
+    threadStart *start;
+
+    if ((start = PM_malloc(sizeof(threadStart))) == NULL)
+        return false;
+    start->func = func;
+    start->arg = arg;
+    if (DosCreateThread(&tid,threadEntry,(ULONG)start,CREATE_READY | STACK_SPARSE,65536) != NO_ERROR) {
+        PM_free(start);
+        return false;
+        }
+    return true;
+}
+
+/****************************************************************************
+RETURNS:
+Handle to the new event, or NULL on failure.
+
+REMARKS:
+Creates a new auto-reset event used to signal between threads. The event
+is initially not signalled. OS/2 event semaphores are manual reset, so
+the event is reset again after every successful wait.
+****************************************************************************/
+void *_MGL_createEvent(void)
+{
+    HEV     hev;
+
+    if (DosCreateEventSem(NULL,&hev,0,FALSE) != NO_ERROR)
+        return NULL;
+    return (void*)hev;
+}
+
+/****************************************************************************
+REMARKS:
+Signals an event, releasing a thread waiting on the event.
+****************************************************************************/
+void _MGL_signalEvent(
+    void *event)
+{
+    DosPostEventSem((HEV)event);
+}
+
+/****************************************************************************
+REMARKS:
+Waits for an event to be signalled.
+****************************************************************************/
+void _MGL_waitEvent(
+    void *event)
+{
+    ULONG   count;
+
+    DosWaitEventSem((HEV)event,SEM_INDEFINITE_WAIT);
+    DosResetEventSem((HEV)event,&count);
+}
+
+/****************************************************************************
+REMARKS:
+Destroys an event.
+****************************************************************************/
+void _MGL_destroyEvent(
+    void *event)
+{
+    DosCloseEventSem((HEV)event);
+}
+
+/****************************************************************************
+REMARKS:
+Memory mapped files are not supported on this platform.
+{secret}
+****************************************************************************/
+void *_MGL_mapFile(
+    const char *filename,
+    ulong *size)
+{
+    (void)filename;
+    (void)size;
+    return NULL;
+}
+
+/****************************************************************************
+REMARKS:
+Memory mapped files are not supported on this platform.
+{secret}
+****************************************************************************/
+void _MGL_unmapFile(
+    void *base,
+    ulong size)
+{
+    (void)base;
+    (void)size;
+}
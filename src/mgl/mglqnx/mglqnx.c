@@ -244,3 +244,162 @@ void _MGL_unlockStaticPalette(
 {
 }
 
+
+/****************************************************************************
+RETURNS:
+Number of processors available in the system.
+****************************************************************************/
+int _MGL_numProcessors(void)
+{
+    long    count = sysconf(_SC_NPROCESSORS_ONLN);
+    return (count > 0) ? (int)count : 1;
+}
+
+/* Start information passed to new threads */
+
+typedef struct {
+    void        (*func)(void *arg);
+    void        *arg;
+    } threadStart;
+
+/****************************************************************************
+REMARKS:
+Entry point for all threads created by the MGL.
+****************************************************************************/
+static void *threadEntry(
+    void *arg)
+{
+    threadStart start = *((threadStart*)arg);
+
+    PM_free(arg);
+    start.func(start.arg);
+    return NULL;
+}
+
+/****************************************************************************
+PARAMETERS:
+func    - Function to run on the new thread
+arg     - Argument to pass to the thread function
+
+RETURNS:
+True if the thread was created, false on failure.
+
+REMARKS:
+Creates a new detached thread to run the specified function.
+****************************************************************************/
+ibool _MGL_createThread(
+    void (*func)(void *arg),
+    void *arg)
+{
+    pthread_t   thread;
+    threadStart *start;
+
+    if ((start = PM_malloc(sizeof(threadStart))) == NULL)
+        return false;
+    start->func = func;
+    start->arg = arg;
+    if (pthread_create(&thread,NULL,threadEntry,start) != 0) {
+        PM_free(start);
+        return false;
+        }
+    pthread_detach(thread);
+    return true;
+}
+
+/****************************************************************************
+RETURNS:
+Handle to the new event, or NULL on failure.
+
+REMARKS:
+Creates a new auto-reset event used to signal between threads. The event
+is initially not signalled.
+****************************************************************************/
+void *_MGL_createEvent(void)
+{
+    sem_t   *sem;
+
+    if ((sem = PM_malloc(sizeof(sem_t))) == NULL)
+        return NULL;
+    if (sem_init(sem,0,0) != 0) {
+        PM_free(sem);
+        return NULL;
+        }
+    return sem;
+}
+
+/****************************************************************************
+REMARKS:
+Signals an event, releasing a thread waiting on the event.
+****************************************************************************/
+void _MGL_signalEvent(
+    void *event)
+{
+    sem_post((sem_t*)event);
+}
+
+/****************************************************************************
+REMARKS:
+Waits for an event to be signalled.
+****************************************************************************/
+void _MGL_waitEvent(
+    void *event)
+{
+    while (sem_wait((sem_t*)event) != 0 && errno == EINTR)
+        ;
+}
+
+/****************************************************************************
+REMARKS:
+Destroys an event.
+****************************************************************************/
+void _MGL_destroyEvent(
+    void *event)
+{
+    sem_destroy((sem_t*)event);
+    PM_free(event);
+}
+
+/****************************************************************************
+PARAMETERS:
+filename    - Name of the file to map
+size        - Place to store the size of the mapping
+
+RETURNS:
+Pointer to the start of the mapping, or NULL on failure.
+
+REMARKS:
+Maps the entire file into memory as a private copy-on-write mapping, so the
+mapped pages can be written to without changing the file on disk.
+****************************************************************************/
+void *_MGL_mapFile(
+    const char *filename,
+    ulong *size)
+{
+    struct stat st;
+    void        *base;
+    int         fd;
+
+    if ((fd = open(filename,O_RDONLY)) < 0)
+        return NULL;
+    if (fstat(fd,&st) != 0 || st.st_size <= 0) {
+        close(fd);
+        return NULL;
+        }
+    base = mmap(NULL,st.st_size,PROT_READ | PROT_WRITE,MAP_PRIVATE,fd,0);
+    close(fd);
+    if (base == MAP_FAILED)
+        return NULL;
+    *size = st.st_size;
+    return base;
+}
+
+/****************************************************************************
+REMARKS:
+Unmaps a file mapped with _MGL_mapFile.
+****************************************************************************/
+void _MGL_unmapFile(
+    void *base,
+    ulong size)
+{
+    munmap(base,size);
+}
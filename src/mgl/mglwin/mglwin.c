@@ -434,3 +434,159 @@ void _MGL_unlockStaticPalette(
         }
 }
 
+
+/****************************************************************************
+RETURNS:
+Number of processors available in the system.
+****************************************************************************/
+int _MGL_numProcessors(void)
+{
+    SYSTEM_INFO info;
+
+    GetSystemInfo(&info);
+    return (info.dwNumberOfProcessors > 0) ? (int)info.dwNumberOfProcessors : 1;
+}
+
+/* Start information passed to new threads */
+
+typedef struct {
+    void        (*func)(void *arg);
+    void        *arg;
+    } threadStart;
+
+/****************************************************************************
+REMARKS:
+Entry point for all threads created by the MGL.
+****************************************************************************/
+static DWORD WINAPI threadEntry(
+    LPVOID arg)
+{
+    threadStart start = *((threadStart*)arg);
+
+    PM_free(arg);
+    start.func(start.arg);
+    return 0;
+}
+
+/****************************************************************************
+PARAMETERS:
+func    - Function to run on the new thread
+arg     - Argument to pass to the thread function
+
+RETURNS:
+True if the thread was created, false on failure.
+
+REMARKS:
+Creates a new thread to run the specified function.
+****************************************************************************/
+ibool _MGL_createThread(
+    void (*func)(void *arg),
+    void *arg)
+{
+    HANDLE      hThread;
+    DWORD       id;
+    threadStart *start;
+
+    if ((start = PM_malloc(sizeof(threadStart))) == NULL)
+        return false;
+    start->func = func;
+    start->arg = arg;
+    if ((hThread = CreateThread(NULL,0,threadEntry,start,0,&id)) == NULL) {
+        PM_free(start);
+        return false;
+        }
+    CloseHandle(hThread);
+    return true;
+}
+
+/****************************************************************************
+RETURNS:
+Handle to the new event, or NULL on failure.
+
+REMARKS:
+Creates a new auto-reset event used to signal between threads. The event
+is initially not signalled.
+****************************************************************************/
+void *_MGL_createEvent(void)
+{
+    return CreateEvent(NULL,FALSE,FALSE,NULL);
+}
+
+/****************************************************************************
+REMARKS:
+Signals an event, releasing a thread waiting on the event.
+****************************************************************************/
+void _MGL_signalEvent(
+    void *event)
+{
+    SetEvent((HANDLE)event);
+}
+
+/****************************************************************************
+REMARKS:
+Waits for an event to be signalled.
+****************************************************************************/
+void _MGL_waitEvent(
+    void *event)
+{
+    WaitForSingleObject((HANDLE)event,INFINITE);
+}
+
+/****************************************************************************
+REMARKS:
+Destroys an event.
+****************************************************************************/
+void _MGL_destroyEvent(
+    void *event)
+{
+    CloseHandle((HANDLE)event);
+}
+
+/****************************************************************************
+PARAMETERS:
+filename    - Name of the file to map
+size        - Place to store the size of the mapping
+
+RETURNS:
+Pointer to the start of the mapping, or NULL on failure.
+
+REMARKS:
+Maps the entire file into memory as a private copy-on-write mapping, so the
+mapped pages can be written to without changing the file on disk. The view
+keeps the file mapping object alive, so we can close the handles right away.
+****************************************************************************/
+void *_MGL_mapFile(
+    const char *filename,
+    ulong *size)
+{
+    HANDLE  hFile,hMap;
+    DWORD   fileSize;
+    void    *base = NULL;
+
+    hFile = CreateFile(filename,GENERIC_READ,FILE_SHARE_READ,NULL,OPEN_EXISTING,FILE_ATTRIBUTE_NORMAL,NULL);
+    if (hFile == INVALID_HANDLE_VALUE)
+        return NULL;
+    fileSize = GetFileSize(hFile,NULL);
+    if (fileSize != 0xFFFFFFFF && fileSize != 0) {
+        if ((hMap = CreateFileMapping(hFile,NULL,PAGE_WRITECOPY,0,0,NULL)) != NULL) {
+            base = MapViewOfFile(hMap,FILE_MAP_COPY,0,0,0);
+            CloseHandle(hMap);
+            }
+        }
+    CloseHandle(hFile);
+    if (base)
+        *size = fileSize;
+    return base;
+}
+
+/****************************************************************************
+REMARKS:
+Unmaps a file mapped with _MGL_mapFile.
+****************************************************************************/
+void _MGL_unmapFile(
+    void *base,
+    ulong size)
+{
+    (void)size;
+    UnmapViewOfFile(base);
+}
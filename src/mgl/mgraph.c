@@ -49,8 +49,8 @@ static ibool    consoleInited = false;
 MGLDC       _MGL_dc;                    /* Global device context            */
 MGLDC *     _MGL_dcPtr = NULL;          /* Pointer to active context        */
 int         _MGL_bufSize = DEF_MGL_BUFSIZE;
-void *      _MGL_buf;                   /* Internal MGL scratch buffer      */
-int         __MGL_result;               /* Result of last operation         */
+MGL_THREAD_LOCAL void * _MGL_buf;       /* Internal MGL scratch buffer      */
+MGL_THREAD_LOCAL int __MGL_result;      /* Result of last operation         */
 ibool       __MGL_useLinearBlits = true;/* True if linear blits are used    */
 char        _MGL_path[PM_MAX_PATH];     /* Root directory for all MGL files */
 int         _MGL_blueCodeIndex = 0xFF;  /* Blue code index for stereo       */
@@ -1180,6 +1180,28 @@ void MGLAPI MGL_exit(void)
             _MGL_buf = NULL;
             }
 
+        /* Shut down the band blitting and resource loading worker threads */
+        _MGL_destroyBandThreads();
+        _MGL_destroyLoaderThreads();
+
+        /* Free all the images in the decoded image cache */
+        _MGL_destroyImageCache();
+
+        /* Free all the glyphs in the TrueType glyph cache */
+        _MGL_destroyGlyphCache();
+
+        /* Free all the composited runs in the text run cache */
+        _MGL_destroyTextRunCache();
+
+        /* Close all the open pack files */
+        _MGL_closePackFiles();
+
+        /* Free the blit batching command queue */
+        _MGL_freeBatch();
+
+        /* Free the error diffusion buffer */
+        _MGL_freeDither();
+
         /* Perform any OS specific exit code */
         _MGL_exitInternal();
 
@@ -1279,6 +1301,10 @@ internal result code is reset back to grOK on return from this routine, so
 you should only call the routine once after the graphics operation. Error
 codes returned by this function are enumerated in MGL_errorType.
 
+The result code is kept separately for each thread, so resources loaded
+in the background with MGL_loadAsync do not disturb the result code of the
+thread calling the MGL.
+
 SEE ALSO:
 MGL_setResult, MGL_errorMsg
 ****************************************************************************/
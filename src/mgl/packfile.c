@@ -0,0 +1,996 @@
+/****************************************************************************
+*
+*                   SciTech Multi-platform Graphics Library
+*
+*  ========================================================================
+*
+*   Copyright (C) 1991-2004 SciTech Software, Inc. All rights reserved.
+*
+*   This file may be distributed and/or modified under the terms of the
+*   GNU General Public License version 2.0 as published by the Free
+*   Software Foundation and appearing in the file LICENSE.GPL included
+*   in the packaging of this file.
+*
+*   Licensees holding a valid Commercial License for this product from
+*   SciTech Software, Inc. may use this file in accordance with the
+*   Commercial License Agreement provided with the Software.
+*
+*   This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING
+*   THE WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+*   PURPOSE.
+*
+*   See http://www.scitechsoft.com/license/ for information about
+*   the licensing options available and how to purchase a Commercial
+*   License Agreement.
+*
+*   Contact license@scitechsoft.com if any conditions of this licensing
+*   are not clear to you, or you have questions about licensing options.
+*
+*  ========================================================================
+*
+*
+* Language:     ANSI C
+* Environment:  Any
+*
+* Description:  Pack file asset loading. A pack file is a standard zip
+*               archive containing bitmaps, fonts, icons and cursors. The
+*               central directory of each archive is indexed once into a
+*               hash table when the archive is opened, and the archive is
+*               then served through the MGL file I/O functions so that
+*               all the existing resource loaders can read from it
+*               directly. Stored entries are read straight out of a
+*               memory mapping of the archive, and deflated entries are
+*               inflated in one pass into pooled buffers when they are
+*               first read. Files that are not found in any open pack file
+*               are passed through to the previous file I/O functions.
+*
+****************************************************************************/
+
+#include "mgl.h"
+#include "zlib.h"
+
+/*--------------------------- Global Variables ----------------------------*/
+
+#define MAX_PACK_STREAMS    256             /* Max open pack file streams  */
+#define PACK_POOL_SIZE      (1024 * 1024L)  /* Max bytes of pooled buffers */
+#define PACK_MIN_BUFFER     4096            /* Smallest pooled buffer size */
+#define ZIP_EOCD_ID         0x06054B50UL
+#define ZIP_EOCD_SIZE       22
+#define ZIP_MAX_COMMENT     0xFFFF
+#define ZIP_DIR_ID          0x02014B50UL
+#define ZIP_DIR_SIZE        46
+#define ZIP_LOCAL_ID        0x04034B50UL
+#define ZIP_LOCAL_SIZE      30
+#define ZIP_ENCRYPTED       0x0001
+#define ZIP_STORED          0
+#define ZIP_DEFLATED        8
+#define ZIP_MAX_RATIO       1032            /* Max deflate expansion ratio */
+
+/* {secret} */
+typedef struct {
+    ulong       hash;           /* Hash value for the entry name           */
+    const char  *name;          /* Normalised name of the entry            */
+    ulong       header;         /* Offset of the local file header         */
+    ulong       compSize;       /* Size of the compressed data             */
+    ulong       size;           /* Size of the uncompressed data           */
+    int         method;         /* Compression method for the entry        */
+    int         next;           /* Next entry in the hash chain (-1 ends)  */
+    } packEntry;
+
+/* {secret} */
+struct packfile_t {
+    packfile_t  *next;          /* Next open pack file in the search list  */
+    uchar       *base;          /* Start of the archive in memory          */
+    ulong       size;           /* Size of the archive in bytes            */
+    ibool       mapped;         /* True if the archive is memory mapped    */
+    int         numEntries;     /* Number of entries in the index          */
+    packEntry   *entries;       /* Index of all the entries                */
+    int         *buckets;       /* First entry in each hash chain          */
+    ulong       hashMask;       /* Number of hash buckets minus one        */
+    int         openCount;      /* Number of streams open on the archive   */
+    };
+
+/* {secret} */
+typedef struct packBuffer {
+    struct packBuffer   *next;  /* Next buffer in the free list            */
+    ulong               size;   /* Size of the buffer data                 */
+    } packBuffer;
+
+/* {secret} */
+typedef struct {
+    packfile_t  *pack;          /* Pack file for the stream (NULL if free) */
+    uchar       *data;          /* Start of the entry data                 */
+    ulong       size;           /* Size of the entry data                  */
+    const uchar *src;           /* Deflated data not yet inflated (or NULL)*/
+    ulong       srcSize;        /* Size of the deflated data               */
+    ulong       pos;            /* Current position within the data        */
+    packBuffer  *buf;           /* Pooled buffer holding inflated data     */
+    } packStream;
+
+static packfile_t   *packs = NULL;
+static packStream   streams[MAX_PACK_STREAMS];
+static packBuffer   *freeBuffers = NULL;
+static ulong        pooledBytes = 0;
+static void         *packLock = NULL;
+static ibool        installed = false;
+static fileio_t     prevIO;
+
+/*------------------------- Implementation --------------------------------*/
+
+/****************************************************************************
+PARAMETERS:
+p   - Pointer to the bytes to read
+
+RETURNS:
+16-bit little endian value read from a possibly unaligned address.
+****************************************************************************/
+static uint read16(
+    const uchar *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+/****************************************************************************
+PARAMETERS:
+p   - Pointer to the bytes to read
+
+RETURNS:
+32-bit little endian value read from a possibly unaligned address.
+****************************************************************************/
+static ulong read32(
+    const uchar *p)
+{
+    return p[0] | (p[1] << 8) | ((ulong)p[2] << 16) | ((ulong)p[3] << 24);
+}
+
+/****************************************************************************
+REMARKS:
+Takes ownership of the pack file list, stream table and buffer pool. The
+lock is an event that is left signalled while everything is free.
+****************************************************************************/
+static void lockPacks(void)
+{
+    if (packLock)
+        _MGL_waitEvent(packLock);
+}
+
+/****************************************************************************
+REMARKS:
+Releases ownership of the pack file list, stream table and buffer pool.
+****************************************************************************/
+static void unlockPacks(void)
+{
+    if (packLock)
+        _MGL_signalEvent(packLock);
+}
+
+/****************************************************************************
+PARAMETERS:
+dst     - Place to store the normalised name
+src     - Name to normalise
+len     - Length of the name to normalise
+maxLen  - Size of the destination buffer
+
+RETURNS:
+Length of the normalised name, or -1 if it is too long.
+
+REMARKS:
+Normalises a file name for looking up in the pack file index. Backslashes
+are converted to forward slashes, upper case characters are converted to
+lower case, and drive letters, leading slashes, repeated slashes and any
+"./" components are removed, so that names match no matter which platform
+the archive was built on.
+****************************************************************************/
+static int normaliseName(
+    char *dst,
+    const char *src,
+    int len,
+    int maxLen)
+{
+    int i,n = 0;
+    char c;
+
+    if (len >= 2 && src[1] == ':') {
+        src += 2;
+        len -= 2;
+        }
+    for (i = 0; i < len; i++) {
+        c = src[i];
+        if (c == '\\')
+            c = '/';
+        else if (c >= 'A' && c <= 'Z')
+            c += 'a' - 'A';
+        if (c == '/' && (n == 0 || dst[n-1] == '/'))
+            continue;
+        if (c == '.' && (n == 0 || dst[n-1] == '/') && i+1 < len && (src[i+1] == '/' || src[i+1] == '\\')) {
+            i++;
+            continue;
+            }
+        if (n >= maxLen-1)
+            return -1;
+        dst[n++] = c;
+        }
+    dst[n] = '\0';
+    return n;
+}
+
+/****************************************************************************
+PARAMETERS:
+name    - Normalised name to hash
+
+RETURNS:
+FNV-1a hash value for the name.
+****************************************************************************/
+static ulong hashName(
+    const char *name)
+{
+    ulong   hash = 2166136261UL;
+
+    while (*name) {
+        hash ^= (uchar)*name++;
+        hash *= 16777619UL;
+        }
+    return hash & 0xFFFFFFFFUL;
+}
+
+/****************************************************************************
+PARAMETERS:
+pack    - Pack file to search
+name    - Normalised name to find
+
+RETURNS:
+Pointer to the entry, or NULL if it is not in the pack file.
+****************************************************************************/
+static packEntry *findEntry(
+    packfile_t *pack,
+    const char *name)
+{
+    ulong       hash = hashName(name);
+    int         i;
+
+    for (i = pack->buckets[hash & pack->hashMask]; i >= 0; i = pack->entries[i].next) {
+        if (pack->entries[i].hash == hash && strcmp(pack->entries[i].name,name) == 0)
+            return &pack->entries[i];
+        }
+    return NULL;
+}
+
+/****************************************************************************
+PARAMETERS:
+filename    - Name of the file to find
+pack        - Place to store the pack file containing the entry
+
+RETURNS:
+Pointer to the entry, or NULL if the file is not in any open pack file.
+
+REMARKS:
+Looks up a file in all the open pack files, most recently opened first.
+If the full path is not found, leading directories are removed one at a
+time so that the paths built by the MGL directory search (which may be
+prefixed with the MGL_init path or the MGL_ROOT variable) will still find
+the entry stored relative to the root of the archive. The pack file list
+must be locked.
+****************************************************************************/
+static packEntry *lookupName(
+    const char *filename,
+    packfile_t **pack)
+{
+    char        name[PM_MAX_PATH];
+    const char  *p;
+    packfile_t  *pf;
+    packEntry   *e;
+
+    if (normaliseName(name,filename,strlen(filename),sizeof(name)) <= 0)
+        return NULL;
+    for (p = name; p; ) {
+        for (pf = packs; pf; pf = pf->next) {
+            if ((e = findEntry(pf,p)) != NULL) {
+                *pack = pf;
+                return e;
+                }
+            }
+        if ((p = strchr(p,'/')) != NULL)
+            p++;
+        }
+    return NULL;
+}
+
+/****************************************************************************
+PARAMETERS:
+size    - Size of the buffer required
+
+RETURNS:
+Pointer to the buffer, or NULL if out of memory.
+
+REMARKS:
+Allocates a buffer to hold an inflated entry, re-using the smallest free
+pooled buffer that is large enough. The pack file list must be locked.
+****************************************************************************/
+static packBuffer *allocBuffer(
+    ulong size)
+{
+    packBuffer  *b,**prev,**best = NULL;
+    ulong       bufSize;
+
+    for (prev = &freeBuffers; (b = *prev) != NULL; prev = &b->next) {
+        if (b->size >= size && (!best || b->size < (*best)->size))
+            best = prev;
+        }
+    if (best) {
+        b = *best;
+        *best = b->next;
+        pooledBytes -= b->size;
+        return b;
+        }
+    if (size > ~0UL - sizeof(packBuffer))
+        return NULL;
+    for (bufSize = PACK_MIN_BUFFER; bufSize < size && bufSize < 0x80000000UL; bufSize <<= 1)
+        ;
+    if (bufSize < size)
+        bufSize = size;
+    if ((b = PM_malloc(sizeof(packBuffer) + bufSize)) == NULL)
+        return NULL;
+    b->size = bufSize;
+    return b;
+}
+
+/****************************************************************************
+PARAMETERS:
+b   - Buffer to release
+
+REMARKS:
+Returns a buffer to the pool, or frees it if the pool is already full.
+The pack file list must be locked.
+****************************************************************************/
+static void releaseBuffer(
+    packBuffer *b)
+{
+    if (pooledBytes + b->size > PACK_POOL_SIZE) {
+        PM_free(b);
+        return;
+        }
+    b->next = freeBuffers;
+    freeBuffers = b;
+    pooledBytes += b->size;
+}
+
+/****************************************************************************
+REMARKS:
+Frees all the buffers in the pool.
+****************************************************************************/
+static void freeBufferPool(void)
+{
+    packBuffer  *b;
+
+    while ((b = freeBuffers) != NULL) {
+        freeBuffers = b->next;
+        PM_free(b);
+        }
+    pooledBytes = 0;
+}
+
+/****************************************************************************
+PARAMETERS:
+dst     - Buffer to inflate the entry into
+size    - Uncompressed size of the entry
+src     - Compressed entry data
+srcSize - Size of the compressed entry data
+
+RETURNS:
+True if the entry inflated to exactly the expected size.
+****************************************************************************/
+static ibool inflateEntry(
+    uchar *dst,
+    ulong size,
+    const uchar *src,
+    ulong srcSize)
+{
+    z_stream    z;
+    int         err;
+
+    memset(&z,0,sizeof(z));
+    if (inflateInit2(&z,-MAX_WBITS) != Z_OK)
+        return false;
+    z.next_in = (Bytef*)src;
+    z.avail_in = srcSize;
+    z.next_out = dst;
+    z.avail_out = size;
+    err = inflate(&z,Z_FINISH);
+    inflateEnd(&z);
+    return (err == Z_STREAM_END && z.total_out == size);
+}
+
+/****************************************************************************
+PARAMETERS:
+pack    - Pack file to open the entry from
+e       - Entry to open
+s       - Stream to initialise for the entry
+
+RETURNS:
+True on success, false if the entry is corrupt.
+
+REMARKS:
+Locates the entry data from the local file header and sets up the stream
+to read it. Stored entries point directly into the archive memory, while
+deflated entries are only inflated when the stream is first read. This
+keeps opening a file cheap, which matters as _MGL_findFile opens and
+closes each file just to check that it exists.
+****************************************************************************/
+static ibool openEntry(
+    packfile_t *pack,
+    packEntry *e,
+    packStream *s)
+{
+    uchar   *p = pack->base + e->header;
+    ulong   start;
+
+    if (read32(p) != ZIP_LOCAL_ID)
+        return false;
+    start = e->header + ZIP_LOCAL_SIZE + read16(p+26) + read16(p+28);
+    if (start > pack->size || e->compSize > pack->size - start)
+        return false;
+    s->size = e->size;
+    s->pos = 0;
+    s->buf = NULL;
+    if (e->method == ZIP_STORED) {
+        s->data = pack->base + start;
+        s->src = NULL;
+        }
+    else {
+        s->data = NULL;
+        s->src = pack->base + start;
+        s->srcSize = e->compSize;
+        }
+    return true;
+}
+
+/****************************************************************************
+PARAMETERS:
+s   - Stream to inflate the entry data for
+
+RETURNS:
+True on success, false if the entry is corrupt or out of memory.
+
+REMARKS:
+Inflates the data for a deflated entry into a pooled buffer the first time
+the stream is read. The pack file list must not be locked, as the
+inflation is done without holding the lock.
+****************************************************************************/
+static ibool inflateStream(
+    packStream *s)
+{
+    packBuffer  *buf;
+
+    lockPacks();
+    buf = allocBuffer(s->size);
+    unlockPacks();
+    if (!buf)
+        return false;
+    if (!inflateEntry((uchar*)(buf+1),s->size,s->src,s->srcSize)) {
+        lockPacks();
+        releaseBuffer(buf);
+        unlockPacks();
+        return false;
+        }
+    s->buf = buf;
+    s->data = (uchar*)(buf+1);
+    s->src = NULL;
+    return true;
+}
+
+/****************************************************************************
+PARAMETERS:
+f   - File pointer to check
+
+RETURNS:
+Pointer to the pack file stream, or NULL if this is not a pack file stream.
+****************************************************************************/
+static packStream *getStream(
+    FILE *f)
+{
+    packStream  *s = (packStream*)f;
+
+    if (s >= streams && s < streams + MAX_PACK_STREAMS)
+        return s;
+    return NULL;
+}
+
+/****************************************************************************
+REMARKS:
+Pack file replacement for fopen. Files opened for reading in binary mode
+are looked up in the open pack files, and everything else is passed on to
+the previous file I/O functions.
+****************************************************************************/
+static FILE * packFopen(
+    const char *filename,
+    const char *mode)
+{
+    packfile_t  *pack = NULL;
+    packEntry   *e;
+    packStream  *s = NULL;
+    int         i;
+
+    if (strchr(mode,'r') && !strchr(mode,'+') && !strchr(mode,'t')) {
+        lockPacks();
+        if ((e = lookupName(filename,&pack)) != NULL) {
+            for (i = 0; i < MAX_PACK_STREAMS; i++) {
+                if (!streams[i].pack) {
+                    s = &streams[i];
+                    s->pack = pack;
+                    pack->openCount++;
+                    break;
+                    }
+                }
+            }
+        unlockPacks();
+        if (e) {
+            if (s && openEntry(pack,e,s))
+                return (FILE*)s;
+            if (s) {
+                lockPacks();
+                s->pack = NULL;
+                pack->openCount--;
+                unlockPacks();
+                }
+            return NULL;
+            }
+        }
+    return prevIO.fopen(filename,mode);
+}
+
+/****************************************************************************
+REMARKS:
+Pack file replacement for fclose.
+****************************************************************************/
+static int packFclose(
+    FILE *f)
+{
+    packStream  *s = getStream(f);
+
+    if (!s)
+        return prevIO.fclose(f);
+    lockPacks();
+    if (s->buf)
+        releaseBuffer(s->buf);
+    s->pack->openCount--;
+    s->pack = NULL;
+    unlockPacks();
+    return 0;
+}
+
+/****************************************************************************
+REMARKS:
+Pack file replacement for fseek.
+****************************************************************************/
+static int packFseek(
+    FILE *f,
+    long offset,
+    int whence)
+{
+    packStream  *s = getStream(f);
+    long        pos;
+
+    if (!s)
+        return prevIO.fseek(f,offset,whence);
+    switch (whence) {
+        case SEEK_SET:  pos = offset;                   break;
+        case SEEK_CUR:  pos = (long)s->pos + offset;    break;
+        case SEEK_END:  pos = (long)s->size + offset;   break;
+        default:        return -1;
+        }
+    if (pos < 0)
+        return -1;
+    s->pos = pos;
+    return 0;
+}
+
+/****************************************************************************
+REMARKS:
+Pack file replacement for ftell.
+****************************************************************************/
+static long packFtell(
+    FILE *f)
+{
+    packStream  *s = getStream(f);
+
+    if (!s)
+        return prevIO.ftell(f);
+    return (long)s->pos;
+}
+
+/****************************************************************************
+REMARKS:
+Pack file replacement for fread.
+****************************************************************************/
+static size_t packFread(
+    void *ptr,
+    size_t size,
+    size_t n,
+    FILE *f)
+{
+    packStream  *s = getStream(f);
+    ulong       bytes;
+
+    if (!s)
+        return prevIO.fread(ptr,size,n,f);
+    if (size == 0 || s->pos >= s->size)
+        return 0;
+    if (s->src && !inflateStream(s))
+        return 0;
+    bytes = s->size - s->pos;
+    if (n < bytes / size)
+        bytes = n * size;
+    memcpy(ptr,s->data + s->pos,bytes);
+    s->pos += bytes;
+    return bytes / size;
+}
+
+/****************************************************************************
+REMARKS:
+Pack file replacement for fwrite. Pack files are read only.
+****************************************************************************/
+static size_t packFwrite(
+    const void *ptr,
+    size_t size,
+    size_t n,
+    FILE *f)
+{
+    if (!getStream(f))
+        return prevIO.fwrite(ptr,size,n,f);
+    return 0;
+}
+
+/****************************************************************************
+PARAMETERS:
+filename    - Name of the archive to load
+size        - Place to store the size of the archive
+mapped      - Place to store true if the archive was memory mapped
+
+RETURNS:
+Pointer to the archive in memory, or NULL on error.
+
+REMARKS:
+Maps the archive into memory if the file I/O functions have not been
+overridden and the platform supports it, otherwise the entire archive is
+read into memory with the current file I/O functions.
+****************************************************************************/
+static uchar *loadArchive(
+    const char *filename,
+    ulong *size,
+    ibool *mapped)
+{
+    FILE    *f;
+    uchar   *base;
+    long    len;
+
+    *mapped = false;
+    if ((installed ? prevIO.fopen : __MGL_fopen) == fopen) {
+        if ((base = _MGL_mapFile(filename,size)) != NULL) {
+            *mapped = true;
+            return base;
+            }
+        }
+    if ((f = __MGL_fopen(filename,"rb")) == NULL)
+        return NULL;
+    base = NULL;
+    if ((len = _MGL_fileSize(f)) > 0 && (base = PM_malloc(len)) != NULL) {
+        if (__MGL_fread(base,1,len,f) != (size_t)len) {
+            PM_free(base);
+            base = NULL;
+            }
+        }
+    __MGL_fclose(f);
+    *size = len;
+    return base;
+}
+
+/****************************************************************************
+PARAMETERS:
+pack    - Pack file to index
+
+RETURNS:
+True on success, false if the archive is not a valid zip file or out of
+memory.
+
+REMARKS:
+Finds the end of central directory record and builds the hash table index
+for all the files in the central directory. Every directory entry is range
+checked against the archive, and directories, encrypted files and files
+using compression methods other than stored and deflated are skipped, as
+are deflated files larger than deflate could ever expand the compressed
+data to. The entries and hash buckets are allocated with the normalised names in a
+single block of memory.
+****************************************************************************/
+static ibool indexArchive(
+    packfile_t *pack)
+{
+    uchar       *p,*end,*dir = NULL;
+    ulong       dirStart,dirSize,namesSize = 0,numBuckets;
+    int         i,count,numEntries,nameLen,len;
+    char        *names;
+    packEntry   *e;
+
+    /* Find the end of central directory record, which is followed by an
+     * optional comment of up to 64Kb.
+     */
+    if (pack->size < ZIP_EOCD_SIZE)
+        return false;
+    end = pack->base + pack->size - ZIP_EOCD_SIZE;
+    for (i = 0; i <= ZIP_MAX_COMMENT && i <= (int)(pack->size - ZIP_EOCD_SIZE); i++) {
+        p = end - i;
+        if (read32(p) == ZIP_EOCD_ID && read16(p+20) <= i) {
+            dir = p;
+            break;
+            }
+        }
+    if (!dir)
+        return false;
+    count = read16(dir+10);
+    dirSize = read32(dir+12);
+    dirStart = read32(dir+16);
+    if (dirStart > pack->size || dirSize > pack->size - dirStart)
+        return false;
+
+    /* Validate the directory and count the entries and name space */
+    end = pack->base + dirStart + dirSize;
+    for (i = 0, p = pack->base + dirStart; i < count; i++) {
+        if (p + ZIP_DIR_SIZE > end || read32(p) != ZIP_DIR_ID)
+            return false;
+        len = ZIP_DIR_SIZE + read16(p+28) + read16(p+30) + read16(p+32);
+        if (p + len > end)
+            return false;
+        namesSize += read16(p+28) + 1;
+        p += len;
+        }
+    for (numBuckets = 16; numBuckets < (ulong)count; numBuckets <<= 1)
+        ;
+
+    /* Allocate the index and build the hash table */
+    if ((pack->entries = PM_malloc(count * sizeof(packEntry) + numBuckets * sizeof(int) + namesSize)) == NULL) {
+        FATALERROR(grNoMem);
+        return false;
+        }
+    pack->buckets = (int*)(pack->entries + count);
+    pack->hashMask = numBuckets - 1;
+    names = (char*)(pack->buckets + numBuckets);
+    for (i = 0; i < (int)numBuckets; i++)
+        pack->buckets[i] = -1;
+    for (i = numEntries = 0, p = pack->base + dirStart; i < count; i++, p += len) {
+        nameLen = read16(p+28);
+        len = ZIP_DIR_SIZE + nameLen + read16(p+30) + read16(p+32);
+        e = &pack->entries[numEntries];
+        e->method = read16(p+10);
+        e->compSize = read32(p+20);
+        e->size = read32(p+24);
+        e->header = read32(p+42);
+        if ((read16(p+8) & ZIP_ENCRYPTED) || (e->method != ZIP_STORED && e->method != ZIP_DEFLATED))
+            continue;
+        if (e->method == ZIP_STORED && e->compSize != e->size)
+            continue;
+        if (e->method == ZIP_DEFLATED && e->size / ZIP_MAX_RATIO > e->compSize)
+            continue;
+        if (pack->size < ZIP_LOCAL_SIZE || e->header > pack->size - ZIP_LOCAL_SIZE || e->compSize > pack->size)
+            continue;
+        if (nameLen == 0 || p[ZIP_DIR_SIZE + nameLen - 1] == '/')
+            continue;
+        if (normaliseName(names,(char*)p + ZIP_DIR_SIZE,nameLen,nameLen+1) <= 0)
+            continue;
+        if (findEntry(pack,names))
+            continue;
+        e->name = names;
+        e->hash = hashName(names);
+        e->next = pack->buckets[e->hash & pack->hashMask];
+        pack->buckets[e->hash & pack->hashMask] = numEntries++;
+        names += strlen(names) + 1;
+        }
+    pack->numEntries = numEntries;
+    return true;
+}
+
+/****************************************************************************
+PARAMETERS:
+pack    - Pack file to free
+
+REMARKS:
+Frees the index and releases the archive memory for a pack file.
+****************************************************************************/
+static void freePack(
+    packfile_t *pack)
+{
+    if (pack->base) {
+        if (pack->mapped)
+            _MGL_unmapFile(pack->base,pack->size);
+        else
+            PM_free(pack->base);
+        }
+    if (pack->entries)
+        PM_free(pack->entries);
+    PM_free(pack);
+}
+
+/****************************************************************************
+DESCRIPTION:
+Opens a pack file archive for loading MGL resources from.
+
+HEADER:
+mgraph.h
+
+PARAMETERS:
+filename    - Name of the pack file to open
+
+RETURNS:
+Pointer to the opened pack file, or NULL on error.
+
+REMARKS:
+This function opens a pack file, which is a standard zip archive, and adds
+it to the list of archives that all the MGL resource loading functions
+search when opening files. This allows the thousands of small bitmaps,
+icons, cursors and fonts that an application may need to be shipped as a
+single file, and loaded with only one file open for the entire archive.
+
+When the first pack file is opened, the current file I/O functions are
+saved and replaced with the pack file I/O functions using MGL_setFileIO.
+After that any file opened for reading in binary mode is first looked up
+in the open pack files, with the most recently opened pack file searched
+first. File names are matched without regard to case or the type of path
+separator used. If the full path name is not found in the archive, the
+leading directories are removed one at a time until a match is found, so
+the paths built by the normal MGL directory search will find files stored
+relative to the root of the archive. Files not found in any pack file, and
+all files opened for writing, are passed through to the saved file I/O
+functions.
+
+The central directory of the archive is indexed into a hash table once
+when the archive is opened, so looking up a file is very fast. If the
+platform supports memory mapped files and the file I/O functions have not
+been overridden, the archive is mapped into memory and files that are
+stored without compression are read directly out of the mapping without
+any extra copies. Files compressed with deflate are decompressed in a
+single pass when they are first read, into buffers that are re-used for later
+files. Other compression methods and encrypted files are not supported.
+
+The pack file functions are safe to call from multiple threads, such as
+the asynchronous resource loading threads, although each open stream
+should only be used by one thread at a time. Pack files should be opened
+and closed from the main thread of the application.
+
+SEE ALSO:
+MGL_closePackFile, MGL_setFileIO, MGL_loadBitmap
+****************************************************************************/
+packfile_t * MGLAPI MGL_openPackFile(
+    const char *filename)
+{
+    packfile_t  *pack;
+    fileio_t    packIO;
+
+    __MGL_result = grOK;
+    if (!packLock) {
+        if ((packLock = _MGL_createEvent()) == NULL) {
+            FATALERROR(grNoMem);
+            return NULL;
+            }
+        _MGL_signalEvent(packLock);
+        }
+    if ((pack = PM_calloc(1,sizeof(packfile_t))) == NULL) {
+        FATALERROR(grNoMem);
+        return NULL;
+        }
+    if ((pack->base = loadArchive(filename,&pack->size,&pack->mapped)) == NULL) {
+        if (__MGL_result == grOK)
+            __MGL_result = grError;
+        goto Error;
+        }
+    if (!indexArchive(pack)) {
+        if (__MGL_result == grOK)
+            __MGL_result = grError;
+        goto Error;
+        }
+
+    /* Add the pack file to the front of the search list, and install the
+     * pack file I/O functions if this is the first pack file.
+     */
+    lockPacks();
+    pack->next = packs;
+    packs = pack;
+    unlockPacks();
+    if (!installed) {
+        prevIO.fopen = __MGL_fopen;
+        prevIO.fclose = __MGL_fclose;
+        prevIO.fseek = __MGL_fseek;
+        prevIO.ftell = __MGL_ftell;
+        prevIO.fread = __MGL_fread;
+        prevIO.fwrite = __MGL_fwrite;
+        packIO.fopen = packFopen;
+        packIO.fclose = packFclose;
+        packIO.fseek = packFseek;
+        packIO.ftell = packFtell;
+        packIO.fread = packFread;
+        packIO.fwrite = packFwrite;
+        MGL_setFileIO(&packIO);
+        installed = true;
+        }
+    return pack;
+
+Error:
+    freePack(pack);
+    return NULL;
+}
+
+/****************************************************************************
+DESCRIPTION:
+Closes a pack file archive.
+
+HEADER:
+mgraph.h
+
+PARAMETERS:
+pack    - Pack file to close
+
+RETURNS:
+True if the pack file was closed, false if it still has open files.
+
+REMARKS:
+This function removes a pack file from the list of archives searched when
+opening files, and frees all the memory used by it. All the files opened
+from the pack file must have been closed first, otherwise the pack file is
+left open and this function returns false.
+
+When the last pack file is closed, the file I/O functions that were in use
+before the first pack file was opened are restored, unless they have been
+changed since with MGL_setFileIO.
+
+SEE ALSO:
+MGL_openPackFile
+****************************************************************************/
+ibool MGLAPI MGL_closePackFile(
+    packfile_t *pack)
+{
+    packfile_t  **prev;
+
+    lockPacks();
+    if (pack->openCount) {
+        unlockPacks();
+        SETERROR(grError);
+        return false;
+        }
+    for (prev = &packs; *prev && *prev != pack; prev = &(*prev)->next)
+        ;
+    if (*prev)
+        *prev = pack->next;
+    if (!packs)
+        freeBufferPool();
+    unlockPacks();
+    freePack(pack);
+    if (!packs && installed) {
+        if (__MGL_fopen == packFopen)
+            MGL_setFileIO(&prevIO);
+        installed = false;
+        }
+    return true;
+}
+
+/****************************************************************************
+REMARKS:
+Closes all the open pack files and frees the pack file lock when the MGL
+is shut down. Any streams still open on the pack files are abandoned.
+{secret}
+****************************************************************************/
+void _MGL_closePackFiles(void)
+{
+    packfile_t  *pack;
+    int         i;
+
+    for (i = 0; i < MAX_PACK_STREAMS; i++) {
+        if (streams[i].pack && streams[i].buf)
+            PM_free(streams[i].buf);
+        streams[i].pack = NULL;
+        }
+    while ((pack = packs) != NULL) {
+        pack->openCount = 0;
+        MGL_closePackFile(pack);
+        }
+    if (packLock) {
+        _MGL_destroyEvent(packLock);
+        packLock = NULL;
+        }
+}
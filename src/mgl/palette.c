@@ -595,7 +595,7 @@ the original pixel in the old palette (the one currently active before this rout
 called).
 
 SEE ALSO:
-MGL_setPalette
+MGL_setPalette, MGL_mapBitmapToPalette
 ****************************************************************************/
 void MGLAPI MGL_mapToPalette(
     MGLDC *dc,
@@ -290,24 +290,33 @@ ibool MGLAPI MGL_getPCXSize(
     return ret;
 }
 
-static int      gcount,gdata,bufSize;
-static uchar    *bufStart,*cStart,*cEnd;
+static MGL_THREAD_LOCAL int   gcount,gdata,bufSize;
+static MGL_THREAD_LOCAL ibool bufAlloc;
+static MGL_THREAD_LOCAL long  bytesLeft;
+static MGL_THREAD_LOCAL uchar *bufStart,*cStart,*cEnd;
 
 /****************************************************************************
 PARAMETERS:
 f   - File to read data from
 
 REMARKS:
-Reads a large chunk of data from disk into the MGL scratch buffer for
-decoding our PCX bitmap data from. Because we read large chunks at a time
-(32Kb for protected mode) it vastly speeds up the time to read and
-decode a PCX file from disk.
+Reads a large chunk of data from disk into the decode buffer for decoding
+our PCX bitmap data from. We never read past the end of the PCX data, and
+if the file is truncated we return a chunk of zeros so the remaining
+pixels are cleared.
 ****************************************************************************/
 static void readChunk(
     FILE *f)
 {
-    ulong size;
-    size = fread(bufStart,1,bufSize,f);
+    size_t size = 0;
+
+    if (bytesLeft > 0)
+        size = __MGL_fread(bufStart,1,MIN(bytesLeft,bufSize),f);
+    if (size == 0) {
+        size = MIN(bufSize,256);
+        memset(bufStart,0,size);
+        }
+    bytesLeft -= size;
     cStart = bufStart;
     cEnd = cStart + size;
 }
@@ -323,7 +332,7 @@ encoding our PCX bitmap data into.
 static void writeChunk(
     FILE *f)
 {
-    fwrite(bufStart,1,cStart - bufStart,f);
+    __MGL_fwrite(bufStart,1,cStart - bufStart,f);
     cStart = bufStart;
     cEnd = cStart + bufSize;
 }
@@ -340,278 +349,223 @@ static void writeChunk(
 
 /****************************************************************************
 PARAMETERS:
-PCXName     - Name of bitmap to get size info for
+f       - File to read data from
+size    - Size of the PCX data remaining in the file
+
+REMARKS:
+Prepares for decoding RLE data from the file. For large images we allocate
+a decode buffer big enough to read the compressed data in a few large
+reads, falling back on the MGL scratch buffer if memory is low.
+****************************************************************************/
+static void beginDecode(
+    FILE *f,
+    long size)
+{
+    bytesLeft = (size > 0) ? size : 0x7FFFFFFFL;
+    bufSize = MIN(bytesLeft,RLE_CHUNK_SIZE);
+    bufAlloc = false;
+    if (bufSize > _MGL_bufSize && (bufStart = PM_malloc(bufSize)) != NULL)
+        bufAlloc = true;
+    else {
+        bufStart = (uchar*)_MGL_buf;
+        bufSize = _MGL_bufSize;
+        }
+    gcount = gdata = 0;
+    readChunk(f);
+}
+
+/****************************************************************************
+REMARKS:
+Releases the decode buffer allocated by beginDecode.
+****************************************************************************/
+static void endDecode(void)
+{
+    if (bufAlloc)
+        PM_free(bufStart);
+    bufAlloc = false;
+}
+
+/****************************************************************************
+PARAMETERS:
+f           - File to read data from
 p           - Pointer to buffer to decode into
 rowbyte     - Number of bytes in a row to decode
 
 REMARKS:
-Decodes a single scanline of data from the PCX file. Note that this routine
-properly handles runs that cross a scanline boundary, which the PCX file
-format allows.
+Decodes a single scanline of data from the PCX file. Encoded runs are
+expanded with memset, and bytes that are not run codes are copied in
+blocks straight out of the decode buffer with memcpy. Note that this
+routine properly handles runs that cross a scanline boundary, which the
+PCX file format allows.
 ****************************************************************************/
 static void decodeScan(
     FILE *f,
     uchar *p,
     int rowbytes)
 {
-    int data = gdata,count = gcount,bytecnt = 0;
-
-    while (bytecnt < rowbytes) {
-        /* Read another run from the file */
-        if (count < 1) {
-            PCX_GETC(data,f);
-            if ((data & PCX_RUN_MASK) == PCX_RUN_MASK) {
-                count = data & PCX_CNT_MASK;
-                PCX_GETC(data,f);
-                }
-            else
-                count = 1;
-            }
+    int     x = 0,n,data;
+    uchar   *q,*end;
+
+    /* Finish any run carried over from the previous scanline */
+    if (gcount > 0) {
+        x = MIN(gcount,rowbytes);
+        memset(p,gdata,x);
+        gcount -= x;
+        }
 
-        /* Decode the run into the bitmap */
-        while (count--) {
-            *p++ = data;
-            if (++bytecnt == rowbytes)
-                break;
+    while (x < rowbytes) {
+        /* Copy a block of literal bytes from the decode buffer */
+        if (cStart == cEnd)
+            readChunk(f);
+        end = cStart + MIN(cEnd - cStart,rowbytes - x);
+        for (q = cStart; q < end && (*q & PCX_RUN_MASK) != PCX_RUN_MASK; q++)
+            ;
+        if (q != cStart) {
+            n = q - cStart;
+            memcpy(p + x,cStart,n);
+            cStart = q;
+            x += n;
+            continue;
             }
+
+        /* Expand an encoded run into the scanline */
+        PCX_GETC(data,f);
+        gcount = data & PCX_CNT_MASK;
+        PCX_GETC(gdata,f);
+        n = MIN(gcount,rowbytes - x);
+        memset(p + x,gdata,n);
+        gcount -= n;
+        x += n;
         }
-    gdata = data;
-    gcount = count;
 }
 
 /****************************************************************************
 PARAMETERS:
-PCXName     - Name of bitmap to get size info for
-p           - Pointer to buffer to decode into
+f           - File to read data from
+line        - Temporary buffer to decode the planar scanline into
+dst         - Pointer to buffer to decode into
 rowbyte     - Number of bytes in a row to decode
 
 REMARKS:
-Decodes a single scanline of data from the PCX file. Note that this routine
-properly handles runs that cross a scanline boundary, which the PCX file
-format allows.
-
-This version decodes a 4bpp planar scanline into a 4bpp packed pixel format,
-used to store 4bpp bitmaps internally.
+Decodes a single scanline of data from the PCX file. This version decodes
+a 4bpp planar scanline into a 4bpp packed pixel format, used to store 4bpp
+bitmaps internally.
 ****************************************************************************/
 static void decodeScan4(
     FILE *f,
+    uchar *line,
     uchar *dst,
     int rowbytes)
 {
-    int     data = gdata,count = gcount,bytecnt = 0;
+    int     i,j,k,pix,data;
     int     planebytes = rowbytes / 4;
-    int     planecnt = 0;
-    uchar   *p;
-
-    p = dst;
-    while (bytecnt < planebytes && planecnt < 4) {
-        /* Read another run from the file */
-        if (count < 1) {
-            PCX_GETC(data,f);
-            if ((data & PCX_RUN_MASK) == PCX_RUN_MASK) {
-                count = data & PCX_CNT_MASK;
-                PCX_GETC(data,f);
-                }
-            else
-                count = 1;
-            }
 
-        /* Decode the run into the bitmap */
-        while (count--) {
-            if (planecnt == 0) {
-                if (data & 0x80) p[0]  = 0x10; else p[0] = 0x00;
-                if (data & 0x40) p[0] |= 0x01;
-                if (data & 0x20) p[1]  = 0x10; else p[1] = 0x00;
-                if (data & 0x10) p[1] |= 0x01;
-                if (data & 0x08) p[2]  = 0x10; else p[2] = 0x00;
-                if (data & 0x04) p[2] |= 0x01;
-                if (data & 0x02) p[3]  = 0x10; else p[3] = 0x00;
-                if (data & 0x01) p[3] |= 0x01;
-                }
-            else if (planecnt == 1) {
-                if (data & 0x80) p[0] |= 0x20;
-                if (data & 0x40) p[0] |= 0x02;
-                if (data & 0x20) p[1] |= 0x20;
-                if (data & 0x10) p[1] |= 0x02;
-                if (data & 0x08) p[2] |= 0x20;
-                if (data & 0x04) p[2] |= 0x02;
-                if (data & 0x02) p[3] |= 0x20;
-                if (data & 0x01) p[3] |= 0x02;
-                }
-            else if (planecnt == 2) {
-                if (data & 0x80) p[0] |= 0x40;
-                if (data & 0x40) p[0] |= 0x04;
-                if (data & 0x20) p[1] |= 0x40;
-                if (data & 0x10) p[1] |= 0x04;
-                if (data & 0x08) p[2] |= 0x40;
-                if (data & 0x04) p[2] |= 0x04;
-                if (data & 0x02) p[3] |= 0x40;
-                if (data & 0x01) p[3] |= 0x04;
-                }
-            else {
-                if (data & 0x80) p[0] |= 0x80;
-                if (data & 0x40) p[0] |= 0x08;
-                if (data & 0x20) p[1] |= 0x80;
-                if (data & 0x10) p[1] |= 0x08;
-                if (data & 0x08) p[2] |= 0x80;
-                if (data & 0x04) p[2] |= 0x08;
-                if (data & 0x02) p[3] |= 0x80;
-                if (data & 0x01) p[3] |= 0x08;
-                }
-            if (++bytecnt == planebytes) {
-                planecnt++;
-                bytecnt = 0;
-                p = dst;
-                break;
+    decodeScan(f,line,rowbytes);
+    for (i = 0; i < planebytes; i++, dst += 4) {
+        for (k = 0; k < 4; k++) {
+            pix = 0;
+            for (j = 0; j < 4; j++) {
+                data = line[i + j*planebytes] >> (6 - k*2);
+                pix |= ((data & 2) << (3 + j)) | ((data & 1) << j);
                 }
-            p += 4;
+            dst[k] = pix;
             }
         }
-    gdata = data;
-    gcount = count;
 }
 
 /****************************************************************************
 PARAMETERS:
-PCXName     - Name of bitmap to get size info for
-p           - Pointer to buffer to decode into
+f           - File to read data from
+line        - Temporary buffer to decode the planar scanline into
+dst         - Pointer to buffer to decode into
 rowbyte     - Number of bytes in a row to decode
 
 REMARKS:
-Decodes a single scanline of data from the PCX file. Note that this routine
-properly handles runs that cross a scanline boundary, which the PCX file
-format allows.
-
-This version decoded 4bpp scanline data into 8bpp scanline data.
+Decodes a single scanline of data from the PCX file. This version decoded
+4bpp planar scanline data into 8bpp scanline data.
 ****************************************************************************/
 static void decodeScan4to8(
     FILE *f,
+    uchar *line,
     uchar *dst,
     int rowbytes)
 {
-    int     data = gdata,count = gcount,bytecnt = 0;
+    int     i,j,k,pix;
     int     planebytes = rowbytes / 4;
-    int     planecnt = 0;
-    uchar   *p;
-
-    p = dst;
-    while (bytecnt < planebytes && planecnt < 4) {
-        /* Read another run from the file */
-        if (count < 1) {
-            PCX_GETC(data,f);
-            if ((data & PCX_RUN_MASK) == PCX_RUN_MASK) {
-                count = data & PCX_CNT_MASK;
-                PCX_GETC(data,f);
-                }
-            else
-                count = 1;
-            }
 
-        /* Decode the run into the bitmap */
-        while (count--) {
-            if (planecnt == 0) {
-                if (data & 0x80) p[0] = 0x01; else p[0] = 0x00;
-                if (data & 0x40) p[1] = 0x01; else p[1] = 0x00;
-                if (data & 0x20) p[2] = 0x01; else p[2] = 0x00;
-                if (data & 0x10) p[3] = 0x01; else p[3] = 0x00;
-                if (data & 0x08) p[4] = 0x01; else p[4] = 0x00;
-                if (data & 0x04) p[5] = 0x01; else p[5] = 0x00;
-                if (data & 0x02) p[6] = 0x01; else p[6] = 0x00;
-                if (data & 0x01) p[7] = 0x01; else p[7] = 0x00;
-                }
-            else if (planecnt == 1) {
-                if (data & 0x80) p[0] |= 0x02;
-                if (data & 0x40) p[1] |= 0x02;
-                if (data & 0x20) p[2] |= 0x02;
-                if (data & 0x10) p[3] |= 0x02;
-                if (data & 0x08) p[4] |= 0x02;
-                if (data & 0x04) p[5] |= 0x02;
-                if (data & 0x02) p[6] |= 0x02;
-                if (data & 0x01) p[7] |= 0x02;
-                }
-            else if (planecnt == 2) {
-                if (data & 0x80) p[0] |= 0x04;
-                if (data & 0x40) p[1] |= 0x04;
-                if (data & 0x20) p[2] |= 0x04;
-                if (data & 0x10) p[3] |= 0x04;
-                if (data & 0x08) p[4] |= 0x04;
-                if (data & 0x04) p[5] |= 0x04;
-                if (data & 0x02) p[6] |= 0x04;
-                if (data & 0x01) p[7] |= 0x04;
-                }
-            else {
-                if (data & 0x80) p[0] |= 0x08;
-                if (data & 0x40) p[1] |= 0x08;
-                if (data & 0x20) p[2] |= 0x08;
-                if (data & 0x10) p[3] |= 0x08;
-                if (data & 0x08) p[4] |= 0x08;
-                if (data & 0x04) p[5] |= 0x08;
-                if (data & 0x02) p[6] |= 0x08;
-                if (data & 0x01) p[7] |= 0x08;
-                }
-            if (++bytecnt == planebytes) {
-                planecnt++;
-                bytecnt = 0;
-                p = dst;
-                break;
-                }
-            p += 8;
+    decodeScan(f,line,rowbytes);
+    for (i = 0; i < planebytes; i++, dst += 8) {
+        for (k = 0; k < 8; k++) {
+            pix = 0;
+            for (j = 0; j < 4; j++)
+                pix |= ((line[i + j*planebytes] >> (7 - k)) & 1) << j;
+            dst[k] = pix;
             }
         }
-    gdata = data;
-    gcount = count;
 }
 
 /****************************************************************************
 PARAMETERS:
-PCXName     - Name of bitmap to get size info for
-p           - Pointer to buffer to decode into
+f           - File to read data from
+line        - Temporary buffer to decode the planar scanline into
+dst         - Pointer to buffer to decode into
 rowbyte     - Number of bytes in a row to decode
 
 REMARKS:
-Decodes a single scanline of data from the PCX file. Note that this routine
-properly handles runs that cross a scanline boundary, which the PCX file
-format allows.
-
-This version decodes planar 24bpp scanline data into packed 24bpp format.
+Decodes a single scanline of data from the PCX file. This version decodes
+planar 24bpp scanline data into packed 24bpp format.
 ****************************************************************************/
 static void decodeScan24(
     FILE *f,
+    uchar *line,
     uchar *dst,
     int rowbytes)
 {
-    int     data = gdata,count = gcount,bytecnt = 0;
-    int     planebytes = rowbytes / 3;
-    int     planecnt = 0;
-    uchar   *p;
-
-    p = dst+2;
-    while (bytecnt < planebytes && planecnt < 3) {
-        /* Read another run from the file */
-        if (count < 1) {
-            PCX_GETC(data,f);
-            if ((data & PCX_RUN_MASK) == PCX_RUN_MASK) {
-                count = data & PCX_CNT_MASK;
-                PCX_GETC(data,f);
-                }
-            else
-                count = 1;
-            }
+    int     i,planebytes = rowbytes / 3;
+    uchar   *r = line,*g = r + planebytes,*b = g + planebytes;
+
+    decodeScan(f,line,rowbytes);
+    for (i = 0; i < planebytes; i++, dst += 3) {
+        dst[0] = b[i];
+        dst[1] = g[i];
+        dst[2] = r[i];
+        }
+}
 
-        /* Decode the run into the bitmap */
-        while (count--) {
-            *p = data;
-            p += 3;
-            if (++bytecnt == planebytes) {
-                planecnt++;
-                bytecnt = 0;
-                p = dst+2-planecnt;
-                break;
-                }
-            }
+/****************************************************************************
+PARAMETERS:
+p           - Pointer to scanline being encoded
+n1          - Index of the first pixel in the run
+n2          - Index of the next pixel to compare
+rowbytes    - Number of bytes in the scanline
+
+RETURNS:
+Index of the first pixel after the end of the run.
+
+REMARKS:
+Finds the end of a run of identical pixels. Once the run reaches a DWORD
+boundary in the scanline we compare four pixels at a time, which quickly
+skips over the long runs of a single color common in sprites and
+backgrounds. This is kept out of encodeScan so that the loop for literal
+pixels stays as tight as possible.
+****************************************************************************/
+static int scanRun(
+    uchar *p,
+    int n1,
+    int n2,
+    int rowbytes)
+{
+    M_uint32    pattern = p[n1] * 0x01010101UL;
+
+    while (((ulong)(p + n2) & 3) && n2 < rowbytes && p[n2] == p[n1])
+        n2++;
+    if (!((ulong)(p + n2) & 3)) {
+        while (n2 + 4 <= rowbytes && *((M_uint32*)(p + n2)) == pattern)
+            n2 += 4;
         }
-    gdata = data;
-    gcount = count;
+    while (n2 < rowbytes && p[n2] == p[n1])
+        n2++;
+    return n2;
 }
 
 /****************************************************************************
@@ -634,8 +588,8 @@ static void encodeScan(
         /* Compute number of bytes in this run */
         n1 = n2;
         n2 = n1 + 1;
-        while (p[n2] == p[n1] && (n2 < rowbytes))
-            n2++;
+        if (n2 < rowbytes && p[n2] == p[n1])
+            n2 = scanRun(p,n1,n2+1,rowbytes);
         n = n2 - n1;
 
         /* Write multiple runs to disk */
@@ -646,8 +600,9 @@ static void encodeScan(
             }
 
         /* Write final run to disk */
-        if ((n > 1) || ((p[n1] & PCX_RUN_MASK) == PCX_RUN_MASK))
+        if ((n > 1) || ((p[n1] & PCX_RUN_MASK) == PCX_RUN_MASK)) {
             PCX_PUTC(n | PCX_RUN_MASK,f);
+            }
         PCX_PUTC(p[n1],f);
         }
 }
@@ -686,7 +641,7 @@ bitmap_t * MGLAPI MGL_loadPCXExt(
     palette_t   pal[256];       /* Temporary space for palette  */
     long        size;
     int         i,palSize;
-    uchar       *p;
+    uchar       *p,*line = NULL;
 
     /* Read the bitmap header information */
     if (!readPCXHeaderExt(&bmh,pal,&palSize,f,dwOffset,dwSize,loadPalette))
@@ -717,20 +672,26 @@ bitmap_t * MGLAPI MGL_loadPCXExt(
         }
     bitmap->surface = (uchar*)bitmap + sizeof(bitmap_t) + palSize;
 
+    /* Allocate a temporary scanline to decode planar images into */
+    if (bitmap->bitsPerPixel == 4 || bitmap->bitsPerPixel == 24) {
+        if ((line = PM_malloc(bitmap->bytesPerLine)) == NULL) {
+            PM_free(bitmap);
+            FATALERROR(grNoMem);
+            return NULL;
+            }
+        }
+
     /* Decode the pixels in the bitmap */
     p = bitmap->surface;
-    bufStart = (uchar*)_MGL_buf;
-    bufSize = _MGL_bufSize;
-    readChunk(f);
-    gcount = gdata = 0;
+    beginDecode(f,(long)dwSize - (__MGL_ftell(f) - (long)dwOffset));
     if (bitmap->bitsPerPixel == 4) {
         for (i = 0; i < bitmap->height; i++, p += bitmap->bytesPerLine) {
-            decodeScan4(f,(uchar*)p,bitmap->bytesPerLine);
+            decodeScan4(f,line,(uchar*)p,bitmap->bytesPerLine);
             }
         }
     else if (bitmap->bitsPerPixel == 24) {
         for (i = 0; i < bitmap->height; i++, p += bitmap->bytesPerLine) {
-            decodeScan24(f,(uchar*)p,bitmap->bytesPerLine);
+            decodeScan24(f,line,(uchar*)p,bitmap->bytesPerLine);
             }
         }
     else {
@@ -738,6 +699,8 @@ bitmap_t * MGLAPI MGL_loadPCXExt(
             decodeScan(f,(uchar*)p,bitmap->bytesPerLine);
             }
         }
+    endDecode();
+    PM_free(line);
     return bitmap;
 }
 
@@ -847,22 +810,33 @@ ibool MGLAPI MGL_loadPCXIntoDCExt(
     int                 i,palSize,height;
     int                 decodeBytes;
     ibool               oldCheckId;
+    uchar               *line = NULL;
 
     /* Read the bitmap header */
     if (!readPCXHeaderExt(&bmh,pal,&palSize,f,dwOffset,dwSize,loadPalette))
         return false;
 
-    /* Allocate a temporary bitmap to convert the scanlines */
+    /* Allocate a temporary bitmap to convert the scanlines, plus a
+     * temporary scanline to decode planar images into.
+     */
     bmh.pal = pal;
     bmh.pf = &_MGL_pixelFormats[pfRGB24];
-    if (bmh.bitsPerPixel == 4) {
-        /* The temporary scanline is actually 8bpp when decoding 4bpp images */
-        if ((bmh.surface = PM_malloc(bmh.width)) == NULL) {
+    if (bmh.bitsPerPixel == 4 || bmh.bitsPerPixel == 24) {
+        if ((line = PM_malloc(bmh.bytesPerLine)) == NULL) {
             FATALERROR(grNoMem);
             return false;
             }
         }
-    else if ((bmh.surface = PM_malloc(bmh.bytesPerLine)) == NULL) {
+    if (bmh.bitsPerPixel == 4) {
+        /* The temporary scanline is actually 8bpp when decoding 4bpp
+         * images, which is 8 pixels for every byte in each plane.
+         */
+        bmh.surface = PM_malloc(MAX(bmh.width,bmh.bytesPerLine*2));
+        }
+    else
+        bmh.surface = PM_malloc(bmh.bytesPerLine);
+    if (bmh.surface == NULL) {
+        PM_free(line);
         FATALERROR(grNoMem);
         return false;
         }
@@ -885,10 +859,7 @@ ibool MGLAPI MGL_loadPCXIntoDCExt(
      * at a time into our temporary memory DC, and then blting this to
      * the destination DC.
      */
-    bufStart = (uchar*)_MGL_buf;
-    bufSize = _MGL_bufSize;
-    readChunk(f);
-    gcount = gdata = 0;
+    beginDecode(f,(long)dwSize - (__MGL_ftell(f) - (long)dwOffset));
     height = bmh.height;
     bmh.height = 1;
     if (bmh.bitsPerPixel == 4) {
@@ -902,14 +873,14 @@ ibool MGLAPI MGL_loadPCXIntoDCExt(
         bmh.bytesPerLine = bmh.width;
         bmh.bitsPerPixel = 8;
         for (i = 0; i < height; i++) {
-            decodeScan4to8(f,bmh.surface,decodeBytes);
+            decodeScan4to8(f,line,bmh.surface,decodeBytes);
             MGL_putBitmap(dc,dstLeft,dstTop+i,&bmh,MGL_REPLACE_MODE);
             }
         }
     else if (bmh.bitsPerPixel == 24) {
         /* 24-bit images are run length encoded by stored plane by plane */
         for (i = 0; i < height; i++) {
-            decodeScan24(f,bmh.surface,bmh.bytesPerLine);
+            decodeScan24(f,line,bmh.surface,bmh.bytesPerLine);
             MGL_putBitmap(dc,dstLeft,dstTop+i,&bmh,MGL_REPLACE_MODE);
             }
         }
@@ -920,6 +891,8 @@ ibool MGLAPI MGL_loadPCXIntoDCExt(
             MGL_putBitmap(dc,dstLeft,dstTop+i,&bmh,MGL_REPLACE_MODE);
             }
         }
+    endDecode();
+    PM_free(line);
     PM_free(bmh.surface);
     MGL_checkIdentityPalette(oldCheckId);
     return true;
@@ -1126,7 +1099,7 @@ ibool MGLAPI MGL_savePCXFromDC(
     p = _MGL_buf;
     bufSize = _MGL_bufSize/2;
     bufStart = (uchar*)_MGL_buf + bufSize;
-    memset(p,bmh.bytesPerLine,0);
+    memset(p,0,bmh.bytesPerLine);
     cStart = bufStart;
     cEnd = cStart + bufSize;
     for (i = top; i < bottom; i++) {
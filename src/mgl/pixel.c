@@ -75,6 +75,7 @@ void MGLAPI MGL_pixelCoordFast(
         return;
     else if (!MGL_ptInRectCoord(x,y,DC.clipRectScreen))
         return;
+    MARK_DIRTY(&DC,x,y,x+1,y+1);
     DC.r.PutPixel(x,y);
 }
 
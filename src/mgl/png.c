@@ -40,7 +40,39 @@
 
 /*--------------------------- Global Variables ----------------------------*/
 
-static jmp_buf  jmpbuf;
+#define PNG_GROUP_SIZE      (256 * 1024L)
+#define PNG_DICT_SIZE       32768L
+#define PNG_ADLER_BASE      65521UL
+
+#ifndef PNG_HAVE_IDAT
+#define PNG_HAVE_IDAT       0x04
+#endif
+
+/* {secret} */
+typedef struct {
+    png_bytep   data;           /* Compressed data for the group           */
+    ulong       size;           /* Size of the compressed data             */
+    ulong       adler;          /* Adler-32 of the filtered group data     */
+    } pngGroup;
+
+/* {secret} */
+typedef struct {
+    png_bytep   raw;            /* Raw scanlines blitted from the DC       */
+    long        rawPitch;       /* Bytes per line for the raw scanlines    */
+    png_bytep   filtered;       /* Filter type byte + filtered scanlines   */
+    png_bytep   zero;           /* Scanline of zeros above the first line  */
+    int         height;         /* Number of scanlines in the image        */
+    int         rowBytes;       /* Bytes in each raw PNG scanline          */
+    int         pixelBytes;     /* Bytes per pixel used by the filters     */
+    int         width;          /* Width in pixels for RGB swapping        */
+    int         filters;        /* Allowed filters (PNG_FILTER_*)          */
+    int         level;          /* Compression level                       */
+    int         strategy;       /* Compression strategy                    */
+    int         groupRows;      /* Scanlines in each compressed group      */
+    int         numGroups;      /* Number of compressed groups             */
+    pngGroup    *groups;        /* Compressed groups                       */
+    ibool       failed;         /* Set if any group failed to compress     */
+    } pngWriter;
 
 /*------------------------- Implementation --------------------------------*/
 
@@ -66,8 +98,7 @@ static void PMAPI my_png_error(
     fclose(f);
 #endif
     __MGL_result = grInvalidBitmap;
-    longjmp(jmpbuf, 1);
-    (void)png_ptr;
+    longjmp(png_ptr->jmpbuf, 1);
 }
 
 /****************************************************************************
@@ -317,7 +348,7 @@ bitmap_t * MGLAPI MGL_loadPNGExt(
         }
 
     /* Set error handling for using the setjmp/longjmp method */
-    if (setjmp(jmpbuf)) {
+    if (setjmp(png_ptr->jmpbuf)) {
         /* We get here on errr, so destroy all memory we allocated */
         png_destroy_read_struct(&png_ptr, &info_ptr, (png_infopp)NULL);
         __MGL_result = grErrorBPD;
@@ -646,7 +677,7 @@ ibool MGLAPI MGL_getPNGSizeExt(
         }
 
     /* Set error handling for using the setjmp/longjmp method */
-    if (setjmp(jmpbuf)) {
+    if (setjmp(png_ptr->jmpbuf)) {
         /* We get here on errr, so destroy all memory we allocated */
         png_destroy_read_struct(&png_ptr, &info_ptr, (png_infopp)NULL);
         __MGL_result = grErrorBPD;
@@ -696,110 +727,35 @@ ibool MGLAPI MGL_getPNGSizeExt(
 }
 
 /****************************************************************************
-DESCRIPTION:
-Loads a PNG file directly into an existing device context.
-
-HEADER:
-mgraph.h
-
-PARAMETERS:
-dc              - Device context to load bitmap into
-PNGName         - Name of PNG file to load
-dstLeft         - Left coordinate to load PNG at
-dstTop          - Top coordinate to load PNG at
-loadPalette     - True if you would like to replace the dc's palette with PNG file's
-
-RETURNS:
-True if the PNG file was loaded, false on error.
-
-REMARKS:
-Locates the specified PNG file and loads it into the specified device context at the
-specified destination coordinates. If the PNG is of a different pixel depth than the
-device context that it is being loaded into, the PNG will be converted as it is loaded
-to the pixel format of the device context it is being loaded into.
-
-If the PNG file has a higher bit depth than the surface the pixel values
-will be dithered to the correct color depth. This will use the currently selected
-palette if loadPalette is false, or the HalfTone palette if true.
-
-When MGL is searching for bitmap files it will first attempt to find the files just by
-using the filename itself. Hence if you wish to look for a specific bitmap file, you
-should pass the full pathname to the file that you are interested in. If the filename is
-a simple relative filename (i.e. "MYFILE.PNG"), MGL will then search in the
-BITMAPS directory relative to the path specified in mglpath variable that was
-passed to MGL_init. As a final resort MGL will also look for the files in the
-BITMAPS directory relative to the MGL_ROOT environment variable.
-
-If the bitmap file was not found, or an error occurred while reading the bitmap file,
-this function will return false. You can check the MGL_result error code to
-determine the cause.
-
-If the PNG file has interlacing enabled MGL must create a memory buffer internally
-to render the image into before blitting to the dc. Therefore using non-interlaced
-images will reduce memory overhead and speed performance.
-
-SEE ALSO:
-MGL_availablePNG, MGL_getPNGSize,MGL_loadPNG, MGL_savePNGFromDC
-****************************************************************************/
-ibool MGLAPI MGL_loadPNGIntoDC(
-    MGLDC *dc,
-    const char *PNGName,
-    int dstLeft,
-    int dstTop,
-    ibool loadPalette)
-{
-    FILE    *f;
-    ibool   ret;
-
-    __MGL_result = grOK;
-    if ((f = _MGL_openFile(MGL_BITMAPS, PNGName, "rb")) == NULL) {
-        __MGL_result = grBitmapNotFound;
-        return false;
-        }
-    ret = MGL_loadPNGIntoDCExt(dc,f,0,_MGL_fileSize(f),dstLeft,dstTop,loadPalette);
-    __MGL_fclose(f);
-    return ret;
-}
-
-/****************************************************************************
-DESCRIPTION:
-Load a PNG file directly into an existing device context
-
-HEADER:
-mgraph.h
-
 PARAMETERS:
-dc              - Device context to output to
+dc              - Device context being loaded into (NULL if none)
 f               - Open binary file to read bitmap from
 dwOffset        - Offset to start of PNG file within open file
 dwSize          - Size of PNG file in bytes
-dstLeft         - Left coordinate to align left edge of bitmap with
-dstTop          - Top coordinate to align top edge of bitmap with
-loadPalette     - true if you wish to load the images palette
+loadPalette     - True to load the images palette into the device context
+bandHeight      - Number of scanlines in each band (0 for default)
+callback        - Callback to receive each decoded band
+cookie          - Cookie passed to the callback
 
 RETURNS:
-True if the PNG was loaded, false on error.
+True on success, false on error or if the callback aborted decoding.
 
 REMARKS:
-This function is the same as MGL_loadPNGIntoDC, however it loads the file from a
-previously open file. This allows you to create your own large files with
-multiple files embedded in them.
-
-If the PNG file has interlacing enabled MGL must create a memory buffer internally
-to render the image into before blitting to the dc. Therefore using non-interlaced
-images will reduce memory overhead and speed performance.
-
-SEE ALSO:
-MGL_loadPNGIntoDC, MGL_loadBitmapIntoDCExt, MGL_loadPNG
+Internal function to decode a PNG file a band of scanlines at a time.
+Scanlines are decoded directly into the band in the native pixel format of
+the image so no intermediate conversion is required. Non-interlaced images
+only ever need a single band of memory, but interlaced images must be
+decoded into a full size buffer before the first band can be delivered.
 ****************************************************************************/
-ibool MGLAPI MGL_loadPNGIntoDCExt(
+static ibool streamPNG(
     MGLDC *dc,
     FILE *f,
     ulong dwOffset,
     ulong dwSize,
-    int dstLeft,
-    int dstTop,
-    ibool loadPalette)
+    ibool loadPalette,
+    int bandHeight,
+    bandcallback_t callback,
+    void *cookie)
 {
     bitmap_t        bmp;
     png_structp     png_ptr;
@@ -810,10 +766,14 @@ ibool MGLAPI MGL_loadPNGIntoDCExt(
     double          screen_gamma, image_gamma;
     char            *gamma_str;
     palette_t       pal[256];
-    int             bitsPerPixel,oldCheckId;
+    int             bitsPerPixel,top,y;
     pixel_format_t  pf;
+    bitmap_t        band;
+    png_bytep       row;
+    ibool           ok = true;
 
     /* Seek to the start of the file */
+    __MGL_result = grOK;
     __MGL_fseek(f,dwOffset,SEEK_SET);
 
     /* Create and initialize the png_struct with the desired error handler
@@ -836,7 +796,7 @@ ibool MGLAPI MGL_loadPNGIntoDCExt(
 
     /* Set error handling for using the setjmp/longjmp method */
     bmp.surface = NULL;
-    if (setjmp(jmpbuf)) {
+    if (setjmp(png_ptr->jmpbuf)) {
         /* We get here on errr, so destroy all memory we allocated */
         PM_free(bmp.surface);
         png_destroy_read_struct(&png_ptr, &info_ptr, (png_infopp)NULL);
@@ -911,13 +871,15 @@ ibool MGLAPI MGL_loadPNGIntoDCExt(
     number_passes = png_set_interlace_handling(png_ptr);
 
     /* Because of the nature of how png files are read and stored we cannot
-     * load multiple pass images directly into the frame buffer,
-     * to avoid multiple translations on the same pixel we create a temporary
-     * dc that is the size of the full image. If the image is not multiple
-     * pass then we create a buffer for only one line.
+     * deliver multiple pass images a band at a time, so for those we decode
+     * into a temporary buffer that is the size of the full image. If the
+     * image is not multiple pass then we create a buffer for only one band.
      */
+    if (bandHeight <= 0)
+        bandHeight = (int)MAX(1L,STREAM_BAND_PIXELS / (long)width);
+    bandHeight = MIN(bandHeight,(int)height);
     bmp.width = width;
-    bmp.height = (number_passes > 1) ? height : 1;
+    bmp.height = (number_passes > 1) ? height : bandHeight;
     bmp.bitsPerPixel = bitsPerPixel;
     switch (bitsPerPixel) {
         case 1:
@@ -942,7 +904,7 @@ ibool MGLAPI MGL_loadPNGIntoDCExt(
         }
     bmp.pal = pal;
     bmp.pf = &pf;
-    if ((bmp.surface = PM_calloc(1,bmp.bytesPerLine * bmp.height)) == NULL) {
+    if ((bmp.surface = PM_calloc(1,(long)bmp.bytesPerLine * bmp.height)) == NULL) {
         png_destroy_read_struct(&png_ptr, &info_ptr, (png_infopp)NULL);
         FATALERROR(grNoMem);
         return false;
@@ -989,7 +951,6 @@ ibool MGLAPI MGL_loadPNGIntoDCExt(
     png_read_update_info(png_ptr, info_ptr);
 
     /* Add the palette to the temporary dc, if there is a palette */
-    oldCheckId = MGL_checkIdentityPalette(false);
     havePal = png_get_valid(png_ptr, info_ptr, PNG_INFO_PLTE);
     if ((havePal && color_type == PNG_COLOR_TYPE_PALETTE) || (color_type == PNG_COLOR_TYPE_GRAY) || (color_type == PNG_COLOR_TYPE_GRAY_ALPHA)) {
         if (havePal) {
@@ -1016,7 +977,7 @@ ibool MGLAPI MGL_loadPNGIntoDCExt(
                 }
             }
         /* If loadPalette is true we also load the palette into the DC */
-        if (loadPalette && numcolors == 256) {
+        if (dc && loadPalette && numcolors == 256) {
             MGL_setPalette(dc,pal,MGL_getPaletteSize(dc),0);
             MGL_realizePalette(dc,MGL_getPaletteSize(dc),0,true);
             }
@@ -1026,7 +987,7 @@ ibool MGLAPI MGL_loadPNGIntoDCExt(
          * If a palette is required by the target dc we will just add the
          * halftone palette.
          */
-        if (loadPalette && (dc->mi.modeFlags & MGL_IS_COLOR_INDEX)) {
+        if (dc && loadPalette && (dc->mi.modeFlags & MGL_IS_COLOR_INDEX)) {
             MGL_getHalfTonePalette(pal);
             MGL_setPalette(dc,pal,MGL_getPaletteSize(dc),0);
             MGL_realizePalette(dc,MGL_getPaletteSize(dc),0,true);
@@ -1039,42 +1000,260 @@ ibool MGLAPI MGL_loadPNGIntoDCExt(
      * device context. I did not add this because the method below is kind of
      * slow compared to just writing the image.
      */
+    band = bmp;
     if (number_passes > 1) {
-        /* Read the image one or more scanlines at a time */
+        /* Decode all passes into the full image buffer first */
         for (pass = 0; pass < number_passes; pass++) {
-            /* Read the image a single row at a time */
-            int y;
             for (y = 0; y < (int)height; y++) {
-                png_bytep row_pointers;
-                row_pointers = ((uchar*)bmp.surface)+(bmp.bytesPerLine*y);
-                /* because the line needs data from the previous pass we must
-                 * load that data from the DC.
-                 */
-                png_read_rows(png_ptr, &row_pointers, NULL, 1);
+                row = ((uchar*)bmp.surface)+(bmp.bytesPerLine*y);
+                png_read_rows(png_ptr, &row, NULL, 1);
                 }
-            MGL_putBitmap(dc, dstLeft, dstTop, &bmp, MGL_REPLACE_MODE);
             }
         }
-    else {
-        int y;
-        for (y = 0; y < (int)height; y++) {
-            png_bytep row_pointers;
-            row_pointers = ((uchar*)bmp.surface);
-            png_read_rows(png_ptr, &row_pointers, NULL, 1);
-            MGL_putBitmap(dc, dstLeft, dstTop+y, &bmp, MGL_REPLACE_MODE);
+
+    /* Deliver the image to the callback a band at a time. For single pass
+     * images each band is decoded just before it is delivered.
+     */
+    for (top = 0; top < (int)height; top += band.height) {
+        band.height = MIN(bandHeight,(int)height - top);
+        if (number_passes > 1)
+            band.surface = (uchar*)bmp.surface + (long)bmp.bytesPerLine * top;
+        else {
+            for (y = 0; y < band.height; y++) {
+                row = ((uchar*)bmp.surface)+(bmp.bytesPerLine*y);
+                png_read_rows(png_ptr, &row, NULL, 1);
+                }
+            }
+        if (!callback(&band,top,cookie)) {
+            ok = false;
+            break;
             }
         }
 
     /* Read rest of file, and get additional chunks in info_ptr */
-    png_read_end(png_ptr, info_ptr);
+    if (ok)
+        png_read_end(png_ptr, info_ptr);
 
     /* Clean up after the read, and free any memory allocated */
     png_destroy_read_struct(&png_ptr, &info_ptr, (png_infopp)NULL);
     PM_free(bmp.surface);
+    (void)dwSize;
+    return ok;
+}
+
+/****************************************************************************
+DESCRIPTION:
+Loads a PNG file directly into an existing device context.
+
+HEADER:
+mgraph.h
+
+PARAMETERS:
+dc              - Device context to load bitmap into
+PNGName         - Name of PNG file to load
+dstLeft         - Left coordinate to load PNG at
+dstTop          - Top coordinate to load PNG at
+loadPalette     - True if you would like to replace the dc's palette with PNG file's
+
+RETURNS:
+True if the PNG file was loaded, false on error.
+
+REMARKS:
+Locates the specified PNG file and loads it into the specified device context at the
+specified destination coordinates. If the PNG is of a different pixel depth than the
+device context that it is being loaded into, the PNG will be converted as it is loaded
+to the pixel format of the device context it is being loaded into.
+
+If the PNG file has a higher bit depth than the surface the pixel values
+will be dithered to the correct color depth. This will use the currently selected
+palette if loadPalette is false, or the HalfTone palette if true.
+
+When MGL is searching for bitmap files it will first attempt to find the files just by
+using the filename itself. Hence if you wish to look for a specific bitmap file, you
+should pass the full pathname to the file that you are interested in. If the filename is
+a simple relative filename (i.e. "MYFILE.PNG"), MGL will then search in the
+BITMAPS directory relative to the path specified in mglpath variable that was
+passed to MGL_init. As a final resort MGL will also look for the files in the
+BITMAPS directory relative to the MGL_ROOT environment variable.
+
+If the bitmap file was not found, or an error occurred while reading the bitmap file,
+this function will return false. You can check the MGL_result error code to
+determine the cause.
+
+If the PNG file has interlacing enabled MGL must create a memory buffer internally
+to render the image into before blitting to the dc. Therefore using non-interlaced
+images will reduce memory overhead and speed performance.
+
+SEE ALSO:
+MGL_availablePNG, MGL_getPNGSize,MGL_loadPNG, MGL_savePNGFromDC
+****************************************************************************/
+ibool MGLAPI MGL_loadPNGIntoDC(
+    MGLDC *dc,
+    const char *PNGName,
+    int dstLeft,
+    int dstTop,
+    ibool loadPalette)
+{
+    FILE    *f;
+    ibool   ret;
+
+    __MGL_result = grOK;
+    if ((f = _MGL_openFile(MGL_BITMAPS, PNGName, "rb")) == NULL) {
+        __MGL_result = grBitmapNotFound;
+        return false;
+        }
+    ret = MGL_loadPNGIntoDCExt(dc,f,0,_MGL_fileSize(f),dstLeft,dstTop,loadPalette);
+    __MGL_fclose(f);
+    return ret;
+}
+
+/****************************************************************************
+DESCRIPTION:
+Load a PNG file directly into an existing device context
+
+HEADER:
+mgraph.h
+
+PARAMETERS:
+dc              - Device context to output to
+f               - Open binary file to read bitmap from
+dwOffset        - Offset to start of PNG file within open file
+dwSize          - Size of PNG file in bytes
+dstLeft         - Left coordinate to align left edge of bitmap with
+dstTop          - Top coordinate to align top edge of bitmap with
+loadPalette     - true if you wish to load the images palette
+
+RETURNS:
+True if the PNG was loaded, false on error.
+
+REMARKS:
+This function is the same as MGL_loadPNGIntoDC, however it loads the file from a
+previously open file. This allows you to create your own large files with
+multiple files embedded in them.
+
+If the PNG file has interlacing enabled MGL must create a memory buffer internally
+to render the image into before blitting to the dc. Therefore using non-interlaced
+images will reduce memory overhead and speed performance.
+
+SEE ALSO:
+MGL_loadPNGIntoDC, MGL_loadBitmapIntoDCExt, MGL_loadPNG
+****************************************************************************/
+ibool MGLAPI MGL_loadPNGIntoDCExt(
+    MGLDC *dc,
+    FILE *f,
+    ulong dwOffset,
+    ulong dwSize,
+    int dstLeft,
+    int dstTop,
+    ibool loadPalette)
+{
+    putbandinfo_t   info;
+    ibool           oldCheckId,ret;
+
+    info.dc = dc;
+    info.dstLeft = dstLeft;
+    info.dstTop = dstTop;
+    oldCheckId = MGL_checkIdentityPalette(false);
+    ret = streamPNG(dc,f,dwOffset,dwSize,loadPalette,0,_MGL_putBand,&info);
     MGL_checkIdentityPalette(oldCheckId);
+    return ret;
+}
+
+/****************************************************************************
+DESCRIPTION:
+Decodes a PNG file a band of scanlines at a time using an open file.
+
+HEADER:
+mgraph.h
+
+PARAMETERS:
+f           - Open binary file to read bitmap from
+dwOffset    - Offset to start of PNG file within open file
+dwSize      - Size of PNG file in bytes
+bandHeight  - Number of scanlines in each band (0 for default)
+callback    - Callback to receive each decoded band
+cookie      - Cookie passed to the callback
+
+RETURNS:
+True if the PNG file was decoded, false on error or if aborted.
+
+REMARKS:
+This function is the same as MGL_streamPNG, however it loads the file from
+a previously open file. This allows you to create your own large files with
+multiple files embedded in them.
+
+SEE ALSO:
+MGL_streamPNG, MGL_loadPNGIntoDCExt
+****************************************************************************/
+ibool MGLAPI MGL_streamPNGExt(
+    FILE *f,
+    ulong dwOffset,
+    ulong dwSize,
+    int bandHeight,
+    bandcallback_t callback,
+    void *cookie)
+{
+    return streamPNG(NULL,f,dwOffset,dwSize,false,bandHeight,callback,cookie);
+}
+
+/****************************************************************************
+DESCRIPTION:
+Decodes a PNG file a band of scanlines at a time.
+
+HEADER:
+mgraph.h
+
+PARAMETERS:
+PNGName     - Name of PNG file to decode
+bandHeight  - Number of scanlines in each band (0 for default)
+callback    - Callback to receive each decoded band
+cookie      - Cookie passed to the callback
+
+RETURNS:
+True if the PNG file was decoded, false on error or if aborted.
+
+REMARKS:
+Locates the specified PNG file and decodes it from top to bottom, calling
+the callback function with each band of scanlines as soon as it has been
+decoded. The band passed to the callback is only valid for the duration of
+the callback, and the top parameter is the index of the first scanline in
+the band. If bandHeight is 0, a default band height is chosen that keeps the
+band to around 64Kb pixels. If the callback returns false, decoding is
+stopped and this function returns false.
+
+Each band is delivered in the native format of the image, the same as the
+bitmaps returned by MGL_loadPNG. Palette based and grayscale images are
+delivered with their palette attached to the band, and images with an alpha
+channel are delivered as 32-bit ARGB (or 8-bit with alpha for grayscale).
+
+Non-interlaced images only ever hold a single band of scanlines in memory.
+Interlaced images cannot be delivered until the final pass has been decoded,
+so MGL must decode them into a full size buffer internally first.
+
+To decode into your own buffer in a different pixel format, wrap the buffer
+with MGL_createCustomDC and use MGL_loadPNGIntoDC, which streams the bands
+into the device context and converts each band as it is handed off.
+
+SEE ALSO:
+MGL_streamPNGExt, MGL_loadPNGIntoDC, MGL_streamJPEG
+****************************************************************************/
+ibool MGLAPI MGL_streamPNG(
+    const char *PNGName,
+    int bandHeight,
+    bandcallback_t callback,
+    void *cookie)
+{
+    FILE    *f;
+    ibool   ret;
+
     __MGL_result = grOK;
-    (void)dwSize;
-    return true;
+    if ((f = _MGL_openFile(MGL_BITMAPS, PNGName, "rb")) == NULL) {
+        __MGL_result = grBitmapNotFound;
+        return false;
+        }
+    ret = MGL_streamPNGExt(f,0,_MGL_fileSize(f),bandHeight,callback,cookie);
+    __MGL_fclose(f);
+    return ret;
 }
 
 /****************************************************************************
@@ -1161,7 +1340,7 @@ viewport. If you specify dimensions that are larger than the current device cont
 you will get garbage in the bitmap file as a result.
 
 SEE ALSO:
-MGL_loadPNG, MGL_loadPNGIntoDC
+MGL_savePNGFromDCOpt, MGL_loadPNG, MGL_loadPNGIntoDC
 ****************************************************************************/
 ibool MGLAPI MGL_savePNGFromDCExt(
     MGLDC *dc,
@@ -1171,18 +1350,404 @@ ibool MGLAPI MGL_savePNGFromDCExt(
     int right,
     int bottom,
     ibool savePalette)
+{
+    pngsaveopts_t   opts;
+
+    opts.speed = MGL_PNG_SPEED_CUSTOM;
+    opts.compressionLevel = -1;
+    opts.filters = MGL_PNG_FILTER_DEFAULT;
+    opts.savePalette = savePalette;
+    opts.parallel = false;
+    return MGL_savePNGFromDCOpt(dc,PNGName,left,top,right,bottom,&opts);
+}
+
+/****************************************************************************
+PARAMETERS:
+ctx     - PNG writer being compressed
+top     - First scanline to swap
+bottom  - Last scanline to swap (exclusive)
+
+REMARKS:
+Swaps the red and blue channels of a band of 24-bit scanlines, since the
+PNG file stores RGB triplets in the opposite order to the MGL pfRGB24
+memory layout.
+****************************************************************************/
+static void swapBand(
+    void *ctx,
+    int top,
+    int bottom)
+{
+    pngWriter   *w = ctx;
+    png_bytep   p;
+    png_byte    t;
+    int         x,y;
+
+    for (y = top; y < bottom; y++) {
+        p = w->raw + y * w->rawPitch;
+        for (x = 0; x < w->width; x++, p += 3) {
+            t = p[0];
+            p[0] = p[2];
+            p[2] = t;
+            }
+        }
+}
+
+/****************************************************************************
+PARAMETERS:
+type        - PNG filter type to apply (0 to 4)
+cur         - Scanline to filter
+prev        - Previous scanline (all zeros for the first scanline)
+out         - Place to store the filtered scanline
+rowBytes    - Number of bytes in the scanline
+pixelBytes  - Number of bytes per pixel (1 for less than 8 bits per pixel)
+
+RETURNS:
+Sum of the absolute values of the filtered bytes.
+
+REMARKS:
+Applies one of the five PNG scanline filters. The returned sum is the same
+heuristic the PNG library uses to pick the best filter for each scanline.
+****************************************************************************/
+static ulong filterRow(
+    int type,
+    png_bytep cur,
+    png_bytep prev,
+    png_bytep out,
+    int rowBytes,
+    int pixelBytes)
+{
+    ulong   sum = 0;
+    int     i,a,b,c,p,pa,pb,pc;
+    png_byte v;
+
+    for (i = 0; i < rowBytes; i++) {
+        a = (i >= pixelBytes) ? cur[i - pixelBytes] : 0;
+        b = prev[i];
+        switch (type) {
+            case 0:
+                v = cur[i];
+                break;
+            case 1:
+                v = (png_byte)(cur[i] - a);
+                break;
+            case 2:
+                v = (png_byte)(cur[i] - b);
+                break;
+            case 3:
+                v = (png_byte)(cur[i] - ((a + b) >> 1));
+                break;
+            default:
+                c = (i >= pixelBytes) ? prev[i - pixelBytes] : 0;
+                p = b - c;
+                pc = a - c;
+                pa = p < 0 ? -p : p;
+                pb = pc < 0 ? -pc : pc;
+                pc = (p + pc) < 0 ? -(p + pc) : p + pc;
+                p = (pa <= pb && pa <= pc) ? a : (pb <= pc) ? b : c;
+                v = (png_byte)(cur[i] - p);
+                break;
+            }
+        out[i] = v;
+        sum += (v < 128) ? v : 256 - v;
+        }
+    return sum;
+}
+
+/****************************************************************************
+PARAMETERS:
+ctx     - PNG writer being compressed
+first   - First group of scanlines to filter
+last    - Last group of scanlines to filter (exclusive)
+
+REMARKS:
+Filters all the scanlines in a range of groups. When more than one filter
+is allowed, each filter is tried in turn and the one with the smallest sum
+of absolute differences is kept for the scanline.
+****************************************************************************/
+static void filterBand(
+    void *ctx,
+    int first,
+    int last)
+{
+    pngWriter   *w = ctx;
+    png_bytep   cur,prev,out;
+    ulong       sum,bestSum;
+    int         y,type,best,tried,top,bottom;
+
+    top = first * w->groupRows;
+    bottom = MIN(last * w->groupRows,w->height);
+    for (y = top; y < bottom; y++) {
+        cur = w->raw + y * w->rawPitch;
+        prev = y ? cur - w->rawPitch : w->zero;
+        out = w->filtered + (long)y * (w->rowBytes + 1);
+        best = tried = -1;
+        bestSum = 0;
+        for (type = 0; type < 5; type++) {
+            if (!(w->filters & (PNG_FILTER_NONE << type)))
+                continue;
+            sum = filterRow(type,cur,prev,out + 1,w->rowBytes,w->pixelBytes);
+            if (best < 0 || sum < bestSum) {
+                best = type;
+                bestSum = sum;
+                }
+            tried = type;
+            }
+        if (best != tried)
+            filterRow(best,cur,prev,out + 1,w->rowBytes,w->pixelBytes);
+        out[0] = (png_byte)best;
+        }
+}
+
+/****************************************************************************
+PARAMETERS:
+ctx     - PNG writer being compressed
+first   - First group of scanlines to compress
+last    - Last group of scanlines to compress (exclusive)
+
+REMARKS:
+Compresses each group of filtered scanlines into an independent raw deflate
+stream. The last 32Kb of the previous group is used as the dictionary so
+matches can still reach back across the group boundary, and every group
+except the last is ended with a sync flush so that the streams can simply
+be concatenated to form a single valid zlib stream.
+****************************************************************************/
+static void compressBand(
+    void *ctx,
+    int first,
+    int last)
+{
+    pngWriter   *w = ctx;
+    pngGroup    *grp;
+    z_stream    zs;
+    png_bytep   in,data;
+    ulong       len,dictLen,alloc;
+    int         g,err,flush;
+
+    for (g = first; g < last && !w->failed; g++) {
+        grp = &w->groups[g];
+        in = w->filtered + (long)g * w->groupRows * (w->rowBytes + 1);
+        len = (ulong)(MIN(w->groupRows,w->height - g * w->groupRows)) * (w->rowBytes + 1);
+        flush = (g == w->numGroups-1) ? Z_FINISH : Z_SYNC_FLUSH;
+        alloc = len + (len >> 8) + 64;
+        if ((grp->data = PM_malloc(alloc)) == NULL) {
+            w->failed = true;
+            return;
+            }
+        memset(&zs,0,sizeof(zs));
+        if (deflateInit2(&zs,w->level,Z_DEFLATED,-MAX_WBITS,8,w->strategy) != Z_OK) {
+            w->failed = true;
+            return;
+            }
+        if (g > 0) {
+            dictLen = MIN(PNG_DICT_SIZE,(ulong)(in - w->filtered));
+            deflateSetDictionary(&zs,in - dictLen,(uInt)dictLen);
+            }
+        zs.next_in = in;
+        zs.avail_in = (uInt)len;
+        for (;;) {
+            zs.next_out = grp->data + grp->size;
+            zs.avail_out = (uInt)(alloc - grp->size);
+            err = deflate(&zs,flush);
+            grp->size = alloc - zs.avail_out;
+            if (err != Z_OK && err != Z_STREAM_END) {
+                w->failed = true;
+                break;
+                }
+            if ((flush == Z_FINISH) ? (err == Z_STREAM_END) : (zs.avail_out != 0))
+                break;
+            alloc *= 2;
+            if ((data = PM_realloc(grp->data,alloc)) == NULL) {
+                w->failed = true;
+                break;
+                }
+            grp->data = data;
+            }
+        deflateEnd(&zs);
+        grp->adler = adler32(1L,in,(uInt)len);
+        }
+}
+
+/****************************************************************************
+PARAMETERS:
+adler1  - Adler-32 of the first block of data
+adler2  - Adler-32 of the second block of data
+len2    - Length of the second block of data
+
+RETURNS:
+Adler-32 of both blocks of data concatenated together.
+****************************************************************************/
+static ulong combineAdler32(
+    ulong adler1,
+    ulong adler2,
+    ulong len2)
+{
+    ulong   sum1,sum2,rem;
+
+    rem = len2 % PNG_ADLER_BASE;
+    sum1 = adler1 & 0xFFFF;
+    sum2 = (rem * sum1) % PNG_ADLER_BASE;
+    sum1 += (adler2 & 0xFFFF) + PNG_ADLER_BASE - 1;
+    sum2 += ((adler1 >> 16) & 0xFFFF) + ((adler2 >> 16) & 0xFFFF) + PNG_ADLER_BASE - rem;
+    if (sum1 >= PNG_ADLER_BASE) sum1 -= PNG_ADLER_BASE;
+    if (sum1 >= PNG_ADLER_BASE) sum1 -= PNG_ADLER_BASE;
+    if (sum2 >= (PNG_ADLER_BASE << 1)) sum2 -= (PNG_ADLER_BASE << 1);
+    if (sum2 >= PNG_ADLER_BASE) sum2 -= PNG_ADLER_BASE;
+    return sum1 | (sum2 << 16);
+}
+
+/****************************************************************************
+PARAMETERS:
+w   - PNG writer to free
+
+REMARKS:
+Frees all the memory allocated for the parallel compression buffers.
+****************************************************************************/
+static void freeWriter(
+    pngWriter *w)
+{
+    int i;
+
+    if (w->groups) {
+        for (i = 0; i < w->numGroups; i++)
+            PM_free(w->groups[i].data);
+        PM_free(w->groups);
+        w->groups = NULL;
+        }
+    PM_free(w->filtered);
+    PM_free(w->zero);
+    w->filtered = w->zero = NULL;
+}
+
+/****************************************************************************
+PARAMETERS:
+png_ptr     - PNG library write structure
+w           - PNG writer with the raw scanlines to compress
+
+RETURNS:
+True on success, false if there was not enough memory.
+
+REMARKS:
+Filters and compresses the image on all the band worker threads, and then
+writes the compressed groups out as IDAT chunks. Nothing is written to the
+file if this function fails, so the caller can fall back to compressing the
+image with the PNG library instead.
+****************************************************************************/
+static ibool writeParallel(
+    png_structp png_ptr,
+    pngWriter *w)
+{
+    static png_byte idat[5] = {73, 68, 65, 84, '\0'};
+    png_byte        hdr[4];
+    ulong           adler,len,rowLen = w->rowBytes + 1;
+    int             g,flevel;
+
+    if ((w->filtered = PM_malloc(rowLen * w->height)) == NULL)
+        return false;
+    if ((w->zero = PM_calloc(1,w->rowBytes)) == NULL)
+        return false;
+    if ((w->groups = PM_calloc(w->numGroups,sizeof(pngGroup))) == NULL)
+        return false;
+
+    /* Filter the scanlines and then compress each group of scanlines */
+    _MGL_runBands(0,w->numGroups,filterBand,w);
+    w->failed = false;
+    _MGL_runBands(0,w->numGroups,compressBand,w);
+    if (w->failed)
+        return false;
+
+    /* Write out each group as an IDAT chunk, adding the zlib stream header
+     * to the first chunk and the combined Adler-32 to the last chunk.
+     */
+    flevel = (w->level < 0 || w->level == 6) ? 2 : (w->level < 2) ? 0 : (w->level < 6) ? 1 : 3;
+    hdr[0] = 0x78;
+    hdr[1] = (png_byte)(flevel << 6);
+    hdr[1] += (png_byte)(31 - ((hdr[0] * 256 + hdr[1]) % 31));
+    adler = 1;
+    for (g = 0; g < w->numGroups; g++) {
+        len = (ulong)(MIN(w->groupRows,w->height - g * w->groupRows)) * rowLen;
+        adler = combineAdler32(adler,w->groups[g].adler,len);
+        len = w->groups[g].size;
+        if (g == 0)
+            len += 2;
+        if (g == w->numGroups-1)
+            len += 4;
+        png_write_chunk_start(png_ptr,idat,len);
+        if (g == 0)
+            png_write_chunk_data(png_ptr,hdr,2);
+        png_write_chunk_data(png_ptr,w->groups[g].data,w->groups[g].size);
+        if (g == w->numGroups-1) {
+            hdr[0] = (png_byte)(adler >> 24);
+            hdr[1] = (png_byte)(adler >> 16);
+            hdr[2] = (png_byte)(adler >> 8);
+            hdr[3] = (png_byte)adler;
+            png_write_chunk_data(png_ptr,hdr,4);
+            }
+        png_write_chunk_end(png_ptr);
+        }
+    png_ptr->mode |= PNG_HAVE_IDAT;
+    return true;
+}
+
+/****************************************************************************
+DESCRIPTION:
+Save a portion of a device context to a PNG file on disk with options.
+
+HEADER:
+mgraph.h
+
+PARAMETERS:
+dc          - Device context to save
+PNGName     - Name of bitmap file to save
+left        - Left coordinate of bitmap to save
+top         - Top coordinate of bitmap to save
+right       - Right coordinate of bitmap to save
+bottom      - Bottom coordinate of bitmap to save
+opts        - Options controlling how the file is compressed
+
+RETURNS:
+True on success, false on error.
+
+REMARKS:
+This function is the same as MGL_savePNGFromDCExt, but allows you to control
+the compression level and scanline filters used when saving the PNG file,
+either directly or by choosing one of the speed presets. Lower compression
+levels and fewer filters make saving much faster at the expense of a larger
+file, which is useful for saving screen captures on the fly.
+
+If the parallel flag is set in the options and multi-threaded blitting has
+been enabled with MGL_setBltThreads, large images are filtered and
+compressed on all the worker threads in parallel. The image is split into
+groups of scanlines that are compressed independently and then stitched
+back together into a single standard PNG data stream. To do this the entire
+image must be copied into memory first, so parallel compression uses more
+memory than saving on a single thread. If there is not enough memory the
+image is simply saved on a single thread instead.
+
+SEE ALSO:
+MGL_savePNGFromDC, MGL_savePNGFromDCExt, MGL_setBltThreads
+****************************************************************************/
+ibool MGLAPI MGL_savePNGFromDCOpt(
+    MGLDC *dc,
+    const char *PNGName,
+    int left,
+    int top,
+    int right,
+    int bottom,
+    const pngsaveopts_t *opts)
 {
     FILE            *fp;
     palette_t       pal[256];
     png_color       pngpal[256];
     MGLDC           *memDC = NULL;
+    pixel_format_t  *pf = NULL;
     png_structp     png_ptr;
     png_infop       info_ptr;
     png_uint_32     mw = right-left;
     png_uint_32     mh = bottom-top;
-    int             bit_depth = 0;
+    int             bit_depth = 0, bits = 0, level, filters;
     png_byte        color_type = 0;
-    int             number_passes, pass;
+    ibool           parallel,blitted = false;
+    pngWriter       w;
 
     /* Attempt to open the file for writing */
     __MGL_result = grOK;
@@ -1200,13 +1765,13 @@ ibool MGLAPI MGL_savePNGFromDCExt(
         case 1:
         case 4:
         case 8:
-            memDC = MGL_createMemoryDC(right-left, 1, dc->mi.bitsPerPixel, NULL);
-            bit_depth = dc->mi.bitsPerPixel;
+            bits = bit_depth = dc->mi.bitsPerPixel;
             color_type = PNG_COLOR_TYPE_PALETTE;
             break;
         case 16:
             if (dc->mi.modeFlags & MGL_IS_COLOR_INDEX) {
-                memDC = MGL_createMemoryDC(right-left, 1, 16, &_MGL_pixelFormats[pfCI8_A]);
+                pf = &_MGL_pixelFormats[pfCI8_A];
+                bits = 16;
                 bit_depth = 8;
                 color_type = PNG_COLOR_TYPE_GRAY_ALPHA;
                 break;
@@ -1214,18 +1779,59 @@ ibool MGLAPI MGL_savePNGFromDCExt(
             // Fall through to 24-bit case if not 8-bit + alpha format
         case 15:
         case 24:
-            memDC = MGL_createMemoryDC(right-left, 1, 24, &_MGL_pixelFormats[pfRGB24]);
-            bit_depth = 8;
-            color_type = PNG_COLOR_TYPE_RGB;
-            break;
         case 32:
-            memDC = MGL_createMemoryDC(right-left, 1, 24, &_MGL_pixelFormats[pfRGB24]);
+            pf = &_MGL_pixelFormats[pfRGB24];
+            bits = 24;
             bit_depth = 8;
             color_type = PNG_COLOR_TYPE_RGB;
             break;
         }
+
+    /* Work out the compression level and filters to use */
+    level = opts->compressionLevel;
+    filters = opts->filters;
+    switch (opts->speed) {
+        case MGL_PNG_SPEED_FASTEST:
+            level = 1;
+            filters = MGL_PNG_FILTER_SUB;
+            break;
+        case MGL_PNG_SPEED_FAST:
+            level = 3;
+            filters = MGL_PNG_FILTER_SUB | MGL_PNG_FILTER_UP;
+            break;
+        case MGL_PNG_SPEED_NORMAL:
+            level = 6;
+            filters = MGL_PNG_FILTER_ALL;
+            break;
+        case MGL_PNG_SPEED_SMALLEST:
+            level = 9;
+            filters = MGL_PNG_FILTER_ALL;
+            break;
+        }
+    if (opts->speed != MGL_PNG_SPEED_CUSTOM && (color_type == PNG_COLOR_TYPE_PALETTE || bit_depth < 8))
+        filters = MGL_PNG_FILTER_NONE;
+    if (level < -1 || level > 9)
+        level = -1;
+    filters &= MGL_PNG_FILTER_ALL;
+
+    /* Blit the entire image into memory for parallel compression, falling
+     * back to compressing a scanline at a time if there is not enough memory
+     */
+    memset(&w,0,sizeof(w));
+    parallel = opts->parallel && mh > 1 && _MGL_useBandThreads((long)mw * mh);
+    if (parallel) {
+        w.rowBytes = (int)(((long)mw * bits + 7) / 8);
+        w.groupRows = (int)MAX(1,PNG_GROUP_SIZE / (w.rowBytes + 1));
+        w.numGroups = (int)((mh + w.groupRows - 1) / w.groupRows);
+        if (w.numGroups < 2)
+            parallel = false;
+        }
+    if (parallel && (memDC = MGL_createMemoryDC(mw,mh,bits,pf)) == NULL)
+        parallel = false;
+    if (!memDC)
+        memDC = MGL_createMemoryDC(mw,1,bits,pf);
     if (memDC == NULL) {
-        fclose(fp);
+        __MGL_fclose(fp);
         __MGL_result = grNoMem;
         return false;
         }
@@ -1244,24 +1850,28 @@ ibool MGLAPI MGL_savePNGFromDCExt(
      * in case we are using dynamically linked libraries.
      */
     if ((png_ptr = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, my_png_error, my_png_warn)) == NULL) {
-        fclose(fp);
+        __MGL_fclose(fp);
+        MGL_destroyDC(memDC);
         __MGL_result = grErrorBPD;
         return false;
         }
 
     /* Allocate/initialize the image information data */
     if ((info_ptr = png_create_info_struct(png_ptr)) == NULL) {
-        fclose(fp);
+        __MGL_fclose(fp);
+        MGL_destroyDC(memDC);
         png_destroy_write_struct(&png_ptr,  (png_infopp)NULL);
         __MGL_result = grErrorBPD;
         return false;
         }
 
     /* Set error handling for using the setjmp/longjmp method */
-    if (setjmp(jmpbuf)) {
+    if (setjmp(png_ptr->jmpbuf)) {
         /* Free all of the memory associated with the png_ptr and info_ptr */
         png_destroy_write_struct(&png_ptr,  (png_infopp)NULL);
-        fclose(fp);
+        __MGL_fclose(fp);
+        MGL_destroyDC(memDC);
+        freeWriter(&w);
         __MGL_result = grErrorBPD;
         return false;
         }
@@ -1272,6 +1882,12 @@ ibool MGLAPI MGL_savePNGFromDCExt(
     /* Flip RGB pixel ordering to the format we need (BGR according to PNG is actually RGB for us!) */
     png_set_bgr(png_ptr);
 
+    /* Set the compression level and filters if they are not the defaults */
+    if (level >= 0)
+        png_set_compression_level(png_ptr, level);
+    if (filters)
+        png_set_filter(png_ptr, PNG_FILTER_TYPE_BASE, filters);
+
     /* Set the image information here.  Width and height are up to 2^31,
      * bit_depth is one of 1, 2, 4, 8, or 16, but valid values also depend on
      * the color_type selected. color_type is one of PNG_COLOR_TYPE_GRAY,
@@ -1282,7 +1898,7 @@ ibool MGLAPI MGL_savePNGFromDCExt(
      */
     png_set_IHDR(png_ptr, info_ptr, mw, mh, bit_depth, color_type,
         PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_BASE, PNG_FILTER_TYPE_BASE);
-    if (savePalette && (dc->mi.modeFlags & MGL_IS_COLOR_INDEX)) {
+    if (opts->savePalette && (dc->mi.modeFlags & MGL_IS_COLOR_INDEX)) {
         /* set the palette if there is one, for indexed-color images */
         int i;
         for (i = 0; i <= (int)dc->mi.maxColor; i++) {
@@ -1296,19 +1912,44 @@ ibool MGLAPI MGL_savePNGFromDCExt(
     /* Write the file header information */
     png_write_info(png_ptr, info_ptr);
 
-    /* Write out the image data by one or more scanlines
-     * The number of passes is either 1 for non-interlaced images,
-     * or 7 for interlaced images.
+    /* Compress the image in parallel if possible. The filters default to the
+     * same ones the PNG library would choose for the image type.
      */
-    number_passes = png_set_interlace_handling(png_ptr);
-    for (pass = 0; pass < number_passes; pass++) {
+    if (parallel) {
+        MGL_bitBltCoord(memDC,dc,left,top,right,bottom,0,0,MGL_REPLACE_MODE);
+        blitted = true;
+        w.raw = memDC->surface;
+        w.rawPitch = memDC->mi.bytesPerLine;
+        w.height = mh;
+        w.width = mw;
+        w.pixelBytes = MAX(1,bits / 8);
+        w.level = level;
+        if ((w.filters = filters) == 0)
+            w.filters = (color_type == PNG_COLOR_TYPE_PALETTE || bit_depth < 8) ? PNG_FILTER_NONE : PNG_ALL_FILTERS;
+        w.strategy = (w.filters == PNG_FILTER_NONE) ? Z_DEFAULT_STRATEGY : Z_FILTERED;
+        if (color_type == PNG_COLOR_TYPE_RGB)
+            _MGL_runBands(0,mh,swapBand,&w);
+        if (!writeParallel(png_ptr,&w)) {
+            /* Put the RGB channels back for the PNG library to swap */
+            if (color_type == PNG_COLOR_TYPE_RGB)
+                _MGL_runBands(0,mh,swapBand,&w);
+            parallel = false;
+            }
+        freeWriter(&w);
+        }
+
+    /* Otherwise write out the image data a scanline at a time */
+    if (!parallel) {
         int y;
         png_bytep p = (png_bytep)memDC->surface;
         for (y = 0; y < (int)mh; y++) {
-            MGL_bitBltCoord(memDC,dc,
-                left,top+y,
-                right,top+y+1,
-                0,0,MGL_REPLACE_MODE);
+            if (!blitted)
+                MGL_bitBltCoord(memDC,dc,
+                    left,top+y,
+                    right,top+y+1,
+                    0,0,MGL_REPLACE_MODE);
+            else
+                p = (png_bytep)memDC->surface + (long)y * memDC->mi.bytesPerLine;
             png_write_rows(png_ptr, &p, 1);
             }
         }
@@ -1316,8 +1957,21 @@ ibool MGLAPI MGL_savePNGFromDCExt(
     /* Clean up and exit */
     png_write_end(png_ptr, info_ptr);
     png_destroy_write_struct(&png_ptr, (png_infopp)NULL);
-    fclose(fp);
+    __MGL_fclose(fp);
     MGL_destroyDC(memDC);
     return true;
 }
 
+/****************************************************************************
+REMARKS:
+Makes sure the PNG library has been loaded. The library is loaded on the
+first call into it, which is not thread safe, so this is called before any
+asynchronous loader threads are started.
+{secret}
+****************************************************************************/
+void _MGL_loadPNGLibrary(void)
+{
+    png_byte    sig[1] = {0};
+
+    png_sig_cmp(sig, (png_size_t)0, 1);
+}
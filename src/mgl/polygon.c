@@ -231,6 +231,8 @@ static int _MGL_preClipPoly(
     cbottom = MIN(bottom,DC.clipRectViewFX.bottom);
     if (ctop >= cbottom)
         return -1;
+    MARK_DIRTY_VIEW(&DC,MGL_FIXTOINT(cleft),MGL_FIXTOINT(ctop),
+        MGL_FIXTOINT(cright)+1,MGL_FIXTOINT(cbottom)+1);
     if (cleft == left && ctop == top && cright == right && cbottom == bottom)
         return 0;
     return 1;
@@ -84,6 +84,7 @@ void MGLAPI MGL_putMonoImage(
         END_VISIBLE_CLIP_LIST(dc);
         return;
         }
+    MARK_DIRTY_VIEW(dc,r.left,r.top,r.right,r.bottom);
 
     /* Now draw the bitmap */
     MAKE_HARDWARE_CURRENT(dc,false);
@@ -206,6 +207,15 @@ void MGLAPI MGL_putBitmap(
         END_VISIBLE_CLIP_LIST(dc);
         return;
         }
+    MARK_DIRTY_VIEW(dc,d.left,d.top,d.right,d.bottom);
+
+    /* Split large blits to memory device contexts across threads, and
+     * dither RGB bitmaps to low color depths with the span kernels.
+     */
+    if (_MGL_bandPutBitmap(dc,d.left-x,d.top-y,d.right-x,d.bottom-y,d.left,d.top,bitmap,op)) {
+        END_VISIBLE_CLIP_LIST(dc);
+        return;
+        }
 
     /* Now blit the bitmap */
     if (bitmap->bitsPerPixel == 1) {
@@ -449,9 +459,18 @@ void MGLAPI MGL_putBitmapSection(
         END_VISIBLE_CLIP_LIST(dc);
         return;
         }
+    MARK_DIRTY_VIEW(dc,d.left,d.top,d.right,d.bottom);
     left += (d.left - dstLeft); right = left + (d.right - d.left);
     top += (d.top - dstTop);    bottom = top + (d.bottom - d.top);
 
+    /* Split large blits to memory device contexts across threads, and
+     * dither RGB bitmaps to low color depths with the span kernels.
+     */
+    if (_MGL_bandPutBitmap(dc,left,top,right,bottom,d.left,d.top,bitmap,op)) {
+        END_VISIBLE_CLIP_LIST(dc);
+        return;
+        }
+
     /* Blt the pixels to the device */
     if (bitmap->bitsPerPixel == 1) {
         int         oldop = dc->a.writeMode;
@@ -623,6 +642,7 @@ void MGLAPI MGL_putBitmapMask(
         END_VISIBLE_CLIP_LIST(dc);
         return;
         }
+    MARK_DIRTY_VIEW(dc,d.left,d.top,d.right,d.bottom);
 
     /* Adjust to bitmap coordinates */
     MGL_offsetRect(d,-x,-y);
@@ -748,6 +768,7 @@ void MGLAPI MGL_putBitmapSrcTrans(
         END_VISIBLE_CLIP_LIST(dc);
         return;
         }
+    MARK_DIRTY_VIEW(dc,d.left,d.top,d.right,d.bottom);
 
     /* Adjust to bitmap coordinates */
     MGL_offsetRect(d,-x,-y);
@@ -921,6 +942,7 @@ void MGLAPI MGL_putBitmapSrcTransSection(
         END_VISIBLE_CLIP_LIST(dc);
         return;
         }
+    MARK_DIRTY_VIEW(dc,d.left,d.top,d.right,d.bottom);
     left += (d.left - dstLeft); right = left + (d.right - d.left);
     top += (d.top - dstTop);    bottom = top + (d.bottom - d.top);
     dstLeft = d.left;           dstTop = d.top;
@@ -1070,6 +1092,7 @@ void MGLAPI MGL_putBitmapDstTrans(
         END_VISIBLE_CLIP_LIST(dc);
         return;
         }
+    MARK_DIRTY_VIEW(dc,d.left,d.top,d.right,d.bottom);
 
     /* Adjust to bitmap coordinates */
     MGL_offsetRect(d,-x,-y);
@@ -1245,6 +1268,7 @@ void MGLAPI MGL_putBitmapDstTransSection(
         END_VISIBLE_CLIP_LIST(dc);
         return;
         }
+    MARK_DIRTY_VIEW(dc,d.left,d.top,d.right,d.bottom);
     left += (d.left - dstLeft); right = left + (d.right - d.left);
     top += (d.top - dstTop);    bottom = top + (d.bottom - d.top);
     dstLeft = d.left;           dstTop = d.top;
@@ -1379,6 +1403,7 @@ void MGLAPI MGL_putBitmapPatt(
         END_VISIBLE_CLIP_LIST(dc);
         return;
         }
+    MARK_DIRTY_VIEW(dc,d.left,d.top,d.right,d.bottom);
 
     /* Adjust to bitmap coordinates */
     MGL_offsetRect(d,-x,-y);
@@ -1505,6 +1530,7 @@ void MGLAPI MGL_putBitmapPattSection(
         END_VISIBLE_CLIP_LIST(dc);
         return;
         }
+    MARK_DIRTY_VIEW(dc,d.left,d.top,d.right,d.bottom);
     left += (d.left - dstLeft); right = left + (d.right - d.left);
     top += (d.top - dstTop);    bottom = top + (d.bottom - d.top);
     dstLeft = d.left;           dstTop = d.top;
@@ -1704,9 +1730,16 @@ void MGLAPI MGL_putBitmapFx(
         END_VISIBLE_CLIP_LIST(dc);
         return;
         }
+    MARK_DIRTY_VIEW(dc,d.left,d.top,d.right,d.bottom);
     left += (d.left - dstLeft); right = left + (d.right - d.left);
     top += (d.top - dstTop);    bottom = top + (d.bottom - d.top);
 
+    /* Blend in linear light to memory device contexts if enabled */
+    if (_MGL_bandBlendBitmap(dc,left,top,right,bottom,d.left,d.top,bitmap,fx)) {
+        END_VISIBLE_CLIP_LIST(dc);
+        return;
+        }
+
     /* Adjust clipped coordinates if we are doing X or Y flipping */
     if (fx->flags & MGL_BLT_FLIPY) {
         t = (bottom - top);
@@ -1882,9 +1915,16 @@ void MGLAPI MGL_putBitmapFxSection(
         END_VISIBLE_CLIP_LIST(dc);
         return;
         }
+    MARK_DIRTY_VIEW(dc,d.left,d.top,d.right,d.bottom);
     left += (d.left - dstLeft); right = left + (d.right - d.left);
     top += (d.top - dstTop);    bottom = top + (d.bottom - d.top);
 
+    /* Blend in linear light to memory device contexts if enabled */
+    if (_MGL_bandBlendBitmap(dc,left,top,right,bottom,d.left,d.top,bitmap,fx)) {
+        END_VISIBLE_CLIP_LIST(dc);
+        return;
+        }
+
     /* Adjust clipped coordinates if we are doing X or Y flipping */
     if (fx->flags & MGL_BLT_FLIPY) {
         t = (bottom - top);
@@ -2058,6 +2098,7 @@ void MGLAPI MGL_stretchBitmap(
         END_VISIBLE_CLIP_LIST(dc);
         return;
         }
+    MARK_DIRTY_VIEW(dc,d.left,d.top,d.right,d.bottom);
     if ((dc->clipRegionScreen) || (d.left != dstLeft) || (d.right  != dstRight)
             || (d.top != dstTop) || (d.bottom != dstBottom))
         clipIt = true;
@@ -2293,6 +2334,7 @@ void MGLAPI MGL_stretchBitmapSection(
         END_VISIBLE_CLIP_LIST(dc);
         return;
         }
+    MARK_DIRTY_VIEW(dc,d.left,d.top,d.right,d.bottom);
     if ((dc->clipRegionScreen) || (d.left != dstLeft) || (d.right  != dstRight)
             || (d.top != dstTop) || (d.bottom != dstBottom))
         clipIt = true;
@@ -2485,6 +2527,7 @@ void MGLAPI MGL_stretchBitmapFx(
         END_VISIBLE_CLIP_LIST(dc);
         return;
         }
+    MARK_DIRTY_VIEW(dc,d.left,d.top,d.right,d.bottom);
 
     /* Adjust clipped coordinates if we are doing X or Y flipping */
     if (fx->flags & MGL_BLT_FLIPY) {
@@ -2721,6 +2764,7 @@ void MGLAPI MGL_stretchBitmapFxSection(
         END_VISIBLE_CLIP_LIST(dc);
         return;
         }
+    MARK_DIRTY_VIEW(dc,d.left,d.top,d.right,d.bottom);
 
     /* Adjust clipped coordinates if we are doing X or Y flipping */
     if (fx->flags & MGL_BLT_FLIPY) {
@@ -0,0 +1,497 @@
+/****************************************************************************
+*
+*                   SciTech Multi-platform Graphics Library
+*
+*  ========================================================================
+*
+*   Copyright (C) 1991-2004 SciTech Software, Inc. All rights reserved.
+*
+*   This file may be distributed and/or modified under the terms of the
+*   GNU General Public License version 2.0 as published by the Free
+*   Software Foundation and appearing in the file LICENSE.GPL included
+*   in the packaging of this file.
+*
+*   Licensees holding a valid Commercial License for this product from
+*   SciTech Software, Inc. may use this file in accordance with the
+*   Commercial License Agreement provided with the Software.
+*
+*   This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING
+*   THE WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+*   PURPOSE.
+*
+*   See http://www.scitechsoft.com/license/ for information about
+*   the licensing options available and how to purchase a Commercial
+*   License Agreement.
+*
+*   Contact license@scitechsoft.com if any conditions of this licensing
+*   are not clear to you, or you have questions about licensing options.
+*
+*  ========================================================================
+*
+* Language:     ANSI C
+* Environment:  Any
+*
+* Description:  Color quantization for building optimal 8 bits per pixel
+*               palettes from RGB images, using the median cut method.
+*               Pixels are first binned into a 32x32x32 color histogram,
+*               so the cost of the median cut itself does not depend on
+*               the size of the images. Histograms from any number of
+*               bitmaps can be combined to build a single shared palette.
+*
+****************************************************************************/
+
+#include "mgl.h"
+
+/*--------------------------- Global Variables ----------------------------*/
+
+/* Box in the color histogram used by the median cut algorithm */
+
+typedef struct {
+    int     min[3];             /* Minimum red, green and blue cells    */
+    int     max[3];             /* Maximum red, green and blue cells    */
+    ulong   count;              /* Number of pixels in the box          */
+    ibool   done;               /* True if the box cannot be split      */
+    } qbox;
+
+/* Relative weights of the red, green and blue axes when choosing the axis
+ * to split a box along, as the eye is most sensitive to green and least
+ * sensitive to blue.
+ */
+
+static int axisWeight[3] = {2,3,1};
+
+#define HIST_CELL(h,c)  (h)[((c)[0] << 10) | ((c)[1] << 5) | (c)[2]]
+
+/*------------------------- Implementation --------------------------------*/
+
+/****************************************************************************
+PARAMETERS:
+hist    - Color histogram to add to
+bitmap  - Bitmap to add to the histogram
+
+REMARKS:
+Adds all the pixels in a bitmap to the 32x32x32 color histogram. 8 bits per
+pixel bitmaps are counted by color index first, so the palette lookup is
+only done once per palette entry.
+****************************************************************************/
+static void addToHistogram(
+    ulong *hist,
+    const bitmap_t *bitmap)
+{
+    pixel_format_t  *pf = bitmap->pf;
+    palette_t       *pal;
+    ulong           counts[256];
+    uchar           *s,R,G,B;
+    int             x,y,width = bitmap->width;
+    M_uint32        c;
+
+    if (bitmap->bitsPerPixel == 8)
+        memset(counts,0,sizeof(counts));
+    for (y = 0; y < bitmap->height; y++) {
+        s = (uchar*)bitmap->surface + (long)y * bitmap->bytesPerLine;
+        switch (bitmap->bitsPerPixel) {
+            case 8:
+                for (x = 0; x < width; x++)
+                    counts[*s++]++;
+                break;
+            case 15:
+            case 16:
+                for (x = 0; x < width; x++, s += 2) {
+                    c = *((ushort*)s);
+                    MGL_unpackColorFast(pf,c,R,G,B);
+                    hist[INVCMAP_INDEX(R,G,B)]++;
+                    }
+                break;
+            case 24:
+                for (x = 0; x < width; x++, s += 3) {
+                    c = s[0] | ((M_uint32)s[1] << 8) | ((M_uint32)s[2] << 16);
+                    MGL_unpackColorFast(pf,c,R,G,B);
+                    hist[INVCMAP_INDEX(R,G,B)]++;
+                    }
+                break;
+            case 32:
+                for (x = 0; x < width; x++, s += 4) {
+                    c = *((M_uint32*)s);
+                    MGL_unpackColorFast(pf,c,R,G,B);
+                    hist[INVCMAP_INDEX(R,G,B)]++;
+                    }
+                break;
+            }
+        }
+    if (bitmap->bitsPerPixel == 8) {
+        for (x = 0, pal = bitmap->pal; x < 256; x++, pal++)
+            hist[INVCMAP_INDEX(pal->red,pal->green,pal->blue)] += counts[x];
+        }
+}
+
+/****************************************************************************
+REMARKS:
+Shrinks a box to the smallest box that encloses all the non-empty
+histogram cells within it, and counts the pixels in the box.
+****************************************************************************/
+static void shrinkBox(
+    ulong *hist,
+    qbox *box)
+{
+    int     c[3],i,min[3],max[3];
+    ulong   n;
+
+    for (i = 0; i < 3; i++) {
+        min[i] = box->max[i];
+        max[i] = box->min[i];
+        }
+    box->count = 0;
+    for (c[0] = box->min[0]; c[0] <= box->max[0]; c[0]++) {
+        for (c[1] = box->min[1]; c[1] <= box->max[1]; c[1]++) {
+            for (c[2] = box->min[2]; c[2] <= box->max[2]; c[2]++) {
+                if ((n = HIST_CELL(hist,c)) != 0) {
+                    box->count += n;
+                    for (i = 0; i < 3; i++) {
+                        min[i] = MIN(min[i],c[i]);
+                        max[i] = MAX(max[i],c[i]);
+                        }
+                    }
+                }
+            }
+        }
+    if (box->count) {
+        for (i = 0; i < 3; i++) {
+            box->min[i] = min[i];
+            box->max[i] = max[i];
+            }
+        }
+}
+
+/****************************************************************************
+PARAMETERS:
+hist    - Color histogram
+box     - Box to split
+newBox  - Place to store the second half of the split box
+
+RETURNS:
+True if the box was split, false if it only contains a single cell.
+
+REMARKS:
+Splits a box along its longest weighted axis, at the point that divides
+the pixels in the box most evenly between the two halves.
+****************************************************************************/
+static ibool splitBox(
+    ulong *hist,
+    qbox *box,
+    qbox *newBox)
+{
+    int     c[3],i,axis = -1,len,maxLen = 0,split;
+    ulong   marginal[32],sum;
+
+    for (i = 0; i < 3; i++) {
+        if ((len = (box->max[i] - box->min[i]) * axisWeight[i]) > maxLen) {
+            maxLen = len;
+            axis = i;
+            }
+        }
+    if (axis < 0)
+        return false;
+
+    /* Find the population median along the axis */
+    memset(marginal,0,sizeof(marginal));
+    for (c[0] = box->min[0]; c[0] <= box->max[0]; c[0]++)
+        for (c[1] = box->min[1]; c[1] <= box->max[1]; c[1]++)
+            for (c[2] = box->min[2]; c[2] <= box->max[2]; c[2]++)
+                marginal[c[axis]] += HIST_CELL(hist,c);
+    sum = 0;
+    for (split = box->min[axis]; split < box->max[axis]-1; split++) {
+        if ((sum += marginal[split]) >= box->count / 2)
+            break;
+        }
+
+    /* Split the box and shrink both halves to fit */
+    *newBox = *box;
+    box->max[axis] = split;
+    newBox->min[axis] = split+1;
+    shrinkBox(hist,box);
+    shrinkBox(hist,newBox);
+    return true;
+}
+
+/****************************************************************************
+PARAMETERS:
+hist        - Color histogram to quantize
+pal         - Place to store the quantized palette
+numColors   - Maximum number of colors to generate
+
+RETURNS:
+Number of colors generated.
+
+REMARKS:
+Builds an optimal palette for a color histogram using the median cut
+method. For the first half of the colors we split the box with the most
+pixels in it, and for the remainder we split the box with the largest
+volume, which gives a good balance between matching the most common
+colors closely and still representing the less common colors. Each
+palette entry is the average of all the pixels in the final box.
+****************************************************************************/
+static int quantizeHistogram(
+    ulong *hist,
+    palette_t *pal,
+    int numColors)
+{
+    qbox    boxes[256],*box,*best;
+    int     c[3],i,numBoxes = 1;
+    long    volume,bestVolume;
+    ulong   n;
+    double  sum[3];
+
+    boxes[0].min[0] = boxes[0].min[1] = boxes[0].min[2] = 0;
+    boxes[0].max[0] = boxes[0].max[1] = boxes[0].max[2] = 31;
+    boxes[0].done = false;
+    shrinkBox(hist,&boxes[0]);
+    if (boxes[0].count == 0)
+        return 0;
+    while (numBoxes < numColors) {
+        best = NULL;
+        bestVolume = 0;
+        for (i = 0, box = boxes; i < numBoxes; i++, box++) {
+            if (box->done)
+                continue;
+            if (numBoxes*2 <= numColors)
+                volume = box->count;
+            else
+                volume = (long)(box->max[0] - box->min[0] + 1)
+                       * (box->max[1] - box->min[1] + 1)
+                       * (box->max[2] - box->min[2] + 1);
+            if (volume > bestVolume) {
+                bestVolume = volume;
+                best = box;
+                }
+            }
+        if (!best)
+            break;
+        if (splitBox(hist,best,&boxes[numBoxes]))
+            numBoxes++;
+        else
+            best->done = true;
+        }
+
+    /* Compute the average color for each box */
+    memset(pal,0,numColors * sizeof(palette_t));
+    for (i = 0, box = boxes; i < numBoxes; i++, box++, pal++) {
+        sum[0] = sum[1] = sum[2] = 0;
+        for (c[0] = box->min[0]; c[0] <= box->max[0]; c[0]++) {
+            for (c[1] = box->min[1]; c[1] <= box->max[1]; c[1]++) {
+                for (c[2] = box->min[2]; c[2] <= box->max[2]; c[2]++) {
+                    if ((n = HIST_CELL(hist,c)) != 0) {
+                        sum[0] += (double)n * ((c[0] << 3) | 4);
+                        sum[1] += (double)n * ((c[1] << 3) | 4);
+                        sum[2] += (double)n * ((c[2] << 3) | 4);
+                        }
+                    }
+                }
+            }
+        pal->red = (uchar)(sum[0] / box->count + 0.5);
+        pal->green = (uchar)(sum[1] / box->count + 0.5);
+        pal->blue = (uchar)(sum[2] / box->count + 0.5);
+        }
+    return numBoxes;
+}
+
+/****************************************************************************
+RETURNS:
+True if the bitmap can be quantized, false if not.
+****************************************************************************/
+static ibool validBitmap(
+    const bitmap_t *bitmap)
+{
+    if (bitmap->bitsPerPixel < 8 || (bitmap->bitsPerPixel == 8 && !bitmap->pal)) {
+        SETERROR(grInvalidBitmap);
+        return false;
+        }
+    return true;
+}
+
+/****************************************************************************
+DESCRIPTION:
+Builds an optimal shared palette for a set of bitmaps.
+
+HEADER:
+mgraph.h
+
+PARAMETERS:
+bitmaps     - Array of bitmaps to build the palette for
+numBitmaps  - Number of bitmaps in the array
+pal         - Place to store the palette
+numColors   - Maximum number of colors in the palette (1 - 256)
+
+RETURNS:
+Number of colors in the palette, 0 on error.
+
+REMARKS:
+This function builds a single optimal palette for an entire set of
+bitmaps, using the median cut color quantization method. This is useful
+when you need to convert a set of RGB bitmaps (such as all the sprites and
+textures for a game level) that will be displayed at the same time on an
+8 bits per pixel display. Once the palette has been built you can convert
+each bitmap to the shared palette with MGL_quantizeBitmap.
+
+The bitmaps may be 15, 16, 24 or 32 bits per pixel RGB bitmaps, or 8 bits
+per pixel bitmaps with their own palette. All the pixels in the bitmaps
+are first binned into a 32x32x32 color histogram, so the cost of building
+the palette after the histogram has been filled in does not depend on the
+size of the bitmaps.
+
+If the bitmaps contain fewer distinct colors than requested, fewer colors
+are returned and the remaining palette entries are set to black.
+
+SEE ALSO:
+MGL_quantizeBitmap, MGL_quantizeDC, MGL_mapBitmapToPalette
+****************************************************************************/
+int MGLAPI MGL_quantizePalette(
+    bitmap_t **bitmaps,
+    int numBitmaps,
+    palette_t *pal,
+    int numColors)
+{
+    ulong   *hist;
+    int     i;
+
+    if (numColors < 1 || numColors > 256)
+        return 0;
+    for (i = 0; i < numBitmaps; i++) {
+        if (!validBitmap(bitmaps[i]))
+            return 0;
+        }
+    if ((hist = PM_calloc(32768,sizeof(ulong))) == NULL) {
+        SETERROR(grNoMem);
+        return 0;
+        }
+    for (i = 0; i < numBitmaps; i++)
+        addToHistogram(hist,bitmaps[i]);
+    numColors = quantizeHistogram(hist,pal,numColors);
+    PM_free(hist);
+    return numColors;
+}
+
+/****************************************************************************
+DESCRIPTION:
+Converts a bitmap to 8 bits per pixel with an optimal or shared palette.
+
+HEADER:
+mgraph.h
+
+PARAMETERS:
+bitmap      - Bitmap to convert
+pal         - Palette to convert to, or NULL to build an optimal palette
+numColors   - Number of colors in the palette (1 - 256)
+
+RETURNS:
+Pointer to the new 8 bits per pixel bitmap, NULL on error.
+
+REMARKS:
+This function converts a 15, 16, 24 or 32 bits per pixel RGB bitmap, or an
+8 bits per pixel bitmap with its own palette, into a new 8 bits per pixel
+bitmap. If the pal parameter is NULL, an optimal palette with up to
+numColors colors is built for the bitmap using the median cut color
+quantization method. Otherwise the bitmap is converted to the first
+numColors entries of the passed in palette, which is usually a shared
+palette built with MGL_quantizePalette. The palette is stored with the new
+bitmap, and pixels are mapped to the closest color in the palette with an
+inverse color map. The original bitmap is left unchanged, and the new
+bitmap should be freed with MGL_unloadBitmap when it is no longer needed.
+
+If this function fails, it will return NULL and you can get the error code
+from the MGL_result function.
+
+SEE ALSO:
+MGL_quantizePalette, MGL_quantizeDC, MGL_mapBitmapToPalette
+****************************************************************************/
+bitmap_t * MGLAPI MGL_quantizeBitmap(
+    const bitmap_t *bitmap,
+    const palette_t *pal,
+    int numColors)
+{
+    MGL_invCMap *icm;
+    bitmap_t    *newBmp;
+    ulong       *hist;
+
+    if (numColors < 1 || numColors > 256 || !validBitmap(bitmap))
+        return NULL;
+    if ((icm = PM_malloc(sizeof(MGL_invCMap))) == NULL) {
+        SETERROR(grNoMem);
+        return NULL;
+        }
+    if (pal) {
+        memcpy(icm->pal,pal,numColors * sizeof(palette_t));
+        icm->palSize = numColors;
+        }
+    else {
+        if ((hist = PM_calloc(32768,sizeof(ulong))) == NULL) {
+            PM_free(icm);
+            SETERROR(grNoMem);
+            return NULL;
+            }
+        addToHistogram(hist,bitmap);
+        icm->palSize = quantizeHistogram(hist,icm->pal,numColors);
+        PM_free(hist);
+        }
+    if (icm->palSize == 0) {
+        PM_free(icm);
+        SETERROR(grInvalidBitmap);
+        return NULL;
+        }
+    _MGL_buildInverseColorMap(icm);
+    if ((newBmp = _MGL_mapBitmapToInverseColorMap(bitmap,icm)) == NULL)
+        SETERROR(grNoMem);
+    PM_free(icm);
+    return newBmp;
+}
+
+/****************************************************************************
+DESCRIPTION:
+Builds an optimal palette for the contents of a device context.
+
+HEADER:
+mgraph.h
+
+PARAMETERS:
+dc          - Device context to build the palette for
+pal         - Place to store the palette
+numColors   - Maximum number of colors in the palette (1 - 256)
+
+RETURNS:
+Number of colors in the palette, 0 on error.
+
+REMARKS:
+This function builds an optimal palette for the current contents of a
+device context, using the median cut color quantization method. This is
+useful for converting an image that has been rendered in an RGB memory
+device context to 8 bits per pixel, by setting the palette for an 8 bits
+per pixel device context to the returned palette and then blitting the
+image to it. The device context must be 8 bits per pixel or higher.
+
+SEE ALSO:
+MGL_quantizePalette, MGL_quantizeBitmap
+****************************************************************************/
+int MGLAPI MGL_quantizeDC(
+    MGLDC *dc,
+    palette_t *pal,
+    int numColors)
+{
+    bitmap_t    bmp,*bitmaps = &bmp;
+
+    if (dc == _MGL_dcPtr)
+        dc = &DC;
+    if (dc->mi.bitsPerPixel < 8) {
+        SETERROR(grInvalidDC);
+        return 0;
+        }
+    bmp.width = dc->mi.xRes+1;
+    bmp.height = dc->mi.yRes+1;
+    bmp.bitsPerPixel = dc->mi.bitsPerPixel;
+    bmp.bytesPerLine = dc->mi.bytesPerLine;
+    bmp.pal = (dc->mi.modeFlags & MGL_IS_COLOR_INDEX) ? TO_PAL(dc->colorTab) : NULL;
+    bmp.pf = &dc->pf;
+    MGL_beginDirectAccessDC(dc);
+    bmp.surface = dc->surface;
+    numColors = MGL_quantizePalette(&bitmaps,1,pal,numColors);
+    MGL_endDirectAccessDC(dc);
+    return numColors;
+}
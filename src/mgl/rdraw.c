@@ -103,6 +103,7 @@ void MGLAPI MGL_drawRegion(
     rect_t      r;
 
     BEGIN_VISIBLE_CLIP_LIST(&DC);
+    MARK_DIRTY_VIEW(&DC,x+rgn->rect.left,y+rgn->rect.top,x+rgn->rect.right,y+rgn->rect.bottom);
     if (MGL_sectRect(DC.clipRectView,rgn->rect,&r)) {
         if (!MGL_equalRect(rgn->rect,r)) {
             _MGL_tmpRectRegion2(tempRgn,DC.clipRectView);
@@ -179,8 +179,10 @@ void MGLAPI MGL_clearDevice(void)
         MGL_setClipRegion(oldClipRegion);
         MGL_freeRegion(oldClipRegion);
         }
-    else
+    else {
+        MARK_DIRTY(&DC,0,0,DC.size.right-DC.size.left,DC.size.bottom-DC.size.top);
         DC.r.cur.DrawRect(0,0,DC.size.right-DC.size.left,DC.size.bottom-DC.size.top);
+        }
 
     /* Restore the pen attributes */
     DC.r.SetForeColor(svColor);
@@ -232,6 +234,8 @@ void MGLAPI MGL_clearViewport(void)
         MGL_freeRegion(oldClipRegion);
         }
     else {
+        MARK_DIRTY(&DC,DC.viewPort.left - DC.size.left,DC.viewPort.top - DC.size.top,
+            DC.viewPort.right - DC.size.left,DC.viewPort.bottom - DC.size.top);
         DC.r.cur.DrawRect(DC.viewPort.left - DC.size.left,DC.viewPort.top - DC.size.top,
             DC.viewPort.right - DC.viewPort.left,DC.viewPort.bottom - DC.viewPort.top);
         }
@@ -277,6 +281,7 @@ void MGLAPI MGL_fillRectCoord(
         d.right = right + DC.viewPort.left;   d.bottom = bottom + DC.viewPort.top;
         BEGIN_CLIP_REGION(clip,DC.clipRegionScreen);
             if (MGL_sectRect(clip,d,&r)) {
+                MARK_DIRTY(&DC,r.left,r.top,r.right,r.bottom);
                 DC.r.cur.DrawRect(r.left,r.top,r.right-r.left,r.bottom-r.top);
                 }
         END_CLIP_REGION();
@@ -286,6 +291,7 @@ void MGLAPI MGL_fillRectCoord(
         d.right = right;    d.bottom = bottom;
         if (MGL_sectRect(DC.clipRectView,d,&d)) {
             MGL_offsetRect(d,DC.viewPort.left,DC.viewPort.top);
+            MARK_DIRTY(&DC,d.left,d.top,d.right,d.bottom);
             DC.r.cur.DrawRect(d.left,d.top,d.right-d.left,d.bottom-d.top);
             }
         }
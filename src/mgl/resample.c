@@ -0,0 +1,1071 @@
+/****************************************************************************
+*
+*                   SciTech Multi-platform Graphics Library
+*
+*  ========================================================================
+*
+*   Copyright (C) 1991-2004 SciTech Software, Inc. All rights reserved.
+*
+*   This file may be distributed and/or modified under the terms of the
+*   GNU General Public License version 2.0 as published by the Free
+*   Software Foundation and appearing in the file LICENSE.GPL included
+*   in the packaging of this file.
+*
+*   Licensees holding a valid Commercial License for this product from
+*   SciTech Software, Inc. may use this file in accordance with the
+*   Commercial License Agreement provided with the Software.
+*
+*   This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING
+*   THE WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+*   PURPOSE.
+*
+*   See http://www.scitechsoft.com/license/ for information about
+*   the licensing options available and how to purchase a Commercial
+*   License Agreement.
+*
+*   Contact license@scitechsoft.com if any conditions of this licensing
+*   are not clear to you, or you have questions about licensing options.
+*
+*  ========================================================================
+*
+* Language:     ANSI C
+* Environment:  Any
+*
+* Description:  Filtered resampling stretch engine. Unlike the nearest
+*               and linear interpolated stretching provided by the
+*               MGL_stretchBlt family of functions, this code implements
+*               separable polyphase filtering (bilinear, box, bicubic
+*               and Lanczos) so that large downscales do not alias.
+*
+*               All sources are unpacked to 32-bit ARGB scanlines, filtered
+*               horizontally into a small ring of intermediate scanlines
+*               and then filtered vertically into bands of output
+*               scanlines. Each band is drawn with MGL_putBitmapSection
+*               so that clipping, complex clip regions and pixel format
+*               conversion to the destination are handled by the regular
+*               bitmap blitting code. Filter weights are precomputed once
+*               per call in 2.14 fixed point, and the two tap filters use
+*               a packed two channels per word inner loop.
+*
+*               When linear light mode is enabled for the destination,
+*               the unpacked scanlines are converted to 16 bits per
+*               component linear light before filtering and converted
+*               back to sRGB afterwards, so that gradients and edges are
+*               not darkened by filtering gamma encoded values.
+*
+****************************************************************************/
+
+#include "mgl.h"
+#include <math.h>
+
+/*--------------------------- Global Variables ----------------------------*/
+
+#define RES_BITS        14              /* Fixed point filter weight bits   */
+#define RES_ONE         (1 << RES_BITS) /* Fixed point 1.0 filter weight    */
+#define RES_BAND        32              /* Scanlines drawn per output band  */
+#define RES_PI          3.14159265358979323846
+
+/* Linearly interpolate between two packed ARGB pixels with an 8-bit
+ * fraction in the range 0-256, two color channels at a time.
+ */
+
+#define RES_LERP(p0,p1,f)                                                   \
+   (((((p0) & 0x00FF00FFUL) * (256 - (f))                                   \
+    + ((p1) & 0x00FF00FFUL) * (f)) >> 8) & 0x00FF00FFUL)                    \
+ | (((((p0) >> 8) & 0x00FF00FFUL) * (256 - (f))                             \
+    + (((p1) >> 8) & 0x00FF00FFUL) * (f)) & 0xFF00FF00UL)
+
+/* Clamp a fixed point channel accumulator to the range 0-255 */
+
+#define RES_CLAMP(v)                                                        \
+    ((v) < 0 ? 0 : ((v) >> RES_BITS) > 255 ? 255 : ((v) >> RES_BITS))
+
+/* Clamp a fixed point linear light accumulator to the range 0-65535 */
+
+#define RES_CLAMP16(v)                                                      \
+    ((v) < 0 ? 0 : ((v) >> RES_BITS) > 65535 ? 65535 : ((v) >> RES_BITS))
+
+/* Filter contribution for a single destination pixel */
+
+typedef struct {
+    int         start;          /* First source pixel contributing      */
+    int         count;          /* Number of contributing pixels        */
+    short       *w;             /* Fixed point weights, summing to 1.0  */
+    } res_contrib;
+
+/* Filter contributions for one axis of the destination rectangle */
+
+typedef struct {
+    res_contrib *c;             /* Contributions for each dest pixel    */
+    short       *weights;       /* Storage for all the weights          */
+    int         maxTaps;        /* Maximum taps for any dest pixel      */
+    ibool       linear;         /* True if at most two positive taps    */
+    } res_table;
+
+/* Description of the source surface being resampled */
+
+typedef struct {
+    uchar           *surface;   /* Pointer to start of source pixels    */
+    int             bytesPerLine;
+    int             bitsPerPixel;
+    pixel_format_t  pf;         /* Source pixel format (15bpp and up)   */
+    M_uint32        lut[256];   /* ARGB lookup table for 8bpp sources   */
+    } res_source;
+
+/* Shared state for resampling in parallel bands */
+
+typedef struct {
+    res_source  *s;             /* Source surface description           */
+    res_table   *tx,*ty;        /* Horizontal and vertical filters      */
+    int         srcLeft;        /* Left of the unpacked source run      */
+    int         srcTop;         /* Top of the source section            */
+    int         srcSpan;        /* Width of the unpacked source run     */
+    int         visW;           /* Width of the visible destination     */
+    M_uint32    *out;           /* Output buffer for all scanlines      */
+    ibool       linear;         /* True to filter in linear light       */
+    ibool       failed;         /* True if any band ran out of memory   */
+    } res_job;
+
+/*------------------------- Implementation --------------------------------*/
+
+/****************************************************************************
+REMARKS:
+Returns the radius of the filter kernel in source pixels when not
+minifying the image.
+****************************************************************************/
+static double filterRadius(
+    int filter)
+{
+    switch (filter) {
+        case MGL_RESAMPLE_BILINEAR:     return 1.0;
+        case MGL_RESAMPLE_BICUBIC:      return 2.0;
+        case MGL_RESAMPLE_LANCZOS3:     return 3.0;
+        }
+    return 0.5;
+}
+
+/****************************************************************************
+REMARKS:
+Evaluates the continuous filter kernel at a distance t from the sample
+center. The box filter is handled separately by computing the exact
+area overlap, so it is not evaluated here.
+****************************************************************************/
+static double filterKernel(
+    int filter,
+    double t)
+{
+    double  x;
+
+    if (t < 0)
+        t = -t;
+    switch (filter) {
+        case MGL_RESAMPLE_BILINEAR:
+            return (t < 1.0) ? 1.0 - t : 0.0;
+        case MGL_RESAMPLE_BICUBIC:
+            /* Catmull-Rom cubic spline (a = -0.5) */
+            if (t < 1.0)
+                return (1.5 * t - 2.5) * t * t + 1.0;
+            if (t < 2.0)
+                return ((-0.5 * t + 2.5) * t - 4.0) * t + 2.0;
+            return 0.0;
+        case MGL_RESAMPLE_LANCZOS3:
+            if (t < 1e-6)
+                return 1.0;
+            if (t < 3.0) {
+                x = RES_PI * t;
+                return 3.0 * sin(x) * sin(x / 3.0) / (x * x);
+                }
+            return 0.0;
+        }
+    return 0.0;
+}
+
+/****************************************************************************
+REMARKS:
+Frees the memory allocated for a filter contribution table.
+****************************************************************************/
+static void freeTable(
+    res_table *t)
+{
+    if (t->c)
+        PM_free(t->c);
+    if (t->weights)
+        PM_free(t->weights);
+    t->c = NULL;
+    t->weights = NULL;
+}
+
+/****************************************************************************
+PARAMETERS:
+t           - Table to build
+filter      - Filter to use for this axis
+srcSize     - Size of the source section along this axis
+dstSize     - Size of the entire destination along this axis
+dstStart    - First destination pixel actually being drawn
+dstCount    - Number of destination pixels actually being drawn
+
+RETURNS:
+True on success, false if out of memory.
+
+REMARKS:
+Builds the table of fixed point filter contributions for the visible part
+of one axis of the destination. The mapping from destination to source is
+always computed from the full unclipped destination size so that clipped
+output lines up exactly with unclipped output. Taps that fall outside the
+source are discarded and the remaining weights renormalised, and the
+rounded fixed point weights are adjusted so they always sum to exactly
+1.0 to avoid any drift in flat areas of the image.
+****************************************************************************/
+static ibool buildTable(
+    res_table *t,
+    int filter,
+    int srcSize,
+    int dstSize,
+    int dstStart,
+    int dstCount)
+{
+    double      scale = (double)dstSize / srcSize;
+    double      fscale = 1.0,support,center,lo,hi,w,total;
+    int         i,j,start,end,sum,big;
+    res_contrib *c;
+    short       *pw;
+
+    if (filter == MGL_RESAMPLE_FAST)
+        filter = (scale < 1.0) ? MGL_RESAMPLE_BOX : MGL_RESAMPLE_BILINEAR;
+    if (scale < 1.0 && filter != MGL_RESAMPLE_NEAREST && filter != MGL_RESAMPLE_BILINEAR)
+        fscale = 1.0 / scale;
+    support = filterRadius(filter) * fscale;
+    t->maxTaps = (filter == MGL_RESAMPLE_NEAREST) ? 1 : (int)(support * 2) + 3;
+    t->linear = true;
+    t->c = PM_malloc(sizeof(res_contrib) * dstCount);
+    t->weights = PM_malloc(sizeof(short) * dstCount * t->maxTaps);
+    if (!t->c || !t->weights) {
+        freeTable(t);
+        return false;
+        }
+    for (i = 0, c = t->c; i < dstCount; i++, c++) {
+        center = (dstStart + i + 0.5) / scale;
+        c->w = pw = t->weights + i * t->maxTaps;
+        if (filter == MGL_RESAMPLE_NEAREST) {
+            c->start = MIN((int)center,srcSize-1);
+            c->count = 1;
+            pw[0] = RES_ONE;
+            continue;
+            }
+
+        /* Find the range of source pixels under the kernel */
+        if (filter == MGL_RESAMPLE_BOX) {
+            lo = center - 0.5 * fscale;
+            hi = center + 0.5 * fscale;
+            start = (int)floor(lo);
+            end = (int)ceil(hi) - 1;
+            }
+        else {
+            start = (int)floor(center - 0.5 - support);
+            end = (int)ceil(center - 0.5 + support);
+            }
+        start = MAX(start,0);
+        end = MIN(end,srcSize-1);
+        if (end - start + 1 > t->maxTaps)
+            end = start + t->maxTaps - 1;
+
+        /* Compute the normalisation factor for the taps we have */
+        total = 0;
+        for (j = start; j <= end; j++) {
+            if (filter == MGL_RESAMPLE_BOX)
+                w = MIN(hi,j+1.0) - MAX(lo,(double)j);
+            else
+                w = filterKernel(filter,(j + 0.5 - center) / fscale);
+            total += (w > 0 || filter != MGL_RESAMPLE_BOX) ? w : 0;
+            }
+        if (total == 0) {
+            c->start = MIN((int)center,srcSize-1);
+            c->count = 1;
+            pw[0] = RES_ONE;
+            continue;
+            }
+
+        /* Convert to fixed point and fix up rounding errors */
+        for (j = start, sum = 0, big = 0; j <= end; j++) {
+            if (filter == MGL_RESAMPLE_BOX) {
+                w = MIN(hi,j+1.0) - MAX(lo,(double)j);
+                if (w < 0)
+                    w = 0;
+                }
+            else
+                w = filterKernel(filter,(j + 0.5 - center) / fscale);
+            pw[j-start] = (short)floor(w / total * RES_ONE + 0.5);
+            sum += pw[j-start];
+            if (pw[j-start] > pw[big])
+                big = j-start;
+            }
+        pw[big] += (short)(RES_ONE - sum);
+
+        /* Trim zero weights off both ends of the filter */
+        while (end > start && pw[end-start] == 0)
+            end--;
+        while (start < end && pw[0] == 0) {
+            pw++;
+            start++;
+            }
+        c->w = pw;
+        c->start = start;
+        c->count = end - start + 1;
+        if (c->count > 2 || pw[0] < 0 || (c->count == 2 && pw[1] < 0))
+            t->linear = false;
+        }
+    return true;
+}
+
+/****************************************************************************
+REMARKS:
+Sets up the source surface description for a source with the specified
+properties. For color index sources we pre-compute the ARGB value for
+every palette entry so that unpacking is a single table lookup.
+****************************************************************************/
+static void setupSource(
+    res_source *s,
+    void *surface,
+    int bytesPerLine,
+    int bitsPerPixel,
+    pixel_format_t *pf,
+    palette_t *pal)
+{
+    int i;
+
+    memset(&s->pf,0,sizeof(s->pf));
+    s->surface = surface;
+    s->bytesPerLine = bytesPerLine;
+    s->bitsPerPixel = bitsPerPixel;
+    if (bitsPerPixel == 8) {
+        for (i = 0; i < 256; i++) {
+            s->lut[i] = 0xFF000000UL | ((M_uint32)pal[i].red << 16)
+                | ((M_uint32)pal[i].green << 8) | pal[i].blue;
+            }
+        }
+    else
+        s->pf = *pf;
+}
+
+/****************************************************************************
+REMARKS:
+Unpacks a run of source pixels from scanline y into 32-bit ARGB format.
+Only 32-bit sources with an alpha channel carry their alpha through, all
+other sources are returned as fully opaque.
+****************************************************************************/
+static void unpackRow(
+    res_source *s,
+    int x,
+    int y,
+    int count,
+    M_uint32 *dst)
+{
+    uchar           *p = s->surface + (long)y * s->bytesPerLine;
+    pixel_format_t  *pf = &s->pf;
+    M_uint32        c,opaque;
+    uchar           A,R,G,B;
+
+    opaque = pf->alphaMask ? 0 : 0xFF000000UL;
+    switch (s->bitsPerPixel) {
+        case 8:
+            for (p += x; count--; )
+                *dst++ = s->lut[*p++];
+            break;
+        case 15:
+        case 16:
+            for (p += x*2; count--; p += 2) {
+                c = *((ushort*)p);
+                MGL_unpackColorFast(pf,c,R,G,B);
+                *dst++ = 0xFF000000UL | ((M_uint32)R << 16) | ((M_uint32)G << 8) | B;
+                }
+            break;
+        case 24:
+            for (p += x*3; count--; p += 3) {
+                c = p[0] | ((M_uint32)p[1] << 8) | ((M_uint32)p[2] << 16);
+                MGL_unpackColorFast(pf,c,R,G,B);
+                *dst++ = 0xFF000000UL | ((M_uint32)R << 16) | ((M_uint32)G << 8) | B;
+                }
+            break;
+        case 32:
+            p += x*4;
+            if (pf->redPos == 16 && pf->greenPos == 8 && pf->bluePos == 0
+                    && (pf->alphaMask == 0 || pf->alphaPos == 24)) {
+                /* Native ARGB layout so this is a straight copy */
+                while (count--) {
+                    *dst++ = *((M_uint32*)p) | opaque;
+                    p += 4;
+                    }
+                }
+            else {
+                for (; count--; p += 4) {
+                    c = *((M_uint32*)p);
+                    MGL_unpackColorFastExt(pf,c,A,R,G,B);
+                    *dst++ = opaque | ((M_uint32)A << 24) | ((M_uint32)R << 16)
+                        | ((M_uint32)G << 8) | B;
+                    }
+                }
+            break;
+        }
+}
+
+/****************************************************************************
+REMARKS:
+Filters a single unpacked source scanline horizontally using the
+precomputed contribution table. The contribution start values have been
+rebased to the start of the unpacked source run.
+****************************************************************************/
+static void filterRowH(
+    res_table *t,
+    M_uint32 *src,
+    M_uint32 *dst,
+    int count)
+{
+    res_contrib *c = t->c;
+    M_uint32    *p,pix;
+    long        a,r,g,b,w;
+    int         k,f;
+
+    if (t->linear) {
+        for (; count--; c++) {
+            p = src + c->start;
+            if (c->count == 1)
+                *dst++ = p[0];
+            else {
+                f = (c->w[1] + (1 << (RES_BITS-9))) >> (RES_BITS-8);
+                *dst++ = RES_LERP(p[0],p[1],f);
+                }
+            }
+        return;
+        }
+    for (; count--; c++) {
+        p = src + c->start;
+        a = r = g = b = RES_ONE/2;
+        for (k = 0; k < c->count; k++) {
+            pix = p[k];
+            w = c->w[k];
+            a += (long)(pix >> 24) * w;
+            r += (long)((pix >> 16) & 0xFF) * w;
+            g += (long)((pix >> 8) & 0xFF) * w;
+            b += (long)(pix & 0xFF) * w;
+            }
+        *dst++ = ((M_uint32)RES_CLAMP(a) << 24) | ((M_uint32)RES_CLAMP(r) << 16)
+            | ((M_uint32)RES_CLAMP(g) << 8) | (M_uint32)RES_CLAMP(b);
+        }
+}
+
+/****************************************************************************
+REMARKS:
+Filters a set of horizontally filtered scanlines vertically to produce a
+single output scanline.
+****************************************************************************/
+static void filterRowV(
+    res_contrib *c,
+    ibool linear,
+    M_uint32 **rows,
+    M_uint32 *dst,
+    int count)
+{
+    M_uint32    *p0,*p1,pix;
+    long        a,r,g,b,w;
+    int         i,k,f;
+
+    if (c->count == 1) {
+        memcpy(dst,rows[0],count * sizeof(M_uint32));
+        return;
+        }
+    if (linear) {
+        p0 = rows[0];
+        p1 = rows[1];
+        f = (c->w[1] + (1 << (RES_BITS-9))) >> (RES_BITS-8);
+        while (count--) {
+            *dst++ = RES_LERP(*p0,*p1,f);
+            p0++;
+            p1++;
+            }
+        return;
+        }
+    for (i = 0; i < count; i++) {
+        a = r = g = b = RES_ONE/2;
+        for (k = 0; k < c->count; k++) {
+            pix = rows[k][i];
+            w = c->w[k];
+            a += (long)(pix >> 24) * w;
+            r += (long)((pix >> 16) & 0xFF) * w;
+            g += (long)((pix >> 8) & 0xFF) * w;
+            b += (long)(pix & 0xFF) * w;
+            }
+        *dst++ = ((M_uint32)RES_CLAMP(a) << 24) | ((M_uint32)RES_CLAMP(r) << 16)
+            | ((M_uint32)RES_CLAMP(g) << 8) | (M_uint32)RES_CLAMP(b);
+        }
+}
+
+/****************************************************************************
+REMARKS:
+Filters a single linear light source scanline horizontally. Each pixel is
+four 16-bit components, and the results are stored in the same format.
+****************************************************************************/
+static void filterRowH16(
+    res_table *t,
+    ushort *src,
+    ushort *dst,
+    int count)
+{
+    res_contrib *c = t->c;
+    ushort      *p;
+    long        acc[4],w;
+    int         i,k,f;
+
+    for (; count--; c++, dst += 4) {
+        p = src + c->start * 4;
+        if (c->count == 1) {
+            for (i = 0; i < 4; i++)
+                dst[i] = p[i];
+            }
+        else if (t->linear) {
+            f = (c->w[1] + (1 << (RES_BITS-9))) >> (RES_BITS-8);
+            for (i = 0; i < 4; i++)
+                dst[i] = (ushort)(((M_uint32)p[i] * (256 - f) + (M_uint32)p[i+4] * f) >> 8);
+            }
+        else {
+            acc[0] = acc[1] = acc[2] = acc[3] = RES_ONE/2;
+            for (k = 0; k < c->count; k++, p += 4) {
+                w = c->w[k];
+                for (i = 0; i < 4; i++)
+                    acc[i] += (long)p[i] * w;
+                }
+            for (i = 0; i < 4; i++)
+                dst[i] = (ushort)RES_CLAMP16(acc[i]);
+            }
+        }
+}
+
+/****************************************************************************
+REMARKS:
+Filters a set of horizontally filtered linear light scanlines vertically
+to produce a single linear light output scanline. Each component is
+filtered independently, so we simply process four times as many values.
+****************************************************************************/
+static void filterRowV16(
+    res_contrib *c,
+    ibool linear,
+    M_uint32 **rows,
+    ushort *dst,
+    int count)
+{
+    ushort  *p0,*p1;
+    long    acc;
+    int     i,k,f;
+
+    count *= 4;
+    if (c->count == 1) {
+        memcpy(dst,rows[0],count * sizeof(ushort));
+        return;
+        }
+    if (linear) {
+        p0 = (ushort*)rows[0];
+        p1 = (ushort*)rows[1];
+        f = (c->w[1] + (1 << (RES_BITS-9))) >> (RES_BITS-8);
+        for (i = 0; i < count; i++)
+            dst[i] = (ushort)(((M_uint32)p0[i] * (256 - f) + (M_uint32)p1[i] * f) >> 8);
+        return;
+        }
+    for (i = 0; i < count; i++) {
+        acc = RES_ONE/2;
+        for (k = 0; k < c->count; k++)
+            acc += (long)((ushort*)rows[k])[i] * c->w[k];
+        dst[i] = (ushort)RES_CLAMP16(acc);
+        }
+}
+
+/****************************************************************************
+REMARKS:
+Filters an unpacked source scanline horizontally into the ring of
+intermediate scanlines. If srcLin is not NULL we are filtering in linear
+light, and the ring holds 16-bit linear light components.
+****************************************************************************/
+static void filterSourceRow(
+    res_table *t,
+    M_uint32 *src,
+    ushort *srcLin,
+    int srcSpan,
+    M_uint32 *dst,
+    int count)
+{
+    if (srcLin) {
+        _MGL_spanToLinear(src,srcLin,srcSpan);
+        filterRowH16(t,srcLin,(ushort*)dst,count);
+        }
+    else
+        filterRowH(t,src,dst,count);
+}
+
+/****************************************************************************
+REMARKS:
+Filters the intermediate scanlines vertically into an output scanline of
+packed ARGB pixels. If outLin is not NULL we are filtering in linear light,
+and the results are converted back to sRGB.
+****************************************************************************/
+static void filterOutputRow(
+    res_contrib *c,
+    ibool linear,
+    M_uint32 **rows,
+    ushort *outLin,
+    M_uint32 *dst,
+    int count)
+{
+    if (outLin) {
+        filterRowV16(c,linear,rows,outLin,count);
+        _MGL_spanFromLinear(outLin,dst,count);
+        }
+    else
+        filterRowV(c,linear,rows,dst,count);
+}
+
+/****************************************************************************
+REMARKS:
+Band function used to resample in parallel. Each band has its own set of
+scanline buffers, so source scanlines that straddle two bands are simply
+filtered horizontally by both of them.
+****************************************************************************/
+static void resampleBand(
+    void *ctx,
+    int top,
+    int bottom)
+{
+    res_job     *job = (res_job*)ctx;
+    res_contrib *cy;
+    M_uint32    *srcRow,*ring,**rows;
+    ushort      *srcLin = NULL,*outLin = NULL;
+    int         *ringRow;
+    int         i,k,y,row,slot,ringSize = job->ty->maxTaps,visW = job->visW;
+    int         pixWords = job->linear ? 2 : 1;
+
+    srcRow = PM_malloc(sizeof(M_uint32) * job->srcSpan);
+    ring = PM_malloc(sizeof(M_uint32) * pixWords * visW * ringSize);
+    rows = PM_malloc(sizeof(M_uint32*) * ringSize);
+    ringRow = PM_malloc(sizeof(int) * ringSize);
+    if (job->linear) {
+        srcLin = PM_malloc(sizeof(ushort) * 4 * job->srcSpan);
+        outLin = PM_malloc(sizeof(ushort) * 4 * visW);
+        }
+    if (!srcRow || !ring || !rows || !ringRow || (job->linear && (!srcLin || !outLin))) {
+        job->failed = true;
+        goto Done;
+        }
+    for (i = 0; i < ringSize; i++)
+        ringRow[i] = -1;
+    for (y = top, cy = job->ty->c + top; y < bottom; y++, cy++) {
+        for (k = 0; k < cy->count; k++) {
+            row = cy->start + k;
+            slot = row % ringSize;
+            if (ringRow[slot] != row) {
+                unpackRow(job->s,job->srcLeft,job->srcTop + row,job->srcSpan,srcRow);
+                filterSourceRow(job->tx,srcRow,srcLin,job->srcSpan,ring + slot * visW * pixWords,visW);
+                ringRow[slot] = row;
+                }
+            rows[k] = ring + slot * visW * pixWords;
+            }
+        filterOutputRow(cy,job->ty->linear,rows,outLin,job->out + (long)y * visW,visW);
+        }
+
+Done:
+    if (srcLin) PM_free(srcLin);
+    if (outLin) PM_free(outLin);
+    if (srcRow) PM_free(srcRow);
+    if (ring) PM_free(ring);
+    if (rows) PM_free(rows);
+    if (ringRow) PM_free(ringRow);
+}
+
+/****************************************************************************
+PARAMETERS:
+dc          - Destination device context
+s           - Source surface description
+left        - Left coordinate of source section (surface coordinates)
+top         - Top coordinate of source section (surface coordinates)
+right       - Right coordinate of source section (surface coordinates)
+bottom      - Bottom coordinate of source section (surface coordinates)
+dstLeft     - Left coordinate of destination (viewport coordinates)
+dstTop      - Top coordinate of destination (viewport coordinates)
+dstRight    - Right coordinate of destination (viewport coordinates)
+dstBottom   - Bottom coordinate of destination (viewport coordinates)
+filter      - Resampling filter to use (MGL_resampleFilterType)
+op          - Write mode to draw the results with
+
+REMARKS:
+Main resampling engine shared by all the public functions. Only the part
+of the destination that lies within the destination clip rectangle is
+computed, and only the source pixels that contribute to that part are
+ever unpacked. The results are drawn in bands with MGL_putBitmapSection.
+Large destinations are resampled in parallel when multi-threaded blitting
+has been enabled with MGL_setBltThreads, in which case the entire result
+is buffered and drawn with a single call.
+****************************************************************************/
+static void resample(
+    MGLDC *dc,
+    res_source *s,
+    int left,
+    int top,
+    int right,
+    int bottom,
+    int dstLeft,
+    int dstTop,
+    int dstRight,
+    int dstBottom,
+    int filter,
+    int op)
+{
+    rect_t      d;
+    res_table   tx,ty;
+    res_contrib *cy;
+    res_job     job;
+    bitmap_t    bmp;
+    M_uint32    *srcRow = NULL,*ring = NULL,*band = NULL,**rows = NULL;
+    ushort      *srcLin = NULL,*outLin = NULL;
+    int         *ringRow = NULL;
+    int         i,k,y,row,slot,srcMin,srcSpan,visW,visH,ringSize,bandTop,bandRows;
+    int         pixWords;
+    ibool       linear;
+
+    /* Compute the visible part of the destination rectangle */
+    if (dc == _MGL_dcPtr)
+        dc = &DC;
+    if (right <= left || bottom <= top)
+        return;
+    d.left = dstLeft;       d.top = dstTop;
+    d.right = dstRight;     d.bottom = dstBottom;
+    if (!MGL_sectRect(dc->clipRectView,d,&d))
+        return;
+    visW = d.right - d.left;
+    visH = d.bottom - d.top;
+    if ((linear = dc->a.linearLight) != false)
+        _MGL_initLinearLight();
+    pixWords = linear ? 2 : 1;
+
+    /* Build the filter tables for the visible area */
+    tx.c = ty.c = NULL;
+    tx.weights = ty.weights = NULL;
+    if (!buildTable(&tx,filter,right-left,dstRight-dstLeft,d.left-dstLeft,visW)
+            || !buildTable(&ty,filter,bottom-top,dstBottom-dstTop,d.top-dstTop,visH)) {
+        SETERROR(grNoMem);
+        goto Done;
+        }
+
+    /* Rebase horizontal contributions to the unpacked source run */
+    srcMin = tx.c[0].start;
+    srcSpan = tx.c[visW-1].start + tx.c[visW-1].count - srcMin;
+    for (i = 0; i < visW; i++)
+        tx.c[i].start -= srcMin;
+
+    /* Set up the bitmap header used to draw the results */
+    bmp.width = visW;
+    bmp.bitsPerPixel = 32;
+    bmp.bytesPerLine = visW * 4;
+    bmp.pal = NULL;
+    bmp.pf = &_MGL_pixelFormats[pfARGB32];
+
+    /* Resample large areas in parallel bands if threads are enabled */
+    if (_MGL_useBandThreads((long)visW * visH)) {
+        if ((band = PM_malloc(sizeof(M_uint32) * visW * visH)) != NULL) {
+            job.s = s;
+            job.tx = &tx;
+            job.ty = &ty;
+            job.srcLeft = left + srcMin;
+            job.srcTop = top;
+            job.srcSpan = srcSpan;
+            job.visW = visW;
+            job.out = band;
+            job.linear = linear;
+            job.failed = false;
+            _MGL_runBands(0,visH,resampleBand,&job);
+            if (job.failed)
+                SETERROR(grNoMem);
+            else {
+                bmp.height = visH;
+                bmp.surface = band;
+                MGL_putBitmapSection(dc,0,0,visW,visH,d.left,d.top,&bmp,op);
+                }
+            goto Done;
+            }
+        }
+
+    /* Allocate the scanline buffers */
+    ringSize = ty.maxTaps;
+    srcRow = PM_malloc(sizeof(M_uint32) * srcSpan);
+    ring = PM_malloc(sizeof(M_uint32) * pixWords * visW * ringSize);
+    band = PM_malloc(sizeof(M_uint32) * visW * MIN(visH,RES_BAND));
+    rows = PM_malloc(sizeof(M_uint32*) * ringSize);
+    ringRow = PM_malloc(sizeof(int) * ringSize);
+    if (linear) {
+        srcLin = PM_malloc(sizeof(ushort) * 4 * srcSpan);
+        outLin = PM_malloc(sizeof(ushort) * 4 * visW);
+        }
+    if (!srcRow || !ring || !band || !rows || !ringRow || (linear && (!srcLin || !outLin))) {
+        SETERROR(grNoMem);
+        goto Done;
+        }
+    for (i = 0; i < ringSize; i++)
+        ringRow[i] = -1;
+    bmp.surface = band;
+
+    /* Filter each output scanline and draw them in bands */
+    for (y = 0, bandTop = 0, bandRows = 0, cy = ty.c; y < visH; y++, cy++) {
+        for (k = 0; k < cy->count; k++) {
+            row = cy->start + k;
+            slot = row % ringSize;
+            if (ringRow[slot] != row) {
+                unpackRow(s,left + srcMin,top + row,srcSpan,srcRow);
+                filterSourceRow(&tx,srcRow,srcLin,srcSpan,ring + slot * visW * pixWords,visW);
+                ringRow[slot] = row;
+                }
+            rows[k] = ring + slot * visW * pixWords;
+            }
+        filterOutputRow(cy,ty.linear,rows,outLin,band + bandRows * visW,visW);
+        if (++bandRows == RES_BAND || y == visH-1) {
+            bmp.height = bandRows;
+            MGL_putBitmapSection(dc,0,0,visW,bandRows,d.left,d.top + bandTop,&bmp,op);
+            bandTop += bandRows;
+            bandRows = 0;
+            }
+        }
+
+Done:
+    if (srcLin) PM_free(srcLin);
+    if (outLin) PM_free(outLin);
+    if (srcRow) PM_free(srcRow);
+    if (ring) PM_free(ring);
+    if (band) PM_free(band);
+    if (rows) PM_free(rows);
+    if (ringRow) PM_free(ringRow);
+    freeTable(&tx);
+    freeTable(&ty);
+}
+
+/****************************************************************************
+DESCRIPTION:
+Resample a section of one device context into another with filtering.
+
+HEADER:
+mgraph.h
+
+PARAMETERS:
+dst         - Destination device context
+src         - Source memory device context
+left        - Left coordinate of source section
+top         - Top coordinate of source section
+right       - Right coordinate of source section
+bottom      - Bottom coordinate of source section
+dstLeft     - Left coordinate of destination rectangle
+dstTop      - Top coordinate of destination rectangle
+dstRight    - Right coordinate of destination rectangle
+dstBottom   - Bottom coordinate of destination rectangle
+filter      - Resampling filter to use (MGL_resampleFilterType)
+op          - Write mode to use when drawing the results
+
+REMARKS:
+This function stretches a section of the source device context to the
+destination rectangle on the destination device context, the same as
+MGL_stretchBltCoord. Unlike MGL_stretchBltCoord this function filters the
+image using the resampling filter specified in filter, so that reducing
+an image by a large factor does not produce aliasing artifacts, and
+enlarging an image produces smooth results. See MGL_resampleFilterType for
+details of the filters available and their relative speed and quality.
+
+The source device context must be a memory device context with a color
+depth of 8 bits per pixel or higher, and the result is always color
+converted to the pixel format of the destination device context. The
+output is clipped to the clip rectangle or clip region of the destination
+device context, and only the visible part of the destination is actually
+computed.
+
+The source rectangle is clipped to the source device context clip
+rectangle, and the destination rectangle adjusted to match.
+
+SEE ALSO:
+MGL_resampleBlt, MGL_resampleBitmap, MGL_resampleBitmapSection,
+MGL_stretchBltCoord
+****************************************************************************/
+void MGLAPI MGL_resampleBltCoord(
+    MGLDC *dst,
+    MGLDC *src,
+    int left,
+    int top,
+    int right,
+    int bottom,
+    int dstLeft,
+    int dstTop,
+    int dstRight,
+    int dstBottom,
+    int filter,
+    int op)
+{
+    res_source  s;
+    rect_t      d;
+    fix32_t     zoomx,zoomy;
+    int         fdLeft,fdTop;
+
+    /* Check for valid device contexts */
+    if (src == _MGL_dcPtr)
+        src = &DC;
+    if ((src == dst) || src->deviceType != MGL_MEMORY_DEVICE || src->mi.bitsPerPixel < 8) {
+        SETERROR(grInvalidDevice);
+        return;
+        }
+    if (right <= left || bottom <= top)
+        return;
+
+    /* Clip to the source device context */
+    zoomx = MGL_FixDiv(MGL_TOFIX(dstRight - dstLeft),MGL_TOFIX(right - left));
+    zoomy = MGL_FixDiv(MGL_TOFIX(dstBottom - dstTop),MGL_TOFIX(bottom - top));
+    d.left = left;              d.top = top;
+    d.right = right;            d.bottom = bottom;
+    if (!MGL_sectRect(src->clipRectView,d,&d))
+        return;
+    if (d.left != left || d.top != top || d.right != right || d.bottom != bottom) {
+        fdLeft = MGL_TOFIX(dstLeft) + ((d.left - left) * zoomx);
+        fdTop = MGL_TOFIX(dstTop) + ((d.top - top) * zoomy);
+        dstRight = MGL_FIXROUND(MGL_TOFIX(dstLeft) + ((d.right - left) * zoomx));
+        dstBottom = MGL_FIXROUND(MGL_TOFIX(dstTop) + ((d.bottom - top) * zoomy));
+        dstLeft = MGL_FIXROUND(fdLeft);
+        dstTop = MGL_FIXROUND(fdTop);
+        }
+
+    /* Now resample the image */
+    setupSource(&s,src->surface,src->mi.bytesPerLine,src->mi.bitsPerPixel,
+        &src->pf,TO_PAL(src->colorTab));
+    resample(dst,&s,d.left + src->viewPort.left,d.top + src->viewPort.top,
+        d.right + src->viewPort.left,d.bottom + src->viewPort.top,
+        dstLeft,dstTop,dstRight,dstBottom,filter,op);
+}
+
+/****************************************************************************
+DESCRIPTION:
+Resample a section of a bitmap onto a device context with filtering.
+
+HEADER:
+mgraph.h
+
+PARAMETERS:
+dc          - Device context to draw bitmap on
+left        - Left coordinate of section of bitmap to draw
+top         - Top coordinate of section of bitmap to draw
+right       - Right coordinate of section of bitmap to draw
+bottom      - Bottom coordinate of section of bitmap to draw
+dstLeft     - Left coordinate of destination rectangle
+dstTop      - Top coordinate of destination rectangle
+dstRight    - Right coordinate of destination rectangle
+dstBottom   - Bottom coordinate of destination rectangle
+bitmap      - Bitmap to draw
+filter      - Resampling filter to use (MGL_resampleFilterType)
+op          - Write mode to use when drawing the results
+
+REMARKS:
+This function is the same as MGL_resampleBitmap, but only draws the
+specified section of the bitmap. The section is clipped to the bounds of
+the bitmap, and the destination rectangle adjusted to match.
+
+Color index bitmaps without a palette are converted using the color
+palette of the destination device context.
+
+SEE ALSO:
+MGL_resampleBitmap, MGL_resampleBltCoord, MGL_stretchBitmapSection
+****************************************************************************/
+void MGLAPI MGL_resampleBitmapSection(
+    MGLDC *dc,
+    int left,
+    int top,
+    int right,
+    int bottom,
+    int dstLeft,
+    int dstTop,
+    int dstRight,
+    int dstBottom,
+    const bitmap_t *bitmap,
+    int filter,
+    int op)
+{
+    res_source  s;
+    palette_t   *pal;
+    rect_t      d,b;
+    fix32_t     zoomx,zoomy;
+    int         fdLeft,fdTop;
+
+    if (bitmap->bitsPerPixel < 8) {
+        SETERROR(grInvalidBitmap);
+        return;
+        }
+    if (dc == _MGL_dcPtr)
+        dc = &DC;
+    if (right <= left || bottom <= top)
+        return;
+
+    /* Clip to the bounds of the bitmap */
+    zoomx = MGL_FixDiv(MGL_TOFIX(dstRight - dstLeft),MGL_TOFIX(right - left));
+    zoomy = MGL_FixDiv(MGL_TOFIX(dstBottom - dstTop),MGL_TOFIX(bottom - top));
+    b.left = 0;                 b.top = 0;
+    b.right = bitmap->width;    b.bottom = bitmap->height;
+    d.left = left;              d.top = top;
+    d.right = right;            d.bottom = bottom;
+    if (!MGL_sectRect(b,d,&d))
+        return;
+    if (d.left != left || d.top != top || d.right != right || d.bottom != bottom) {
+        fdLeft = MGL_TOFIX(dstLeft) + ((d.left - left) * zoomx);
+        fdTop = MGL_TOFIX(dstTop) + ((d.top - top) * zoomy);
+        dstRight = MGL_FIXROUND(MGL_TOFIX(dstLeft) + ((d.right - left) * zoomx));
+        dstBottom = MGL_FIXROUND(MGL_TOFIX(dstTop) + ((d.bottom - top) * zoomy));
+        dstLeft = MGL_FIXROUND(fdLeft);
+        dstTop = MGL_FIXROUND(fdTop);
+        }
+
+    /* Now resample the image */
+    pal = bitmap->pal ? bitmap->pal : TO_PAL(dc->colorTab);
+    setupSource(&s,bitmap->surface,bitmap->bytesPerLine,bitmap->bitsPerPixel,
+        bitmap->pf,pal);
+    resample(dc,&s,d.left,d.top,d.right,d.bottom,
+        dstLeft,dstTop,dstRight,dstBottom,filter,op);
+}
+
+/****************************************************************************
+DESCRIPTION:
+Resample a bitmap onto a device context with filtering.
+
+HEADER:
+mgraph.h
+
+PARAMETERS:
+dc          - Device context to draw bitmap on
+dstLeft     - Left coordinate of destination rectangle
+dstTop      - Top coordinate of destination rectangle
+dstRight    - Right coordinate of destination rectangle
+dstBottom   - Bottom coordinate of destination rectangle
+bitmap      - Bitmap to draw
+filter      - Resampling filter to use (MGL_resampleFilterType)
+op          - Write mode to use when drawing the results
+
+REMARKS:
+This function draws the bitmap stretched to the destination rectangle,
+the same as MGL_stretchBitmap, but filters the image using the specified
+resampling filter. This produces much better quality results than
+MGL_stretchBitmap when generating thumbnails or other reduced size
+images, and smooth results when enlarging images.
+
+The bitmap must have a color depth of 8 bits per pixel or higher, and the
+results are always color converted to the pixel format of the destination
+device context.
+
+SEE ALSO:
+MGL_resampleBitmapSection, MGL_resampleBltCoord, MGL_stretchBitmap
+****************************************************************************/
+void MGLAPI MGL_resampleBitmap(
+    MGLDC *dc,
+    int dstLeft,
+    int dstTop,
+    int dstRight,
+    int dstBottom,
+    const bitmap_t *bitmap,
+    int filter,
+    int op)
+{
+    MGL_resampleBitmapSection(dc,0,0,bitmap->width,bitmap->height,
+        dstLeft,dstTop,dstRight,dstBottom,bitmap,filter,op);
+}
@@ -359,6 +359,36 @@ typedef struct {
 #define PCX_CNT_MASK    0x3F            /* Mask out pixel count     */
 #define PCX_MAX_RUN     0x3F            /* Maxium repeat count      */
 
+/* MGL native surface file format header information. The header is
+ * followed by the palette (if present) and then the pixel data, which
+ * starts on a 64 byte boundary. Compressed pixel data starts with a table
+ * of the compressed size of each block of scanlines, followed by the
+ * compressed blocks.
+ */
+
+typedef struct {
+    char      id[4];                    /* Always "MGS\x1A"          */
+    M_uint32  headerSize;               /* Size of this header        */
+    M_uint16  version;                  /* Format version (1)         */
+    M_uint16  flags;                    /* MGS_* flags                */
+    M_int32   width;                    /* Width in pixels            */
+    M_int32   height;                   /* Height in pixels           */
+    M_int32   bitsPerPixel;             /* Pixel depth                */
+    M_int32   bytesPerLine;             /* Scanline width (64 aligned)*/
+    M_uint32  palSize;                  /* Number of palette entries  */
+    M_uint32  dataOffset;               /* Offset to the pixel data   */
+    M_uint32  dataSize;                 /* Size of the pixel data     */
+    M_uint32  blockRows;                /* Scanlines per LZ block     */
+    pixel_format_t  pf;                 /* Pixel format (> 8 bits)    */
+    M_uint8   extra[8];                 /* Pad to 64 bytes            */
+    } MGSHEADER;
+
+#define MGS_ID          "MGS\x1A"       /* Surface file identifier   */
+#define MGS_VERSION     1               /* Current format version    */
+#define MGS_ALIGN       64              /* Scanline alignment        */
+#define MGS_LZ          0x0001          /* Pixel data is compressed  */
+#define MGS_STORED      0x80000000UL    /* Block is not compressed   */
+
 /* Macros for extracting values from resource file structures in little
  * endian or big endian format. We define the following macros:
  *
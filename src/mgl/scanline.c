@@ -188,6 +188,8 @@ void MGLAPI MGL_scanLine(
 {
     if (x2 < x1)
         SWAP(x1,x2);
-    if (x1 < x2)
+    if (x1 < x2) {
+        MARK_DIRTY(&DC,x1,y,x2,y+1);
         DC.r.cur.DrawRect(x1,y,x2-x1,1);
+        }
 }
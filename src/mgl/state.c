@@ -986,7 +986,9 @@ This function sets the current dithering mode used when blitting RGB images
 to 8, 15 and 16 bits per pixel device context. If dithering is enabled, the
 blit operation will dither the resulting image to produce the best quality.
 When dithering is disabled, the blit operation uses the closest color which
-has less quality but is faster.
+has less quality but is faster. Setting the mode to MGL_DITHER_DIFFUSE
+selects Floyd-Steinberg error diffusion instead of the ordered halftone
+dither when drawing to memory device contexts.
 
 Note:   The closest color method is fastest when the destination device
         context is a 15 or 16 bits per pixel bitmap. However when the
@@ -1026,6 +1028,65 @@ int MGLAPI MGL_getDitherMode(void)
     return DC.a.ditherMode;
 }
 
+/****************************************************************************
+DESCRIPTION:
+Enables or disables linear light blending and resampling.
+
+HEADER:
+mgraph.h
+
+PARAMETERS:
+enable  - True to blend and resample in linear light, false for sRGB
+
+REMARKS:
+This function sets whether software alpha blending and filtered resampling
+into the current device context are done in linear light. Pixel values
+are normally gamma encoded (sRGB), and blending or filtering the encoded
+values directly makes anti-aliased edges, blended gradients and scaled
+photographs look darker than they should. When linear light mode is
+enabled, the MGL converts pixels to 16 bits per component linear light
+with lookup tables before blending or filtering them, and converts the
+results back to sRGB afterwards.
+
+Linear light mode affects the MGL_resampleBitmap family of functions, and
+source alpha or constant alpha blending with the MGL_bitBltFx and
+MGL_putBitmapFx families of functions when the destination is a 15 bits
+per pixel or higher memory device context. Blending done by hardware is
+not affected.
+
+Note:   Linear light mode is /off/ by default in the MGL.
+
+SEE ALSO:
+MGL_getLinearLightMode, MGL_resampleBitmap, MGL_bitBltFx, MGL_putBitmapFx
+****************************************************************************/
+void MGLAPI MGL_setLinearLightMode(
+    ibool enable)
+{
+    DC.a.linearLight = enable;
+}
+
+/****************************************************************************
+DESCRIPTION:
+Returns the current linear light blending mode.
+
+HEADER:
+mgraph.h
+
+RETURNS:
+True if linear light blending and resampling is enabled.
+
+REMARKS:
+This function returns true if software blending and resampling into the
+current device context is done in linear light.
+
+SEE ALSO:
+MGL_setLinearLightMode
+****************************************************************************/
+ibool MGLAPI MGL_getLinearLightMode(void)
+{
+    return DC.a.linearLight;
+}
+
 /****************************************************************************
 DESCRIPTION:
 Sets the current pen size.
@@ -1875,6 +1936,7 @@ void MGLAPI MGL_defaultAttributes(
     dc->a.alphaValue        = 0xFF;
     dc->a.planeMask         = 0xFFFFFFFFUL;
     dc->a.ditherMode        = MGL_DITHER_ON;
+    dc->a.linearLight       = false;
     dc->a.ts.horizJust      = MGL_LEFT_TEXT;
     dc->a.ts.vertJust       = MGL_TOP_TEXT;
     dc->a.ts.dir            = MGL_RIGHT_TEXT;
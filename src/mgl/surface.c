@@ -0,0 +1,1173 @@
+/****************************************************************************
+*
+*                   SciTech Multi-platform Graphics Library
+*
+*  ========================================================================
+*
+*   Copyright (C) 1991-2004 SciTech Software, Inc. All rights reserved.
+*
+*   This file may be distributed and/or modified under the terms of the
+*   GNU General Public License version 2.0 as published by the Free
+*   Software Foundation and appearing in the file LICENSE.GPL included
+*   in the packaging of this file.
+*
+*   Licensees holding a valid Commercial License for this product from
+*   SciTech Software, Inc. may use this file in accordance with the
+*   Commercial License Agreement provided with the Software.
+*
+*   This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING
+*   THE WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+*   PURPOSE.
+*
+*   See http://www.scitechsoft.com/license/ for information about
+*   the licensing options available and how to purchase a Commercial
+*   License Agreement.
+*
+*   Contact license@scitechsoft.com if any conditions of this licensing
+*   are not clear to you, or you have questions about licensing options.
+*
+*  ========================================================================
+*
+*
+* Language:     ANSI C
+* Environment:  Any
+*
+* Description:  MGL native surface file loading and saving routines. The
+*               native format stores bitmaps in the exact memory layout
+*               used by the MGL, with 64 byte aligned scanlines, so that
+*               uncompressed files can be read straight into memory or
+*               mapped directly from disk with no conversion. The pixel
+*               data can optionally be compressed with a simple and very
+*               fast LZ77 style block compressor, with each block of
+*               scanlines compressed independently so that large images
+*               can be decompressed on all the band worker threads.
+*
+****************************************************************************/
+
+#include "mgl.h"
+
+/*--------------------------- Global Variables ----------------------------*/
+
+#define MGS_BLOCK_SIZE  (64 * 1024L)    /* Target size of each LZ block */
+#define LZ_HASH_BITS    12
+#define LZ_HASH_SIZE    (1 << LZ_HASH_BITS)
+#define LZ_MIN_MATCH    4
+#define LZ_MAX_OFFSET   0xFFFF
+#define LZ_COPY         16              /* Size of fast copy chunks     */
+#define LZ_HASH(v)      ((M_uint32)((v) * 2654435761UL) >> (32 - LZ_HASH_BITS))
+
+/* {secret} */
+typedef struct {
+    const uchar *data;          /* Compressed blocks                       */
+    ulong       *start;         /* Offset of each block within the data    */
+    ulong       *size;          /* Size of each block (MGS_STORED if raw)  */
+    uchar       *dst;           /* Destination surface                     */
+    long        pitch;          /* Bytes per line of the surface           */
+    int         height;         /* Number of scanlines in the surface      */
+    int         blockRows;      /* Scanlines in each block                 */
+    ibool       failed;         /* Set if any block failed to decompress   */
+    } mgsDecoder;
+
+/*------------------------- Implementation --------------------------------*/
+
+/****************************************************************************
+PARAMETERS:
+p   - Pointer to the bytes to read
+
+RETURNS:
+32-bit value read from a possibly unaligned address.
+****************************************************************************/
+static M_uint32 read32(
+    const uchar *p)
+{
+    M_uint32    v;
+
+    memcpy(&v,p,sizeof(v));
+    return v;
+}
+
+/****************************************************************************
+PARAMETERS:
+width           - Width of the scanline in pixels
+bitsPerPixel    - Pixel depth of the scanline
+
+RETURNS:
+Number of bytes of pixel data in each scanline.
+****************************************************************************/
+static long scanlineBytes(
+    int width,
+    int bitsPerPixel)
+{
+    if (bitsPerPixel < 8)
+        return ((long)width * bitsPerPixel + 7) / 8;
+    return (long)width * ((bitsPerPixel + 7) / 8);
+}
+
+/****************************************************************************
+PARAMETERS:
+op  - Place to store the length bytes
+len - Remaining length to encode (after the 15 stored in the token)
+
+RETURNS:
+Pointer to the byte following the encoded length.
+****************************************************************************/
+static uchar *putLength(
+    uchar *op,
+    long len)
+{
+    while (len >= 255) {
+        *op++ = 255;
+        len -= 255;
+        }
+    *op++ = (uchar)len;
+    return op;
+}
+
+/****************************************************************************
+PARAMETERS:
+src     - Data to compress
+n       - Number of bytes to compress
+dst     - Place to store the compressed data
+hash    - Hash table for the compressor (LZ_HASH_SIZE entries)
+
+RETURNS:
+Size of the compressed data.
+
+REMARKS:
+Compresses a block of data with a greedy LZ77 compressor. The output is a
+sequence of tokens, each holding a count of literal bytes that follow the
+token and the length of a match that follows the literals, with the match
+offset stored as a 16-bit value after the literals. The final token only
+has literals. The destination must be at least n + n/255 + 16 bytes long.
+The compressor skips ahead faster the longer it goes without finding a
+match, so incompressible data is passed over very quickly.
+****************************************************************************/
+static long compressBlock(
+    const uchar *src,
+    long n,
+    uchar *dst,
+    ulong *hash)
+{
+    const uchar *ip = src,*anchor = src,*ref,*end = src + n;
+    const uchar *limit = (n > LZ_MIN_MATCH) ? end - LZ_MIN_MATCH : src;
+    uchar       *op = dst,*token;
+    M_uint32    v;
+    long        len,mlen;
+    uint        h;
+
+    memset(hash,0,LZ_HASH_SIZE * sizeof(hash[0]));
+    while (ip < limit) {
+        v = read32(ip);
+        h = LZ_HASH(v);
+        ref = src + hash[h];
+        hash[h] = (ulong)(ip - src);
+        if (ref >= ip || ip - ref > LZ_MAX_OFFSET || read32(ref) != v) {
+            ip += 1 + ((ip - anchor) >> 6);
+            continue;
+            }
+
+        /* Extend the match as far as possible */
+        mlen = LZ_MIN_MATCH;
+        while (ip + mlen < end && ref[mlen] == ip[mlen])
+            mlen++;
+
+        /* Emit the literals followed by the match */
+        len = (long)(ip - anchor);
+        token = op++;
+        *token = (uchar)((len >= 15 ? 15 : len) << 4);
+        if (len >= 15)
+            op = putLength(op,len - 15);
+        memcpy(op,anchor,len);
+        op += len;
+        *op++ = (uchar)(ip - ref);
+        *op++ = (uchar)((ip - ref) >> 8);
+        len = mlen - LZ_MIN_MATCH;
+        *token |= (uchar)(len >= 15 ? 15 : len);
+        if (len >= 15)
+            op = putLength(op,len - 15);
+        ip += mlen;
+        anchor = ip;
+        }
+
+    /* Emit the final run of literals */
+    len = (long)(end - anchor);
+    *op++ = (uchar)((len >= 15 ? 15 : len) << 4);
+    if (len >= 15)
+        op = putLength(op,len - 15);
+    memcpy(op,anchor,len);
+    op += len;
+    return (long)(op - dst);
+}
+
+/****************************************************************************
+PARAMETERS:
+src     - Compressed data
+n       - Size of the compressed data
+dst     - Place to store the decompressed data
+size    - Expected size of the decompressed data
+
+RETURNS:
+True if the block decompressed to exactly the expected size.
+
+REMARKS:
+Decompresses a block compressed with compressBlock. Every length and
+offset is checked against the input and output buffers, so a corrupt file
+can never read or write outside of them.
+****************************************************************************/
+static ibool decompressBlock(
+    const uchar *src,
+    long n,
+    uchar *dst,
+    long size)
+{
+    const uchar *ip = src,*iend = src + n,*ref;
+    uchar       *op = dst,*oend = dst + size;
+    long        len,offset;
+    uint        token,c;
+
+    while (ip < iend) {
+        /* Copy the literals */
+        token = *ip++;
+        len = token >> 4;
+        if (len == 15) {
+            do {
+                if (ip >= iend)
+                    return false;
+                len += (c = *ip++);
+                } while (c == 255);
+            }
+        if (len > iend - ip || len > oend - op)
+            return false;
+        if (len <= LZ_COPY && iend - ip >= LZ_COPY && oend - op >= LZ_COPY)
+            memcpy(op,ip,LZ_COPY);
+        else
+            memcpy(op,ip,len);
+        op += len;
+        ip += len;
+        if (ip == iend)
+            break;
+
+        /* Copy the match */
+        if (iend - ip < 2)
+            return false;
+        offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > op - dst)
+            return false;
+        len = (token & 15) + LZ_MIN_MATCH;
+        if ((token & 15) == 15) {
+            do {
+                if (ip >= iend)
+                    return false;
+                len += (c = *ip++);
+                } while (c == 255);
+            }
+        if (len > oend - op)
+            return false;
+        /* Matches far enough back are copied in fixed size chunks, which may
+         * write a little past the end of the match but never past the end
+         * of the block. Overlapping matches are copied in chunks that double
+         * in size as the distance back to the start of the match grows.
+         */
+        ref = op - offset;
+        if (offset >= LZ_COPY && oend - op >= len + LZ_COPY) {
+            do {
+                memcpy(op,ref,LZ_COPY);
+                op += LZ_COPY;
+                ref += LZ_COPY;
+                len -= LZ_COPY;
+                } while (len > 0);
+            op += len;
+            continue;
+            }
+        while (len > 0) {
+            offset = MIN(len,(long)(op - ref));
+            memcpy(op,ref,offset);
+            op += offset;
+            len -= offset;
+            }
+        }
+    return op == oend;
+}
+
+/****************************************************************************
+PARAMETERS:
+ctx     - Surface decoder
+first   - First block to decompress
+last    - Last block to decompress (exclusive)
+
+REMARKS:
+Decompresses a range of blocks straight into the destination surface.
+Blocks are independent of each other, so this can be run on the band worker
+threads in parallel.
+****************************************************************************/
+static void decodeBlocks(
+    void *ctx,
+    int first,
+    int last)
+{
+    mgsDecoder  *d = ctx;
+    uchar       *dst;
+    long        size;
+    int         b,rows;
+
+    for (b = first; b < last; b++) {
+        rows = MIN(d->blockRows,d->height - b * d->blockRows);
+        dst = d->dst + (long)b * d->blockRows * d->pitch;
+        size = (long)rows * d->pitch;
+        if (d->size[b] & MGS_STORED) {
+            if ((long)(d->size[b] & ~MGS_STORED) != size)
+                d->failed = true;
+            else
+                memcpy(dst,d->data + d->start[b],size);
+            }
+        else if (!decompressBlock(d->data + d->start[b],d->size[b],dst,size))
+            d->failed = true;
+        }
+}
+
+/****************************************************************************
+PARAMETERS:
+hdr         - Place to store the surface file header
+pal         - Place to store the palette
+f           - Open file to read from
+dwOffset    - Offset to start of surface within the file
+dwSize      - Size of the surface file
+
+RETURNS:
+True if the header is valid, false if not.
+
+REMARKS:
+Reads and validates the surface file header and palette, converting the
+header fields to native byte order. The file is left positioned at the
+start of the pixel data.
+****************************************************************************/
+static ibool readSurfaceHeader(
+    MGSHEADER *hdr,
+    palette_t *pal,
+    FILE *f,
+    ulong dwOffset,
+    ulong dwSize)
+{
+    long    rowBytes;
+    ulong   palBytes,numBlocks;
+
+    __MGL_fseek(f,dwOffset,SEEK_SET);
+    if (dwSize < sizeof(MGSHEADER) || __MGL_fread(hdr,1,sizeof(MGSHEADER),f) != sizeof(MGSHEADER))
+        goto Error;
+    if (strncmp(hdr->id,MGS_ID,4) != 0)
+        goto Error;
+    convLELong(hdr->headerSize);
+    convLEShort(hdr->version);
+    convLEShort(hdr->flags);
+    convLELong(hdr->width);
+    convLELong(hdr->height);
+    convLELong(hdr->bitsPerPixel);
+    convLELong(hdr->bytesPerLine);
+    convLELong(hdr->palSize);
+    convLELong(hdr->dataOffset);
+    convLELong(hdr->dataSize);
+    convLELong(hdr->blockRows);
+    if (hdr->version != MGS_VERSION || hdr->headerSize < sizeof(MGSHEADER))
+        goto Error;
+    switch (hdr->bitsPerPixel) {
+        case 1: case 4: case 8: case 15: case 16: case 24: case 32:
+            break;
+        default:
+            goto Error;
+        }
+    if (hdr->width <= 0 || hdr->height <= 0 || hdr->width > 0xFFFF || hdr->height > 0xFFFF)
+        goto Error;
+    rowBytes = scanlineBytes(hdr->width,hdr->bitsPerPixel);
+    if (hdr->bytesPerLine != ((rowBytes + MGS_ALIGN-1) & ~(MGS_ALIGN-1)))
+        goto Error;
+    if ((ulong)hdr->height > 0x7FFFFFFFUL / (ulong)hdr->bytesPerLine)
+        goto Error;
+    if (hdr->palSize > 256 || (hdr->palSize && hdr->bitsPerPixel > 8))
+        goto Error;
+    palBytes = hdr->palSize * sizeof(palette_t);
+    if (hdr->dataOffset < hdr->headerSize + palBytes || hdr->dataOffset > dwSize || hdr->dataSize > dwSize - hdr->dataOffset)
+        goto Error;
+    if (hdr->flags & MGS_LZ) {
+        if (hdr->blockRows == 0)
+            goto Error;
+        numBlocks = ((ulong)hdr->height + hdr->blockRows - 1) / hdr->blockRows;
+        if (hdr->dataSize < numBlocks * 4)
+            goto Error;
+        }
+    else if (hdr->dataSize != (ulong)hdr->bytesPerLine * hdr->height)
+        goto Error;
+
+    /* Read the palette and skip to the pixel data */
+    __MGL_fseek(f,dwOffset + hdr->headerSize,SEEK_SET);
+    if (palBytes && __MGL_fread(pal,1,palBytes,f) != palBytes)
+        goto Error;
+    __MGL_fseek(f,dwOffset + hdr->dataOffset,SEEK_SET);
+    return true;
+
+Error:
+    __MGL_result = grInvalidBitmap;
+    return false;
+}
+
+/****************************************************************************
+PARAMETERS:
+hdr     - Surface file header
+f       - Open file positioned at the start of the pixel data
+dst     - Place to store the pixel data (bytesPerLine * height bytes)
+
+RETURNS:
+True on success, false on error.
+
+REMARKS:
+Reads the pixel data into the destination with the scanlines in the file
+layout. Uncompressed data is read with a single read, and compressed data
+is read in one piece and then decompressed on the band worker threads.
+****************************************************************************/
+static ibool readSurfaceData(
+    MGSHEADER *hdr,
+    FILE *f,
+    uchar *dst)
+{
+    mgsDecoder  d;
+    uchar       *data;
+    ulong       *table,offset;
+    int         b,numBlocks;
+    long        pixels = (long)hdr->width * hdr->height;
+
+    if (!(hdr->flags & MGS_LZ)) {
+        if (__MGL_fread(dst,1,hdr->dataSize,f) != hdr->dataSize) {
+            __MGL_result = grInvalidBitmap;
+            return false;
+            }
+        return true;
+        }
+
+    /* Read the block table and the compressed blocks */
+    numBlocks = (hdr->height + hdr->blockRows - 1) / hdr->blockRows;
+    if ((data = PM_malloc(hdr->dataSize)) == NULL) {
+        FATALERROR(grNoMem);
+        return false;
+        }
+    if ((table = PM_malloc(numBlocks * 2 * sizeof(ulong))) == NULL) {
+        PM_free(data);
+        FATALERROR(grNoMem);
+        return false;
+        }
+    d.failed = __MGL_fread(data,1,hdr->dataSize,f) != hdr->dataSize;
+    d.data = data;
+    d.start = table;
+    d.size = table + numBlocks;
+    offset = numBlocks * 4;
+    for (b = 0; b < numBlocks && !d.failed; b++) {
+        d.size[b] = getLELong(data[b * 4]);
+        d.start[b] = offset;
+        offset += d.size[b] & ~MGS_STORED;
+        if (offset > hdr->dataSize || offset < d.start[b])
+            d.failed = true;
+        }
+
+    /* Decompress the blocks on the worker threads if possible */
+    if (!d.failed) {
+        d.dst = dst;
+        d.pitch = hdr->bytesPerLine;
+        d.height = hdr->height;
+        d.blockRows = hdr->blockRows;
+        if (_MGL_useBandThreads(pixels))
+            _MGL_runBands(0,numBlocks,decodeBlocks,&d);
+        else
+            decodeBlocks(&d,0,numBlocks);
+        }
+    PM_free(table);
+    PM_free(data);
+    if (d.failed) {
+        __MGL_result = grInvalidBitmap;
+        return false;
+        }
+    return true;
+}
+
+/****************************************************************************
+PARAMETERS:
+bitmap  - Bitmap header to fill in
+hdr     - Surface file header
+
+REMARKS:
+Fills in the bitmap header fields from the surface file header.
+****************************************************************************/
+static void initBitmapHeader(
+    bitmap_t *bitmap,
+    MGSHEADER *hdr)
+{
+    bitmap->width = hdr->width;
+    bitmap->height = hdr->height;
+    bitmap->bitsPerPixel = hdr->bitsPerPixel;
+    bitmap->bytesPerLine = hdr->bytesPerLine;
+    bitmap->surface = NULL;
+    bitmap->pal = NULL;
+    bitmap->pf = NULL;
+}
+
+/****************************************************************************
+DESCRIPTION:
+Loads a native MGL surface file into memory from an open file.
+
+HEADER:
+mgraph.h
+
+PARAMETERS:
+f           - Open binary file to read data from
+dwOffset    - Offset to start of surface in file
+dwSize      - Size of the file
+loadPalette - Should we load the palette values as well?
+
+RETURNS:
+Pointer to the loaded bitmap, NULL on error.
+
+REMARKS:
+This function is the same as MGL_loadSurface, however it loads the file from
+a previously open file. This allows you to create your own large files with
+multiple files embedded in them.
+
+SEE ALSO:
+MGL_loadSurface, MGL_loadSurfaceIntoDC
+****************************************************************************/
+bitmap_t * MGLAPI MGL_loadSurfaceExt(
+    FILE *f,
+    ulong dwOffset,
+    ulong dwSize,
+    ibool loadPalette)
+{
+    MGSHEADER   hdr;
+    palette_t   pal[256];
+    bitmap_t    *bitmap;
+    long        size,palSize;
+    uchar       *p;
+
+    if (!readSurfaceHeader(&hdr,pal,f,dwOffset,dwSize))
+        return NULL;
+
+    /* Allocate memory for the bitmap, with the surface 64 byte aligned */
+    palSize = loadPalette ? hdr.palSize * sizeof(palette_t) : 0;
+    size = sizeof(bitmap_t) + sizeof(pixel_format_t) + palSize + MGS_ALIGN-1;
+    if ((bitmap = PM_malloc(size + (long)hdr.bytesPerLine * hdr.height)) == NULL) {
+        FATALERROR(grNoMem);
+        return NULL;
+        }
+    initBitmapHeader(bitmap,&hdr);
+    p = (uchar*)(bitmap + 1);
+    if (hdr.bitsPerPixel > 8) {
+        bitmap->pf = (pixel_format_t*)p;
+        *bitmap->pf = hdr.pf;
+        p += sizeof(pixel_format_t);
+        }
+    else if (palSize) {
+        bitmap->pal = (palette_t*)p;
+        memcpy(bitmap->pal,pal,palSize);
+        p += palSize;
+        }
+    p += (MGS_ALIGN - ((ulong)p & (MGS_ALIGN-1))) & (MGS_ALIGN-1);
+    bitmap->surface = p;
+
+    /* Read the pixel data straight into the bitmap surface */
+    if (!readSurfaceData(&hdr,f,bitmap->surface)) {
+        PM_free(bitmap);
+        return NULL;
+        }
+    return bitmap;
+}
+
+/****************************************************************************
+DESCRIPTION:
+Load a native MGL surface file from disk.
+
+HEADER:
+mgraph.h
+
+PARAMETERS:
+surfaceName - Name of surface file to load
+loadPalette - True if the palette should also be loaded
+
+RETURNS:
+Pointer to the loaded bitmap, NULL on error.
+
+REMARKS:
+Locates the specified surface file and loads it into a lightweight bitmap
+structure. Surface files are the MGL's native bitmap format, written by
+MGL_saveSurface, and store the bitmap in exactly the pixel format and
+memory layout of the bitmap that was saved. Because no decoding or pixel
+format conversion is needed, loading an uncompressed surface file is a
+single read of the pixel data, and compressed files are decompressed with
+a very fast LZ decompressor (on all the band worker threads if
+multi-threaded blitting has been enabled with MGL_setBltThreads). This
+makes surface files ideal for pre-baked game and user interface assets.
+
+Each scanline of the loaded bitmap starts on a 64 byte boundary. If
+loadPalette is true, the palette values for the bitmap will be loaded into
+the structure as well (if there is no palette, it will not be loaded),
+otherwise the palette entry for the bitmap will be NULL.
+
+When MGL is searching for surface files it searches in the same places as
+for bitmap files, as described for MGL_loadBitmap.
+
+The bitmap must be freed with MGL_unloadBitmap when you are done with it.
+If the file was not found or is not a valid surface file, this function
+will return NULL. You can check the MGL_result error code to determine the
+cause.
+
+SEE ALSO:
+MGL_saveSurface, MGL_mapSurface, MGL_loadSurfaceIntoDC, MGL_unloadBitmap,
+MGL_loadSurfaceExt
+****************************************************************************/
+bitmap_t * MGLAPI MGL_loadSurface(
+    const char *surfaceName,
+    ibool loadPalette)
+{
+    FILE        *f;
+    bitmap_t    *bitmap;
+
+    __MGL_result = grOK;
+    if ((f = _MGL_openFile(MGL_BITMAPS, surfaceName, "rb")) == NULL) {
+        __MGL_result = grBitmapNotFound;
+        return NULL;
+        }
+    bitmap = MGL_loadSurfaceExt(f,0,_MGL_fileSize(f),loadPalette);
+    __MGL_fclose(f);
+    return bitmap;
+}
+
+/****************************************************************************
+DESCRIPTION:
+Maps a native MGL surface file directly into memory.
+
+HEADER:
+mgraph.h
+
+PARAMETERS:
+surfaceName - Name of surface file to map
+loadPalette - True if the palette should also be loaded
+
+RETURNS:
+Pointer to the mapped bitmap, NULL on error.
+
+REMARKS:
+This function is similar to MGL_loadSurface, but rather than reading the
+pixel data into memory it maps the surface file into the address space of
+the application and points the bitmap surface directly at the pixel data
+in the file mapping. The operating system then pages in the pixel data as
+it is accessed, so mapping a surface is almost instantaneous no matter how
+large it is, and the memory can be shared with other processes that map
+the same file. Since the pixel data starts at a 64 byte aligned offset in
+the file and the mapping starts on a page boundary, each scanline is still
+64 byte aligned. The mapping is private to
+the application, so writing to the surface does not change the file.
+
+If the surface file is compressed, the platform does not support mapping
+files or the file I/O functions have been overridden with MGL_setFileIO,
+the surface is loaded into memory with MGL_loadSurface instead. Either way
+the bitmap must be released with MGL_unmapBitmap and not MGL_unloadBitmap.
+
+SEE ALSO:
+MGL_unmapBitmap, MGL_loadSurface, MGL_saveSurface
+****************************************************************************/
+bitmap_t * MGLAPI MGL_mapSurface(
+    const char *surfaceName,
+    ibool loadPalette)
+{
+    mappedBitmap    *mb;
+    MGSHEADER       hdr;
+    char            path[PM_MAX_PATH];
+    FILE            *f;
+
+    __MGL_result = grOK;
+    if ((mb = PM_calloc(1,sizeof(mappedBitmap))) == NULL) {
+        FATALERROR(grNoMem);
+        return NULL;
+        }
+
+    /* We can only map uncompressed files that live on disk where the
+     * standard C file I/O functions can find them.
+     */
+    if (__MGL_fopen == fopen && _MGL_findFile(path,MGL_BITMAPS,surfaceName,"rb")) {
+        if ((f = __MGL_fopen(path,"rb")) == NULL) {
+            PM_free(mb);
+            __MGL_result = grBitmapNotFound;
+            return NULL;
+            }
+        if (!readSurfaceHeader(&hdr,mb->pal,f,0,_MGL_fileSize(f))) {
+            __MGL_fclose(f);
+            PM_free(mb);
+            return NULL;
+            }
+        __MGL_fclose(f);
+        if (!(hdr.flags & MGS_LZ) && (mb->base = _MGL_mapFile(path,&mb->size)) != NULL) {
+            if (mb->size >= hdr.dataOffset + hdr.dataSize) {
+                initBitmapHeader(&mb->bm,&hdr);
+                mb->bm.surface = (uchar*)mb->base + hdr.dataOffset;
+                if (hdr.bitsPerPixel > 8) {
+                    mb->pf = hdr.pf;
+                    mb->bm.pf = &mb->pf;
+                    }
+                else if (loadPalette && hdr.palSize)
+                    mb->bm.pal = mb->pal;
+                return &mb->bm;
+                }
+            _MGL_unmapFile(mb->base,mb->size);
+            mb->base = NULL;
+            }
+        }
+
+    /* Fall back on loading a copy of the surface into memory */
+    if ((mb->copy = MGL_loadSurface(surfaceName,loadPalette)) == NULL) {
+        PM_free(mb);
+        return NULL;
+        }
+    mb->bm = *mb->copy;
+    return &mb->bm;
+}
+
+/****************************************************************************
+DESCRIPTION:
+Obtain the dimensions of a native MGL surface file from an open file.
+
+HEADER:
+mgraph.h
+
+PARAMETERS:
+f               - Pointer to opened surface file
+dwOffset        - Offset into the file
+dwSize          - Size of the surface file
+width           - Place to store the surface width
+height          - Place to store the surface height
+bitsPerPixel    - Place to store the surface pixel depth
+pf              - Place to store the surface pixel format
+
+RETURNS:
+True if the surface file was valid, otherwise false.
+
+REMARKS:
+This function is the same as MGL_getSurfaceSize, however it works with a
+previously opened file. This allows you to create your own large files with
+multiple files embedded in them.
+
+SEE ALSO:
+MGL_getSurfaceSize
+****************************************************************************/
+ibool MGLAPI MGL_getSurfaceSizeExt(
+    FILE *f,
+    ulong dwOffset,
+    ulong dwSize,
+    int *width,
+    int *height,
+    int *bitsPerPixel,
+    pixel_format_t *pf)
+{
+    MGSHEADER   hdr;
+    palette_t   pal[256];
+
+    if (!readSurfaceHeader(&hdr,pal,f,dwOffset,dwSize))
+        return false;
+    *width = hdr.width;
+    *height = hdr.height;
+    *bitsPerPixel = hdr.bitsPerPixel;
+    if (hdr.bitsPerPixel > 8)
+        *pf = hdr.pf;
+    return true;
+}
+
+/****************************************************************************
+DESCRIPTION:
+Obtain the dimensions of a native MGL surface file.
+
+HEADER:
+mgraph.h
+
+PARAMETERS:
+surfaceName     - Name of the surface file
+width           - Place to store the surface width
+height          - Place to store the surface height
+bitsPerPixel    - Place to store the surface pixel depth
+pf              - Place to store the surface pixel format
+
+RETURNS:
+True if the surface file was found, otherwise false.
+
+REMARKS:
+This function reads the header of a surface file written by
+MGL_saveSurface and returns its dimensions and pixel format. The pixel
+format is only filled in for surfaces with more than 8 bits per pixel.
+
+SEE ALSO:
+MGL_loadSurface, MGL_getSurfaceSizeExt
+****************************************************************************/
+ibool MGLAPI MGL_getSurfaceSize(
+    const char *surfaceName,
+    int *width,
+    int *height,
+    int *bitsPerPixel,
+    pixel_format_t *pf)
+{
+    FILE    *f;
+    ibool   ret;
+
+    __MGL_result = grOK;
+    if ((f = _MGL_openFile(MGL_BITMAPS, surfaceName, "rb")) == NULL) {
+        __MGL_result = grBitmapNotFound;
+        return false;
+        }
+    ret = MGL_getSurfaceSizeExt(f,0,_MGL_fileSize(f),width,height,bitsPerPixel,pf);
+    __MGL_fclose(f);
+    return ret;
+}
+
+/****************************************************************************
+DESCRIPTION:
+Loads a native MGL surface file into a device context from an open file.
+
+HEADER:
+mgraph.h
+
+PARAMETERS:
+dc          - Device context to load surface into
+f           - Pointer to opened surface file
+dwOffset    - Offset into the file
+dwSize      - Size of the surface file
+dstLeft     - Left coordinate to place surface at
+dstTop      - Top coordinate to place surface at
+loadPalette - Should we load the palette values as well?
+
+RETURNS:
+True if the surface was successfully loaded.
+
+REMARKS:
+This function is the same as MGL_loadSurfaceIntoDC, however it works with
+a previously opened file. This allows you to create your own large files
+with multiple files embedded in them.
+
+SEE ALSO:
+MGL_loadSurfaceIntoDC
+****************************************************************************/
+ibool MGLAPI MGL_loadSurfaceIntoDCExt(
+    MGLDC *dc,
+    FILE *f,
+    ulong dwOffset,
+    ulong dwSize,
+    int dstLeft,
+    int dstTop,
+    ibool loadPalette)
+{
+    MGSHEADER   hdr;
+    palette_t   pal[256];
+    bitmap_t    band;
+    uchar       *data = NULL,*buf;
+    ulong       blockSize,size,offset;
+    int         y,rows,blockRows;
+    ibool       oldCheckId,ok = true;
+
+    if (!readSurfaceHeader(&hdr,pal,f,dwOffset,dwSize))
+        return false;
+
+    /* Allocate a band buffer for one block of scanlines, plus a buffer for
+     * the compressed data of each block.
+     */
+    blockRows = (hdr.flags & MGS_LZ) ? hdr.blockRows : (int)MAX(1,MGS_BLOCK_SIZE / hdr.bytesPerLine);
+    blockRows = MIN(blockRows,hdr.height);
+    blockSize = (ulong)blockRows * hdr.bytesPerLine;
+    if ((buf = PM_malloc(blockSize)) == NULL) {
+        FATALERROR(grNoMem);
+        return false;
+        }
+    if ((hdr.flags & MGS_LZ) && (data = PM_malloc(hdr.dataSize)) == NULL) {
+        PM_free(buf);
+        FATALERROR(grNoMem);
+        return false;
+        }
+    initBitmapHeader(&band,&hdr);
+    band.surface = buf;
+    band.pal = hdr.palSize ? pal : NULL;
+    band.pf = &hdr.pf;
+    oldCheckId = MGL_checkIdentityPalette(false);
+
+    /* Store the palette in the destination DC */
+    if (loadPalette && hdr.palSize) {
+        MGL_setPalette(dc,pal,hdr.palSize,0);
+        if (MGL_getVisualPage(dc) == MGL_getActivePage(dc))
+            MGL_realizePalette(dc,hdr.palSize,0,false);
+        }
+    else if (loadPalette && ((dc->mi.modeFlags & MGL_IS_COLOR_INDEX) && hdr.bitsPerPixel > 8)) {
+        MGL_getHalfTonePalette(pal);
+        MGL_setPalette(dc,pal,MGL_getPaletteSize(dc),0);
+        if (MGL_getVisualPage(dc) == MGL_getActivePage(dc))
+            MGL_realizePalette(dc,MGL_getPaletteSize(dc),0,false);
+        }
+
+    /* Decode the surface a block of scanlines at a time and blit each block
+     * to the destination, which is a straight copy when the device context
+     * has the same pixel format as the surface.
+     */
+    if (data && __MGL_fread(data,1,hdr.dataSize,f) != hdr.dataSize)
+        ok = false;
+    offset = ((ulong)hdr.height + blockRows - 1) / blockRows * 4;
+    for (y = 0; ok && y < hdr.height; y += blockRows) {
+        rows = MIN(blockRows,hdr.height - y);
+        band.height = rows;
+        blockSize = (ulong)rows * hdr.bytesPerLine;
+        if (data) {
+            size = getLELong(data[(y / blockRows) * 4]);
+            if (offset + (size & ~MGS_STORED) > hdr.dataSize)
+                ok = false;
+            else if (size & MGS_STORED) {
+                if ((size & ~MGS_STORED) != blockSize)
+                    ok = false;
+                else
+                    memcpy(buf,data + offset,blockSize);
+                }
+            else
+                ok = decompressBlock(data + offset,size,buf,blockSize);
+            offset += size & ~MGS_STORED;
+            }
+        else if (__MGL_fread(buf,1,blockSize,f) != blockSize)
+            ok = false;
+        if (ok)
+            MGL_putBitmap(dc,dstLeft,dstTop+y,&band,MGL_REPLACE_MODE);
+        }
+    PM_free(data);
+    PM_free(buf);
+    MGL_checkIdentityPalette(oldCheckId);
+    if (!ok)
+        __MGL_result = grInvalidBitmap;
+    return ok;
+}
+
+/****************************************************************************
+DESCRIPTION:
+Loads a native MGL surface file directly into an existing device context.
+
+HEADER:
+mgraph.h
+
+PARAMETERS:
+dc          - Device context to load surface into
+surfaceName - Name of surface file to load
+dstLeft     - Left coordinate to load surface at
+dstTop      - Top coordinate to load surface at
+loadPalette - True if the palette should also be loaded
+
+RETURNS:
+True if the surface was loaded, false on error.
+
+REMARKS:
+Locates the specified surface file and loads it into the specified device
+context at the specified destination coordinates. The surface is
+decompressed a block of scanlines at a time, and each block is blitted to
+the device context as soon as it is ready, so a full size copy of the
+image is never needed. When the device context has the same pixel format
+as the surface (such as a memory device context created for the asset),
+each block is simply copied into place. If the pixel formats differ, the
+surface is converted to the pixel format of the device context as it is
+loaded.
+
+If loadPalette is true, the palette values for the surface will be loaded
+and stored in the device context's palette. If the device context being
+loaded into is the currently active display device, the palette will also
+be realized before the surface is loaded.
+
+SEE ALSO:
+MGL_loadSurface, MGL_saveSurface, MGL_loadSurfaceIntoDCExt
+****************************************************************************/
+ibool MGLAPI MGL_loadSurfaceIntoDC(
+    MGLDC *dc,
+    const char *surfaceName,
+    int dstLeft,
+    int dstTop,
+    ibool loadPalette)
+{
+    FILE    *f;
+    ibool   ret;
+
+    __MGL_result = grOK;
+    if ((f = _MGL_openFile(MGL_BITMAPS, surfaceName, "rb")) == NULL) {
+        __MGL_result = grBitmapNotFound;
+        return false;
+        }
+    ret = MGL_loadSurfaceIntoDCExt(dc,f,0,_MGL_fileSize(f),dstLeft,dstTop,loadPalette);
+    __MGL_fclose(f);
+    return ret;
+}
+
+/****************************************************************************
+PARAMETERS:
+p       - Data to write
+size    - Number of bytes to write
+f       - File to write to
+
+RETURNS:
+True if all the data was written, false on error.
+****************************************************************************/
+static ibool writeBytes(
+    const void *p,
+    long size,
+    FILE *f)
+{
+    return size == 0 || __MGL_fwrite(p,1,size,f) == (size_t)size;
+}
+
+/****************************************************************************
+DESCRIPTION:
+Save a bitmap to a native MGL surface file on disk.
+
+HEADER:
+mgraph.h
+
+PARAMETERS:
+surfaceName - Name of surface file to save
+bitmap      - Bitmap to save
+compress    - True to compress the pixel data
+
+RETURNS:
+True on success, false on error.
+
+REMARKS:
+This function saves a lightweight bitmap to disk in the MGL's native
+surface file format, which can be loaded again with MGL_loadSurface,
+MGL_mapSurface and MGL_loadSurfaceIntoDC. The bitmap is stored in exactly
+the same pixel format as it is in memory, including the palette for color
+index bitmaps, and each scanline is padded out to a multiple of 64 bytes so
+that loaded surfaces are suitably aligned for fast blitting. To save
+the contents of a device context, use MGL_getBitmapFromDC to grab a
+bitmap of the area to save first.
+
+If compress is true the pixel data is compressed with a very fast LZ
+compressor. Compression works well for typical user interface artwork and
+sprites with large areas of flat color, and decompression is usually
+faster than reading the uncompressed data from disk. Uncompressed files
+can be mapped directly into memory with MGL_mapSurface, which is the
+fastest way to load very large surfaces. If the pixel data in a block of
+scanlines does not compress, it is stored uncompressed.
+
+Surfaces are saved in the native memory layout of the machine, and the
+bytesPerLine field of the bitmap may be negative for bottom up bitmaps
+such as those returned by MGL_mapBitmap.
+
+SEE ALSO:
+MGL_loadSurface, MGL_mapSurface, MGL_getBitmapFromDC
+****************************************************************************/
+ibool MGLAPI MGL_saveSurface(
+    const char *surfaceName,
+    const bitmap_t *bitmap,
+    ibool compress)
+{
+    FILE        *f;
+    MGSHEADER   hdr;
+    uchar       pad[MGS_ALIGN],*block = NULL,*out = NULL,*table = NULL;
+    ulong       *hash = NULL;
+    long        pitch,rowBytes,size,dataSize;
+    int         y,i,rows,blockRows,numBlocks,palSize = 0;
+    ibool       ok = true;
+
+    /* Build the file header */
+    __MGL_result = grOK;
+    rowBytes = scanlineBytes(bitmap->width,bitmap->bitsPerPixel);
+    pitch = (rowBytes + MGS_ALIGN-1) & ~(MGS_ALIGN-1);
+    if (bitmap->bitsPerPixel <= 8 && bitmap->pal)
+        palSize = 1 << bitmap->bitsPerPixel;
+    blockRows = (int)MAX(1,MGS_BLOCK_SIZE / pitch);
+    numBlocks = (bitmap->height + blockRows - 1) / blockRows;
+    memset(&hdr,0,sizeof(hdr));
+    memcpy(hdr.id,MGS_ID,4);
+    putLELong(hdr.headerSize,sizeof(MGSHEADER));
+    putLEShort(hdr.version,MGS_VERSION);
+    putLEShort(hdr.flags,compress ? MGS_LZ : 0);
+    putLELong(hdr.width,bitmap->width);
+    putLELong(hdr.height,bitmap->height);
+    putLELong(hdr.bitsPerPixel,bitmap->bitsPerPixel);
+    putLELong(hdr.bytesPerLine,pitch);
+    putLELong(hdr.palSize,palSize);
+    size = (sizeof(MGSHEADER) + palSize * sizeof(palette_t) + MGS_ALIGN-1) & ~(MGS_ALIGN-1);
+    putLELong(hdr.dataOffset,size);
+    putLELong(hdr.blockRows,compress ? blockRows : 0);
+    if (bitmap->bitsPerPixel > 8 && bitmap->pf)
+        hdr.pf = *bitmap->pf;
+
+    /* Allocate the buffers for assembling and compressing each block */
+    if ((block = PM_calloc(1,(long)blockRows * pitch)) == NULL)
+        goto NoMem;
+    if (compress) {
+        size = (long)blockRows * pitch;
+        if ((out = PM_malloc(size + size / 255 + 16)) == NULL)
+            goto NoMem;
+        if ((hash = PM_malloc(LZ_HASH_SIZE * sizeof(ulong))) == NULL)
+            goto NoMem;
+        if ((table = PM_calloc(numBlocks,4)) == NULL)
+            goto NoMem;
+        }
+
+    /* Write the header, palette and block table, and pad the file out to
+     * the start of the pixel data.
+     */
+    if ((f = __MGL_fopen(surfaceName,"wb")) == NULL) {
+        __MGL_result = grBitmapNotFound;
+        ok = false;
+        goto Done;
+        }
+    memset(pad,0,sizeof(pad));
+    size = getLELong(hdr.dataOffset) - sizeof(hdr) - palSize * sizeof(palette_t);
+    ok = writeBytes(&hdr,sizeof(hdr),f)
+        && writeBytes(bitmap->pal,palSize * sizeof(palette_t),f)
+        && writeBytes(pad,size,f);
+    dataSize = 0;
+    if (compress) {
+        ok = ok && writeBytes(table,numBlocks * 4,f);
+        dataSize = numBlocks * 4;
+        }
+
+    /* Write out each block of scanlines */
+    for (y = 0; ok && y < bitmap->height; y += blockRows) {
+        rows = MIN(blockRows,bitmap->height - y);
+        for (i = 0; i < rows; i++)
+            memcpy(block + i * pitch,(uchar*)bitmap->surface + (long)(y+i) * bitmap->bytesPerLine,rowBytes);
+        size = (long)rows * pitch;
+        if (compress) {
+            long n = compressBlock(block,size,out,hash);
+            if (n < size) {
+                putLELong(table[(y / blockRows) * 4],n);
+                ok = writeBytes(out,n,f);
+                size = n;
+                }
+            else {
+                putLELong(table[(y / blockRows) * 4],size | MGS_STORED);
+                ok = writeBytes(block,size,f);
+                }
+            }
+        else
+            ok = writeBytes(block,size,f);
+        dataSize += size;
+        }
+
+    /* Go back and fill in the data size and block table */
+    putLELong(hdr.dataSize,dataSize);
+    if (ok) {
+        __MGL_fseek(f,0,SEEK_SET);
+        ok = writeBytes(&hdr,sizeof(hdr),f);
+        }
+    if (ok && compress) {
+        __MGL_fseek(f,getLELong(hdr.dataOffset),SEEK_SET);
+        ok = writeBytes(table,numBlocks * 4,f);
+        }
+    if (__MGL_fclose(f) != 0)
+        ok = false;
+    if (!ok)
+        __MGL_result = grError;
+    goto Done;
+
+NoMem:
+    FATALERROR(grNoMem);
+    ok = false;
+
+Done:
+    PM_free(table);
+    PM_free(hash);
+    PM_free(out);
+    PM_free(block);
+    return ok;
+}
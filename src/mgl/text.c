@@ -365,6 +365,8 @@ void MGLAPI MGL_drawStrXY(
 {
     if (DC.a.ts.font == NULL) return;
 
+    if (DC.dirtyRegion)
+        _MGL_markTextDirty(x,y,MGL_textWidth(str));
     BEGIN_VISIBLE_CLIP_LIST(&DC);
     switch (DC.a.ts.font->fontType & MGL_FONTTYPEMASK) {
         case MGL_VECTORFONT:
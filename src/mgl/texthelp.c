@@ -75,14 +75,14 @@ int __MGL_charWidth(
             glyph = ch - BITFONT(font)->startGlyph;
             if (glyph < 0)
                 return 0;
-            if ((glyph < BITFONT(font)->numGlyphs) && !BITFONT(font)->valid[glyph])
+            if ((glyph < BITFONT(font)->numGlyphs) && !BIT_METRICS(font,glyph)->valid)
                 _MGL_generateGlyph(glyph,BITFONT(font));
             if ((glyph >= BITFONT(font)->numGlyphs) ||
                 (ch < BITFONT(font)->startGlyph) ||
                 (BIT_ISMISSING(font,glyph)))
-                return BITFONT(font)->width[BIT_MISSINGSYMBOL(font)] + DC.a.ts.spaceExtra;
+                return BIT_METRICS(font,BIT_MISSINGSYMBOL(font))->width + DC.a.ts.spaceExtra;
             else
-                return BITFONT(font)->width[glyph] + DC.a.ts.spaceExtra;
+                return BIT_METRICS(font,glyph)->width + DC.a.ts.spaceExtra;
         default:
             return 0;
         }
@@ -151,6 +151,33 @@ void __MGL_findTextBounds(
         }
 }
 
+/****************************************************************************
+PARAMETERS:
+x       - x coordinate string is drawn at (viewport space)
+y       - y coordinate string is drawn at (viewport space)
+width   - Width of the string
+
+REMARKS:
+Internal function to add the area covered by a text string to the dirty
+region for the current device context. The bounding box is padded by the
+maximum character width and the text height, since glyphs with kerning or
+overhang, and scaled vector fonts, can draw outside the nominal bounds.
+{secret}
+****************************************************************************/
+void _MGL_markTextDirty(
+    int x,
+    int y,
+    int width)
+{
+    rect_t  r;
+    int     padx,pady;
+
+    __MGL_findTextBounds(x,y,width,&r);
+    padx = MGL_maxCharWidth();
+    pady = MGL_textHeight();
+    _MGL_markDirtyView(&DC,r.left-padx,r.top-pady,r.right+padx,r.bottom+pady);
+}
+
 /****************************************************************************
 PARAMETERS:
 ch      - Character to measure
@@ -169,6 +196,7 @@ void __MGL_getCharMetrics(
     text_settings_t ts = DC.a.ts;
     font_t          *font = ts.font;
     vector          *vec;
+    glyph_metrics   *gm;
 
     if (font == NULL) return;
 
@@ -204,13 +232,16 @@ void __MGL_getCharMetrics(
         case MGL_PROPFONT:
         case MGL_FIXEDFONT:
             glyph = ch - BITFONT(font)->startGlyph;
-            m->width = BITFONT(font)->width[glyph];
-            m->fontWidth = BITFONT(font)->iwidth[glyph];
-            m->ascent = BITFONT(font)->charAscent[glyph];
-            m->descent = BITFONT(font)->charDescent[glyph];
+            if ((glyph < 0) || (glyph >= BITFONT(font)->numGlyphs))
+                glyph = BIT_MISSINGSYMBOL(font);
+            gm = BIT_METRICS(font,glyph);
+            m->width = gm->width;
+            m->fontWidth = gm->iwidth;
+            m->ascent = gm->charAscent;
+            m->descent = gm->charDescent;
             m->leading = font->leading;
             m->fontHeight = m->ascent - m->descent + 1;
-            m->kern = -BITFONT(font)->loc[glyph];
+            m->kern = -gm->loc;
             break;
         default:
             m->width = font->maxWidth;
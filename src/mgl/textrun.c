@@ -0,0 +1,381 @@
+/****************************************************************************
+*
+*                   SciTech Multi-platform Graphics Library
+*
+*  ========================================================================
+*
+*   Copyright (C) 1991-2004 SciTech Software, Inc. All rights reserved.
+*
+*   This file may be distributed and/or modified under the terms of the
+*   GNU General Public License version 2.0 as published by the Free
+*   Software Foundation and appearing in the file LICENSE.GPL included
+*   in the packaging of this file.
+*
+*   Licensees holding a valid Commercial License for this product from
+*   SciTech Software, Inc. may use this file in accordance with the
+*   Commercial License Agreement provided with the Software.
+*
+*   This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING
+*   THE WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+*   PURPOSE.
+*
+*   See http://www.scitechsoft.com/license/ for information about
+*   the licensing options available and how to purchase a Commercial
+*   License Agreement.
+*
+*   Contact license@scitechsoft.com if any conditions of this licensing
+*   are not clear to you, or you have questions about licensing options.
+*
+*  ========================================================================
+*
+*
+* Language:     ANSI C
+* Environment:  Any
+*
+* Description:  Cache of recently drawn text runs. Horizontal strings in
+*               bitmap and TrueType fonts are composited into a single mono
+*               or coverage mask before they are drawn, and the masks for
+*               recently drawn strings are kept in a cache keyed by the
+*               font, the extra character spacing and the glyph codes, so
+*               static labels can be drawn again without compositing them.
+*               The cache is disabled by default, and the least recently
+*               used runs are evicted when it grows past its memory budget.
+*
+****************************************************************************/
+
+#include "mgl.h"
+
+/*--------------------------- Global Variables ----------------------------*/
+
+#define RUN_HASH_SIZE       1024        /* Number of hash table buckets    */
+
+/* {secret} */
+typedef struct runEntry {
+    struct runEntry *hashNext;          /* Next entry in the hash chain    */
+    struct runEntry *lruPrev;           /* Previous (more recently used)   */
+    struct runEntry *lruNext;           /* Next (less recently used)       */
+    font_t          *font;              /* Font the run was drawn with     */
+    int             spaceExtra;         /* Extra spacing between glyphs    */
+    int             count;              /* Number of glyph codes           */
+    ulong           hash;               /* Hash value for the key          */
+    ulong           bytes;              /* Total memory used by the entry  */
+    uint            *codes;             /* Glyph codes for the run         */
+    text_run        run;                /* Run metrics and mask            */
+    } runEntry;
+
+static runEntry     **hashTable = NULL;
+static runEntry     *lruHead = NULL;
+static runEntry     *lruTail = NULL;
+static ulong        budget = 0;
+static ulong        bytesUsed = 0;
+static uchar        *runBuf = NULL;
+static long         runBufSize = 0;
+
+/*------------------------- Implementation --------------------------------*/
+
+/****************************************************************************
+PARAMETERS:
+font        - Font the run is drawn with
+spaceExtra  - Extra spacing between glyphs
+codes       - Glyph codes for the run
+count       - Number of glyph codes
+
+RETURNS:
+Hash value for the run key.
+****************************************************************************/
+static ulong hashRun(
+    font_t *font,
+    int spaceExtra,
+    const uint *codes,
+    int count)
+{
+    ulong   hash = 2166136261UL;
+    int     i;
+
+    hash = (hash ^ (ulong)font) * 16777619UL;
+    hash = (hash ^ (ulong)spaceExtra) * 16777619UL;
+    for (i = 0; i < count; i++)
+        hash = (hash ^ (ulong)codes[i]) * 16777619UL;
+    return hash & 0xFFFFFFFFUL;
+}
+
+/****************************************************************************
+PARAMETERS:
+e   - Entry to unlink
+
+REMARKS:
+Removes an entry from the LRU list.
+****************************************************************************/
+static void lruRemove(
+    runEntry *e)
+{
+    if (e->lruPrev)
+        e->lruPrev->lruNext = e->lruNext;
+    else
+        lruHead = e->lruNext;
+    if (e->lruNext)
+        e->lruNext->lruPrev = e->lruPrev;
+    else
+        lruTail = e->lruPrev;
+}
+
+/****************************************************************************
+PARAMETERS:
+e   - Entry to link
+
+REMARKS:
+Adds an entry to the head of the LRU list as the most recently used entry.
+****************************************************************************/
+static void lruAdd(
+    runEntry *e)
+{
+    e->lruPrev = NULL;
+    e->lruNext = lruHead;
+    if (lruHead)
+        lruHead->lruPrev = e;
+    else
+        lruTail = e;
+    lruHead = e;
+}
+
+/****************************************************************************
+PARAMETERS:
+e   - Entry to free
+
+REMARKS:
+Removes a run from the cache and frees it.
+****************************************************************************/
+static void freeEntry(
+    runEntry *e)
+{
+    runEntry    **prev;
+
+    for (prev = &hashTable[e->hash & (RUN_HASH_SIZE-1)]; *prev != e; prev = &(*prev)->hashNext)
+        ;
+    *prev = e->hashNext;
+    lruRemove(e);
+    bytesUsed -= e->bytes;
+    PM_free(e);
+}
+
+/****************************************************************************
+PARAMETERS:
+font        - Font the run is drawn with
+spaceExtra  - Extra spacing between glyphs
+codes       - Glyph codes for the run
+count       - Number of glyph codes
+
+RETURNS:
+Pointer to the cached text run, or NULL if the run is not cached.
+
+REMARKS:
+Looks up a previously composited text run in the cache, and marks it as
+the most recently used run.
+{secret}
+****************************************************************************/
+text_run *_MGL_findTextRun(
+    font_t *font,
+    int spaceExtra,
+    const uint *codes,
+    int count)
+{
+    runEntry    *e;
+    ulong       hash;
+
+    if (!hashTable)
+        return NULL;
+    hash = hashRun(font,spaceExtra,codes,count);
+    for (e = hashTable[hash & (RUN_HASH_SIZE-1)]; e; e = e->hashNext) {
+        if (e->hash == hash && e->font == font && e->spaceExtra == spaceExtra
+                && e->count == count && memcmp(e->codes,codes,count * sizeof(uint)) == 0) {
+            if (e != lruHead) {
+                lruRemove(e);
+                lruAdd(e);
+                }
+            return &e->run;
+            }
+        }
+    return NULL;
+}
+
+/****************************************************************************
+PARAMETERS:
+font        - Font the run is drawn with
+spaceExtra  - Extra spacing between glyphs
+codes       - Glyph codes for the run
+count       - Number of glyph codes
+maskSize    - Size of the run mask in bytes
+
+RETURNS:
+Pointer to the new text run with a zeroed mask, or NULL if the run cannot be
+cached.
+
+REMARKS:
+Adds a new text run to the cache, evicting the least recently used runs if
+necessary to stay within the memory budget. The run must not already be in
+the cache, and the caller composites the run directly into the mask and
+fills in the run metrics. NULL is returned if the cache is disabled, or the
+run is larger than the cache budget.
+{secret}
+****************************************************************************/
+text_run *_MGL_addTextRun(
+    font_t *font,
+    int spaceExtra,
+    const uint *codes,
+    int count,
+    long maskSize)
+{
+    runEntry    *e;
+    ulong       bytes = sizeof(runEntry) + count * sizeof(uint) + maskSize;
+
+    if (bytes > budget)
+        return NULL;
+    if (!hashTable && (hashTable = PM_calloc(RUN_HASH_SIZE,sizeof(runEntry*))) == NULL)
+        return NULL;
+    while (lruTail && bytesUsed + bytes > budget)
+        freeEntry(lruTail);
+    if ((e = PM_malloc(bytes)) == NULL)
+        return NULL;
+    e->font = font;
+    e->spaceExtra = spaceExtra;
+    e->count = count;
+    e->hash = hashRun(font,spaceExtra,codes,count);
+    e->bytes = bytes;
+    e->codes = (uint*)(e+1);
+    memcpy(e->codes,codes,count * sizeof(uint));
+    e->run.mask = (uchar*)(e->codes + count);
+    memset(e->run.mask,0,maskSize);
+    e->hashNext = hashTable[e->hash & (RUN_HASH_SIZE-1)];
+    hashTable[e->hash & (RUN_HASH_SIZE-1)] = e;
+    lruAdd(e);
+    bytesUsed += bytes;
+    return &e->run;
+}
+
+/****************************************************************************
+PARAMETERS:
+size    - Size of the buffer needed in bytes
+
+RETURNS:
+Pointer to the zeroed buffer, or NULL if out of memory.
+
+REMARKS:
+Returns a buffer to composite a text run into when the run is not being
+cached. The MGL scratch buffer cannot be used for this, as it is used to
+rasterise the glyphs while the run is composited. The buffer is kept and
+grown as necessary for the next run.
+{secret}
+****************************************************************************/
+uchar *_MGL_getTextRunBuffer(
+    long size)
+{
+    if (size > runBufSize) {
+        if (runBuf)
+            PM_free(runBuf);
+        if ((runBuf = PM_malloc(size)) == NULL) {
+            runBufSize = 0;
+            return NULL;
+            }
+        runBufSize = size;
+        }
+    if (runBuf)
+        memset(runBuf,0,size);
+    return runBuf;
+}
+
+/****************************************************************************
+PARAMETERS:
+font    - Font to flush the text runs for
+
+REMARKS:
+Removes all the text runs for a font from the cache. This is called when a
+font is unloaded, so that a new font allocated at the same address cannot
+find the old runs.
+{secret}
+****************************************************************************/
+void _MGL_flushTextRuns(
+    font_t *font)
+{
+    runEntry    *e,*next;
+
+    for (e = lruHead; e; e = next) {
+        next = e->lruNext;
+        if (e->font == font)
+            freeEntry(e);
+        }
+}
+
+/****************************************************************************
+DESCRIPTION:
+Sets the memory budget for the text run cache.
+
+HEADER:
+mgraph.h
+
+PARAMETERS:
+maxBytes    - Maximum number of bytes of memory to use for cached text runs
+
+REMARKS:
+Horizontal strings drawn with bitmap and TrueType fonts over a transparent
+background are composited into a single mask before they are drawn, so the
+string is clipped and drawn in one operation rather than one glyph at a
+time. If the text run cache is enabled, the masks for recently drawn
+strings are kept in the cache, and drawing the same string again in the
+same font simply draws the cached mask. This makes a big difference for
+applications that draw many static labels every frame.
+
+The text run cache is disabled by default. This function enables the cache
+with the specified memory budget, or disables it and frees all the cached
+runs if maxBytes is 0. When the cache grows past its memory budget, the
+least recently used runs are freed.
+
+SEE ALSO:
+MGL_flushTextRunCache, MGL_drawStr, MGL_setGlyphCacheSize
+****************************************************************************/
+void MGLAPI MGL_setTextRunCacheSize(
+    ulong maxBytes)
+{
+    budget = maxBytes;
+    while (lruTail && bytesUsed > budget)
+        freeEntry(lruTail);
+}
+
+/****************************************************************************
+DESCRIPTION:
+Frees all the text runs in the text run cache.
+
+HEADER:
+mgraph.h
+
+REMARKS:
+This function frees all the composited text runs in the text run cache.
+Strings will be composited again the next time they are drawn.
+
+SEE ALSO:
+MGL_setTextRunCacheSize
+****************************************************************************/
+void MGLAPI MGL_flushTextRunCache(void)
+{
+    while (lruHead)
+        freeEntry(lruHead);
+}
+
+/****************************************************************************
+REMARKS:
+Frees all the memory used by the text run cache when the MGL is shut down.
+{secret}
+****************************************************************************/
+void _MGL_destroyTextRunCache(void)
+{
+    MGL_flushTextRunCache();
+    if (hashTable) {
+        PM_free(hashTable);
+        hashTable = NULL;
+        }
+    if (runBuf) {
+        PM_free(runBuf);
+        runBuf = NULL;
+        }
+    runBufSize = 0;
+    budget = 0;
+}
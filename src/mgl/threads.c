@@ -0,0 +1,234 @@
+/****************************************************************************
+*
+*                   SciTech Multi-platform Graphics Library
+*
+*  ========================================================================
+*
+*   Copyright (C) 1991-2004 SciTech Software, Inc. All rights reserved.
+*
+*   This file may be distributed and/or modified under the terms of the
+*   GNU General Public License version 2.0 as published by the Free
+*   Software Foundation and appearing in the file LICENSE.GPL included
+*   in the packaging of this file.
+*
+*   Licensees holding a valid Commercial License for this product from
+*   SciTech Software, Inc. may use this file in accordance with the
+*   Commercial License Agreement provided with the Software.
+*
+*   This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING
+*   THE WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+*   PURPOSE.
+*
+*   See http://www.scitechsoft.com/license/ for information about
+*   the licensing options available and how to purchase a Commercial
+*   License Agreement.
+*
+*   Contact license@scitechsoft.com if any conditions of this licensing
+*   are not clear to you, or you have questions about licensing options.
+*
+*  ========================================================================
+*
+* Language:     ANSI C
+* Environment:  Any
+*
+* Description:  Band worker thread pool. Large software blits between
+*               system memory surfaces are split into horizontal bands
+*               that are processed in parallel by a small pool of worker
+*               threads, with the calling thread processing the first
+*               band itself. The OS specific thread and event primitives
+*               are provided by the platform binding code, and on
+*               systems without threads the pool is never created so
+*               everything simply runs on the calling thread.
+*
+****************************************************************************/
+
+#include "mgl.h"
+
+/*--------------------------- Global Variables ----------------------------*/
+
+#define MAX_BAND_THREADS    32
+#define DEF_BAND_THRESHOLD  (256L * 256L)
+
+typedef struct {
+    void        *start;         /* Event signalled to start a band      */
+    void        *done;          /* Event signalled when band is done    */
+    int         top;            /* Top scanline of band to process      */
+    int         bottom;         /* Bottom scanline of band to process   */
+    } bandWorker;
+
+static int          numWorkers = 0;
+static long         threshold = DEF_BAND_THRESHOLD;
+static bandWorker   workers[MAX_BAND_THREADS];
+static bandFunc     jobFunc;
+static void         *jobCtx;
+static ibool        exiting = false;
+
+/*------------------------- Implementation --------------------------------*/
+
+/****************************************************************************
+PARAMETERS:
+arg - Pointer to the worker structure for this thread
+
+REMARKS:
+Main loop for each worker thread. The thread sleeps until it is handed a
+band to process, and exits when the pool is destroyed.
+****************************************************************************/
+static void workerThread(
+    void *arg)
+{
+    bandWorker  *w = (bandWorker*)arg;
+
+    for (;;) {
+        _MGL_waitEvent(w->start);
+        if (exiting)
+            break;
+        jobFunc(jobCtx,w->top,w->bottom);
+        _MGL_signalEvent(w->done);
+        }
+    _MGL_signalEvent(w->done);
+}
+
+/****************************************************************************
+REMARKS:
+Shuts down all the worker threads in the pool and frees the events.
+****************************************************************************/
+void _MGL_destroyBandThreads(void)
+{
+    int i;
+
+    exiting = true;
+    for (i = 0; i < numWorkers; i++)
+        _MGL_signalEvent(workers[i].start);
+    for (i = 0; i < numWorkers; i++) {
+        _MGL_waitEvent(workers[i].done);
+        _MGL_destroyEvent(workers[i].start);
+        _MGL_destroyEvent(workers[i].done);
+        }
+    numWorkers = 0;
+    exiting = false;
+}
+
+/****************************************************************************
+PARAMETERS:
+pixels  - Number of pixels that will be touched by the operation
+
+RETURNS:
+True if the operation should be split into bands across the worker threads.
+****************************************************************************/
+ibool _MGL_useBandThreads(
+    long pixels)
+{
+    return (numWorkers > 0 && pixels >= threshold);
+}
+
+/****************************************************************************
+PARAMETERS:
+top     - Top scanline of the area to process
+bottom  - Bottom scanline of the area to process (exclusive)
+func    - Function to call to process each band
+ctx     - Context pointer passed to the band function
+
+REMARKS:
+Splits the scanlines from top to bottom into equal sized bands and calls
+the band function for each of them in parallel, returning once all the
+bands have been completed. The first band is processed on the calling
+thread. If the pool has not been created this simply calls the band
+function once for the entire area.
+****************************************************************************/
+void _MGL_runBands(
+    int top,
+    int bottom,
+    bandFunc func,
+    void *ctx)
+{
+    int i,count,height = bottom - top;
+
+    count = MIN(numWorkers+1,height);
+    if (count <= 1) {
+        func(ctx,top,bottom);
+        return;
+        }
+    jobFunc = func;
+    jobCtx = ctx;
+    for (i = 1; i < count; i++) {
+        workers[i-1].top = top + (int)(((long)height * i) / count);
+        workers[i-1].bottom = top + (int)(((long)height * (i+1)) / count);
+        _MGL_signalEvent(workers[i-1].start);
+        }
+    func(ctx,top,top + height / count);
+    for (i = 1; i < count; i++)
+        _MGL_waitEvent(workers[i-1].done);
+}
+
+/****************************************************************************
+DESCRIPTION:
+Enables multi-threaded blitting for large memory device context blits.
+
+HEADER:
+mgraph.h
+
+PARAMETERS:
+numThreads  - Total number of threads to use (0 for one per processor)
+minPixels   - Minimum blit size in pixels to split across threads
+
+REMARKS:
+This function enables multi-threaded software blitting for large blit
+operations between memory device contexts. When enabled, MGL_bitBltCoord,
+MGL_stretchBltCoord, the MGL_putBitmap family of functions and the
+MGL_resampleBitmap family of functions will split any blit that touches at
+least minPixels pixels into horizontal bands, and process the bands in
+parallel using a pool of worker threads. Blits smaller than this are
+always processed on the calling thread, since the cost of handing out the
+work would outweigh any gain. If minPixels is 0, a default threshold of
+65536 pixels (256x256) is used.
+
+The calling thread always processes one of the bands itself, so passing
+a value of 1 for numThreads disables multi-threaded blitting, which is the
+default. Passing a value of 0 creates one thread for every processor in
+the system.
+
+Clipping, including complex clip regions, is applied exactly as it is for
+single threaded blits. Only blits in MGL_REPLACE_MODE between system memory
+surfaces are split across threads, including blits that use ordered
+dithering and alpha blended blits done in linear light (see
+MGL_setLinearLightMode). Blits that use error diffusion dithering always
+run on the calling thread, and all other blits fall back to the regular
+single threaded code.
+
+Note:   The MGL itself is not thread safe, so you must still only call
+        the MGL from a single thread. The worker threads are private to
+        the MGL and only ever touch the surfaces being blitted.
+
+Note:   This function is not supported on DOS, where threads are not
+        available, and the blits always run on the calling thread.
+
+SEE ALSO:
+MGL_bitBltCoord, MGL_stretchBltCoord, MGL_putBitmap, MGL_resampleBitmap
+****************************************************************************/
+void MGLAPI MGL_setBltThreads(
+    int numThreads,
+    long minPixels)
+{
+    bandWorker  *w;
+
+    _MGL_destroyBandThreads();
+    threshold = (minPixels > 0) ? minPixels : DEF_BAND_THRESHOLD;
+    if (numThreads <= 0)
+        numThreads = _MGL_numProcessors();
+    numThreads = MIN(numThreads,MAX_BAND_THREADS+1);
+    while (numWorkers < numThreads-1) {
+        w = &workers[numWorkers];
+        if ((w->start = _MGL_createEvent()) == NULL)
+            break;
+        if ((w->done = _MGL_createEvent()) == NULL) {
+            _MGL_destroyEvent(w->start);
+            break;
+            }
+        if (!_MGL_createThread(workerThread,w)) {
+            _MGL_destroyEvent(w->start);
+            _MGL_destroyEvent(w->done);
+            break;
+            }
+        numWorkers++;
+        }
+}
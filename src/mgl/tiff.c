@@ -33,13 +33,926 @@
 *
 * Description:  TIFF bitmap resource loading/unloading routines. We support
 *               loading and saving of 24-bit imagery files, since the TIFF
-*               format is RGB only. If you load a TIFF into an 8-bit device
+*               format is RGB only (files with an alpha channel are loaded
+*               as 32-bit ARGB bitmaps). If you load a TIFF into an 8-bit device
 *               context, it will be dithered. If you save a TIFF file from
 *               an 8bpp device context it will be converted to a 24-bit
 *               file when written to disk. Hence if you plan to edit TIFF
 *               files and then save the results to disk, do this with
 *               a 24-bpp display or memory DC for the best results.
 *
+*               Large strip or tile organised files are decoded in
+*               parallel on the band worker threads, with each worker
+*               opening its own handle on the file and decoding its own
+*               range of strips or tile rows. Files in formats that
+*               cannot be decoded a strip at a time are decoded on the
+*               calling thread with TIFFReadRGBAImage.
+*
 ****************************************************************************/
 
 #include "mgl.h"
+#include "tiffio.h"
+
+/*--------------------------- Global Variables ----------------------------*/
+
+#define TIFF_GROUP_PIXELS   (4096L * 4096L)
+
+#define TIFF_FALLBACK       0       /* Decoded with TIFFReadRGBAImage       */
+#define TIFF_RGB            1       /* 8-bit contiguous RGB(A) samples      */
+#define TIFF_LUT            2       /* 1-8 bit grayscale or palette samples */
+
+/* {secret} */
+typedef struct {
+    const char  *name;          /* Name of file for opening worker handles */
+    FILE        *f;             /* File for the main TIFF handle           */
+    TIFF        *tif;           /* Main TIFF handle                        */
+    int         width;          /* Image width                             */
+    int         height;         /* Image height                            */
+    int         kind;           /* Decode method (TIFF_*)                  */
+    int         bps;            /* Bits per sample                         */
+    int         spp;            /* Samples per pixel                       */
+    ibool       alpha;          /* True if the image has an alpha channel  */
+    ibool       assocAlpha;     /* True if the alpha is premultiplied      */
+    ibool       tiled;          /* True if the file is tile organised      */
+    int         blockWidth;     /* Tile width (image width for strips)     */
+    int         blockHeight;    /* Tile height or rows per strip           */
+    int         numBlockRows;   /* Number of strips or rows of tiles       */
+    M_uint32    lut[256];       /* Sample to RGB table for TIFF_LUT        */
+    uint32      *raster;        /* Decoded image for TIFF_FALLBACK         */
+    uchar       *dst;           /* Destination buffer for decoded rows     */
+    int         dstPitch;       /* Destination bytes per line              */
+    int         dstBytes;       /* Destination bytes per pixel (3 or 4)    */
+    int         firstBlock;     /* First block row decoded into dst        */
+    ibool       failed;         /* Set if any band failed to decode        */
+    } tiffImage;
+
+/*------------------------- Implementation --------------------------------*/
+
+/****************************************************************************
+PARAMETERS:
+module  - Name of the TIFF library module reporting the error
+fmt     - Format string for the error message
+ap      - Arguments for the format string
+
+REMARKS:
+TIFF error handling routine. The function is called when an error occurs,
+and allows us to dump the error message to a log file (for CHECKED builds)
+and return a failure condition to the caller. The TIFF library functions
+return error codes themselves, so we don't need to longjmp out.
+****************************************************************************/
+static void TIFFAPI my_tiff_error(
+    const char *module,
+    const char *fmt,
+    va_list ap)
+{
+#ifdef  CHECKED
+    FILE    *f;
+
+    if ((f = fopen("tiff.log","a+")) == NULL)
+        exit(1);
+    if (module)
+        fprintf(f,"%s: ",module);
+    vfprintf(f,fmt,ap);
+    fprintf(f,"\n");
+    fclose(f);
+#else
+    (void)module;
+    (void)fmt;
+    (void)ap;
+#endif
+    __MGL_result = grInvalidBitmap;
+}
+
+/****************************************************************************
+PARAMETERS:
+module  - Name of the TIFF library module reporting the warning
+fmt     - Format string for the warning message
+ap      - Arguments for the format string
+
+REMARKS:
+TIFF warning handling routine. Warnings are only logged for CHECKED builds.
+****************************************************************************/
+static void TIFFAPI my_tiff_warn(
+    const char *module,
+    const char *fmt,
+    va_list ap)
+{
+#ifdef  CHECKED
+    FILE    *f;
+
+    if ((f = fopen("tiff.log","a+")) == NULL)
+        exit(1);
+    if (module)
+        fprintf(f,"%s: ",module);
+    vfprintf(f,fmt,ap);
+    fprintf(f,"\n");
+    fclose(f);
+#else
+    (void)module;
+    (void)fmt;
+    (void)ap;
+#endif
+}
+
+/****************************************************************************
+REMARKS:
+Custom I/O functions. The TIFF library includes a mechanism for customizing
+how file I/O is handled, and these routines replace the default functions
+with the MGL file I/O (which can be replaced by the developer). The files
+are always closed by the MGL, so the close function does nothing and memory
+mapping is never used.
+****************************************************************************/
+static tsize_t TIFFAPI my_tiff_read(
+    thandle_t fd,
+    tdata_t buf,
+    tsize_t size)
+{
+    return __MGL_fread(buf,1,size,(FILE*)fd);
+}
+
+static tsize_t TIFFAPI my_tiff_write(
+    thandle_t fd,
+    tdata_t buf,
+    tsize_t size)
+{
+    return __MGL_fwrite(buf,1,size,(FILE*)fd);
+}
+
+static toff_t TIFFAPI my_tiff_seek(
+    thandle_t fd,
+    toff_t off,
+    int whence)
+{
+    __MGL_fseek((FILE*)fd,off,whence);
+    return __MGL_ftell((FILE*)fd);
+}
+
+static int TIFFAPI my_tiff_close(
+    thandle_t fd)
+{
+    (void)fd;
+    return 0;
+}
+
+static toff_t TIFFAPI my_tiff_size(
+    thandle_t fd)
+{
+    return _MGL_fileSize((FILE*)fd);
+}
+
+static int TIFFAPI my_tiff_map(
+    thandle_t fd,
+    tdata_t *base,
+    toff_t *size)
+{
+    (void)fd;
+    (void)base;
+    (void)size;
+    return 0;
+}
+
+static void TIFFAPI my_tiff_unmap(
+    thandle_t fd,
+    tdata_t base,
+    toff_t size)
+{
+    (void)fd;
+    (void)base;
+    (void)size;
+}
+
+/****************************************************************************
+PARAMETERS:
+f       - Open file to attach the TIFF handle to
+name    - Name of the file (for error messages)
+mode    - TIFF library open mode ("r" or "w")
+
+RETURNS:
+TIFF handle for the file, NULL on error.
+****************************************************************************/
+static TIFF *openTIFF(
+    FILE *f,
+    const char *name,
+    const char *mode)
+{
+    TIFFSetErrorHandler(my_tiff_error);
+    TIFFSetWarningHandler(my_tiff_warn);
+    return TIFFClientOpen(name,mode,(thandle_t)f,
+        my_tiff_read,my_tiff_write,my_tiff_seek,my_tiff_close,
+        my_tiff_size,my_tiff_map,my_tiff_unmap);
+}
+
+/****************************************************************************
+PARAMETERS:
+t   - TIFF image to build the lookup table for
+
+REMARKS:
+Builds the table used to convert 1-8 bit grayscale or palette samples to
+RGB. Some older files store 8-bit values in the color map rather than
+16-bit values, so we check for that and use the values as is.
+****************************************************************************/
+static void buildLUT(
+    tiffImage *t,
+    int photometric)
+{
+    uint16  *r,*g,*b;
+    int     i,shift,v,count = 1 << t->bps,max = count - 1;
+
+    if (photometric == PHOTOMETRIC_PALETTE) {
+        TIFFGetField(t->tif,TIFFTAG_COLORMAP,&r,&g,&b);
+        for (i = 0, shift = 0; i < count; i++) {
+            if (r[i] >= 256 || g[i] >= 256 || b[i] >= 256)
+                shift = 8;
+            }
+        for (i = 0; i < count; i++) {
+            t->lut[i] = ((M_uint32)(r[i] >> shift) << 16)
+                      | ((M_uint32)(g[i] >> shift) << 8)
+                      | (M_uint32)(b[i] >> shift);
+            }
+        }
+    else {
+        for (i = 0; i < count; i++) {
+            v = (i * 255 + max/2) / max;
+            if (photometric == PHOTOMETRIC_MINISWHITE)
+                v = 255 - v;
+            t->lut[i] = ((M_uint32)v << 16) | ((M_uint32)v << 8) | v;
+            }
+        }
+}
+
+/****************************************************************************
+PARAMETERS:
+t       - TIFF image to open
+name    - Name of the TIFF file to open
+
+RETURNS:
+True on success, false on error.
+
+REMARKS:
+Opens the TIFF file and reads the image information, and works out how the
+image will be decoded. Contiguous 8-bit RGB and 1-8 bit grayscale or palette
+images with the default orientation can be decoded a strip or tile at a
+time, and anything else is handled by TIFFReadRGBAImage.
+****************************************************************************/
+static ibool openImage(
+    tiffImage *t,
+    const char *name)
+{
+    uint32  width,height,rows,tileWidth,tileHeight;
+    uint16  bps,spp,photometric,planar,orientation,extraCount,*extraTypes;
+
+    memset(t,0,sizeof(*t));
+    t->name = name;
+    if ((t->f = _MGL_openFile(MGL_BITMAPS,name,"rb")) == NULL) {
+        __MGL_result = grBitmapNotFound;
+        return false;
+        }
+    if ((t->tif = openTIFF(t->f,name,"r")) == NULL) {
+        __MGL_fclose(t->f);
+        __MGL_result = grInvalidBitmap;
+        return false;
+        }
+    TIFFGetField(t->tif,TIFFTAG_IMAGEWIDTH,&width);
+    TIFFGetField(t->tif,TIFFTAG_IMAGELENGTH,&height);
+    TIFFGetFieldDefaulted(t->tif,TIFFTAG_BITSPERSAMPLE,&bps);
+    TIFFGetFieldDefaulted(t->tif,TIFFTAG_SAMPLESPERPIXEL,&spp);
+    TIFFGetFieldDefaulted(t->tif,TIFFTAG_PLANARCONFIG,&planar);
+    TIFFGetFieldDefaulted(t->tif,TIFFTAG_ORIENTATION,&orientation);
+    TIFFGetFieldDefaulted(t->tif,TIFFTAG_EXTRASAMPLES,&extraCount,&extraTypes);
+    if (!TIFFGetField(t->tif,TIFFTAG_PHOTOMETRIC,&photometric))
+        photometric = (spp >= 3) ? PHOTOMETRIC_RGB : PHOTOMETRIC_MINISBLACK;
+    t->width = width;
+    t->height = height;
+    t->bps = bps;
+    t->spp = spp;
+    if (extraCount > 0) {
+        t->alpha = (extraTypes[0] == EXTRASAMPLE_ASSOCALPHA || extraTypes[0] == EXTRASAMPLE_UNASSALPHA);
+        t->assocAlpha = (extraTypes[0] == EXTRASAMPLE_ASSOCALPHA);
+        }
+    t->dstBytes = t->alpha ? 4 : 3;
+
+    /* Work out if we can decode the image a strip or tile at a time */
+    t->kind = TIFF_FALLBACK;
+    if ((planar == PLANARCONFIG_CONTIG || spp == 1) && orientation == ORIENTATION_TOPLEFT) {
+        if (photometric == PHOTOMETRIC_RGB && bps == 8 && spp >= 3)
+            t->kind = TIFF_RGB;
+        else if ((photometric == PHOTOMETRIC_MINISBLACK || photometric == PHOTOMETRIC_MINISWHITE)
+                && (bps == 1 || bps == 2 || bps == 4 || bps == 8) && (spp == 1 || (spp == 2 && bps == 8)))
+            t->kind = TIFF_LUT;
+        else if (photometric == PHOTOMETRIC_PALETTE && spp == 1
+                && (bps == 1 || bps == 2 || bps == 4 || bps == 8))
+            t->kind = TIFF_LUT;
+        }
+    if (t->kind == TIFF_LUT)
+        buildLUT(t,photometric);
+    if (t->kind != TIFF_FALLBACK) {
+        if ((t->tiled = TIFFIsTiled(t->tif)) != 0) {
+            TIFFGetField(t->tif,TIFFTAG_TILEWIDTH,&tileWidth);
+            TIFFGetField(t->tif,TIFFTAG_TILELENGTH,&tileHeight);
+            t->blockWidth = tileWidth;
+            t->blockHeight = tileHeight;
+            }
+        else {
+            TIFFGetFieldDefaulted(t->tif,TIFFTAG_ROWSPERSTRIP,&rows);
+            t->blockWidth = t->width;
+            t->blockHeight = (rows == 0 || rows > height) ? height : rows;
+            }
+        }
+    else {
+        /* Decode the entire image now, and hand it out a row at a time */
+        t->blockWidth = t->width;
+        t->blockHeight = 1;
+        }
+    if (t->width <= 0 || t->height <= 0 || t->blockWidth <= 0 || t->blockHeight <= 0) {
+        TIFFClose(t->tif);
+        __MGL_fclose(t->f);
+        __MGL_result = grInvalidBitmap;
+        return false;
+        }
+    t->numBlockRows = (t->height + t->blockHeight - 1) / t->blockHeight;
+    return true;
+}
+
+/****************************************************************************
+PARAMETERS:
+t   - TIFF image to read the fallback raster for
+
+RETURNS:
+True on success, false on error.
+
+REMARKS:
+Decodes the entire image with TIFFReadRGBAImage for images that cannot be
+decoded a strip or tile at a time.
+****************************************************************************/
+static ibool readRaster(
+    tiffImage *t)
+{
+    if ((t->raster = PM_malloc((long)t->width * t->height * sizeof(uint32))) == NULL) {
+        FATALERROR(grNoMem);
+        return false;
+        }
+    if (!TIFFReadRGBAImage(t->tif,t->width,t->height,t->raster,0)) {
+        __MGL_result = grInvalidBitmap;
+        return false;
+        }
+    return true;
+}
+
+/****************************************************************************
+PARAMETERS:
+t   - TIFF image to close
+****************************************************************************/
+static void closeImage(
+    tiffImage *t)
+{
+    PM_free(t->raster);
+    TIFFClose(t->tif);
+    __MGL_fclose(t->f);
+}
+
+/****************************************************************************
+PARAMETERS:
+d       - Row of 32-bit ARGB pixels to convert
+count   - Number of pixels to convert
+
+REMARKS:
+Converts a row of premultiplied alpha pixels to regular alpha in place.
+****************************************************************************/
+static void unpremultiplyRow(
+    uchar *d,
+    int count)
+{
+    int     i,v,a;
+
+    for (i = 0; i < count; i++, d += 4) {
+        if ((a = d[3]) != 0 && a != 255) {
+            v = (d[0] * 255 + a/2) / a;     d[0] = (uchar)MIN(v,255);
+            v = (d[1] * 255 + a/2) / a;     d[1] = (uchar)MIN(v,255);
+            v = (d[2] * 255 + a/2) / a;     d[2] = (uchar)MIN(v,255);
+            }
+        }
+}
+
+/****************************************************************************
+PARAMETERS:
+t       - TIFF image being decoded
+s       - Decoded TIFF samples for the row
+d       - Destination for the converted pixels
+count   - Number of pixels to convert
+
+REMARKS:
+Converts a run of decoded TIFF samples to 24-bit RGB or 32-bit ARGB pixels.
+Premultiplied alpha is converted to regular alpha since that is what the
+MGL expects.
+****************************************************************************/
+static void convertRow(
+    tiffImage *t,
+    uchar *s,
+    uchar *d,
+    int count)
+{
+    M_uint32    c;
+    int         i,bit,shift,mask;
+
+    if (t->kind == TIFF_RGB) {
+        for (i = 0; i < count; i++, s += t->spp, d += t->dstBytes) {
+            d[0] = s[2];
+            d[1] = s[1];
+            d[2] = s[0];
+            if (t->alpha)
+                d[3] = s[3];
+            }
+        }
+    else if (t->bps == 8) {
+        for (i = 0; i < count; i++, s += t->spp, d += t->dstBytes) {
+            c = t->lut[s[0]];
+            d[0] = (uchar)c;
+            d[1] = (uchar)(c >> 8);
+            d[2] = (uchar)(c >> 16);
+            if (t->alpha)
+                d[3] = s[1];
+            }
+        }
+    else {
+        mask = (1 << t->bps) - 1;
+        for (i = 0, bit = 0; i < count; i++, bit += t->bps, d += t->dstBytes) {
+            shift = 8 - t->bps - (bit & 7);
+            c = t->lut[(s[bit >> 3] >> shift) & mask];
+            d[0] = (uchar)c;
+            d[1] = (uchar)(c >> 8);
+            d[2] = (uchar)(c >> 16);
+            }
+        }
+    if (t->assocAlpha)
+        unpremultiplyRow(d - count * 4,count);
+}
+
+/****************************************************************************
+PARAMETERS:
+ctx     - TIFF image being decoded
+top     - First strip or row of tiles to decode
+bottom  - Last strip or row of tiles to decode (exclusive)
+
+REMARKS:
+Decodes a range of strips or rows of tiles into the destination buffer.
+The TIFF library handles are not thread safe, so bands running on the
+worker threads open their own handle on the file, while the band on the
+calling thread uses the main handle.
+****************************************************************************/
+static void decodeBand(
+    void *ctx,
+    int top,
+    int bottom)
+{
+    tiffImage   *t = (tiffImage*)ctx;
+    TIFF        *tif = t->tif;
+    FILE        *f = NULL;
+    uchar       *buf,*d;
+    tsize_t     rowSize;
+    int         block,x,y,row,rows,count;
+
+    if (top != t->firstBlock) {
+        if ((f = _MGL_openFile(MGL_BITMAPS,t->name,"rb")) == NULL) {
+            t->failed = true;
+            return;
+            }
+        if ((tif = openTIFF(f,t->name,"r")) == NULL) {
+            __MGL_fclose(f);
+            t->failed = true;
+            return;
+            }
+        }
+    rowSize = t->tiled ? TIFFTileRowSize(tif) : TIFFScanlineSize(tif);
+    if ((buf = PM_malloc(t->tiled ? TIFFTileSize(tif) : TIFFStripSize(tif))) == NULL) {
+        t->failed = true;
+        }
+    else {
+        for (block = top; block < bottom && !t->failed; block++) {
+            y = block * t->blockHeight;
+            rows = MIN(t->blockHeight,t->height - y);
+            d = t->dst + (long)(block - t->firstBlock) * t->blockHeight * t->dstPitch;
+            for (x = 0; x < t->width; x += t->blockWidth) {
+                if (t->tiled) {
+                    if (TIFFReadEncodedTile(tif,TIFFComputeTile(tif,x,y,0,0),buf,(tsize_t)-1) < 0) {
+                        t->failed = true;
+                        break;
+                        }
+                    }
+                else if (TIFFReadEncodedStrip(tif,block,buf,(tsize_t)-1) < 0) {
+                    t->failed = true;
+                    break;
+                    }
+                count = MIN(t->blockWidth,t->width - x);
+                for (row = 0; row < rows; row++)
+                    convertRow(t,buf + row * rowSize,d + (long)row * t->dstPitch + x * t->dstBytes,count);
+                }
+            }
+        PM_free(buf);
+        }
+    if (f) {
+        TIFFClose(tif);
+        __MGL_fclose(f);
+        }
+}
+
+/****************************************************************************
+PARAMETERS:
+t           - TIFF image being decoded
+first       - First strip or row of tiles to decode
+last        - Last strip or row of tiles to decode (exclusive)
+dst         - Destination buffer for the decoded rows
+dstPitch    - Bytes per line for the destination buffer
+
+RETURNS:
+True on success, false on error.
+
+REMARKS:
+Decodes a range of strips or rows of tiles into a 24-bit RGB or 32-bit ARGB
+buffer. Large ranges are split across the band worker threads.
+****************************************************************************/
+static ibool decodeRows(
+    tiffImage *t,
+    int first,
+    int last,
+    uchar *dst,
+    int dstPitch)
+{
+    uint32  *s;
+    int     y;
+
+    t->dst = dst;
+    t->dstPitch = dstPitch;
+    t->firstBlock = first;
+    if (t->kind == TIFF_FALLBACK) {
+        /* The raster is stored bottom up in ABGR format, and is always
+         * premultiplied since TIFFReadRGBAImage premultiplies unassociated
+         * alpha as well.
+         */
+        for (y = first; y < last; y++, dst += dstPitch) {
+            uchar   *d = dst;
+            int     x;
+
+            s = t->raster + (long)(t->height - 1 - y) * t->width;
+            for (x = 0; x < t->width; x++, s++, d += t->dstBytes) {
+                d[0] = (uchar)TIFFGetB(*s);
+                d[1] = (uchar)TIFFGetG(*s);
+                d[2] = (uchar)TIFFGetR(*s);
+                if (t->alpha)
+                    d[3] = (uchar)TIFFGetA(*s);
+                }
+            if (t->alpha)
+                unpremultiplyRow(dst,t->width);
+            }
+        return true;
+        }
+    t->failed = false;
+    if (_MGL_useBandThreads((long)t->width * (last - first) * t->blockHeight))
+        _MGL_runBands(first,last,decodeBand,t);
+    else
+        decodeBand(t,first,last);
+    if (t->failed) {
+        __MGL_result = grInvalidBitmap;
+        return false;
+        }
+    return true;
+}
+
+/****************************************************************************
+DESCRIPTION:
+Obtain the dimensions of a TIFF file from disk.
+
+HEADER:
+mgraph.h
+
+PARAMETERS:
+TIFFName        - Name of the bitmap file to load header for
+width           - Place to store the bitmap width
+height          - Place to store the bitmap height
+bitsPerPixel    - Place to store the bitmap pixel depth
+pf              - Place to store the bitmap pixel format information
+
+RETURNS:
+True if the TIFF file was found, false if not.
+
+REMARKS:
+This functions loads all the header information for a TIFF file from disk,
+without actually loading the bits for the bitmap surface. This is useful to
+determine the dimensions and pixel format for the bitmap before it is loaded,
+so you can create an appropriate memory device context that you can load the
+bitmap into with the MGL_loadTIFFIntoDC function.
+
+TIFF files are always loaded as 24-bit RGB images, or as 32-bit ARGB images
+if the file contains an alpha channel, so this function will always return
+information for one of those two pixel formats.
+
+SEE ALSO:
+MGL_loadTIFF, MGL_loadTIFFIntoDC
+****************************************************************************/
+ibool MGLAPI MGL_getTIFFSize(
+    const char *TIFFName,
+    int *width,
+    int *height,
+    int *bitsPerPixel,
+    pixel_format_t *pf)
+{
+    tiffImage   t;
+
+    __MGL_result = grOK;
+    if (!openImage(&t,TIFFName))
+        return false;
+    *width = t.width;
+    *height = t.height;
+    if (t.alpha) {
+        *bitsPerPixel = 32;
+        *pf = _MGL_pixelFormats[pfARGB32];
+        }
+    else {
+        *bitsPerPixel = 24;
+        *pf = _MGL_pixelFormats[pfRGB24];
+        }
+    closeImage(&t);
+    return true;
+}
+
+/****************************************************************************
+DESCRIPTION:
+Load a TIFF bitmap file from disk.
+
+HEADER:
+mgraph.h
+
+PARAMETERS:
+TIFFName    - Name of TIFF file to load
+
+RETURNS:
+Pointer to the loaded TIFF file, NULL on error.
+
+REMARKS:
+Locates the specified TIFF file and loads it into a lightweight bitmap
+structure. TIFF files are always decoded as 24-bit RGB bitmaps, or as 32-bit
+ARGB bitmaps if the file contains an alpha channel, regardless of the number
+of bits per sample or the color space of the file. If you wish to load the
+bitmap as a different color depth or pixel format use the
+MGL_loadTIFFIntoDC function.
+
+Strip and tile organised files with 8-bit RGB samples, or 1 to 8-bit
+grayscale or palette samples, are decoded directly a strip or tile at a
+time. If multi-threaded blitting has been enabled with MGL_setBltThreads,
+large files of this type are decoded in parallel, with each thread
+decoding its own range of strips or rows of tiles. All other files are
+decoded on the calling thread.
+
+When MGL is searching for TIFF files it will first attempt to find the files
+just by using the filename itself. Hence if you wish to look for a specific
+TIFF file, you should pass the full pathname to the file that you are
+interested in. If the filename is a simple relative filename (i.e.
+"MYBMP.TIF"), MGL will then search in the BITMAPS directory relative to the
+path specified in mglpath variable that was passed to MGL_init. As a final
+resort MGL will also look for the files in the BITMAPS directory relative
+to the MGL_ROOT environment variable.
+
+If the TIFF file was not found, or an error occurred while reading the TIFF
+file, this function will return NULL. You can check the MGL_result error
+code to determine the cause.
+
+SEE ALSO:
+MGL_unloadBitmap, MGL_getTIFFSize, MGL_loadTIFFIntoDC, MGL_saveTIFFFromDC,
+MGL_putBitmap, MGL_setBltThreads
+****************************************************************************/
+bitmap_t * MGLAPI MGL_loadTIFF(
+    const char *TIFFName)
+{
+    bitmap_t    *bitmap;
+    tiffImage   t;
+    ulong       size;
+
+    __MGL_result = grOK;
+    if (!openImage(&t,TIFFName))
+        return NULL;
+    if (t.kind == TIFF_FALLBACK && !readRaster(&t)) {
+        closeImage(&t);
+        return NULL;
+        }
+
+    /* Allocate memory for the bitmap */
+    size = sizeof(bitmap_t) + sizeof(pixel_format_t)
+         + (ulong)t.width * t.dstBytes * t.height;
+    if ((bitmap = PM_malloc(size)) == NULL) {
+        closeImage(&t);
+        FATALERROR(grNoMem);
+        return NULL;
+        }
+    size = sizeof(bitmap_t);
+    bitmap->width = t.width;
+    bitmap->height = t.height;
+    bitmap->bitsPerPixel = t.dstBytes * 8;
+    bitmap->bytesPerLine = t.width * t.dstBytes;
+    bitmap->pal = NULL;
+    bitmap->pf = (pixel_format_t*)((uchar*)bitmap + size);
+    memcpy(bitmap->pf,&_MGL_pixelFormats[t.alpha ? pfARGB32 : pfRGB24],sizeof(pixel_format_t));
+    size += sizeof(pixel_format_t);
+    bitmap->surface = (uchar*)bitmap + size;
+
+    /* Decode the entire image directly into the bitmap surface */
+    if (!decodeRows(&t,0,t.numBlockRows,bitmap->surface,bitmap->bytesPerLine)) {
+        PM_free(bitmap);
+        closeImage(&t);
+        return NULL;
+        }
+    closeImage(&t);
+    return bitmap;
+}
+
+/****************************************************************************
+DESCRIPTION:
+Loads a TIFF file directly into an existing device context.
+
+HEADER:
+mgraph.h
+
+PARAMETERS:
+dc          - Device context to load bitmap into
+TIFFName    - Name of TIFF file to load
+dstLeft     - Left coordinate to load TIFF at
+dstTop      - Top coordinate to load TIFF at
+
+RETURNS:
+True if the TIFF file was loaded, false on error.
+
+REMARKS:
+Locates the specified TIFF file and loads it into the specified device
+context at the specified destination coordinates. If the TIFF is of a
+different pixel depth than the device context that it is being loaded into,
+the TIFF will be converted as it is loaded to the pixel format of the device
+context it is being loaded into, and will be dithered if the device context
+is 8-bits per pixel.
+
+The image is decoded in groups of strips or rows of tiles, so very large
+files can be loaded without holding the entire decoded image in memory.
+Each group is decoded in parallel if multi-threaded blitting has been
+enabled with MGL_setBltThreads (see MGL_loadTIFF).
+
+When MGL is searching for bitmap files it will first attempt to find the files just by
+using the filename itself. Hence if you wish to look for a specific bitmap file, you
+should pass the full pathname to the file that you are interested in. If the filename is
+a simple relative filename (i.e. "MYFILE.TIF"), MGL will then search in the
+BITMAPS directory relative to the path specified in mglpath variable that was
+passed to MGL_init. As a final resort MGL will also look for the files in the
+BITMAPS directory relative to the MGL_ROOT environment variable.
+
+If the bitmap file was not found, or an error occurred while reading the bitmap file,
+this function will return false. You can check the MGL_result error code to
+determine the cause.
+
+SEE ALSO:
+MGL_getTIFFSize, MGL_loadTIFF, MGL_saveTIFFFromDC
+****************************************************************************/
+ibool MGLAPI MGL_loadTIFFIntoDC(
+    MGLDC *dc,
+    const char *TIFFName,
+    int dstLeft,
+    int dstTop)
+{
+    bitmap_t    bmp;
+    tiffImage   t;
+    int         block,blocksPerGroup,last,top;
+    ibool       ret = true;
+
+    __MGL_result = grOK;
+    if (!openImage(&t,TIFFName))
+        return false;
+    if (t.kind == TIFF_FALLBACK && !readRaster(&t)) {
+        closeImage(&t);
+        return false;
+        }
+
+    /* Allocate a temporary bitmap for a group of strips or tiles */
+    blocksPerGroup = (int)(TIFF_GROUP_PIXELS / ((long)t.width * t.blockHeight));
+    blocksPerGroup = MIN(MAX(blocksPerGroup,1),t.numBlockRows);
+    bmp.width = t.width;
+    bmp.height = blocksPerGroup * t.blockHeight;
+    bmp.bitsPerPixel = t.dstBytes * 8;
+    bmp.bytesPerLine = t.width * t.dstBytes;
+    bmp.pal = NULL;
+    bmp.pf = &_MGL_pixelFormats[t.alpha ? pfARGB32 : pfRGB24];
+    if ((bmp.surface = PM_malloc((long)bmp.bytesPerLine * bmp.height)) == NULL) {
+        closeImage(&t);
+        FATALERROR(grNoMem);
+        return false;
+        }
+
+    /* Decode and draw each group of strips or tiles in turn */
+    for (block = 0; block < t.numBlockRows; block += blocksPerGroup) {
+        last = MIN(block + blocksPerGroup,t.numBlockRows);
+        if (!decodeRows(&t,block,last,bmp.surface,bmp.bytesPerLine)) {
+            ret = false;
+            break;
+            }
+        top = block * t.blockHeight;
+        bmp.height = MIN(last * t.blockHeight,t.height) - top;
+        MGL_putBitmap(dc,dstLeft,dstTop + top,&bmp,MGL_REPLACE_MODE);
+        }
+    PM_free(bmp.surface);
+    closeImage(&t);
+    return ret;
+}
+
+/****************************************************************************
+DESCRIPTION:
+Save a portion of a device context to TIFF on disk.
+
+HEADER:
+mgraph.h
+
+PARAMETERS:
+dc          - Device context to save
+TIFFName    - Name of bitmap file to save
+left        - Left coordinate of bitmap to save
+top         - Top coordinate of bitmap to save
+right       - Right coordinate of bitmap to save
+bottom      - Bottom coordinate of bitmap to save
+
+RETURNS:
+True on success, false on error.
+
+REMARKS:
+This function saves a portion of a device context as a 24-bit RGB TIFF
+format bitmap file to disk, compressed with LZW. If this function fails for
+some reason, it will return false and you can get the error code from the
+MGL_result function.
+
+Note that the source rectangle for the bitmap to be saved is not clipped to the
+current clipping rectangle for the device context, but it is mapped to the current
+viewport. If you specify dimensions that are larger than the current device context,
+you will get garbage in the bitmap file as a result.
+
+SEE ALSO:
+MGL_loadTIFF, MGL_loadTIFFIntoDC
+****************************************************************************/
+ibool MGLAPI MGL_saveTIFFFromDC(
+    MGLDC *dc,
+    const char *TIFFName,
+    int left,
+    int top,
+    int right,
+    int bottom)
+{
+    FILE        *f;
+    TIFF        *tif;
+    palette_t   pal[256];
+    MGLDC       *memDC;
+    int         y;
+    ibool       ret = true;
+
+    /* Attempt to open the file for writing */
+    __MGL_result = grOK;
+    if ((f = __MGL_fopen(TIFFName,"wb")) == NULL) {
+        __MGL_result = grBitmapNotFound;
+        return false;
+        }
+
+    /* Allocate a temporary buffer in the correct format for compression */
+    if ((memDC = MGL_createMemoryDC(right-left,1,24,&_MGL_pixelFormats[pfBGR24])) == NULL) {
+        __MGL_fclose(f);
+        __MGL_result = grNoMem;
+        return false;
+        }
+    /* Set palette for 24-bit memory DC the same as input DC */
+    MGL_getPalette(dc,pal,256,0);
+    MGL_setPalette(memDC,pal,256,0);
+    MGL_realizePalette(memDC,256,0,false);
+
+    /* Create the TIFF file and set up the image information */
+    if ((tif = openTIFF(f,TIFFName,"w")) == NULL) {
+        MGL_destroyDC(memDC);
+        __MGL_fclose(f);
+        __MGL_result = grInvalidBitmap;
+        return false;
+        }
+    TIFFSetField(tif,TIFFTAG_IMAGEWIDTH,(uint32)(right-left));
+    TIFFSetField(tif,TIFFTAG_IMAGELENGTH,(uint32)(bottom-top));
+    TIFFSetField(tif,TIFFTAG_BITSPERSAMPLE,8);
+    TIFFSetField(tif,TIFFTAG_SAMPLESPERPIXEL,3);
+    TIFFSetField(tif,TIFFTAG_PHOTOMETRIC,PHOTOMETRIC_RGB);
+    TIFFSetField(tif,TIFFTAG_PLANARCONFIG,PLANARCONFIG_CONTIG);
+    TIFFSetField(tif,TIFFTAG_ORIENTATION,ORIENTATION_TOPLEFT);
+    TIFFSetField(tif,TIFFTAG_COMPRESSION,COMPRESSION_LZW);
+    TIFFSetField(tif,TIFFTAG_ROWSPERSTRIP,TIFFDefaultStripSize(tif,(uint32)-1));
+
+    /* Loop around passing one scanline at a time to the compressor */
+    for (y = top; y < bottom; y++) {
+        MGL_bitBltCoord(memDC,dc,left,y,right,y+1,0,0,MGL_REPLACE_MODE);
+        if (TIFFWriteScanline(tif,memDC->surface,y - top,0) < 0) {
+            ret = false;
+            break;
+            }
+        }
+
+    /* Finish compression and clean up */
+    TIFFClose(tif);
+    __MGL_fclose(f);
+    MGL_destroyDC(memDC);
+    if (!ret)
+        __MGL_result = grInvalidBitmap;
+    return ret;
+}
@@ -256,6 +256,9 @@ void MGLAPI MGL_setViewportDC(
     MGLDC *dc,
     rect_t view)
 {
+    /* Submit any batched commands before the viewport changes */
+    _MGL_flushBatchDC(dc);
+
     /* Set the internal viewport variables */
     dc->viewPort.left       = (view.left += dc->size.left);
     dc->viewPort.top        = (view.top += dc->size.top);
@@ -402,6 +405,9 @@ void  MGLAPI MGL_setViewportOrgDC(
     MGLDC *dc,
     point_t org)
 {
+    /* Submit any batched commands before the viewport changes */
+    _MGL_flushBatchDC(dc);
+
     /* Set the viewport origin */
     dc->viewPortOrg = org;
     MGL_offsetRect(dc->viewPort,-org.x,-org.y);
@@ -676,6 +682,9 @@ static void __MGL_setClipRect(
     MGLDC *dc,
     rect_t clip)
 {
+    /* Submit any batched commands before the clipping changes */
+    _MGL_flushBatchDC(dc);
+
     /* Set the user supplied clipping rectangle */
     dc->clipRectUser = clip;
 
@@ -260,6 +260,8 @@ void MGLAPI MGL_drawStrXY_W(
 {
     if (DC.a.ts.font == NULL) return;
 
+    if (DC.dirtyRegion)
+        _MGL_markTextDirty(x,y,MGL_textWidth_W(str));
     BEGIN_VISIBLE_CLIP_LIST(&DC);
     switch (DC.a.ts.font->fontType & MGL_FONTTYPEMASK) {
         case MGL_FIXEDFONT: